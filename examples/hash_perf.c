@@ -0,0 +1,223 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/hash.h>
+#include <csnip/mem.h>
+#include <csnip/x.h>
+
+/* Hash function throughput comparison.
+ *
+ * Compares FNV-1a 64 and mx64 from hash.h, for buffers and C strings,
+ * across key lengths.  For each length, a set of keys totalling about
+ * 256 KiB, i.e., fitting into the L2 cache, is hashed repeatedly
+ * until about the requested number of bytes has been processed.  The
+ * time per key and the throughput are reported.
+ *
+ * For short keys, separate calls of mx64 are also compared with the
+ * batched functions.
+ */
+
+static double get_delta(struct timespec* b, struct timespec* a)
+{
+	return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec)/1.e9;
+}
+
+/* Sink for hash values, so that the computation is not optimized
+ * away */
+static volatile uint64_t sink;
+
+typedef uint64_t (*buf_hash_fn)(const void*, size_t, uint64_t);
+typedef uint64_t (*str_hash_fn)(const char*, uint64_t);
+
+static uint64_t fnv64_b(const void* buf, size_t sz, uint64_t h0)
+{
+	return hash_fnv64_b(buf, sz, h0 ^ FNV64_INIT);
+}
+
+static uint64_t fnv64_s(const char* str, uint64_t h0)
+{
+	return hash_fnv64_s(str, h0 ^ FNV64_INIT);
+}
+
+static void report(const char* name, size_t len, size_t nhash, double t)
+{
+	printf("%-12s %6zu %10.2f %10.2f\n", name, len,
+		t / (double)nhash * 1e9,
+		(double)nhash * (double)len / t / 1e9);
+}
+
+static void bench_b(const char* name, buf_hash_fn f,
+		const char* keys, size_t nkeys, size_t len, size_t nrep)
+{
+	struct timespec t0, t1;
+	uint64_t h = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (size_t r = 0; r < nrep; ++r) {
+		for (size_t i = 0; i < nkeys; ++i)
+			h += f(&keys[i * (len + 1)], len, r);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	sink = h;
+	report(name, len, nrep * nkeys, get_delta(&t1, &t0));
+}
+
+static void bench_s(const char* name, str_hash_fn f,
+		const char* keys, size_t nkeys, size_t len, size_t nrep)
+{
+	struct timespec t0, t1;
+	uint64_t h = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (size_t r = 0; r < nrep; ++r) {
+		for (size_t i = 0; i < nkeys; ++i)
+			h += f(&keys[i * (len + 1)], r);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	sink = h;
+	report(name, len, nrep * nkeys, get_delta(&t1, &t0));
+}
+
+static void bench_many(const char* name,
+		const char* keys, size_t nkeys, size_t len, size_t nrep)
+{
+	const void** kp;
+	size_t* lens;
+	uint64_t* out;
+	mem_Alloc(nkeys, kp, _);
+	mem_Alloc(nkeys, lens, _);
+	mem_Alloc(nkeys, out, _);
+	for (size_t i = 0; i < nkeys; ++i) {
+		kp[i] = &keys[i * (len + 1)];
+		lens[i] = len;
+	}
+
+	struct timespec t0, t1;
+	uint64_t h = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (size_t r = 0; r < nrep; ++r) {
+		hash_mx64_many(kp, lens, nkeys, r, out);
+		h += out[r % nkeys];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	sink = h;
+	report(name, len, nrep * nkeys, get_delta(&t1, &t0));
+
+	mem_Free(kp);
+	mem_Free(lens);
+	mem_Free(out);
+}
+
+static void bench_u64(const uint64_t* keys, size_t nkeys, size_t nrep)
+{
+	uint64_t* out;
+	mem_Alloc(nkeys, out, _);
+	struct timespec t0, t1;
+	uint64_t h = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (size_t r = 0; r < nrep; ++r) {
+		for (size_t i = 0; i < nkeys; ++i)
+			out[i] = hash_mx64_b(&keys[i], 8, r);
+		h += out[r % nkeys];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	report("mx64_b", 8, nrep * nkeys, get_delta(&t1, &t0));
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (size_t r = 0; r < nrep; ++r) {
+		hash_mx64_u64_many(keys, nkeys, r, out);
+		h += out[r % nkeys];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	report("mx64_u64", 8, nrep * nkeys, get_delta(&t1, &t0));
+
+	sink = h;
+	mem_Free(out);
+}
+
+static void usage(void)
+{
+	printf(
+	"Usage: hash_perf [-h] [-M #]\n"
+	"Compare hash function throughput across key lengths.\n"
+	"\n"
+	"-h             Display help and exit.\n"
+	"-M #           MiB hashed per function and length (default 256).\n"
+	);
+}
+
+int main(int argc, char** argv)
+{
+	static const size_t lens[] = {
+		4, 8, 16, 24, 32, 48, 64, 100, 256, 1024, 4096
+	};
+	int M = 256;
+	int c;
+	while ((c = x_getopt(argc, argv, "hM:")) != -1) {
+		switch (c) {
+		case 'h':	usage();			return 0;
+		case 'M':	M = atoi(x_optarg);		break;
+		default:	usage();			return 1;
+		}
+	}
+	if (M < 1) {
+		fprintf(stderr, "Error:  Invalid parameters.\n");
+		return 1;
+	}
+
+	const size_t kbytes = 256 * 1024;
+	char* keys;
+	mem_Alloc(kbytes + 4097, keys, _);
+	srand(1);
+	for (size_t i = 0; i < kbytes + 4097; ++i)
+		keys[i] = (char)('a' + rand() % 26);
+
+	printf("%-12s %6s %10s %10s\n", "function", "length",
+		"ns/key", "GB/s");
+	for (size_t j = 0; j < sizeof(lens) / sizeof(lens[0]); ++j) {
+		const size_t len = lens[j];
+		size_t nkeys = kbytes / (len + 1);
+		if (nkeys == 0)
+			nkeys = 1;
+		for (size_t i = 0; i < nkeys; ++i)
+			keys[i * (len + 1) + len] = '\0';
+		size_t nrep = (size_t)M * 1024 * 1024 / (nkeys * len);
+		if (nrep == 0)
+			nrep = 1;
+
+		bench_b("fnv64_b", fnv64_b, keys, nkeys, len, nrep);
+		bench_b("mx64_b", hash_mx64_b, keys, nkeys, len, nrep);
+		bench_s("fnv64_s", fnv64_s, keys, nkeys, len, nrep);
+		bench_s("mx64_s", hash_mx64_s, keys, nkeys, len, nrep);
+
+		for (size_t i = 0; i < nkeys; ++i)
+			keys[i * (len + 1) + len] = (char)('a' + rand() % 26);
+	}
+
+	/* Batched hashing of short keys */
+	printf("\n%-12s %6s %10s %10s\n", "batched", "length",
+		"ns/key", "GB/s");
+	for (size_t len = 8; len <= 64; len *= 2) {
+		const size_t nkeys = 4096;
+		size_t nrep = (size_t)M * 1024 * 1024 / (nkeys * len);
+		if (nrep == 0)
+			nrep = 1;
+		bench_b("mx64_b", hash_mx64_b, keys, nkeys, len, nrep);
+		bench_many("mx64_many", keys, nkeys, len, nrep);
+	}
+	{
+		const size_t nkeys = 4096;
+		uint64_t* k64;
+		mem_Alloc(nkeys, k64, _);
+		for (size_t i = 0; i < nkeys; ++i)
+			k64[i] = (uint64_t)rand() << 32 ^ (uint64_t)rand();
+		bench_u64(k64, nkeys, (size_t)M * 1024 * 1024 / (nkeys * 8) + 1);
+		mem_Free(k64);
+	}
+
+	mem_Free(keys);
+	return 0;
+}
@@ -0,0 +1,201 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/cext.h>
+#include <csnip/lphash_cctable.h>
+#include <csnip/lphash_table.h>
+#include <csnip/mem.h>
+#include <csnip/x.h>
+
+/* Multithreaded hash table throughput.
+ *
+ * Compares the concurrent hash table from lphash_cctable.h with an
+ * lphash_table protected by a single reader-writer lock.  The table
+ * is filled with N keys, and then each thread performs a mix of
+ * lookups and updates (insert_or_assign of an existing key) on random
+ * keys.  The number of threads is doubled from 1 up to the given
+ * maximum, and the total throughput is reported.
+ */
+
+static double get_delta(struct timespec* b, struct timespec* a)
+{
+	return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec)/1.e9;
+}
+
+static uint64_t u64hash(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+typedef struct {
+	uint64_t key;
+	uint64_t val;
+} u64entry;
+
+/* Concurrent table */
+CSNIP_LPHASH_CCTABLE_DEF_TYPE(cctbl, u64entry)
+CSNIP_LPHASH_CCTABLE_DEF_FUNCS(cext_unused static, cctbl_,
+	uint64_t, u64entry, struct cctbl,
+	k1, k2, e, u64hash(k1), k1 == k2, e.key)
+
+/* Table with reader-writer lock */
+CSNIP_LPHASH_TABLE_DEF_TYPE(lptbl, u64entry)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(cext_unused static, lptbl_,
+	uint64_t, u64entry, struct lptbl,
+	k1, k2, e, u64hash(k1), k1 == k2, e.key)
+
+struct rwtbl {
+	pthread_rwlock_t lock;
+	struct lptbl* T;
+};
+
+static _Bool rwtbl_find(struct rwtbl* R, uint64_t key, u64entry* ret)
+{
+	pthread_rwlock_rdlock(&R->lock);
+	u64entry* E = lptbl_find(R->T, key);
+	if (E) *ret = *E;
+	pthread_rwlock_unlock(&R->lock);
+	return E != NULL;
+}
+
+static void rwtbl_insert_or_assign(struct rwtbl* R, u64entry E)
+{
+	pthread_rwlock_wrlock(&R->lock);
+	lptbl_insert_or_assign(R->T, NULL, E, NULL);
+	pthread_rwlock_unlock(&R->lock);
+}
+
+/* Benchmark driver */
+
+static int N = 1000000;
+static long nops = 1000000;
+static int read_pct = 90;
+
+struct thread_arg {
+	void* tbl;
+	unsigned int seed;
+	size_t nfound;
+};
+
+#define DEF_WORKER(name, find_expr, update_expr) \
+	static void* name(void* arg_) \
+	{ \
+		struct thread_arg* arg = arg_; \
+		unsigned int seed = arg->seed; \
+		size_t nfound = 0; \
+		for (long i = 0; i < nops; ++i) { \
+			const unsigned int r = (unsigned int)rand_r(&seed); \
+			const uint64_t key = (uint64_t)(r >> 7) % N; \
+			u64entry E; \
+			if ((int)(r & 127) * 100 < read_pct * 128) { \
+				nfound += (find_expr); \
+			} else { \
+				E = (u64entry){ key, r }; \
+				update_expr; \
+			} \
+		} \
+		arg->nfound = nfound; \
+		return NULL; \
+	}
+
+DEF_WORKER(cc_worker,
+	cctbl_find(arg->tbl, key, &E),
+	cctbl_insert_or_assign(arg->tbl, NULL, E, NULL))
+DEF_WORKER(rw_worker,
+	rwtbl_find(arg->tbl, key, &E),
+	rwtbl_insert_or_assign(arg->tbl, E))
+
+static void run(const char* desc, void* tbl, void* (*worker)(void*),
+		int nthreads)
+{
+	pthread_t* thr;
+	struct thread_arg* args;
+	mem_Alloc(nthreads, thr, _);
+	mem_Alloc(nthreads, args, _);
+
+	struct timespec t0, t1;
+	x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t0);
+	for (int i = 0; i < nthreads; ++i) {
+		args[i] = (struct thread_arg){ tbl, (unsigned int)i + 1, 0 };
+		if (pthread_create(&thr[i], NULL, worker, &args[i]) != 0) {
+			fprintf(stderr, "Error:  Could not create thread.\n");
+			exit(1);
+		}
+	}
+	for (int i = 0; i < nthreads; ++i)
+		pthread_join(thr[i], NULL);
+	x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t1);
+
+	printf("%-22s %3d threads  %8.2f Mops/s\n", desc, nthreads,
+		nthreads * (double)nops / get_delta(&t1, &t0) / 1e6);
+	mem_Free(thr);
+	mem_Free(args);
+}
+
+static void usage(void)
+{
+	puts(
+	"Multithreaded hash table throughput.\n"
+	"\n"
+	"-h             Display help and exit.\n"
+	"-N #           Number of keys (default 1000000).\n"
+	"-n #           Number of operations per thread (default 1000000).\n"
+	"-r #           Percentage of lookups (default 90).\n"
+	"-t #           Maximum number of threads (default 32).\n"
+	);
+}
+
+int main(int argc, char** argv)
+{
+	int maxthreads = 32;
+	int c;
+	while ((c = x_getopt(argc, argv, "hN:n:r:t:")) != -1) {
+		switch (c) {
+		case 'h':	usage();			return 0;
+		case 'N':	N = atoi(x_optarg);		break;
+		case 'n':	nops = atol(x_optarg);		break;
+		case 'r':	read_pct = atoi(x_optarg);	break;
+		case 't':	maxthreads = atoi(x_optarg);	break;
+		default:	usage();			return 1;
+		}
+	}
+	if (N < 1 || nops < 1 || read_pct < 0 || read_pct > 100
+	  || maxthreads < 1)
+	{
+		fprintf(stderr, "Error:  Invalid parameters.\n");
+		return 1;
+	}
+
+	/* Fill the tables */
+	struct cctbl* C = cctbl_make(NULL);
+	struct rwtbl R;
+	pthread_rwlock_init(&R.lock, NULL);
+	R.T = lptbl_make(NULL);
+	for (int i = 0; i < N; ++i) {
+		u64entry E = { (uint64_t)i, 0 };
+		cctbl_insert(C, NULL, E);
+		lptbl_insert(R.T, NULL, E);
+	}
+
+	printf("N = %d keys, %ld operations per thread, %d%% lookups\n",
+		N, nops, read_pct);
+	for (int t = 1; t <= maxthreads; t *= 2)
+		run("lphash_cctable", C, cc_worker, t);
+	for (int t = 1; t <= maxthreads; t *= 2)
+		run("lphash_table+rwlock", &R, rw_worker, t);
+
+	cctbl_free(C);
+	lptbl_free(R.T);
+	pthread_rwlock_destroy(&R.lock);
+	return 0;
+}
@@ -0,0 +1,300 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/cext.h>
+#include <csnip/hash.h>
+#include <csnip/lphash_table.h>
+#include <csnip/lphash_cuckootable.h>
+#include <csnip/lphash_irtable.h>
+#include <csnip/lphash_rhtable.h>
+#include <csnip/lphash_soatable.h>
+#include <csnip/lphash_swtable.h>
+#include <csnip/mem.h>
+#include <csnip/x.h>
+
+/* Hash table performance comparison.
+ *
+ * Compares the hash table implementations from lphash_table.h,
+ * lphash_rhtable.h, lphash_swtable.h and lphash_irtable.h on integer
+ * and string keys.  For each, N keys are inserted, then looked up,
+ * and then N keys not in the table are looked up.  Finally, the
+ * inserted keys are looked up again in batches with find_many().
+ * The insertions are
+ * timed in batches, and the slowest batch is reported as well, to
+ * show the pauses caused by rehashing.
+ *
+ * Finally, maps from integer keys to large values are compared in
+ * lphash_table, with key and value in one entry, and in
+ * lphash_soatable, with keys and values in separate arrays.
+ */
+
+static double get_delta(struct timespec* b, struct timespec* a)
+{
+	return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec)/1.e9;
+}
+
+static uint64_t u64hash(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+/* Integer keyed tables */
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(u64lp, uint64_t)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(cext_unused static, u64lp_,
+	uint64_t, uint64_t, struct u64lp,
+	k1, k2, e, u64hash(k1), k1 == k2, e)
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(u64rh, uint64_t)
+CSNIP_LPHASH_RHTABLE_DEF_FUNCS(cext_unused static, u64rh_,
+	uint64_t, uint64_t, struct u64rh,
+	k1, k2, e, u64hash(k1), k1 == k2, e)
+
+CSNIP_LPHASH_SWTABLE_DEF_TYPE(u64sw, uint64_t)
+CSNIP_LPHASH_SWTABLE_DEF_FUNCS(cext_unused static, u64sw_,
+	uint64_t, uint64_t, struct u64sw,
+	k1, k2, e, u64hash(k1), k1 == k2, e)
+
+CSNIP_LPHASH_IRTABLE_DEF_TYPE(u64ir, uint64_t)
+CSNIP_LPHASH_IRTABLE_DEF_FUNCS(cext_unused static, u64ir_,
+	uint64_t, uint64_t, struct u64ir,
+	k1, k2, e, u64hash(k1), k1 == k2, e)
+
+CSNIP_LPHASH_CUCKOOTABLE_DEF_TYPE(u64ck, uint64_t)
+CSNIP_LPHASH_CUCKOOTABLE_DEF_FUNCS(cext_unused static, u64ck_,
+	uint64_t, uint64_t, struct u64ck,
+	k1, k2, e, u64hash(k1), k1 == k2, e)
+
+/* String keyed tables */
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(strlp, const char*)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(cext_unused static, strlp_,
+	const char*, const char*, struct strlp,
+	k1, k2, e, hash_fnv64_s(k1, FNV64_INIT), strcmp(k1, k2) == 0, e)
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(strrh, const char*)
+CSNIP_LPHASH_RHTABLE_DEF_FUNCS(cext_unused static, strrh_,
+	const char*, const char*, struct strrh,
+	k1, k2, e, hash_fnv64_s(k1, FNV64_INIT), strcmp(k1, k2) == 0, e)
+
+CSNIP_LPHASH_SWTABLE_DEF_TYPE(strsw, const char*)
+CSNIP_LPHASH_SWTABLE_DEF_FUNCS(cext_unused static, strsw_,
+	const char*, const char*, struct strsw,
+	k1, k2, e, hash_fnv64_s(k1, FNV64_INIT), strcmp(k1, k2) == 0, e)
+
+CSNIP_LPHASH_CUCKOOTABLE_DEF_TYPE(strck, const char*)
+CSNIP_LPHASH_CUCKOOTABLE_DEF_FUNCS(cext_unused static, strck_,
+	const char*, const char*, struct strck,
+	k1, k2, e, hash_fnv64_s(k1, FNV64_INIT), strcmp(k1, k2) == 0, e)
+
+/* Integer keys with large values */
+
+typedef struct {
+	uint64_t a[12];
+} bigval;
+
+typedef struct {
+	uint64_t key;
+	bigval val;
+} bigentry;
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(biglp, bigentry)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(cext_unused static, biglp_,
+	uint64_t, bigentry, struct biglp,
+	k1, k2, e, u64hash(k1), k1 == k2, e.key)
+
+CSNIP_LPHASH_SOATABLE_DEF_TYPE(bigsoa, uint64_t, bigval)
+CSNIP_LPHASH_SOATABLE_DEF_FUNCS(cext_unused static, bigsoa_,
+	uint64_t, bigval, struct bigsoa,
+	k1, k2, u64hash(k1), k1 == k2)
+
+/* Benchmark driver.
+ *
+ * keys[0..N) are inserted, keys[N..2N) are used for unsuccessful
+ * lookups.
+ */
+#define BATCH 1024
+
+#define DEF_BENCH(name, prefix, tbltype, keytype) \
+	static void name(const char* desc, int N, keytype* keys) \
+	{ \
+		struct timespec t0, t1, t2, t3, t4, tb0, tb1; \
+		keytype* out[BATCH]; \
+		size_t nfound = 0; \
+		double worst = 0.0; \
+		tbltype* T = prefix##make(NULL); \
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t0); \
+		tb0 = t0; \
+		for (int i = 0; i < N; ++i) { \
+			prefix##insert(T, NULL, keys[i]); \
+			if (i % BATCH == BATCH - 1) { \
+				x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, \
+					&tb1); \
+				if (get_delta(&tb1, &tb0) > worst) \
+					worst = get_delta(&tb1, &tb0); \
+				tb0 = tb1; \
+			} \
+		} \
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t1); \
+		for (int i = 0; i < N; ++i) \
+			nfound += (prefix##find(T, keys[i]) != NULL); \
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t2); \
+		for (int i = N; i < 2 * N; ++i) \
+			nfound += (prefix##find(T, keys[i]) != NULL); \
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t3); \
+		for (int i = 0; i < N; i += BATCH) { \
+			const int m = (N - i < BATCH ? N - i : BATCH); \
+			nfound += prefix##find_many(T, &keys[i], m, out); \
+		} \
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t4); \
+		if (nfound != 2 * (size_t)N) { \
+			fprintf(stderr, "Error:  Unexpected number of " \
+			  "keys found: %zu\n", nfound); \
+			exit(1); \
+		} \
+		printf("%-25s insert %6.1f ns  hit %6.1f ns  " \
+			"miss %6.1f ns  hit (batched) %6.1f ns  " \
+			"worst batch %8.1f us  (load %.3f)\n", \
+			desc, \
+			get_delta(&t1, &t0) * 1e9 / N, \
+			get_delta(&t2, &t1) * 1e9 / N, \
+			get_delta(&t3, &t2) * 1e9 / N, \
+			get_delta(&t4, &t3) * 1e9 / N, \
+			worst * 1e6, \
+			prefix##size(T) / (double)prefix##capacity(T)); \
+		prefix##free(T); \
+	}
+
+DEF_BENCH(bench_u64lp, u64lp_, struct u64lp, uint64_t)
+DEF_BENCH(bench_u64rh, u64rh_, struct u64rh, uint64_t)
+DEF_BENCH(bench_u64sw, u64sw_, struct u64sw, uint64_t)
+DEF_BENCH(bench_u64ir, u64ir_, struct u64ir, uint64_t)
+DEF_BENCH(bench_u64ck, u64ck_, struct u64ck, uint64_t)
+DEF_BENCH(bench_strlp, strlp_, struct strlp, const char*)
+DEF_BENCH(bench_strrh, strrh_, struct strrh, const char*)
+DEF_BENCH(bench_strsw, strsw_, struct strsw, const char*)
+DEF_BENCH(bench_strck, strck_, struct strck, const char*)
+
+/* Benchmark driver for large values. */
+#define DEF_BIGBENCH(name, prefix, tbltype, insert_expr, val_expr) \
+	static void name(const char* desc, int N, uint64_t* keys) \
+	{ \
+		struct timespec t0, t1, t2, t3; \
+		size_t nfound = 0; \
+		uint64_t sum = 0; \
+		tbltype* T = prefix##make(NULL); \
+		bigval v = { { 0 } }; \
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t0); \
+		for (int i = 0; i < N; ++i) { \
+			const uint64_t key = keys[i]; \
+			v.a[0] = key; \
+			insert_expr; \
+		} \
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t1); \
+		for (int i = 0; i < N; ++i) { \
+			const void* p = prefix##find(T, keys[i]); \
+			if (p) { \
+				++nfound; \
+				sum += (val_expr).a[0]; \
+			} \
+		} \
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t2); \
+		for (int i = N; i < 2 * N; ++i) \
+			nfound += (prefix##find(T, keys[i]) != NULL); \
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t3); \
+		if (nfound != (size_t)N || sum == 0) { \
+			fprintf(stderr, "Error:  Unexpected number of " \
+			  "keys found: %zu\n", nfound); \
+			exit(1); \
+		} \
+		printf("%-25s insert %6.1f ns  hit %6.1f ns  " \
+			"miss %6.1f ns\n", \
+			desc, \
+			get_delta(&t1, &t0) * 1e9 / N, \
+			get_delta(&t2, &t1) * 1e9 / N, \
+			get_delta(&t3, &t2) * 1e9 / N); \
+		prefix##free(T); \
+	}
+
+DEF_BIGBENCH(bench_biglp, biglp_, struct biglp,
+	biglp_insert(T, NULL, (bigentry){ key, v }),
+	((const bigentry*)p)->val)
+DEF_BIGBENCH(bench_bigsoa, bigsoa_, struct bigsoa,
+	bigsoa_insert(T, NULL, key, v),
+	*(const bigval*)p)
+
+static void usage(void)
+{
+	puts(
+	"Hash table performance comparison.\n"
+	"\n"
+	"-h             Display help and exit.\n"
+	"-N #           Number of keys (default 1000000).\n"
+	"-l #           Length of string keys (default 24).\n"
+	);
+}
+
+int main(int argc, char** argv)
+{
+	int N = 1000000, len = 24;
+	int c;
+	while ((c = x_getopt(argc, argv, "hN:l:")) != -1) {
+		switch (c) {
+		case 'h':	usage();			return 0;
+		case 'N':	N = atoi(x_optarg);		break;
+		case 'l':	len = atoi(x_optarg);		break;
+		default:	usage();			return 1;
+		}
+	}
+	if (N < 1 || len < 12) {
+		fprintf(stderr, "Error:  Invalid parameters.\n");
+		return 1;
+	}
+
+	/* Create keys */
+	uint64_t* ikeys;
+	const char** skeys;
+	char* sbuf;
+	mem_Alloc(2 * (size_t)N, ikeys, _);
+	mem_Alloc(2 * (size_t)N, skeys, _);
+	mem_Alloc(2 * (size_t)N * (len + 1), sbuf, _);
+	for (int i = 0; i < 2 * N; ++i) {
+		ikeys[i] = u64hash((uint64_t)i + 1);
+		char* s = &sbuf[(size_t)i * (len + 1)];
+		memset(s, 'x', len);
+		s[len] = '\0';
+		snprintf(s, 12, "%011d", i);
+		s[11] = 'x';
+		skeys[i] = s;
+	}
+
+	printf("N = %d keys, string length %d, batches of %d\n",
+		N, len, BATCH);
+	bench_u64lp("u64 lphash_table", N, ikeys);
+	bench_u64rh("u64 lphash_rhtable", N, ikeys);
+	bench_u64sw("u64 lphash_swtable", N, ikeys);
+	bench_u64ir("u64 lphash_irtable", N, ikeys);
+	bench_u64ck("u64 lphash_cuckootable", N, ikeys);
+	bench_strlp("string lphash_table", N, skeys);
+	bench_strrh("string lphash_rhtable", N, skeys);
+	bench_strsw("string lphash_swtable", N, skeys);
+	bench_strck("string lphash_cuckootable", N, skeys);
+
+	printf("\nu64 keys with %zu byte values\n", sizeof(bigval));
+	bench_biglp("big lphash_table", N, ikeys);
+	bench_bigsoa("big lphash_soatable", N, ikeys);
+
+	mem_Free(ikeys);
+	mem_Free(skeys);
+	mem_Free(sbuf);
+	return 0;
+}
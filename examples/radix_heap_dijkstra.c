@@ -0,0 +1,193 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/arr.h>
+#include <csnip/cext.h>
+#include <csnip/heap.h>
+#include <csnip/mem.h>
+#include <csnip/radix_heap.h>
+#include <csnip/util.h>
+#include <csnip/x.h>
+
+/* Dijkstra shortest path benchmark comparing csnip's binary heap
+ * (heap.h) with the radix heap (radix_heap.h).
+ *
+ * A random directed graph with N nodes and out-degree D is created,
+ * and single source shortest paths are computed with both priority
+ * queues.  Both variants use "lazy deletion", i.e., instead of
+ * decreasing keys, a new entry is pushed and stale entries are
+ * skipped when they are popped.
+ */
+
+typedef struct {
+	uint32_t to;
+	uint32_t w;
+} edge;
+
+typedef struct {
+	uint64_t d;
+	uint32_t node;
+} qentry;
+
+CSNIP_RADIXHEAP_DEF_TYPE(dist_rheap_s, uint64_t, uint32_t)
+typedef struct dist_rheap_s dist_rheap;
+CSNIP_RADIXHEAP_DEF_FUNCS(cext_unused static,
+			dist_rheap_,
+			uint64_t,
+			uint32_t,
+			dist_rheap)
+
+static double get_delta(struct timespec* b, struct timespec* a)
+{
+	return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec)/1.e9;
+}
+
+static uint32_t rng(uint64_t* s)
+{
+	*s = *s * 6364136223846793005ull + 1442695040888963407ull;
+	return (uint32_t)(*s >> 33);
+}
+
+static void dijkstra_binheap(int N, int D, const edge* E, uint64_t* dist)
+{
+	qentry* q;
+	size_t nq = 0, capq = 0;
+	arr_Init(q, nq, capq, 16, _);
+
+	for (int i = 0; i < N; ++i)
+		dist[i] = UINT64_MAX;
+	dist[0] = 0;
+	arr_Push(q, nq, capq, ((qentry){ 0, 0 }), _);
+	while (nq > 0) {
+		/* Pop */
+		const qentry t = q[0];
+		q[0] = q[--nq];
+		if (nq > 0) {
+			heap_SiftDown(u, v, q[u].d < q[v].d,
+				Tswap(qentry, q[u], q[v]), 2, nq, 0);
+		}
+		if (t.d > dist[t.node])
+			continue;
+
+		/* Relax */
+		const edge* e = &E[(size_t)t.node * D];
+		for (int j = 0; j < D; ++j) {
+			const uint64_t nd = t.d + e[j].w;
+			if (nd < dist[e[j].to]) {
+				dist[e[j].to] = nd;
+				arr_Push(q, nq, capq,
+					((qentry){ nd, e[j].to }), _);
+				heap_SiftUp(u, v, q[u].d < q[v].d,
+					Tswap(qentry, q[u], q[v]),
+					2, nq, nq - 1);
+			}
+		}
+	}
+	arr_Deinit(q, nq, capq);
+}
+
+static void dijkstra_radixheap(int N, int D, const edge* E, uint64_t* dist)
+{
+	dist_rheap H;
+	dist_rheap_init(&H);
+
+	for (int i = 0; i < N; ++i)
+		dist[i] = UINT64_MAX;
+	dist[0] = 0;
+	dist_rheap_push(&H, NULL, 0, 0);
+	while (dist_rheap_size(&H) > 0) {
+		uint32_t node;
+		const uint64_t d = dist_rheap_pop(&H, NULL, &node);
+		if (d > dist[node])
+			continue;
+
+		const edge* e = &E[(size_t)node * D];
+		for (int j = 0; j < D; ++j) {
+			const uint64_t nd = d + e[j].w;
+			if (nd < dist[e[j].to]) {
+				dist[e[j].to] = nd;
+				dist_rheap_push(&H, NULL, nd, e[j].to);
+			}
+		}
+	}
+	dist_rheap_deinit(&H);
+}
+
+static void usage(void)
+{
+	puts(
+	"Dijkstra benchmark: binary heap vs. radix heap.\n"
+	"\n"
+	"-h             Display help and exit.\n"
+	"-N #           Number of nodes (default 1000000).\n"
+	"-D #           Out-degree of each node (default 8).\n"
+	"-W #           Maximum edge weight (default 100000).\n"
+	"-r #           Number of repetitions (default 3).\n"
+	);
+}
+
+int main(int argc, char** argv)
+{
+	int N = 1000000, D = 8, nRep = 3;
+	uint32_t W = 100000;
+	int c;
+	while ((c = x_getopt(argc, argv, "hN:D:W:r:")) != -1) {
+		switch (c) {
+		case 'h':	usage();			return 0;
+		case 'N':	N = atoi(x_optarg);		break;
+		case 'D':	D = atoi(x_optarg);		break;
+		case 'W':	W = (uint32_t)atol(x_optarg);	break;
+		case 'r':	nRep = atoi(x_optarg);		break;
+		default:	usage();			return 1;
+		}
+	}
+	if (N < 1 || D < 1 || W < 1 || nRep < 1) {
+		fprintf(stderr, "Error:  Invalid parameters.\n");
+		return 1;
+	}
+
+	/* Create the graph */
+	edge* E;
+	uint64_t *dist_a, *dist_b;
+	mem_Alloc((size_t)N * D, E, _);
+	mem_Alloc(N, dist_a, _);
+	mem_Alloc(N, dist_b, _);
+	uint64_t seed = 1;
+	for (size_t i = 0; i < (size_t)N * D; ++i) {
+		E[i].to = rng(&seed) % (uint32_t)N;
+		E[i].w = 1 + rng(&seed) % W;
+	}
+	printf("Graph with N = %d nodes, out-degree D = %d, "
+		"weights in [1, %lu].\n", N, D, (unsigned long)W);
+
+	double t_bin = 0, t_radix = 0;
+	for (int r = 0; r < nRep; ++r) {
+		struct timespec t0, t1, t2;
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t0);
+		dijkstra_binheap(N, D, E, dist_a);
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t1);
+		dijkstra_radixheap(N, D, E, dist_b);
+		x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &t2);
+		t_bin += get_delta(&t1, &t0);
+		t_radix += get_delta(&t2, &t1);
+
+		for (int i = 0; i < N; ++i) {
+			if (dist_a[i] != dist_b[i]) {
+				fprintf(stderr, "Error:  Distance mismatch "
+				  "at node %d.\n", i);
+				return 1;
+			}
+		}
+	}
+
+	printf("binary heap:  %g s per run\n", t_bin / nRep);
+	printf("radix heap:   %g s per run\n", t_radix / nRep);
+
+	mem_Free(E);
+	mem_Free(dist_a);
+	mem_Free(dist_b);
+	return 0;
+}
@@ -0,0 +1,188 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/mem.h>
+#include <csnip/slaballoc.h>
+#include <csnip/x.h>
+
+/* Slab allocator vs. malloc comparison.
+ *
+ * Allocates and frees message sized objects, drawn log-uniformly
+ * between 32 bytes and 4 KiB, with the size class slab allocator and
+ * with the libc malloc().  Two patterns are timed:
+ *
+ * - burst:  allocate a batch of messages, then free them in the order
+ *   they were allocated, as a request handler would;
+ *
+ * - churn:  keep a window of live messages, and repeatedly replace a
+ *   random one with a new message.
+ *
+ * The first bytes of every message are written, so that the memory is
+ * touched as it would be in use.  The time per allocation and free
+ * pair is reported.
+ */
+
+static double get_delta(struct timespec* b, struct timespec* a)
+{
+	return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec)/1.e9;
+}
+
+static void usage(void)
+{
+	puts("Usage:  slaballoc_perf [-h] [-n nops] [-b batch] [-w window]");
+	puts("");
+	puts("  -h         display this help");
+	puts("  -n nops    number of allocations per test [10000000]");
+	puts("  -b batch   messages per burst [1000]");
+	puts("  -w window  live messages for churn [100000]");
+}
+
+typedef struct {
+	const char* name;
+	void* (*alloc)(void* ctx, size_t sz);
+	void (*free)(void* ctx, void* p);
+	void* ctx;
+} allocator;
+
+static void* m_alloc(void* ctx, size_t sz)
+{
+	(void)ctx;
+	return malloc(sz);
+}
+
+static void m_free(void* ctx, void* p)
+{
+	(void)ctx;
+	free(p);
+}
+
+static void* s_alloc(void* ctx, size_t sz)
+{
+	return slaballoc_alloc_item(ctx, sz, NULL);
+}
+
+static void s_free(void* ctx, void* p)
+{
+	slaballoc_free_item(ctx, p);
+}
+
+static volatile uint64_t sink;
+
+static void touch(void* p, size_t sz)
+{
+	memset(p, (int)(sz & 0xff), (sz < 64 ? sz : 64));
+}
+
+static void bench_burst(const allocator* A, const uint32_t* sizes,
+			size_t nsizes, size_t batch, size_t nops)
+{
+	void** p;
+	mem_Alloc(batch, p, _);
+	struct timespec t0, t1;
+	size_t k = 0;
+	uint64_t s = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (size_t done = 0; done < nops; done += batch) {
+		for (size_t i = 0; i < batch; ++i) {
+			const size_t sz = sizes[k++ & (nsizes - 1)];
+			p[i] = A->alloc(A->ctx, sz);
+			touch(p[i], sz);
+		}
+		for (size_t i = 0; i < batch; ++i) {
+			s += *(unsigned char*)p[i];
+			A->free(A->ctx, p[i]);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	sink = s;
+	printf("%-10s %-6s %10.2f\n", A->name, "burst",
+		get_delta(&t1, &t0) / (double)k * 1e9);
+	mem_Free(p);
+}
+
+static void bench_churn(const allocator* A, const uint32_t* sizes,
+			size_t nsizes, size_t window, size_t nops)
+{
+	void** p;
+	mem_Alloc(window, p, _);
+	size_t k = 0;
+	for (size_t i = 0; i < window; ++i) {
+		const size_t sz = sizes[k++ & (nsizes - 1)];
+		p[i] = A->alloc(A->ctx, sz);
+		touch(p[i], sz);
+	}
+
+	struct timespec t0, t1;
+	uint64_t s = 0;
+	uint64_t r = 0x9e3779b97f4a7c15ull;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (size_t op = 0; op < nops; ++op) {
+		r ^= r << 13;
+		r ^= r >> 7;
+		r ^= r << 17;
+		const size_t j = (size_t)(r % window);
+		s += *(unsigned char*)p[j];
+		A->free(A->ctx, p[j]);
+		const size_t sz = sizes[k++ & (nsizes - 1)];
+		p[j] = A->alloc(A->ctx, sz);
+		touch(p[j], sz);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	sink = s;
+	printf("%-10s %-6s %10.2f\n", A->name, "churn",
+		get_delta(&t1, &t0) / (double)nops * 1e9);
+
+	for (size_t i = 0; i < window; ++i)
+		A->free(A->ctx, p[i]);
+	mem_Free(p);
+}
+
+int main(int argc, char** argv)
+{
+	size_t nops = 10000000, batch = 1000, window = 100000;
+	int c;
+	while ((c = x_getopt(argc, argv, "hn:b:w:")) != -1) {
+		switch (c) {
+		case 'h':	usage();				return 0;
+		case 'n':	nops = (size_t)atol(x_optarg);		break;
+		case 'b':	batch = (size_t)atol(x_optarg);		break;
+		case 'w':	window = (size_t)atol(x_optarg);	break;
+		default:	usage();				return 1;
+		}
+	}
+	if (nops < 1 || batch < 1 || window < 1) {
+		fprintf(stderr, "Error:  Invalid parameters.\n");
+		return 1;
+	}
+
+	/* Log-uniform message sizes between 32 bytes and 4 KiB */
+	const size_t nsizes = 1 << 16;
+	uint32_t* sizes;
+	mem_Alloc(nsizes, sizes, _);
+	srand(1);
+	for (size_t i = 0; i < nsizes; ++i) {
+		const int lg = 5 + rand() % 7;
+		sizes[i] = (uint32_t)((1u << lg) + (unsigned)rand()
+					% (1u << lg));
+	}
+
+	slaballoc* S = slaballoc_make(NULL);
+	const allocator alloc[] = {
+		{ "malloc", m_alloc, m_free, NULL },
+		{ "slaballoc", s_alloc, s_free, S },
+	};
+
+	printf("%-10s %-6s %10s\n", "allocator", "test", "ns/op");
+	for (size_t a = 0; a < sizeof(alloc) / sizeof(alloc[0]); ++a)
+		bench_burst(&alloc[a], sizes, nsizes, batch, nops);
+	for (size_t a = 0; a < sizeof(alloc) / sizeof(alloc[0]); ++a)
+		bench_churn(&alloc[a], sizes, nsizes, window, nops);
+
+	slaballoc_free(S);
+	mem_Free(sizes);
+	return 0;
+}
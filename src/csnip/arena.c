@@ -0,0 +1,254 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <csnip/csnip_conf.h>
+
+#ifdef CSNIP_CONF__HAVE_MMAP
+#include <sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS	MAP_ANON
+#endif
+#endif
+
+#if defined(CSNIP_CONF__HAVE_MMAP) && defined(MAP_ANONYMOUS)
+#define HAVE_RESERVE
+#endif
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/err.h>
+#include <csnip/mem.h>
+#include <csnip/arena.h>
+
+/* Chunks are linked from the most recent to the oldest; the memory
+ * handed out follows the header. */
+struct csnip_arena__chunk {
+	csnip_arena__chunk* next;
+	size_t sz;			/* Bytes following the header */
+	max_align_t pad[];
+};
+
+static inline char* chunk_begin(csnip_arena__chunk* C)
+{
+	return (char*)C->pad;
+}
+
+static inline char* chunk_end(csnip_arena__chunk* C)
+{
+	return (char*)C->pad + C->sz;
+}
+
+arena* csnip_arena_make(size_t chunk_sz, int* err)
+{
+	if (err) *err = 0;
+	arena* A;
+	mem_Alloc(1, A, *err);
+	if (err && *err)
+		return NULL;
+	*A = (arena) {
+		.chunk_sz = (chunk_sz ? chunk_sz : CSNIP_ARENA_CHUNK_SZ),
+	};
+	return A;
+}
+
+arena* csnip_arena_make_reserved(size_t reserve, int* err)
+{
+#ifdef HAVE_RESERVE
+	if (err) *err = 0;
+	const size_t c = CSNIP_ARENA_COMMIT_SZ;
+	if (reserve == 0 || reserve > SIZE_MAX - c) {
+		csnip_err_Raise(csnip_err_INVAL, *err);
+		return NULL;
+	}
+	reserve = (reserve + c - 1) / c * c;
+
+	arena* A;
+	mem_Alloc(1, A, *err);
+	if (err && *err)
+		return NULL;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+	flags |= MAP_NORESERVE;
+#endif
+	void* p = mmap(NULL, reserve, PROT_NONE, flags, -1, 0);
+	if (p == MAP_FAILED) {
+		mem_Free(A);
+		csnip_err_Raise(csnip_err_NOMEM, *err);
+		return NULL;
+	}
+	*A = (arena) {
+		.cur = p,
+		.end = p,
+		.chunk_sz = CSNIP_ARENA_CHUNK_SZ,
+		.vbase = p,
+		.vsize = reserve,
+	};
+	return A;
+#else
+	(void)reserve;
+	return csnip_arena_make(0, err);
+#endif
+}
+
+static void free_chunks(csnip_arena__chunk* C)
+{
+	while (C) {
+		csnip_arena__chunk* next = C->next;
+		mem_Free(C);
+		C = next;
+	}
+}
+
+void csnip_arena_free(arena* A)
+{
+#ifdef HAVE_RESERVE
+	if (A->vbase)
+		munmap(A->vbase, A->vsize);
+#endif
+	free_chunks(A->chunk);
+	free_chunks(A->spare);
+	mem_Free(A);
+}
+
+void csnip_arena_reset(arena* A)
+{
+	arena_mark m = { NULL, A->vbase };
+	csnip_arena_reset_to_mark(A, m);
+}
+
+void csnip_arena_reset_to_mark(arena* A, arena_mark m)
+{
+	while (A->chunk != m.chunk) {
+		csnip_arena__chunk* C = A->chunk;
+		A->chunk = C->next;
+		C->next = A->spare;
+		A->spare = C;
+	}
+	A->cur = m.cur;
+	if (A->vbase == NULL)
+		A->end = (A->chunk ? chunk_end(A->chunk) : NULL);
+	A->last = NULL;
+}
+
+#ifdef HAVE_RESERVE
+/* Commit the reserved range up to at least p */
+static _Bool commit_to(arena* A, const char* p)
+{
+	if (p <= A->end)
+		return 1;
+	const size_t c = CSNIP_ARENA_COMMIT_SZ;
+	const size_t used = (size_t)(p - A->vbase);
+	if (used > A->vsize)
+		return 0;
+	size_t upto = (used + c - 1) / c * c;
+	if (upto > A->vsize)
+		upto = A->vsize;
+	if (mprotect(A->end, (size_t)(A->vbase + upto - A->end),
+			PROT_READ | PROT_WRITE) != 0)
+	{
+		return 0;
+	}
+	A->end = A->vbase + upto;
+	return 1;
+}
+#endif
+
+void* csnip_arena__alloc_slow(arena* A,
+			size_t nAlign,
+			size_t sz,
+			int* err)
+{
+#ifdef HAVE_RESERVE
+	if (A->vbase) {
+		const uintptr_t off = ((uintptr_t)A->cur + nAlign - 1)
+					& ~(uintptr_t)(nAlign - 1);
+		char* p = (char*)off;
+		if (off < (uintptr_t)A->cur
+		  || (size_t)(p - A->vbase) > A->vsize
+		  || sz > A->vsize - (size_t)(p - A->vbase)
+		  || !commit_to(A, p + sz))
+		{
+			csnip_err_Raise(csnip_err_NOMEM, *err);
+			return NULL;
+		}
+		A->last = p;
+		A->cur = p + sz;
+		return p;
+	}
+#endif
+
+	/* Start a new chunk:  reuse a spare one if large enough */
+	if (sz > SIZE_MAX - nAlign) {
+		csnip_err_Raise(csnip_err_NOMEM, *err);
+		return NULL;
+	}
+	const size_t need = sz + nAlign - 1;
+	csnip_arena__chunk** pC = &A->spare;
+	while (*pC && (*pC)->sz < need)
+		pC = &(*pC)->next;
+	csnip_arena__chunk* C = *pC;
+	if (C) {
+		*pC = C->next;
+	} else {
+		const size_t csz = (need > A->chunk_sz ? need : A->chunk_sz);
+		if (csz > SIZE_MAX - sizeof(*C)) {
+			csnip_err_Raise(csnip_err_NOMEM, *err);
+			return NULL;
+		}
+		C = malloc(sizeof(*C) + csz);
+		if (C == NULL) {
+			csnip_err_Raise(csnip_err_NOMEM, *err);
+			return NULL;
+		}
+		C->sz = csz;
+	}
+	C->next = A->chunk;
+	A->chunk = C;
+
+	char* p = (char*)(((uintptr_t)chunk_begin(C) + nAlign - 1)
+				& ~(uintptr_t)(nAlign - 1));
+	A->end = chunk_end(C);
+	A->last = p;
+	A->cur = p + sz;
+	return p;
+}
+
+void* csnip_arena_realloc(arena* A,
+			void* p,
+			size_t old_sz,
+			size_t nAlign,
+			size_t new_sz,
+			int* err)
+{
+	if (err) *err = 0;
+	if (new_sz == 0)
+		new_sz = 1;
+
+	/* Resize the most recent allocation in place */
+	if (p != NULL && p == A->last) {
+		char* q = p;
+		if (new_sz <= (size_t)(A->end - q)) {
+			A->cur = q + new_sz;
+			return p;
+		}
+#ifdef HAVE_RESERVE
+		if (A->vbase && new_sz <= A->vsize - (size_t)(q - A->vbase)
+		  && commit_to(A, q + new_sz))
+		{
+			A->cur = q + new_sz;
+			return p;
+		}
+#endif
+	}
+
+	int err2;
+	void* r = arena_alloc(A, nAlign, new_sz, &err2);
+	if (r == NULL) {
+		csnip_err_Raise(err2, *err);
+		return NULL;
+	}
+	if (p)
+		memcpy(r, p, (old_sz < new_sz ? old_sz : new_sz));
+	return r;
+}
@@ -0,0 +1,500 @@
+#ifndef CSNIP_ARENA_H
+#define CSNIP_ARENA_H
+
+/**	@file arena.h
+ *	@brief			Arena allocator
+ *	@defgroup arena		Arena allocator
+ *	@{
+ *
+ *	@brief Bump allocation with bulk release.
+ *
+ *	An arena hands out memory by advancing a pointer through large
+ *	chunks, and releases it all at once, either completely with
+ *	csnip_arena_reset(), or back to a previously taken mark with
+ *	csnip_arena_reset_to_mark().  There is no way to free an
+ *	individual allocation.  This suits allocations with a common
+ *	lifetime, such as the temporary strings and scratch arrays built
+ *	while processing a request:  allocation costs a few
+ *	instructions, and the release costs one call instead of one
+ *	free() per object.
+ *
+ *	Released chunks are kept for reuse by later allocations, so an
+ *	arena that is reset after every request settles at the memory it
+ *	needs for the largest request and then no longer calls malloc().
+ *	The memory is returned to the system by csnip_arena_free().
+ *
+ *	Alternatively, an arena can reserve a contiguous range of
+ *	address space up front, with csnip_arena_make_reserved().  The
+ *	memory is then committed as the allocations advance, and all
+ *	allocations come from the single range.  This needs mmap(); on
+ *	systems without it, the arena falls back to chunks.
+ *
+ *	Besides the functions, there are macros analogous to those in
+ *	mem.h that derive the element size from the pointer type, and
+ *	adaptors for dynamic arrays (arr.h, arrt.h) that take their
+ *	memory from an arena.  Linear probing hash tables (lphash_table.h)
+ *	can be directed to an arena with the CSNIP_LPHASH_TABLE_ALLOC and
+ *	CSNIP_LPHASH_TABLE_FREE macros, e.g.,
+ *
+ *		static csnip_arena* tbl_arena;
+ *		#define CSNIP_LPHASH_TABLE_ALLOC(nMember, ptr, err) \
+ *			csnip_arena_Alloc(tbl_arena, nMember, ptr, err)
+ *		#define CSNIP_LPHASH_TABLE_FREE(ptr)	((void)0)
+ *
+ *	before the tables are defined.
+ *
+ *	Arenas are not thread safe; use one arena per thread.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <csnip/arr.h>
+#include <csnip/err.h>
+#include <csnip/mem.h>
+#include <csnip/util.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**	Default chunk size, in bytes. */
+#define CSNIP_ARENA_CHUNK_SZ		(64 * 1024)
+
+/**	Commit granularity of arenas with reserved address space. */
+#define CSNIP_ARENA_COMMIT_SZ		(64 * 1024)
+
+/** @cond */
+typedef struct csnip_arena__chunk csnip_arena__chunk;
+/** @endcond */
+
+/**	Arena.
+ *
+ *	The members are exposed for the inline allocation fast path,
+ *	and should be considered private.
+ */
+typedef struct {
+	char* cur;			/**< Next free byte */
+	char* end;			/**< End of the usable memory */
+	char* last;			/**< Most recent allocation */
+	csnip_arena__chunk* chunk;	/**< Current chunk */
+	csnip_arena__chunk* spare;	/**< Chunks kept for reuse */
+	size_t chunk_sz;		/**< Chunk size */
+	char* vbase;			/**< Reserved range, or NULL */
+	size_t vsize;			/**< Size of the reserved range */
+} csnip_arena;
+
+/**	Arena mark.
+ *
+ *	Position of the arena to reset to, @sa csnip_arena_get_mark().
+ */
+typedef struct {
+	csnip_arena__chunk* chunk;
+	char* cur;
+} csnip_arena_mark;
+
+/**	Create an arena.
+ *
+ *	@param	chunk_sz
+ *		Size of the chunks to allocate, in bytes; 0 selects
+ *		CSNIP_ARENA_CHUNK_SZ.  Larger allocations get a chunk
+ *		of their own.
+ *
+ *	@param	err
+ *		Error return.
+ *
+ *	@return	The new arena, or NULL on error.
+ */
+csnip_arena* csnip_arena_make(size_t chunk_sz, int* err);
+
+/**	Create an arena with reserved address space.
+ *
+ *	Reserves @a reserve bytes of address space, which is committed
+ *	in steps of CSNIP_ARENA_COMMIT_SZ as it is used.  Allocations
+ *	beyond the reserved size fail with csnip_err_NOMEM.  Without
+ *	mmap(), this is the same as csnip_arena_make(0, err).
+ */
+csnip_arena* csnip_arena_make_reserved(size_t reserve, int* err);
+
+/**	Free an arena and all memory allocated from it. */
+void csnip_arena_free(csnip_arena* A);
+
+/**	Release all allocations.
+ *
+ *	The chunks are kept for reuse.
+ */
+void csnip_arena_reset(csnip_arena* A);
+
+/**	Take a mark.
+ *
+ *	The allocations made after the mark can be released with
+ *	csnip_arena_reset_to_mark().
+ */
+static inline csnip_arena_mark csnip_arena_get_mark(const csnip_arena* A)
+{
+	csnip_arena_mark m = { A->chunk, A->cur };
+	return m;
+}
+
+/**	Release the allocations made after a mark.
+ *
+ *	The mark must have been taken on the same arena, and not have
+ *	been invalidated by resetting to an earlier mark, or by
+ *	csnip_arena_reset().
+ */
+void csnip_arena_reset_to_mark(csnip_arena* A, csnip_arena_mark m);
+
+/** @cond */
+void* csnip_arena__alloc_slow(csnip_arena* A,
+			size_t nAlign,
+			size_t sz,
+			int* err);
+/** @endcond */
+
+/**	Allocate memory.
+ *
+ *	@param	A
+ *		The arena.
+ *
+ *	@param	nAlign
+ *		Alignment, a power of two.
+ *
+ *	@param	sz
+ *		Size in bytes.
+ *
+ *	@param	err
+ *		Error return.
+ *
+ *	@return	The memory, or NULL on error.
+ */
+static inline void* csnip_arena_alloc(csnip_arena* A,
+				size_t nAlign,
+				size_t sz,
+				int* err)
+{
+	if (err) *err = 0;
+	if (sz == 0)
+		sz = 1;
+	const uintptr_t p = ((uintptr_t)A->cur + nAlign - 1)
+				& ~(uintptr_t)(nAlign - 1);
+	if (p <= (uintptr_t)A->end && sz <= (uintptr_t)A->end - p) {
+		A->last = (char*)p;
+		A->cur = (char*)p + sz;
+		return (void*)p;
+	}
+	return csnip_arena__alloc_slow(A, nAlign, sz, err);
+}
+
+/**	Allocate an array.
+ *
+ *	As csnip_arena_alloc(), for n members of the given size.
+ */
+static inline void* csnip_arena_alloc_n(csnip_arena* A,
+				size_t nAlign,
+				size_t n,
+				size_t size,
+				int* err)
+{
+	if (err) *err = 0;
+	if (size != 0 && SIZE_MAX / size < n) {
+		csnip_err_Raise(csnip_err_RANGE, *err);
+		return NULL;
+	}
+	return csnip_arena_alloc(A, nAlign, n * size, err);
+}
+
+/**	Resize an allocation.
+ *
+ *	If @a p is the most recent allocation, it is resized in place
+ *	if there is room.  Otherwise, new memory is allocated and the
+ *	contents are copied;  the old memory is only released with the
+ *	rest of the arena.  On error, @a p remains valid.
+ *
+ *	@param	p
+ *		The allocation, or NULL.
+ *
+ *	@param	old_sz
+ *		Current size of the allocation, in bytes.
+ *
+ *	@param	nAlign
+ *		Alignment, a power of two.
+ *
+ *	@param	new_sz
+ *		New size, in bytes.
+ *
+ *	@param	err
+ *		Error return.
+ */
+void* csnip_arena_realloc(csnip_arena* A,
+			void* p,
+			size_t old_sz,
+			size_t nAlign,
+			size_t new_sz,
+			int* err);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @cond */
+/* Alignment for objects of the given size:  the largest power of two
+ * dividing the size, up to CSNIP_ARENA__MAX_ALIGN.  A type's alignment
+ * always divides its size, so this suffices for all types aligned to
+ * at most CSNIP_ARENA__MAX_ALIGN. */
+#define CSNIP_ARENA__MAX_ALIGN ((size_t)64)
+#define csnip_arena__align_for(size) \
+	(((size) & (~(size) + 1)) < CSNIP_ARENA__MAX_ALIGN \
+	 ? (size) & (~(size) + 1) : CSNIP_ARENA__MAX_ALIGN)
+/** @endcond */
+
+/**	Allocate a member or an array of members.
+ *
+ *	Arena version of csnip_mem_Alloc().  The alignment is derived
+ *	from the size of the target type of @a ptr, which suffices for
+ *	types with an alignment of up to 64 bytes, including
+ *	cache-line aligned ones.  Types with stricter alignment need to
+ *	use csnip_arena_AlignedAlloc().
+ */
+#define csnip_arena_Alloc(A, nMember, ptr, err) \
+	csnip_arena_AlignedAlloc((A), (nMember), \
+		csnip_arena__align_for(sizeof(*(ptr))), ptr, err)
+
+/**	Aligned allocation.
+ *
+ *	Arena version of csnip_mem_AlignedAlloc().
+ */
+#define csnip_arena_AlignedAlloc(A, nMember, nAlign, ptr, err) \
+	csnip_arena__AlignedAlloc((A), (nMember), (nAlign), ptr, err, \
+				csnip__err)
+
+/** @cond */
+#define csnip_arena__AlignedAlloc(A, nMember, nAlign, ptr, err,	err2) \
+	do { \
+		int err2; \
+		(ptr) = csnip_mem__cxxcast(ptr, \
+			csnip_arena_alloc_n(A, nAlign, nMember, \
+				sizeof(*(ptr)), &err2)); \
+		if (err2) \
+			csnip_err_Raise(err2, err); \
+	} while(0)
+/** @endcond */
+
+/**	Resize an array.
+ *
+ *	Arena version of csnip_mem_Realloc(), with the current number
+ *	of members @a nOld.  If the reallocation fails, @a ptr remains
+ *	unchanged.  The alignment is chosen as for csnip_arena_Alloc().
+ */
+#define csnip_arena_Realloc(A, nOld, nMember, ptr, err) \
+	csnip_arena__Realloc((A), (nOld), (nMember), ptr, err, \
+				csnip__p, csnip__err)
+
+/** @cond */
+#define csnip_arena__Realloc(A, nOld, nMember, ptr, err,	p, err2) \
+	do { \
+		if (SIZE_MAX / sizeof(*(ptr)) < (size_t)(nMember)) { \
+			csnip_err_Raise(csnip_err_RANGE, err); \
+			break; \
+		} \
+		int err2; \
+		void* p = csnip_arena_realloc(A, ptr, \
+			sizeof(*(ptr)) * (size_t)(nOld), \
+			csnip_arena__align_for(sizeof(*(ptr))), \
+			sizeof(*(ptr)) * (size_t)(nMember), &err2); \
+		if (err2) { \
+			csnip_err_Raise(err2, err); \
+			break; \
+		} \
+		(ptr) = csnip_mem__cxxcast(ptr, p); \
+	} while(0)
+/** @endcond */
+
+/**	@defgroup arena_arr	Arena backed dynamic arrays
+ *	@{
+ *
+ *	Versions of the dynamic array macros from arr.h that allocate
+ *	from an arena.  The arrays are the same (a, n, cap) triples, and
+ *	the macros not allocating memory, csnip_arr_Pop() and
+ *	csnip_arr_DeleteAt(), apply to them unchanged.  The array must
+ *	not be passed to the arr.h macros that allocate or free.
+ *
+ *	As with all arena memory, the array storage is released with
+ *	the arena;  an array that is the most recent allocation of its
+ *	arena grows in place.
+ */
+
+/**	Initialize an array.  @sa csnip_arr_Init() */
+#define csnip_arena_arr_Init(A, a, n, cap, initial_cap, err) \
+	do { \
+		(n) = 0; \
+		if (((cap) = (initial_cap)) > 0) { \
+			csnip_arena_Alloc(A, initial_cap, a, err); \
+		} else { \
+			(a) = NULL; \
+		} \
+	} while(0)
+
+/**	Reserve space for members to be added.  @sa csnip_arr_Reserve() */
+#define csnip_arena_arr_Reserve(A, a, n, cap, least_cap, err) \
+	csnip_arena_arr__Reserve((A), (a), (n), (cap), (least_cap), (err), \
+				csnip__i, csnip__err2)
+
+/** @cond */
+#define csnip_arena_arr__Reserve(A, a, n, cap, least_cap, err,	i, err2) \
+	do { \
+		size_t i = csnip_next_pow_of_2(csnip_Max(least_cap, n)); \
+		if (i != (size_t)cap) { \
+			int err2 = 0; \
+			csnip_arena_Realloc(A, csnip_Min(i, (size_t)cap), i, \
+						a, err2); \
+			if (err2) { \
+				csnip_err_Raise(err2, err); \
+				break; \
+			} \
+			cap = i; \
+		} \
+	} while(0)
+/** @endcond */
+
+/**	Append a value at the end of the array.  @sa csnip_arr_Push() */
+#define csnip_arena_arr_Push(A, a, n, cap, value, err) \
+	do { \
+		int csnip_err = 0; \
+		csnip_arena_arr_Reserve(A, a, n, cap, (n) + 1, csnip_err); \
+		if (csnip_err) { \
+			csnip_err_Raise(csnip_err, err); \
+			break; \
+		} \
+		(a)[(n)++] = (value); \
+	} while(0)
+
+/**	Insert a value.  @sa csnip_arr_InsertAt() */
+#define csnip_arena_arr_InsertAt(A, a, n, cap, index, val, err) \
+	do { \
+		int csnip_err = 0; \
+		csnip_arena_arr_Reserve(A, a, n, cap, (n) + 1, csnip_err); \
+		if (csnip_err) { \
+			csnip_err_Raise(csnip_err, err); \
+			break; \
+		} \
+		for (size_t csnip_i = (n); csnip_i > (index); --csnip_i) \
+		{ \
+			(a)[csnip_i] = (a)[csnip_i - 1]; \
+		} \
+		(a)[(index)] = (val); \
+		++(n); \
+	} while(0)
+
+/**	Detach an array from its storage.
+ *
+ *	The result is an empty array with no memory associated;  the
+ *	storage itself is released with the arena.
+ */
+#define csnip_arena_arr_Deinit(A, a, n, cap) \
+	do { \
+		(void)(A); \
+		(a) = NULL; \
+		(n) = 0; \
+		(cap) = 0; \
+	} while(0)
+
+/**	Define arena backed array functions.
+ *
+ *	Like CSNIP_ARR_DEF_FUNCS(), with the additional argument @a A ,
+ *	an expression for the arena in terms of the arguments.  The
+ *	functions are declared with CSNIP_ARR_DECL_FUNCS().
+ */
+#define CSNIP_ARENA_ARR_DEF_FUNCS(scope, prefix, val_type, gen_args, \
+				A, a, n, cap, err) \
+	scope void prefix ## init(csnip_pp_prepend_##gen_args \
+				size_t cs) \
+	{ \
+		csnip_arena_arr_Init(A, a, n, cap, cs, err); \
+	} \
+	\
+	scope void prefix ## reserve(csnip_pp_prepend_##gen_args \
+				size_t least_cap) \
+	{ \
+		csnip_arena_arr_Reserve(A, a, n, cap, least_cap, err); \
+	} \
+	\
+	scope void prefix ## push(csnip_pp_prepend_##gen_args \
+				val_type v) \
+	{ \
+		csnip_arena_arr_Push(A, a, n, cap, v, err); \
+	} \
+	\
+	scope void prefix ## pop(csnip_pp_list_##gen_args) \
+	{ \
+		csnip_arr_Pop(a, n, cap, err); \
+	} \
+	\
+	scope void prefix ## insert_at(csnip_pp_prepend_##gen_args \
+		size_t i, val_type v) \
+	{ \
+		csnip_arena_arr_InsertAt(A, a, n, cap, i, v, err); \
+	} \
+	\
+	scope void prefix ## delete_at(csnip_pp_prepend_##gen_args \
+		size_t i) \
+	{ \
+		csnip_arr_DeleteAt(a, n, cap, i, err); \
+	} \
+	scope void prefix ## deinit(csnip_pp_list_##gen_args) \
+	{ \
+		csnip_arena_arr_Deinit(A, a, n, cap); \
+	}
+
+/**	Define an arena backed array type.
+ *
+ *	As CSNIP_ARRT_DEF_TYPE(), with the additional member `arena`,
+ *	the arena to allocate from.  It has to be set before the array
+ *	is initialized.
+ */
+#define CSNIP_ARENA_ARRT_DEF_TYPE(arr_type, elem_type) \
+	typedef struct arr_type ## _s { \
+		elem_type* a; \
+		size_t n; \
+		size_t cap; \
+		csnip_arena* arena; \
+	} arr_type;
+
+/**	Define the functions of an arena backed array type.
+ *
+ *	The functions are those of CSNIP_ARRT_DEF_FUNCS(), and are
+ *	declared with CSNIP_ARRT_DECL_FUNCS().
+ */
+#define CSNIP_ARENA_ARRT_DEF_FUNCS(scope, prefix, arr_type, val_type) \
+	CSNIP_ARENA_ARR_DEF_FUNCS(scope, prefix, val_type, \
+			args(arr_type* A, int* err), \
+			A->arena, A->a, A->n, A->cap, *err)
+
+/** @} */
+
+/** @} */
+
+#endif /* CSNIP_ARENA_H */
+
+#if defined(CSNIP_SHORT_NAMES) && !defined(CSNIP_ARENA_HAVE_SHORT_NAMES)
+#define arena				csnip_arena
+#define arena_mark			csnip_arena_mark
+#define arena_make			csnip_arena_make
+#define arena_make_reserved		csnip_arena_make_reserved
+#define arena_free			csnip_arena_free
+#define arena_reset			csnip_arena_reset
+#define arena_get_mark			csnip_arena_get_mark
+#define arena_reset_to_mark		csnip_arena_reset_to_mark
+#define arena_alloc			csnip_arena_alloc
+#define arena_alloc_n			csnip_arena_alloc_n
+#define arena_realloc			csnip_arena_realloc
+#define arena_Alloc			csnip_arena_Alloc
+#define arena_AlignedAlloc		csnip_arena_AlignedAlloc
+#define arena_Realloc			csnip_arena_Realloc
+#define arena_arr_Init			csnip_arena_arr_Init
+#define arena_arr_Reserve		csnip_arena_arr_Reserve
+#define arena_arr_Push			csnip_arena_arr_Push
+#define arena_arr_InsertAt		csnip_arena_arr_InsertAt
+#define arena_arr_Deinit		csnip_arena_arr_Deinit
+#define CSNIP_ARENA_HAVE_SHORT_NAMES
+#endif /* CSNIP_SHORT_NAMES && !CSNIP_ARENA_HAVE_SHORT_NAMES */
@@ -18,7 +18,8 @@
  *	The array macros assume the triple is given as lvalues, and will
  *	suitably modify them.  The pointer to the array must be either a
  *	NULL pointer (allowable for empty arrays), or a pointer suitable
- *	for modification with realloc or free.
+ *	for modification with realloc or free, or with the allocator
+ *	selected with CSNIP_ARR_ALLOC and its companions.
  *
  *	It is of course OK to modify the array directly without using
  *	the csnip_arr_* macros.  No "SetAt" and "GetAt" methods are
@@ -33,6 +34,43 @@
 #include <csnip/util.h>
 #include <csnip/preproc.h>
 
+/**	Memory allocation of the arrays.
+ *
+ *	The array macros allocate, resize and release the array storage
+ *	with these macros, which take the same arguments as
+ *	csnip_mem_Alloc(), csnip_mem_Realloc() and csnip_mem_Free().
+ *	They are expanded where the array macros are used, and in
+ *	particular with CSNIP_ARR_DEF_FUNCS(), so they can be defined
+ *	before including arr.h to affect all arrays, or undefined and
+ *	redefined between instantiations to select the memory of
+ *	individual array types.  For example, large arrays accessed
+ *	randomly can be backed by huge pages with
+ *
+ *		#define CSNIP_ARR_ALLOC(nMember, ptr, err) \
+ *			csnip_mem_HugeAlloc(nMember, 0, ptr, err)
+ *		#define CSNIP_ARR_REALLOC(nMember, ptr, err) \
+ *			csnip_mem_HugeRealloc(nMember, 0, ptr, err)
+ *		#define CSNIP_ARR_FREE(ptr)	csnip_mem_HugeFree(ptr)
+ *
+ *	The array pointer must then only be released with
+ *	csnip_arr_Deinit() or the matching function.
+ */
+#ifndef CSNIP_ARR_ALLOC
+#define CSNIP_ARR_ALLOC(nMember, ptr, err) \
+	csnip_mem_Alloc(nMember, ptr, err)
+#endif
+
+/**	Memory reallocation, @sa CSNIP_ARR_ALLOC */
+#ifndef CSNIP_ARR_REALLOC
+#define CSNIP_ARR_REALLOC(nMember, ptr, err) \
+	csnip_mem_Realloc(nMember, ptr, err)
+#endif
+
+/**	Memory release, @sa CSNIP_ARR_ALLOC */
+#ifndef CSNIP_ARR_FREE
+#define CSNIP_ARR_FREE(ptr)		csnip_mem_Free(ptr)
+#endif
+
 /**	Initialize an array.
  *
  *	An empty array of the given initial capacity is allocated.  No
@@ -42,7 +80,7 @@
 	do { \
 		(n) = 0; \
 		if (((cap) = (initial_cap)) > 0) { \
-			csnip_mem_Alloc(initial_cap, a, err); \
+			CSNIP_ARR_ALLOC(initial_cap, a, err); \
 		} else { \
 			(a) = NULL; \
 		} \
@@ -72,7 +110,7 @@
 		size_t i = csnip_next_pow_of_2(csnip_Max(least_cap, n)); \
 		if(i != (size_t)cap) { \
 			int err2 = 0; \
-			csnip_mem_Realloc(i, a, err2); \
+			CSNIP_ARR_REALLOC(i, a, err2); \
 			if (err2) { \
 				csnip_err_Raise(err2, err); \
 				break; \
@@ -166,7 +204,7 @@
  */
 #define csnip_arr_Deinit(a, n, cap) \
 	do { \
-		csnip_mem_Free(a); \
+		CSNIP_ARR_FREE(a); \
 		(n) = 0; \
 		(cap) = 0; \
 	} while(0)
@@ -0,0 +1,375 @@
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/bloom.h>
+#include <csnip/cext.h>
+#include <csnip/err.h>
+#include <csnip/hash.h>
+#include <csnip/mem.h>
+
+/* Serialization format: magic, then k, blocked and nbits as little
+ * endian 32, 32 and 64 bit integers, then the words of the bit array
+ * as little endian 64 bit integers.
+ */
+#define MAGIC		"csnBLM1"
+#define HEADER_SIZE	24
+
+#define BLOCK_WORDS	8
+#define BLOCK_BITS	(64 * BLOCK_WORDS)
+
+/* Number of keys processed together in the batched functions */
+#define BATCH		16
+
+/* Salts for the blocked filter; odd constants, as in Parquet's split
+ * block Bloom filters. */
+static const uint32_t salt[CSNIP_BLOOM_MAX_K] = {
+	0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+	0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+	0x6a5a1f29u, 0x9b1b7e4bu, 0xc2b2ae35u, 0x27d4eb2fu,
+	0x165667b1u, 0x85ebca6bu, 0xd3a2646du, 0xfd7046c5u,
+};
+
+/* Standard filter: bit index of the i-th probe */
+static uint64_t std_bit(const bloom* F, uint64_t h1, uint64_t h2, int i)
+{
+	return (h1 + (uint64_t)i * h2) % F->nbits;
+}
+
+/* Blocked filter: block of a key, and mask of its bits */
+static uint64_t* blk_block(const bloom* F, uint64_t h1)
+{
+	return &F->bits[(h1 % (F->nwords / BLOCK_WORDS)) * BLOCK_WORDS];
+}
+
+static void blk_mask(const bloom* F, uint64_t h2, uint64_t* mask)
+{
+	/* The bits go to consecutive words, starting at a word chosen
+	 * by the hash, so that all words are equally loaded. */
+	const uint32_t x = (uint32_t)(h2 >> 32);
+	const int w0 = (int)(h2 >> 1) & (BLOCK_WORDS - 1);
+	for (int w = 0; w < BLOCK_WORDS; ++w)
+		mask[w] = 0;
+	for (int i = 0; i < F->k; ++i) {
+		mask[(w0 + i) & (BLOCK_WORDS - 1)] |=
+			1ull << ((x * salt[i]) >> 26);
+	}
+}
+
+bloom* bloom_make(uint64_t nbits, int k, int blocked, int* err)
+{
+	if (err) *err = 0;
+
+	if (k < 1 || k > CSNIP_BLOOM_MAX_K) {
+		csnip_err_Raise(err_INVAL, *err);
+		return NULL;
+	}
+	const uint64_t unit = blocked ? BLOCK_BITS : 64;
+	if (nbits == 0)
+		nbits = 1;
+	nbits = (nbits + unit - 1) / unit * unit;
+	if (nbits / 64 > SIZE_MAX / sizeof(uint64_t)) {
+		csnip_err_Raise(err_INVAL, *err);
+		return NULL;
+	}
+
+	bloom* F;
+	mem_Alloc(1, F, *err);
+	if (err && *err)
+		return NULL;
+	F->nbits = nbits;
+	F->k = k;
+	F->blocked = blocked ? 1 : 0;
+	F->nwords = (size_t)(nbits / 64);
+	mem_AlignedAlloc(F->nwords, 64, F->bits, *err);
+	if (err && *err) {
+		mem_Free(F);
+		return NULL;
+	}
+	bloom_clear(F);
+	return F;
+}
+
+/* False positive rate of a blocked filter, with n keys in nblocks
+ * blocks.  The number of keys per block is Poisson distributed;
+ * each word of a block receives about k/8 of the bits of a key.
+ */
+static double blocked_fpr(double n, double nblocks, int k)
+{
+	const double lambda = n / nblocks;
+	const double bpw = (double)k / BLOCK_WORDS;
+	const int cmax = (int)(lambda + 12.0 * sqrt(lambda) + 20.0);
+	double p = exp(-lambda);
+	double r = 0.0;
+	for (int c = 0; c <= cmax; ++c) {
+		const double fill = 1.0 - pow(1.0 - 1.0 / 64.0, c * bpw);
+		r += p * pow(fill, k);
+		p *= lambda / (c + 1);
+	}
+	return r;
+}
+
+/* False positive rate of a standard filter of m bits with n keys */
+static double std_fpr(double n, double m, int k)
+{
+	return pow(1.0 - exp(-(double)k * n / m), k);
+}
+
+static int k_for(double m, double n)
+{
+	int k = (int)(m / n * log(2.0) + 0.5);
+	if (k < 1)
+		k = 1;
+	if (k > CSNIP_BLOOM_MAX_K)
+		k = CSNIP_BLOOM_MAX_K;
+	return k;
+}
+
+bloom* bloom_make_for(size_t n, double fpr, int blocked, int* err)
+{
+	if (err) *err = 0;
+
+	if (!(fpr > 0.0 && fpr < 1.0)) {
+		csnip_err_Raise(err_INVAL, *err);
+		return NULL;
+	}
+	const double dn = (n > 0 ? (double)n : 1.0);
+	const double ln2 = log(2.0);
+	double m = ceil(-dn * log(fpr) / (ln2 * ln2));
+	int k = k_for(m, dn);
+
+	if (blocked) {
+		/* Grow until the rate is met */
+		while (blocked_fpr(dn, ceil(m / BLOCK_BITS), k) > fpr) {
+			m *= 1.05;
+			k = k_for(m, dn);
+		}
+	} else if (std_fpr(dn, m, k) > fpr) {
+		/* k was capped at CSNIP_BLOOM_MAX_K; solve the rate for m
+		 * with that k, which only increases the optimal k */
+		m = ceil(-(double)k * dn / log1p(-pow(fpr, 1.0 / k)));
+		while (std_fpr(dn, m, k) > fpr)
+			m = ceil(m * 1.001);
+	}
+	return bloom_make((uint64_t)m, k, blocked, err);
+}
+
+void bloom_free(bloom* F)
+{
+	mem_AlignedFree(F->bits);
+	mem_Free(F);
+}
+
+void bloom_clear(bloom* F)
+{
+	memset(F->bits, 0, F->nwords * sizeof(uint64_t));
+}
+
+void bloom_add(bloom* F, uint64_t h)
+{
+	uint64_t h1, h2;
+	hash_split64(h, &h1, &h2);
+	if (F->blocked) {
+		uint64_t* b = blk_block(F, h1);
+		uint64_t mask[BLOCK_WORDS];
+		blk_mask(F, h2, mask);
+		for (int w = 0; w < BLOCK_WORDS; ++w)
+			b[w] |= mask[w];
+	} else {
+		for (int i = 0; i < F->k; ++i) {
+			const uint64_t j = std_bit(F, h1, h2, i);
+			F->bits[j / 64] |= 1ull << (j % 64);
+		}
+	}
+}
+
+bool bloom_test(const bloom* F, uint64_t h)
+{
+	uint64_t h1, h2;
+	hash_split64(h, &h1, &h2);
+	if (F->blocked) {
+		const uint64_t* b = blk_block(F, h1);
+		uint64_t mask[BLOCK_WORDS];
+		blk_mask(F, h2, mask);
+		uint64_t miss = 0;
+		for (int w = 0; w < BLOCK_WORDS; ++w)
+			miss |= mask[w] & ~b[w];
+		return miss == 0;
+	}
+	for (int i = 0; i < F->k; ++i) {
+		const uint64_t j = std_bit(F, h1, h2, i);
+		if (!(F->bits[j / 64] & (1ull << (j % 64))))
+			return 0;
+	}
+	return 1;
+}
+
+void bloom_add_b(bloom* F, const void* buf, size_t sz)
+{
+	bloom_add(F, hash_fnv64_b(buf, sz, FNV64_INIT));
+}
+
+bool bloom_test_b(const bloom* F, const void* buf, size_t sz)
+{
+	return bloom_test(F, hash_fnv64_b(buf, sz, FNV64_INIT));
+}
+
+/* Prefetch the memory accessed for the hash values h[0 .. m - 1] */
+static void prefetch_many(const bloom* F, const uint64_t* h, size_t m)
+{
+	for (size_t i = 0; i < m; ++i) {
+		uint64_t h1, h2;
+		hash_split64(h[i], &h1, &h2);
+		if (F->blocked) {
+			cext_prefetch(blk_block(F, h1));
+		} else {
+			for (int j = 0; j < F->k; ++j) {
+				const uint64_t b = std_bit(F, h1, h2, j);
+				cext_prefetch(&F->bits[b / 64]);
+			}
+		}
+	}
+}
+
+void bloom_add_many(bloom* F, const uint64_t* h, size_t n)
+{
+	for (size_t b = 0; b < n; b += BATCH) {
+		const size_t m = (n - b < BATCH ? n - b : BATCH);
+		prefetch_many(F, &h[b], m);
+		for (size_t i = 0; i < m; ++i)
+			bloom_add(F, h[b + i]);
+	}
+}
+
+size_t bloom_test_many(const bloom* F,
+			const uint64_t* h,
+			size_t n,
+			bool* out)
+{
+	size_t npos = 0;
+	for (size_t b = 0; b < n; b += BATCH) {
+		const size_t m = (n - b < BATCH ? n - b : BATCH);
+		prefetch_many(F, &h[b], m);
+		for (size_t i = 0; i < m; ++i) {
+			out[b + i] = bloom_test(F, h[b + i]);
+			npos += out[b + i];
+		}
+	}
+	return npos;
+}
+
+static bool compatible(const bloom* F, const bloom* G)
+{
+	return F->nbits == G->nbits && F->k == G->k
+		&& F->blocked == G->blocked;
+}
+
+void bloom_union(bloom* F, const bloom* G, int* err)
+{
+	if (err) *err = 0;
+	if (!compatible(F, G)) {
+		csnip_err_Raise(err_INVAL, *err);
+		return;
+	}
+	for (size_t i = 0; i < F->nwords; ++i)
+		F->bits[i] |= G->bits[i];
+}
+
+void bloom_intersect(bloom* F, const bloom* G, int* err)
+{
+	if (err) *err = 0;
+	if (!compatible(F, G)) {
+		csnip_err_Raise(err_INVAL, *err);
+		return;
+	}
+	for (size_t i = 0; i < F->nwords; ++i)
+		F->bits[i] &= G->bits[i];
+}
+
+static int popcount64(uint64_t x)
+{
+	x = x - ((x >> 1) & 0x5555555555555555ull);
+	x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+	return (int)((x * 0x0101010101010101ull) >> 56);
+}
+
+double bloom_fpr(const bloom* F)
+{
+	uint64_t nset = 0;
+	for (size_t i = 0; i < F->nwords; ++i)
+		nset += (uint64_t)popcount64(F->bits[i]);
+	return pow((double)nset / (double)F->nbits, F->k);
+}
+
+/* Serialization */
+static void put_u64(unsigned char* p, uint64_t x)
+{
+	for (int i = 0; i < 8; ++i)
+		p[i] = (unsigned char)(x >> (8 * i));
+}
+
+static uint64_t get_u64(const unsigned char* p)
+{
+	uint64_t x = 0;
+	for (int i = 0; i < 8; ++i)
+		x |= (uint64_t)p[i] << (8 * i);
+	return x;
+}
+
+size_t bloom_serialized_size(const bloom* F)
+{
+	return HEADER_SIZE + F->nwords * 8;
+}
+
+size_t bloom_serialize(const bloom* F, void* buf, size_t sz, int* err)
+{
+	if (err) *err = 0;
+
+	const size_t len = bloom_serialized_size(F);
+	if (sz < len) {
+		csnip_err_Raise(err_RANGE, *err);
+		return 0;
+	}
+	unsigned char* p = buf;
+	memcpy(p, MAGIC, 8);
+	put_u64(p + 8, (uint64_t)F->k | ((uint64_t)F->blocked << 32));
+	put_u64(p + 16, F->nbits);
+	p += HEADER_SIZE;
+	for (size_t i = 0; i < F->nwords; ++i, p += 8)
+		put_u64(p, F->bits[i]);
+	return len;
+}
+
+bloom* bloom_deserialize(const void* buf, size_t sz, int* err)
+{
+	if (err) *err = 0;
+
+	const unsigned char* p = buf;
+	if (sz < HEADER_SIZE || memcmp(p, MAGIC, 8) != 0) {
+		csnip_err_Raise(err_FORMAT, *err);
+		return NULL;
+	}
+	const uint64_t kb = get_u64(p + 8);
+	const uint64_t k = kb & 0xffffffffu;
+	const uint64_t blocked = kb >> 32;
+	const uint64_t nbits = get_u64(p + 16);
+	const uint64_t unit = blocked ? BLOCK_BITS : 64;
+	if (k < 1 || k > CSNIP_BLOOM_MAX_K || blocked > 1
+	  || nbits == 0 || nbits % unit != 0
+	  || (sz - HEADER_SIZE) / 8 != nbits / 64
+	  || (sz - HEADER_SIZE) % 8 != 0)
+	{
+		csnip_err_Raise(err_FORMAT, *err);
+		return NULL;
+	}
+
+	bloom* F = bloom_make(nbits, (int)k, (int)blocked, err);
+	if (F == NULL)
+		return NULL;
+	p += HEADER_SIZE;
+	for (size_t i = 0; i < F->nwords; ++i, p += 8)
+		F->bits[i] = get_u64(p);
+	return F;
+}
@@ -0,0 +1,227 @@
+#ifndef CSNIP_BLOOM_H
+#define CSNIP_BLOOM_H
+
+/**	@file bloom.h
+ *	@brief			Bloom filters
+ *	@defgroup bloom		Bloom filters
+ *	@{
+ *
+ *	@brief Bloom filters.
+ *
+ *	A Bloom filter is a compact set representation that answers
+ *	membership queries with no false negatives, but with a small
+ *	probability of false positives.  It is useful as a cheap check
+ *	in front of a more expensive lookup, e.g., in a large hash table
+ *	or on disk.
+ *
+ *	Two variants are provided:
+ *
+ *	* The standard Bloom filter sets k bits anywhere in the bit
+ *	  array for each key.  This is the most space efficient, but a
+ *	  query touches k cache lines.
+ *
+ *	* The blocked Bloom filter confines the k bits of a key to a
+ *	  single 64 byte block, so that a query touches a single cache
+ *	  line.  The bits are spread over the 8 words of the block, and
+ *	  tested with a mask comparison of the whole block, which
+ *	  compilers vectorize.  For the same false positive rate, it
+ *	  needs somewhat more memory than the standard filter.
+ *
+ *	Keys are given as 64 bit hash values, from which the bit
+ *	positions are derived by double hashing.  Any hash function of
+ *	reasonable quality can be used; csnip_bloom_add_b() and
+ *	csnip_bloom_test_b() hash a buffer with csnip_hash_fnv64_b().
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**	Maximum number of bits set per key. */
+#define CSNIP_BLOOM_MAX_K		16
+
+/**	Bloom filter. */
+typedef struct {
+	uint64_t nbits;		/**< Number of bits */
+	int k;			/**< Number of bits per key */
+	int blocked;		/**< Whether the filter is blocked */
+	size_t nwords;		/**< Number of 64 bit words */
+	uint64_t* bits;		/**< The bit array */
+} csnip_bloom;
+
+/**	Create a Bloom filter.
+ *
+ *	@param	nbits
+ *		Number of bits.  This is rounded up to a multiple of 64
+ *		for standard filters, and of 512 for blocked ones.
+ *
+ *	@param	k
+ *		Number of bits per key, between 1 and
+ *		CSNIP_BLOOM_MAX_K.
+ *
+ *	@param	blocked
+ *		Whether to create a blocked filter.
+ *
+ *	@param	err
+ *		Error return.  csnip_err_INVAL for invalid parameters,
+ *		csnip_err_NOMEM if out of memory.
+ *
+ *	@return	The new, empty filter, or NULL on error.
+ */
+csnip_bloom* csnip_bloom_make(uint64_t nbits,
+			int k,
+			int blocked,
+			int* err);
+
+/**	Create a Bloom filter for a given false positive rate.
+ *
+ *	Choose the number of bits and of bits per key such that the
+ *	false positive rate is at most @a fpr after @a n keys have been
+ *	added.
+ *
+ *	@param	n
+ *		Expected number of keys.
+ *
+ *	@param	fpr
+ *		Desired false positive rate, between 0 and 1.
+ *
+ *	@param	blocked
+ *		Whether to create a blocked filter.
+ *
+ *	@param	err
+ *		Error return, as for csnip_bloom_make().
+ */
+csnip_bloom* csnip_bloom_make_for(size_t n,
+			double fpr,
+			int blocked,
+			int* err);
+
+/**	Free a Bloom filter. */
+void csnip_bloom_free(csnip_bloom* F);
+
+/**	Remove all keys. */
+void csnip_bloom_clear(csnip_bloom* F);
+
+/**	Add a key, given by its hash value. */
+void csnip_bloom_add(csnip_bloom* F, uint64_t h);
+
+/**	Test for a key, given by its hash value.
+ *
+ *	@return	0 if the key was certainly not added, and 1 if it
+ *		probably was.
+ */
+_Bool csnip_bloom_test(const csnip_bloom* F, uint64_t h);
+
+/**	Add a key given by a buffer. */
+void csnip_bloom_add_b(csnip_bloom* F, const void* buf, size_t sz);
+
+/**	Test for a key given by a buffer. */
+_Bool csnip_bloom_test_b(const csnip_bloom* F, const void* buf, size_t sz);
+
+/**	Add several keys.
+ *
+ *	Equivalent to calling csnip_bloom_add() for each of the @a n
+ *	hash values in @a h, but faster for filters that do not fit in
+ *	the cache, since the memory accesses of several keys are
+ *	overlapped.
+ */
+void csnip_bloom_add_many(csnip_bloom* F, const uint64_t* h, size_t n);
+
+/**	Test several keys.
+ *
+ *	Store the results of csnip_bloom_test() for the @a n hash values
+ *	in @a h into @a out, using prefetching as
+ *	csnip_bloom_add_many().
+ *
+ *	@return	The number of positive results.
+ */
+size_t csnip_bloom_test_many(const csnip_bloom* F,
+			const uint64_t* h,
+			size_t n,
+			_Bool* out);
+
+/**	Union of filters.
+ *
+ *	Add the keys of @a G to @a F.  Afterwards, F is the filter that
+ *	would have resulted from adding the keys of both filters.  The
+ *	filters need to have the same parameters, otherwise
+ *	csnip_err_INVAL is raised.
+ */
+void csnip_bloom_union(csnip_bloom* F, const csnip_bloom* G, int* err);
+
+/**	Intersection of filters.
+ *
+ *	Restrict @a F to the bits also set in @a G.  The result has no
+ *	false negatives for keys added to both filters, but a false
+ *	positive rate that can be higher than that of a filter built
+ *	from the intersection directly.  The filters need to have the
+ *	same parameters, otherwise csnip_err_INVAL is raised.
+ */
+void csnip_bloom_intersect(csnip_bloom* F, const csnip_bloom* G, int* err);
+
+/**	Estimate the false positive rate.
+ *
+ *	The estimate is computed from the fraction of bits set.
+ */
+double csnip_bloom_fpr(const csnip_bloom* F);
+
+/**	Size of the serialized filter in bytes. */
+size_t csnip_bloom_serialized_size(const csnip_bloom* F);
+
+/**	Serialize a filter.
+ *
+ *	Write the filter to the buffer @a buf of @a sz bytes, in a
+ *	format independent of the byte order of the machine.
+ *
+ *	@return	The number of bytes written, which is
+ *		csnip_bloom_serialized_size().  If the buffer is too
+ *		small, csnip_err_RANGE is raised and 0 returned.
+ */
+size_t csnip_bloom_serialize(const csnip_bloom* F,
+			void* buf,
+			size_t sz,
+			int* err);
+
+/**	Deserialize a filter.
+ *
+ *	Create a filter from the buffer written by
+ *	csnip_bloom_serialize().
+ *
+ *	@return	The filter, or NULL on error.  Malformed buffers raise
+ *		csnip_err_FORMAT.
+ */
+csnip_bloom* csnip_bloom_deserialize(const void* buf,
+			size_t sz,
+			int* err);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+
+#endif /* CSNIP_BLOOM_H */
+
+#if defined(CSNIP_SHORT_NAMES) && !defined(CSNIP_BLOOM_HAVE_SHORT_NAMES)
+#define bloom				csnip_bloom
+#define bloom_make			csnip_bloom_make
+#define bloom_make_for			csnip_bloom_make_for
+#define bloom_free			csnip_bloom_free
+#define bloom_clear			csnip_bloom_clear
+#define bloom_add			csnip_bloom_add
+#define bloom_test			csnip_bloom_test
+#define bloom_add_b			csnip_bloom_add_b
+#define bloom_test_b			csnip_bloom_test_b
+#define bloom_add_many			csnip_bloom_add_many
+#define bloom_test_many			csnip_bloom_test_many
+#define bloom_union			csnip_bloom_union
+#define bloom_intersect			csnip_bloom_intersect
+#define bloom_fpr			csnip_bloom_fpr
+#define bloom_serialized_size		csnip_bloom_serialized_size
+#define bloom_serialize			csnip_bloom_serialize
+#define bloom_deserialize		csnip_bloom_deserialize
+#define CSNIP_BLOOM_HAVE_SHORT_NAMES
+#endif /* CSNIP_SHORT_NAMES && !CSNIP_BLOOM_HAVE_SHORT_NAMES */
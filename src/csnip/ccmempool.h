@@ -0,0 +1,388 @@
+#ifndef CSNIP_CCMEMPOOL_H
+#define CSNIP_CCMEMPOOL_H
+
+/**	@file ccmempool.h
+ *	@addtogroup mempool
+ *	@{
+ *	@defgroup ccmempool	Concurrent memory pools
+ *	@{
+ *
+ *	Memory pools for concurrent use.
+ *
+ *	Like the pools of mempool.h, these allocate fixed size items,
+ *	but a pool can be shared by several threads, and items can be
+ *	freed by any thread, not only the one that allocated them.
+ *
+ *	Each thread accesses the pool through a cache of its own, which
+ *	holds up to two magazines, i.e., stacks of up to
+ *	CSNIP_CCMEMPOOL_MAG_SIZE free items.  Allocations pop from and
+ *	frees push to the cache's magazines without synchronization.
+ *	Only when both magazines of a cache are empty (on allocation)
+ *	or full (on freeing) is the pool's lock taken, to exchange a
+ *	magazine with the pool's depot of full and empty magazines.
+ *	Thus the lock is taken at most once per CSNIP_CCMEMPOOL_MAG_SIZE
+ *	operations of a thread, and threads alternating between
+ *	allocations and frees do not take it at all.
+ *
+ *	When the depot has no full magazines, new items are carved from
+ *	slabs, which grow geometrically.  When it has no empty
+ *	magazines and none can be allocated, freed items go back to a
+ *	free list of the pool.  Memory is returned to the system only
+ *	when the pool is freed.
+ *
+ *	Items freed by a thread other than the one that allocated them
+ *	simply end up in the magazines of the freeing thread; items are
+ *	interchangeable, so there is no need to return them to their
+ *	allocating thread.
+ *
+ *	For single threaded use, the pools of mempool.h remain faster.
+ *	This module requires POSIX threads.
+ *
+ *	Usage:
+ *
+ *		CSNIP_CCMEMPOOL_DEF_TYPE(pool, struct item)
+ *		CSNIP_CCMEMPOOL_DEF_FUNCS(static, pool_, struct item,
+ *			struct pool, struct pool_cache,
+ *			struct pool_magazine)
+ *
+ *		struct pool* P = pool_make(NULL);
+ *		// In each thread:
+ *		struct pool_cache C = pool_cache_init(P);
+ *		struct item* it = pool_alloc_item(&C, NULL);
+ *		...
+ *		pool_free_item(&C, it);
+ *		pool_cache_deinit(&C);
+ *		// After all caches were deinitialized:
+ *		pool_free(P);
+ */
+
+#include <errno.h>
+#include <stddef.h>
+
+#include <pthread.h>
+
+#include <csnip/err.h>
+#include <csnip/mem.h>
+
+/**	Number of items in a magazine. */
+#ifndef CSNIP_CCMEMPOOL_MAG_SIZE
+#define CSNIP_CCMEMPOOL_MAG_SIZE	64
+#endif
+
+/**	Define a concurrent memory pool type.
+ *
+ *	Defines struct struct_pooltype, the pool, struct
+ *	struct_pooltype_cache, the per thread cache, and struct
+ *	struct_pooltype_magazine, the magazine.
+ *
+ *	@param	struct_pooltype
+ *		Name of the pool struct.
+ *
+ *	@param	itemtype
+ *		Type of the items.  It needs to be at least as large
+ *		as a pointer, and have at least the alignment of a
+ *		pointer.
+ */
+#define CSNIP_CCMEMPOOL_DEF_TYPE(struct_pooltype, itemtype) \
+	struct struct_pooltype##_magazine { \
+		struct struct_pooltype##_magazine* next; \
+		size_t n; \
+		itemtype* item[CSNIP_CCMEMPOOL_MAG_SIZE]; \
+	}; \
+	\
+	struct struct_pooltype##_cache { \
+		struct struct_pooltype* pool; \
+		struct struct_pooltype##_magazine* loaded; \
+		struct struct_pooltype##_magazine* prev; \
+	}; \
+	\
+	struct struct_pooltype { \
+		pthread_mutex_t lock; \
+		\
+		/* Depot */ \
+		struct struct_pooltype##_magazine* full; \
+		struct struct_pooltype##_magazine* empty; \
+		\
+		/* Item sources */ \
+		itemtype* first_free; \
+		void* slabs;		/* List of slabs */ \
+		itemtype* bump; \
+		size_t n_bump; \
+		size_t n_carved; \
+	};
+
+/**	Declare concurrent memory pool functions.
+ *
+ *	@sa CSNIP_CCMEMPOOL_DEF_FUNCS()
+ */
+#define CSNIP_CCMEMPOOL_DECL_FUNCS(scope, \
+		prefix, \
+		itemtype, \
+		pooltype, \
+		cachetype) \
+	/* Pool creation and release */ \
+	scope pooltype* prefix##make(int* err); \
+	scope void prefix##free(pooltype* pool); \
+	\
+	/* Per thread caches */ \
+	scope cachetype prefix##cache_init(pooltype* pool); \
+	scope void prefix##cache_deinit(cachetype* cache); \
+	\
+	/* Item allocation and release */ \
+	scope itemtype* prefix##alloc_item(cachetype* cache, int* err); \
+	scope void prefix##free_item(cachetype* cache, itemtype* e);
+
+/**	Define concurrent memory pool functions.
+ *
+ *	@param	scope
+ *		scope of the generated functions.
+ *
+ *	@param	prefix
+ *		prefix of the generated function names.
+ *
+ *	@param	itemtype
+ *		type of the items.
+ *
+ *	@param	pooltype, cachetype, magtype
+ *		the pool, cache and magazine types, as defined by
+ *		CSNIP_CCMEMPOOL_DEF_TYPE().
+ *
+ *	The following functions will be generated:
+ *
+ *	* `make`: `pooltype* make(int* err);`  Create a pool.
+ *	* `free`: `void free(pooltype* pool);`  Free a pool, with all
+ *	  of its items.  All caches need to have been deinitialized.
+ *	* `cache_init`: `cachetype cache_init(pooltype* pool);`  Create
+ *	  a cache for a thread.  No memory is allocated until the first
+ *	  allocation or release of an item.
+ *	* `cache_deinit`: `void cache_deinit(cachetype* cache);`  Return
+ *	  the magazines of a cache to the pool.
+ *	* `alloc_item`: `itemtype* alloc_item(cachetype* cache, int*
+ *	  err);`  Allocate an item.  Returns NULL if no memory is
+ *	  available.
+ *	* `free_item`: `void free_item(cachetype* cache, itemtype* e);`
+ *	  Release an item, which may have been allocated through any
+ *	  cache of the same pool.
+ *
+ *	A cache must only be used by one thread at a time; different
+ *	caches of the same pool can be used concurrently.
+ */
+#define CSNIP_CCMEMPOOL_DEF_FUNCS(scope, \
+		prefix, \
+		itemtype, \
+		pooltype, \
+		cachetype, \
+		magtype) \
+	\
+	CSNIP_CCMEMPOOL_DECL_FUNCS(scope, prefix, itemtype, pooltype, \
+		cachetype) \
+	\
+	_Static_assert(sizeof(itemtype) >= sizeof(itemtype*), \
+			"memory pool items too small"); \
+	_Static_assert(_Alignof(itemtype) >= _Alignof(itemtype*), \
+			"item alignment needs to be that of a pointer."); \
+	\
+	/* Private methods.  These are called with the pool locked. */ \
+	\
+	/* Refill the empty magazine M with free items. */ \
+	static void prefix##_internal_fill(pooltype* P, magtype* M, \
+						int* err) \
+	{ \
+		while (P->first_free && M->n < CSNIP_CCMEMPOOL_MAG_SIZE) { \
+			itemtype* it = P->first_free; \
+			P->first_free = *((itemtype**)it); \
+			M->item[M->n++] = it; \
+		} \
+		if (M->n > 0) \
+			return; \
+		\
+		if (P->n_bump == 0) { \
+			size_t sz = P->n_carved; \
+			if (sz < 4 * CSNIP_CCMEMPOOL_MAG_SIZE) \
+				sz = 4 * CSNIP_CCMEMPOOL_MAG_SIZE; \
+			struct { \
+				void* next; \
+				itemtype item[]; \
+			}* sl; \
+			sl = csnip_mem_alloc(1, sizeof(*sl) \
+					+ sz * sizeof(itemtype)); \
+			if (sl == NULL) { \
+				csnip_err_Raise(csnip_err_NOMEM, *err); \
+				return; \
+			} \
+			sl->next = P->slabs; \
+			P->slabs = sl; \
+			P->bump = sl->item; \
+			P->n_bump = sz; \
+		} \
+		while (P->n_bump > 0 && M->n < CSNIP_CCMEMPOOL_MAG_SIZE) { \
+			M->item[M->n++] = P->bump++; \
+			--P->n_bump; \
+			++P->n_carved; \
+		} \
+	} \
+	\
+	/* Get an empty magazine from the depot or the allocator */ \
+	static magtype* prefix##_internal_empty_mag(pooltype* P) \
+	{ \
+		magtype* M = P->empty; \
+		if (M) { \
+			P->empty = M->next; \
+			return M; \
+		} \
+		M = csnip_mem_alloc(1, sizeof(magtype)); \
+		if (M) \
+			M->n = 0; \
+		return M; \
+	} \
+	\
+	/* Return a magazine to the depot */ \
+	static void prefix##_internal_put_mag(pooltype* P, magtype* M) \
+	{ \
+		if (M->n > 0) { \
+			M->next = P->full; \
+			P->full = M; \
+		} else { \
+			M->next = P->empty; \
+			P->empty = M; \
+		} \
+	} \
+	\
+	/* Pool creation and release */ \
+	scope pooltype* prefix##make(int* err) \
+	{ \
+		if (err) *err = 0; \
+		pooltype* P; \
+		csnip_mem_Alloc(1, P, *err); \
+		if (err && *err) \
+			return NULL; \
+		*P = (pooltype) { .first_free = NULL }; \
+		const int rc_ = pthread_mutex_init(&P->lock, NULL); \
+		if (rc_ != 0) { \
+			csnip_mem_Free(P); \
+			errno = rc_; \
+			csnip_err_Raise(csnip_err_ERRNO, *err); \
+			return NULL; \
+		} \
+		return P; \
+	} \
+	\
+	scope void prefix##free(pooltype* P) \
+	{ \
+		for (int i = 0; i < 2; ++i) { \
+			magtype* M = (i == 0 ? P->full : P->empty); \
+			while (M) { \
+				magtype* next = M->next; \
+				csnip_mem_Free(M); \
+				M = next; \
+			} \
+		} \
+		while (P->slabs) { \
+			void* next = *((void**)P->slabs); \
+			csnip_mem_Free(P->slabs); \
+			P->slabs = next; \
+		} \
+		pthread_mutex_destroy(&P->lock); \
+		csnip_mem_Free(P); \
+	} \
+	\
+	/* Per thread caches */ \
+	scope cachetype prefix##cache_init(pooltype* P) \
+	{ \
+		return (cachetype) { .pool = P }; \
+	} \
+	\
+	scope void prefix##cache_deinit(cachetype* C) \
+	{ \
+		pooltype* P = C->pool; \
+		pthread_mutex_lock(&P->lock); \
+		if (C->loaded) \
+			prefix##_internal_put_mag(P, C->loaded); \
+		if (C->prev) \
+			prefix##_internal_put_mag(P, C->prev); \
+		pthread_mutex_unlock(&P->lock); \
+		C->loaded = C->prev = NULL; \
+	} \
+	\
+	/* Item allocation and release */ \
+	scope itemtype* prefix##alloc_item(cachetype* C, int* err) \
+	{ \
+		if (err) *err = 0; \
+		magtype* M = C->loaded; \
+		if (M && M->n > 0) \
+			return M->item[--M->n]; \
+		if (C->prev && C->prev->n > 0) { \
+			C->loaded = C->prev; \
+			C->prev = M; \
+			M = C->loaded; \
+			return M->item[--M->n]; \
+		} \
+		\
+		/* Both magazines empty:  exchange with the depot */ \
+		pooltype* P = C->pool; \
+		pthread_mutex_lock(&P->lock); \
+		if (P->full) { \
+			M = P->full; \
+			P->full = M->next; \
+			if (C->prev) \
+				prefix##_internal_put_mag(P, C->prev); \
+			C->prev = C->loaded; \
+			C->loaded = M; \
+		} else { \
+			if (C->loaded == NULL) { \
+				C->loaded = prefix##_internal_empty_mag(P); \
+				if (C->loaded == NULL) { \
+					pthread_mutex_unlock(&P->lock); \
+					csnip_err_Raise(csnip_err_NOMEM, *err); \
+					return NULL; \
+				} \
+			} \
+			M = C->loaded; \
+			prefix##_internal_fill(P, M, err); \
+			if (M->n == 0) { \
+				pthread_mutex_unlock(&P->lock); \
+				return NULL; \
+			} \
+		} \
+		pthread_mutex_unlock(&P->lock); \
+		return M->item[--M->n]; \
+	} \
+	\
+	scope void prefix##free_item(cachetype* C, itemtype* e) \
+	{ \
+		magtype* M = C->loaded; \
+		if (M && M->n < CSNIP_CCMEMPOOL_MAG_SIZE) { \
+			M->item[M->n++] = e; \
+			return; \
+		} \
+		if (C->prev && C->prev->n == 0) { \
+			C->loaded = C->prev; \
+			C->prev = M; \
+			C->loaded->item[C->loaded->n++] = e; \
+			return; \
+		} \
+		\
+		/* Both magazines full or missing:  exchange with the \
+		 * depot */ \
+		pooltype* P = C->pool; \
+		pthread_mutex_lock(&P->lock); \
+		magtype* E = prefix##_internal_empty_mag(P); \
+		if (E == NULL) { \
+			/* Out of memory:  keep the item in the pool */ \
+			*((itemtype**)e) = P->first_free; \
+			P->first_free = e; \
+		} else { \
+			if (C->prev) \
+				prefix##_internal_put_mag(P, C->prev); \
+			C->prev = C->loaded; \
+			C->loaded = E; \
+			E->item[E->n++] = e; \
+		} \
+		pthread_mutex_unlock(&P->lock); \
+	}
+
+/** @}
+ *  @}
+ */
+
+#endif /* CSNIP_CCMEMPOOL_H */
@@ -67,6 +67,19 @@
 #  define csnip_cext_nodiscard		/* nothing */
 #endif
 
+/**	Prefetch memory for reading.
+ *
+ *	Hint that the memory at the given address will be read soon,
+ *	so that it can be brought into the cache while other work is
+ *	being done.  Expands to nothing useful if the compiler provides
+ *	no way to do this.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#  define csnip_cext_prefetch(addr)	__builtin_prefetch(addr)
+#else
+#  define csnip_cext_prefetch(addr)	((void)(addr))
+#endif
+
 /**@}*/
 
 #endif /* CSNIP_CEXT_H */
@@ -76,5 +89,6 @@
 #define cext_export		csnip_cext_export
 #define cext_import		csnip_cext_import
 #define cext_nodiscard		csnip_cext_nodiscard
+#define cext_prefetch		csnip_cext_prefetch
 #define CSNIP_CEXT_HAVE_SHORT_NAMES
 #endif /* CSNIP_SHORT_NAMES && !CSNIP_CEXT_HAVE_SHORT_NAMES */
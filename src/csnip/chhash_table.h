@@ -0,0 +1,630 @@
+#ifndef CSNIP_CHHASH_TABLE_H
+#define CSNIP_CHHASH_TABLE_H
+
+/**	@file chhash_table.h
+ *	@addtogroup hash_tables		Hash tables
+ *	@{
+ *	@defgroup chhash_table		Chained Hash Table
+ *	@{
+ *
+ *	Hash tables with separate chaining and stable node addresses.
+ *
+ *	The table consists of a power-of-two array of buckets, each
+ *	the head of a singly linked list of nodes.  Nodes are never
+ *	moved by the table, so that pointers to them remain valid until
+ *	they are removed, unlike for the open addressing tables of
+ *	lphash_table.h, which move entries when they grow and when
+ *	entries are removed.
+ *
+ *	The nodes are intrusive:  The node type is a user defined struct
+ *	with a member of type csnip_chhash_link, which holds the chain
+ *	pointer and the hash value of the node.  The table owns a memory
+ *	pool (see mempool.h) from which insert() and its variants
+ *	allocate nodes, and to which remove() returns them.
+ *	Alternatively, link() and unlink() add and remove nodes whose
+ *	memory is managed by the caller, e.g., nodes embedded in other
+ *	structures.  The two ways should not be mixed for the same
+ *	node, since remove() returns the node to the pool.
+ *
+ *	Resizing is incremental:  When the table grows, a bucket array
+ *	of twice the size is allocated, and the chains of the old array
+ *	are moved to the new one a few buckets at a time by subsequent
+ *	insertions, so that no single insertion has to rehash the whole
+ *	table.  The table grows when the number of nodes exceeds the
+ *	number of buckets.
+ *
+ *	Example:
+ *	@code{.c}
+ *	typedef struct {
+ *		csnip_chhash_link link;
+ *		uint64_t key;
+ *		int value;
+ *	} node;
+ *
+ *	CSNIP_MEMPOOL_DEF_TYPE(nodepool, node)
+ *	CSNIP_MEMPOOL_DEF_FUNCS(static, nodepool_, node, struct nodepool)
+ *
+ *	CSNIP_CHHASH_TABLE_DEF_TYPE(nodetbl, struct nodepool)
+ *	CSNIP_CHHASH_TABLE_DEF_FUNCS(static, nodetbl_, uint64_t, node,
+ *		struct nodetbl, nodepool_, link,
+ *		k1, k2, e, csnip_hash_fmix64(k1), k1 == k2, e.key)
+ *	@endcode
+ */
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <csnip/mem.h>
+#include <csnip/mempool.h>
+
+/**	Chain link.
+ *
+ *	Nodes of chained hash tables contain a member of this type.
+ */
+typedef struct csnip_chhash_link {
+	struct csnip_chhash_link* next;	/**< Next node in the chain */
+	size_t hval;			/**< Hash value of the node */
+} csnip_chhash_link;
+
+/**	Number of buckets migrated per insertion during resizing.
+ *
+ *	This needs to be at least 1 for the migration to complete before
+ *	the table needs to grow again.
+ */
+#ifndef CSNIP_CHHASH_TABLE_MIGRATE
+#define CSNIP_CHHASH_TABLE_MIGRATE	4
+#endif
+
+/**	Defines a chained hash table type.
+ *
+ *	@param	struct_tbltype
+ *		Name of the struct to be defined.
+ *
+ *	@param	pooltype
+ *		Type of the node memory pool, as defined with
+ *		CSNIP_MEMPOOL_DEF_TYPE() for the node type.
+ */
+#define CSNIP_CHHASH_TABLE_DEF_TYPE(struct_tbltype, pooltype) \
+	struct struct_tbltype { \
+		size_t size;		/* Number of nodes */ \
+		size_t nb;		/* Number of buckets */ \
+		csnip_chhash_link** bucket; /* Buckets */ \
+		size_t old_nb;		/* Buckets of the old array */ \
+		csnip_chhash_link** old_bucket; /* Array being migrated */ \
+		size_t migrated;	/* Old buckets migrated */ \
+		pooltype pool;		/* Node memory */ \
+	};
+
+/** Declare chained hash table functions.
+ *
+ *  @sa CSNIP_CHHASH_TABLE_DEF_FUNCS()
+ */
+#define CSNIP_CHHASH_TABLE_DECL_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				nodetype, \
+				tbltype) \
+	/* Creation & Deletion */ \
+	scope tbltype* prefix##make(int* err); \
+	scope void prefix##free(tbltype* tbl); \
+	\
+	/* Pool allocated nodes */ \
+	scope int prefix##insert( \
+			tbltype* tbl, \
+			int* err, \
+			nodetype E); \
+	scope int prefix##insert_or_assign( \
+			tbltype* tbl, \
+			int* err, \
+			nodetype E, \
+			nodetype* ret_old); \
+	scope nodetype* prefix##find_or_insert( \
+			tbltype* tbl, \
+			int* err, \
+			nodetype E); \
+	scope _Bool prefix##remove( \
+			tbltype* tbl, \
+			int* err, \
+			keytype key); \
+	\
+	/* Caller allocated nodes */ \
+	scope nodetype* prefix##link( \
+			tbltype* tbl, \
+			int* err, \
+			nodetype* nd); \
+	scope nodetype* prefix##unlink( \
+			tbltype* tbl, \
+			keytype key); \
+	scope void prefix##unlinknode( \
+			tbltype* tbl, \
+			nodetype* nd); \
+	\
+	/* Search */ \
+	scope nodetype* prefix##find( \
+			const tbltype* tbl, \
+			keytype key); \
+	\
+	/* Size and capacity */ \
+	scope size_t prefix##size(const tbltype* tbl); \
+	scope size_t prefix##capacity(const tbltype* tbl); \
+	scope void prefix##reserve( \
+			tbltype* tbl, \
+			int* err, \
+			size_t min_size); \
+	\
+	/* Iteration */ \
+	scope nodetype* prefix##first(const tbltype* tbl); \
+	scope nodetype* prefix##next( \
+			const tbltype* tbl, \
+			const nodetype* nd);
+
+/**	Define chained hash table functions.
+ *
+ *	@param	scope
+ *		scope of function declarations.
+ *
+ *	@param	prefix
+ *		function name prefix to add to generated functions.
+ *
+ *	@param	keytype
+ *		the type of the keys.
+ *
+ *	@param	nodetype
+ *		the node type, a struct with a csnip_chhash_link member.
+ *
+ *	@param	tbltype
+ *		the table type, as defined with
+ *		CSNIP_CHHASH_TABLE_DEF_TYPE().
+ *
+ *	@param	poolprefix
+ *		prefix of the memory pool functions for the pool type
+ *		of the table, as generated by CSNIP_MEMPOOL_DEF_FUNCS().
+ *
+ *	@param	linkmember
+ *		name of the csnip_chhash_link member of nodetype.
+ *
+ *	@param	k1, k2
+ *		dummy variables representing keys.
+ *
+ *	@param	e
+ *		dummy variable representing a node.
+ *
+ *	@param	hash
+ *		an expression evaluating to a hash of @a k1.
+ *
+ *	@param	is_match
+ *		an expression evaluation to true if @a k1 and @a k2
+ *		compare equal, and false otherwise.
+ *
+ *	@param	get_key
+ *		an expression evaluating to the key of node @a e.
+ *
+ *	The following functions will be generated:
+ *
+ *	Creation and destruction:
+ *		* `make`:  `tbltype* make(int* err);`  Create an empty
+ *		  table.
+ *		* `free`:  `void free(tbltype* tbl);`  Free the table
+ *		  and the nodes allocated from its pool.  Caller
+ *		  allocated nodes are not touched.
+ *
+ *	Pool allocated nodes:
+ *		* `insert`:  `int insert(tbltype* tbl, int* err,
+ *		  nodetype E);`  If no node with the key of E exists,
+ *		  allocate a node, copy E into it and insert it.
+ *		  Returns 1 if the node was inserted, and 0 otherwise.
+ *		* `insert_or_assign`:  `int insert_or_assign(tbltype*
+ *		  tbl, int* err, nodetype E, nodetype* ret_old);`  If a
+ *		  node with the key of E exists, copy E into it,
+ *		  keeping its link, and return the previous contents in
+ *		  `*ret_old` if `ret_old` is non-NULL; then return 0.
+ *		  Otherwise insert E as `insert` does and return 1.
+ *		* `find_or_insert`:  `nodetype* find_or_insert(tbltype*
+ *		  tbl, int* err, nodetype E);`  Return the node with the
+ *		  key of E, inserting E if there is none.
+ *		* `remove`:  `bool remove(tbltype* tbl, int* err,
+ *		  keytype key);`  Remove the node with the given key,
+ *		  and return it to the pool.  Returns true if there was
+ *		  such a node.
+ *
+ *	Caller allocated nodes:
+ *		* `link`:  `nodetype* link(tbltype* tbl, int* err,
+ *		  nodetype* nd);`  Insert the node, unless a node
+ *		  with the same key exists.  Returns the node with that
+ *		  key in the table after the call, i.e., `node` if it
+ *		  was inserted.  Returns NULL on error.
+ *		* `unlink`:  `nodetype* unlink(tbltype* tbl, keytype
+ *		  key);`  Remove the node with the given key from the
+ *		  table, and return it, or NULL if there was none.
+ *		* `unlinknode`:  `void unlinknode(tbltype* tbl,
+ *		  nodetype* nd);`  Remove the given node, which must
+ *		  be in the table.
+ *
+ *	Search:
+ *		* `find`:  `nodetype* find(const tbltype* tbl, keytype
+ *		  key);`  Return the node with the given key, or NULL.
+ *
+ *	Size and capacity:
+ *		* `size`:  Number of nodes in the table.
+ *		* `capacity`:  Number of buckets.
+ *		* `reserve`:  `void reserve(tbltype* tbl, int* err,
+ *		  size_t min_size);`  Grow the table so that it can hold
+ *		  `min_size` nodes without growing, and complete any
+ *		  pending migration.
+ *
+ *	Iteration:
+ *		* `first`:  `nodetype* first(const tbltype* tbl);`
+ *		  Return the first node, or NULL if the table is empty.
+ *		* `next`:  `nodetype* next(const tbltype* tbl, const
+ *		  nodetype* nd);`  Return the node after `node`, or
+ *		  NULL.
+ *
+ *		  Insertions invalidate the iteration order; removals
+ *		  do not, so that the current node can be removed after
+ *		  obtaining its successor.
+ */
+#define CSNIP_CHHASH_TABLE_DEF_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				nodetype, \
+				tbltype, \
+				poolprefix, \
+				linkmember,	/* link member of nodetype */ \
+				k1, k2,		/* key dummy vars */ \
+				e,		/* node dummy var */ \
+				hash,		/* evaluate to hash(k1) */ \
+				is_match,	/* Check whether k1 and k2 match */ \
+				get_key)	/* evaluate to the key of e */ \
+	\
+	/* Declare functions in case they weren't yet. */ \
+	CSNIP_CHHASH_TABLE_DECL_FUNCS(scope, prefix, keytype, nodetype, \
+	  tbltype) \
+	\
+	/* Private methods */ \
+	static nodetype* prefix##_internal_node(const csnip_chhash_link* l) \
+	{ \
+		return (nodetype*)((char*)l - offsetof(nodetype, linkmember)); \
+	} \
+	\
+	/* The bucket holding the chain for hash value h */ \
+	static csnip_chhash_link** prefix##_internal_bucket( \
+				const tbltype* T, \
+				size_t h) \
+	{ \
+		if (T->old_nb) { \
+			const size_t i = h & (T->old_nb - 1); \
+			if (i >= T->migrated) \
+				return &T->old_bucket[i]; \
+		} \
+		return &T->bucket[h & (T->nb - 1)]; \
+	} \
+	\
+	/* Find the key with hash value h_.  Returns the address of the
+	 * link pointer to the matching node, or NULL if not found.
+	 */ \
+	static csnip_chhash_link** prefix##_internal_findref( \
+				const tbltype* T, \
+				keytype key, \
+				size_t h_) \
+	{ \
+		if (T->nb == 0) \
+			return NULL; \
+		keytype k1 = key; \
+		keytype k2; \
+		nodetype e; \
+		csnip_chhash_link** p_ = prefix##_internal_bucket(T, h_); \
+		for (; *p_; p_ = &(*p_)->next) { \
+			if ((*p_)->hval != h_) \
+				continue; \
+			e = *prefix##_internal_node(*p_); \
+			k2 = (get_key); \
+			if (is_match) \
+				return p_; \
+		} \
+		return NULL; \
+	} \
+	\
+	/* Move up to n buckets from the old to the new array */ \
+	static void prefix##_internal_migrate(tbltype* T, size_t n) \
+	{ \
+		while (T->old_nb && n-- > 0) { \
+			csnip_chhash_link* l_ = T->old_bucket[T->migrated]; \
+			while (l_) { \
+				csnip_chhash_link* nx_ = l_->next; \
+				csnip_chhash_link** b_ = \
+					&T->bucket[l_->hval & (T->nb - 1)]; \
+				l_->next = *b_; \
+				*b_ = l_; \
+				l_ = nx_; \
+			} \
+			if (++T->migrated == T->old_nb) { \
+				csnip_mem_Free(T->old_bucket); \
+				T->old_bucket = NULL; \
+				T->old_nb = 0; \
+				T->migrated = 0; \
+			} \
+		} \
+	} \
+	\
+	/* Start growing if the table can't hold min_size nodes. */ \
+	static void prefix##_internal_grow(tbltype* T, \
+						int* err, \
+						size_t min_size) \
+	{ \
+		if (min_size <= T->nb) \
+			return; \
+		\
+		/* Complete a previous migration */ \
+		prefix##_internal_migrate(T, T->old_nb); \
+		\
+		size_t nb = (T->nb ? 2 * T->nb : 8); \
+		while (nb < min_size) \
+			nb *= 2; \
+		csnip_chhash_link** nbucket; \
+		csnip_mem_Alloc(nb, nbucket, *err); \
+		if (err && *err) \
+			return; \
+		for (size_t i = 0; i < nb; ++i) \
+			nbucket[i] = NULL; \
+		if (T->nb) { \
+			T->old_bucket = T->bucket; \
+			T->old_nb = T->nb; \
+			T->migrated = 0; \
+		} \
+		T->bucket = nbucket; \
+		T->nb = nb; \
+	} \
+	\
+	/* Link a new node with hash value h_ */ \
+	static void prefix##_internal_linknew(tbltype* T, \
+						csnip_chhash_link* l_, \
+						size_t h_) \
+	{ \
+		csnip_chhash_link** b_ = prefix##_internal_bucket(T, h_); \
+		l_->hval = h_; \
+		l_->next = *b_; \
+		*b_ = l_; \
+		++T->size; \
+	} \
+	\
+	/* Insert a copy of node e, known not to be in the table. */ \
+	static nodetype* prefix##_internal_insert(tbltype* T, \
+						int* err, \
+						nodetype e, \
+						size_t h_) \
+	{ \
+		prefix##_internal_grow(T, err, T->size + 1); \
+		if (err && *err) \
+			return NULL; \
+		nodetype* N_ = poolprefix##alloc_item(&T->pool, err); \
+		if (err && *err) \
+			return NULL; \
+		*N_ = e; \
+		prefix##_internal_linknew(T, &N_->linkmember, h_); \
+		return N_; \
+	} \
+	\
+	/* Creation / Deletion */ \
+	scope tbltype* prefix##make(int* err) \
+	{ \
+		if (err) *err = 0; \
+		\
+		tbltype* T; \
+		csnip_mem_Alloc(1, T, *err); \
+		if (err && *err) \
+			return NULL; \
+		T->size = 0; \
+		T->nb = 0; \
+		T->bucket = NULL; \
+		T->old_nb = 0; \
+		T->old_bucket = NULL; \
+		T->migrated = 0; \
+		T->pool = poolprefix##init_empty(); \
+		return T; \
+	} \
+	\
+	scope void prefix##free(tbltype* T) \
+	{ \
+		if (T->bucket) csnip_mem_Free(T->bucket); \
+		if (T->old_bucket) csnip_mem_Free(T->old_bucket); \
+		poolprefix##deinit(&T->pool); \
+		csnip_mem_Free(T); \
+	} \
+	\
+	/* Pool allocated nodes */ \
+	scope int prefix##insert(tbltype* T, int* err, nodetype e) \
+	{ \
+		if (err) *err = 0; \
+		\
+		keytype k1 = (get_key); \
+		const size_t h_ = (size_t)(hash); \
+		prefix##_internal_migrate(T, CSNIP_CHHASH_TABLE_MIGRATE); \
+		if (prefix##_internal_findref(T, k1, h_)) \
+			return 0; \
+		if (prefix##_internal_insert(T, err, e, h_) == NULL) \
+			return 0; \
+		return 1; \
+	} \
+	\
+	scope int prefix##insert_or_assign(tbltype* T, \
+				int* err, \
+				nodetype e, \
+				nodetype* old) \
+	{ \
+		if (err) *err = 0; \
+		\
+		keytype k1 = (get_key); \
+		const size_t h_ = (size_t)(hash); \
+		prefix##_internal_migrate(T, CSNIP_CHHASH_TABLE_MIGRATE); \
+		csnip_chhash_link** p_ = \
+			prefix##_internal_findref(T, k1, h_); \
+		if (p_) { \
+			nodetype* N_ = prefix##_internal_node(*p_); \
+			const csnip_chhash_link l_ = N_->linkmember; \
+			if (old) *old = *N_; \
+			*N_ = e; \
+			N_->linkmember = l_; \
+			return 0; \
+		} \
+		if (prefix##_internal_insert(T, err, e, h_) == NULL) \
+			return 0; \
+		return 1; \
+	} \
+	\
+	scope nodetype* prefix##find_or_insert(tbltype* T, \
+					int* err, \
+					nodetype e) \
+	{ \
+		if (err) *err = 0; \
+		\
+		keytype k1 = (get_key); \
+		const size_t h_ = (size_t)(hash); \
+		prefix##_internal_migrate(T, CSNIP_CHHASH_TABLE_MIGRATE); \
+		csnip_chhash_link** p_ = \
+			prefix##_internal_findref(T, k1, h_); \
+		if (p_) \
+			return prefix##_internal_node(*p_); \
+		return prefix##_internal_insert(T, err, e, h_); \
+	} \
+	\
+	scope _Bool prefix##remove(tbltype* T, int* err, keytype key) \
+	{ \
+		if (err) *err = 0; \
+		\
+		nodetype* N_ = prefix##unlink(T, key); \
+		if (N_ == NULL) \
+			return 0; \
+		poolprefix##free_item(&T->pool, N_); \
+		return 1; \
+	} \
+	\
+	/* Caller allocated nodes */ \
+	scope nodetype* prefix##link(tbltype* T, int* err, nodetype* nd) \
+	{ \
+		if (err) *err = 0; \
+		\
+		nodetype e = *nd; \
+		keytype k1 = (get_key); \
+		const size_t h_ = (size_t)(hash); \
+		prefix##_internal_migrate(T, CSNIP_CHHASH_TABLE_MIGRATE); \
+		csnip_chhash_link** p_ = \
+			prefix##_internal_findref(T, k1, h_); \
+		if (p_) \
+			return prefix##_internal_node(*p_); \
+		prefix##_internal_grow(T, err, T->size + 1); \
+		if (err && *err) \
+			return NULL; \
+		prefix##_internal_linknew(T, &nd->linkmember, h_); \
+		return nd; \
+	} \
+	\
+	scope nodetype* prefix##unlink(tbltype* T, keytype key) \
+	{ \
+		keytype k1 = key; \
+		csnip_chhash_link** p_ = \
+			prefix##_internal_findref(T, key, (size_t)(hash)); \
+		if (p_ == NULL) \
+			return NULL; \
+		csnip_chhash_link* l_ = *p_; \
+		*p_ = l_->next; \
+		--T->size; \
+		return prefix##_internal_node(l_); \
+	} \
+	\
+	scope void prefix##unlinknode(tbltype* T, nodetype* nd) \
+	{ \
+		csnip_chhash_link* l_ = &nd->linkmember; \
+		csnip_chhash_link** p_ = \
+			prefix##_internal_bucket(T, l_->hval); \
+		while (*p_ != l_) { \
+			assert(*p_ != NULL); \
+			p_ = &(*p_)->next; \
+		} \
+		*p_ = l_->next; \
+		--T->size; \
+	} \
+	\
+	/* Search */ \
+	scope nodetype* prefix##find(const tbltype* T, keytype key) \
+	{ \
+		keytype k1 = key; \
+		csnip_chhash_link** p_ = \
+			prefix##_internal_findref(T, key, (size_t)(hash)); \
+		if (p_) \
+			return prefix##_internal_node(*p_); \
+		return NULL; \
+	} \
+	\
+	/* Size and capacity */ \
+	scope size_t prefix##size(const tbltype* T) \
+	{ \
+		return T->size; \
+	} \
+	\
+	scope size_t prefix##capacity(const tbltype* T) \
+	{ \
+		return T->nb; \
+	} \
+	\
+	scope void prefix##reserve(tbltype* T, int* err, size_t min_size) \
+	{ \
+		if (err) *err = 0; \
+		prefix##_internal_grow(T, err, min_size); \
+		prefix##_internal_migrate(T, T->old_nb); \
+	} \
+	\
+	/* Iteration.
+	 *
+	 * The unmigrated buckets of the old array come first, then the
+	 * buckets of the new array.
+	 */ \
+	static nodetype* prefix##_internal_scan(const tbltype* T, \
+						_Bool in_old, \
+						size_t i) \
+	{ \
+		if (in_old) { \
+			for (; i < T->old_nb; ++i) { \
+				if (T->old_bucket[i]) { \
+					return prefix##_internal_node( \
+						T->old_bucket[i]); \
+				} \
+			} \
+			i = 0; \
+		} \
+		for (; i < T->nb; ++i) { \
+			if (T->bucket[i]) \
+				return prefix##_internal_node(T->bucket[i]); \
+		} \
+		return NULL; \
+	} \
+	\
+	scope nodetype* prefix##first(const tbltype* T) \
+	{ \
+		return prefix##_internal_scan(T, 1, T->migrated); \
+	} \
+	\
+	scope nodetype* prefix##next(const tbltype* T, \
+					const nodetype* nd) \
+	{ \
+		const csnip_chhash_link* l_ = &nd->linkmember; \
+		if (l_->next) \
+			return prefix##_internal_node(l_->next); \
+		if (T->old_nb) { \
+			const size_t i = l_->hval & (T->old_nb - 1); \
+			if (i >= T->migrated) \
+				return prefix##_internal_scan(T, 1, i + 1); \
+		} \
+		return prefix##_internal_scan(T, 0, \
+			(l_->hval & (T->nb - 1)) + 1); \
+	}
+
+/** @}
+ *  @}
+ */
+
+#endif /* CSNIP_CHHASH_TABLE_H */
+
+#if defined(CSNIP_SHORT_NAMES) && !defined(CSNIP_CHHASH_TABLE_HAVE_SHORT_NAMES)
+#define chhash_link			csnip_chhash_link
+#define CSNIP_CHHASH_TABLE_HAVE_SHORT_NAMES
+#endif /* CSNIP_SHORT_NAMES && !CSNIP_CHHASH_TABLE_HAVE_SHORT_NAMES */
@@ -0,0 +1,261 @@
+#include <math.h>
+#include <string.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/cmsketch.h>
+#include <csnip/err.h>
+#include <csnip/hash.h>
+#include <csnip/mem.h>
+
+/* Hash value of row i.  The counter index is given by the top lgw
+ * bits, the sign for the count sketch by the bit below them. */
+static uint64_t row_hash(uint64_t h1, uint64_t h2, int i)
+{
+	return (h1 + (uint64_t)i * h2) * 0x9e3779b97f4a7c15ull;
+}
+
+static size_t row_index(uint64_t u, int lgw)
+{
+	return (size_t)(u >> (64 - lgw));
+}
+
+static int row_sign(uint64_t u, int lgw)
+{
+	return (u >> (63 - lgw)) & 1 ? -1 : 1;
+}
+
+/* Check the dimensions and compute the base 2 logarithm of the
+ * rounded width; returns -1 if invalid. */
+static int dims_lgw(size_t width, int depth)
+{
+	if (depth < 1 || depth > CSNIP_CMSKETCH_MAX_DEPTH || width == 0)
+		return -1;
+	int lgw = 1;
+	while (lgw <= 32 && ((size_t)1 << lgw) < width)
+		++lgw;
+	return lgw > 32 ? -1 : lgw;
+}
+
+/* Dimensions for given error bounds: the width is c / eps^q, the
+ * depth ln(1 / delta).  Returns 0 if the bounds are out of range. */
+static _Bool dims_for(double eps, double delta, double c, int q,
+		size_t* width, int* depth)
+{
+	if (!(eps > 0.0 && eps < 1.0 && delta > 0.0 && delta < 1.0))
+		return 0;
+	const double w = ceil(c / pow(eps, q));
+	const double d = ceil(log(1.0 / delta));
+	if (w > 4294967296.0 || d > CSNIP_CMSKETCH_MAX_DEPTH)
+		return 0;
+	*width = (size_t)w;
+	*depth = (d < 1.0 ? 1 : (int)d);
+	return 1;
+}
+
+/* Count-min sketch */
+
+cmsketch* cmsketch_make(size_t width, int depth, int* err)
+{
+	if (err) *err = 0;
+
+	const int lgw = dims_lgw(width, depth);
+	if (lgw < 0) {
+		csnip_err_Raise(err_INVAL, *err);
+		return NULL;
+	}
+	cmsketch* S;
+	mem_Alloc(1, S, *err);
+	if (err && *err)
+		return NULL;
+	S->lgw = lgw;
+	S->width = (size_t)1 << lgw;
+	S->depth = depth;
+	S->total = 0;
+	mem_Alloc0(S->width * (size_t)depth, S->count, *err);
+	if (err && *err) {
+		mem_Free(S);
+		return NULL;
+	}
+	return S;
+}
+
+cmsketch* cmsketch_make_for(double eps, double delta, int* err)
+{
+	size_t width;
+	int depth;
+	if (!dims_for(eps, delta, exp(1.0), 1, &width, &depth)) {
+		if (err) *err = 0;
+		csnip_err_Raise(err_INVAL, *err);
+		return NULL;
+	}
+	return cmsketch_make(width, depth, err);
+}
+
+void cmsketch_free(cmsketch* S)
+{
+	mem_Free(S->count);
+	mem_Free(S);
+}
+
+void cmsketch_clear(cmsketch* S)
+{
+	memset(S->count, 0, S->width * (size_t)S->depth * sizeof(uint64_t));
+	S->total = 0;
+}
+
+void cmsketch_add(cmsketch* S, uint64_t h, uint64_t c)
+{
+	uint64_t h1, h2;
+	hash_split64(h, &h1, &h2);
+	uint64_t* row = S->count;
+	for (int i = 0; i < S->depth; ++i) {
+		row[row_index(row_hash(h1, h2, i), S->lgw)] += c;
+		row += S->width;
+	}
+	S->total += c;
+}
+
+void cmsketch_add_many(cmsketch* S, const uint64_t* h, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		cmsketch_add(S, h[i], 1);
+}
+
+uint64_t cmsketch_estimate(const cmsketch* S, uint64_t h)
+{
+	uint64_t h1, h2;
+	hash_split64(h, &h1, &h2);
+	const uint64_t* row = S->count;
+	uint64_t est = UINT64_MAX;
+	for (int i = 0; i < S->depth; ++i) {
+		const uint64_t c = row[row_index(row_hash(h1, h2, i), S->lgw)];
+		if (c < est)
+			est = c;
+		row += S->width;
+	}
+	return est;
+}
+
+void cmsketch_merge(cmsketch* into, const cmsketch* other, int* err)
+{
+	if (err) *err = 0;
+
+	if (into->width != other->width || into->depth != other->depth) {
+		csnip_err_Raise(err_INVAL, *err);
+		return;
+	}
+	const size_t n = into->width * (size_t)into->depth;
+	for (size_t i = 0; i < n; ++i)
+		into->count[i] += other->count[i];
+	into->total += other->total;
+}
+
+/* Count sketch */
+
+csketch* csketch_make(size_t width, int depth, int* err)
+{
+	if (err) *err = 0;
+
+	const int lgw = dims_lgw(width, depth);
+	if (lgw < 0) {
+		csnip_err_Raise(err_INVAL, *err);
+		return NULL;
+	}
+	csketch* S;
+	mem_Alloc(1, S, *err);
+	if (err && *err)
+		return NULL;
+	S->lgw = lgw;
+	S->width = (size_t)1 << lgw;
+	S->depth = depth;
+	mem_Alloc0(S->width * (size_t)depth, S->count, *err);
+	if (err && *err) {
+		mem_Free(S);
+		return NULL;
+	}
+	return S;
+}
+
+csketch* csketch_make_for(double eps, double delta, int* err)
+{
+	size_t width;
+	int depth;
+	if (!dims_for(eps, delta, 3.0, 2, &width, &depth)) {
+		if (err) *err = 0;
+		csnip_err_Raise(err_INVAL, *err);
+		return NULL;
+	}
+	/* Odd depth, so that the median is a single row's value */
+	if (depth % 2 == 0)
+		depth += (depth < CSNIP_CMSKETCH_MAX_DEPTH ? 1 : -1);
+	return csketch_make(width, depth, err);
+}
+
+void csketch_free(csketch* S)
+{
+	mem_Free(S->count);
+	mem_Free(S);
+}
+
+void csketch_clear(csketch* S)
+{
+	memset(S->count, 0, S->width * (size_t)S->depth * sizeof(int64_t));
+}
+
+void csketch_add(csketch* S, uint64_t h, int64_t c)
+{
+	uint64_t h1, h2;
+	hash_split64(h, &h1, &h2);
+	int64_t* row = S->count;
+	for (int i = 0; i < S->depth; ++i) {
+		const uint64_t u = row_hash(h1, h2, i);
+		row[row_index(u, S->lgw)] += row_sign(u, S->lgw) * c;
+		row += S->width;
+	}
+}
+
+void csketch_add_many(csketch* S, const uint64_t* h, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		csketch_add(S, h[i], 1);
+}
+
+int64_t csketch_estimate(const csketch* S, uint64_t h)
+{
+	uint64_t h1, h2;
+	hash_split64(h, &h1, &h2);
+	const int64_t* row = S->count;
+	int64_t v[CSNIP_CMSKETCH_MAX_DEPTH];
+	for (int i = 0; i < S->depth; ++i) {
+		const uint64_t u = row_hash(h1, h2, i);
+		const int64_t c = row_sign(u, S->lgw)
+				* row[row_index(u, S->lgw)];
+
+		/* Insertion sort */
+		int j = i;
+		while (j > 0 && v[j - 1] > c) {
+			v[j] = v[j - 1];
+			--j;
+		}
+		v[j] = c;
+		row += S->width;
+	}
+
+	const int d = S->depth;
+	if (d % 2)
+		return v[d / 2];
+	return v[d / 2 - 1] + (v[d / 2] - v[d / 2 - 1]) / 2;
+}
+
+void csketch_merge(csketch* into, const csketch* other, int* err)
+{
+	if (err) *err = 0;
+
+	if (into->width != other->width || into->depth != other->depth) {
+		csnip_err_Raise(err_INVAL, *err);
+		return;
+	}
+	const size_t n = into->width * (size_t)into->depth;
+	for (size_t i = 0; i < n; ++i)
+		into->count[i] += other->count[i];
+}
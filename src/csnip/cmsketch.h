@@ -0,0 +1,182 @@
+#ifndef CSNIP_CMSKETCH_H
+#define CSNIP_CMSKETCH_H
+
+/**	@file cmsketch.h
+ *	@brief			Frequency sketches
+ *	@defgroup cmsketch	Frequency sketches
+ *	@{
+ *
+ *	@brief Count-min and count sketches for frequency estimation.
+ *
+ *	These sketches estimate how often each key occurs in a stream,
+ *	in a fixed amount of memory that does not depend on the number
+ *	of distinct keys.  Both consist of depth rows of width
+ *	counters; each key is mapped to one counter per row.  Updates
+ *	and queries take O(depth) time.
+ *
+ *	* The count-min sketch (csnip_cmsketch) adds the counts to the
+ *	  counters and estimates the frequency as the minimum over the
+ *	  rows.  It never underestimates; with width e / eps and depth
+ *	  ln(1 / delta), the overestimate is at most eps times the
+ *	  total count with probability 1 - delta.  Counts must be
+ *	  nonnegative.
+ *
+ *	* The count sketch (csnip_csketch) adds the counts with a
+ *	  random sign per row, and estimates the frequency as the
+ *	  median over the rows.  The estimate is unbiased, and its error
+ *	  is bounded by eps times the L2 norm of the frequency vector
+ *	  for width 3 / eps^2, which is much better than the count-min
+ *	  bound for skewed streams.  Counts may be negative.
+ *
+ *	Sketches with the same dimensions can be merged, giving the
+ *	sketch of the concatenated streams, similar to
+ *	csnip_meanvar_merge().
+ *
+ *	Keys are given as 64 bit hash values, which are remixed before
+ *	use.  The width is rounded up to a power of 2.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**	Maximum number of rows. */
+#define CSNIP_CMSKETCH_MAX_DEPTH	32
+
+/**	Count-min sketch. */
+typedef struct {
+	size_t width;		/**< Number of counters per row */
+	int lgw;		/**< Base 2 logarithm of the width */
+	int depth;		/**< Number of rows */
+	uint64_t total;		/**< Sum of all counts added */
+	uint64_t* count;	/**< The counters, row by row */
+} csnip_cmsketch;
+
+/**	Create a count-min sketch.
+ *
+ *	@param	width
+ *		Number of counters per row; rounded up to a power of 2,
+ *		which is at least 2 and at most 2^32.
+ *
+ *	@param	depth
+ *		Number of rows, between 1 and CSNIP_CMSKETCH_MAX_DEPTH.
+ *
+ *	@param	err
+ *		Error return.  csnip_err_INVAL for invalid dimensions,
+ *		csnip_err_NOMEM if out of memory.
+ */
+csnip_cmsketch* csnip_cmsketch_make(size_t width, int depth, int* err);
+
+/**	Create a count-min sketch for given error bounds.
+ *
+ *	The sketch overestimates counts by at most @a eps times the
+ *	total count, with probability at least 1 - @a delta.
+ */
+csnip_cmsketch* csnip_cmsketch_make_for(double eps, double delta, int* err);
+
+/**	Free a count-min sketch. */
+void csnip_cmsketch_free(csnip_cmsketch* S);
+
+/**	Reset all counters to zero. */
+void csnip_cmsketch_clear(csnip_cmsketch* S);
+
+/**	Add @a c occurrences of the key with hash value @a h. */
+void csnip_cmsketch_add(csnip_cmsketch* S, uint64_t h, uint64_t c);
+
+/**	Add one occurrence of each of @a n keys. */
+void csnip_cmsketch_add_many(csnip_cmsketch* S, const uint64_t* h, size_t n);
+
+/**	Estimate the count of a key.
+ *
+ *	The estimate is never below the true count.
+ */
+uint64_t csnip_cmsketch_estimate(const csnip_cmsketch* S, uint64_t h);
+
+/**	Merge count-min sketches.
+ *
+ *	Add the counts of @a other to @a into.  The sketches must have
+ *	the same dimensions, otherwise csnip_err_INVAL is raised.
+ */
+void csnip_cmsketch_merge(csnip_cmsketch* into,
+			const csnip_cmsketch* other,
+			int* err);
+
+/**	Count sketch. */
+typedef struct {
+	size_t width;		/**< Number of counters per row */
+	int lgw;		/**< Base 2 logarithm of the width */
+	int depth;		/**< Number of rows */
+	int64_t* count;		/**< The counters, row by row */
+} csnip_csketch;
+
+/**	Create a count sketch.
+ *
+ *	The parameters are as for csnip_cmsketch_make().  An odd depth
+ *	is recommended, so that the median is a single row's value.
+ */
+csnip_csketch* csnip_csketch_make(size_t width, int depth, int* err);
+
+/**	Create a count sketch for given error bounds.
+ *
+ *	The error of the estimate is at most @a eps times the L2 norm
+ *	of the frequency vector, with probability at least 1 - @a
+ *	delta.
+ */
+csnip_csketch* csnip_csketch_make_for(double eps, double delta, int* err);
+
+/**	Free a count sketch. */
+void csnip_csketch_free(csnip_csketch* S);
+
+/**	Reset all counters to zero. */
+void csnip_csketch_clear(csnip_csketch* S);
+
+/**	Add @a c occurrences of the key with hash value @a h. */
+void csnip_csketch_add(csnip_csketch* S, uint64_t h, int64_t c);
+
+/**	Add one occurrence of each of @a n keys. */
+void csnip_csketch_add_many(csnip_csketch* S, const uint64_t* h, size_t n);
+
+/**	Estimate the count of a key. */
+int64_t csnip_csketch_estimate(const csnip_csketch* S, uint64_t h);
+
+/**	Merge count sketches.
+ *
+ *	Add the counts of @a other to @a into.  The sketches must have
+ *	the same dimensions, otherwise csnip_err_INVAL is raised.
+ */
+void csnip_csketch_merge(csnip_csketch* into,
+			const csnip_csketch* other,
+			int* err);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+
+#endif /* CSNIP_CMSKETCH_H */
+
+#if defined(CSNIP_SHORT_NAMES) && !defined(CSNIP_CMSKETCH_HAVE_SHORT_NAMES)
+#define cmsketch			csnip_cmsketch
+#define cmsketch_make			csnip_cmsketch_make
+#define cmsketch_make_for		csnip_cmsketch_make_for
+#define cmsketch_free			csnip_cmsketch_free
+#define cmsketch_clear			csnip_cmsketch_clear
+#define cmsketch_add			csnip_cmsketch_add
+#define cmsketch_add_many		csnip_cmsketch_add_many
+#define cmsketch_estimate		csnip_cmsketch_estimate
+#define cmsketch_merge			csnip_cmsketch_merge
+#define csketch				csnip_csketch
+#define csketch_make			csnip_csketch_make
+#define csketch_make_for		csnip_csketch_make_for
+#define csketch_free			csnip_csketch_free
+#define csketch_clear			csnip_csketch_clear
+#define csketch_add			csnip_csketch_add
+#define csketch_add_many		csnip_csketch_add_many
+#define csketch_estimate		csnip_csketch_estimate
+#define csketch_merge			csnip_csketch_merge
+#define CSNIP_CMSKETCH_HAVE_SHORT_NAMES
+#endif /* CSNIP_SHORT_NAMES && !CSNIP_CMSKETCH_HAVE_SHORT_NAMES */
@@ -0,0 +1,240 @@
+#include <string.h>
+
+#include <csnip/csnip_conf.h>
+#ifdef CSNIP_CONF__SUPPORT_THREADING
+#include <pthread.h>
+#endif
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/crc32c.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_CRC
+#include <nmmintrin.h>
+#endif
+
+/* CRC32C.
+ *
+ * All internal functions work on the bare CRC register, without the
+ * pre- and post-inversion of the checksum, and in the reflected bit
+ * order, i.e., bit 31 holds the coefficient of x^0.
+ *
+ * Appending n zero bytes to a message multiplies its register by
+ * x^(8n) modulo the polynomial; this is used both by combine() and
+ * by the hardware implementation, which computes three streams
+ * independently and then shifts the registers of the first two into
+ * place.  For the fixed stream lengths used there, the shift is done
+ * with tables, which is faster than the bitwise multiplication.
+ */
+
+#define POLY		0x82f63b78ul	/* Reflected Castagnoli polynomial */
+#define LONG		8192		/* Stream lengths for 3-way CRC */
+#define SHORT		256
+
+/* Slicing-by-8 tables */
+static uint32_t tbl[8][256];
+
+/* Tables shifting the register by LONG resp. SHORT zero bytes */
+static uint32_t tbl_long[4][256];
+static uint32_t tbl_short[4][256];
+
+/* x2n[k] = x^(2^k) mod POLY; enough for lengths up to 2^64 bytes */
+static uint32_t x2n[67];
+
+static _Bool use_hw;
+
+/* Little endian reads */
+static inline uint64_t r64(const unsigned char* p)
+{
+	uint64_t v;
+	memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+static inline uint32_t r32(const unsigned char* p)
+{
+	uint32_t v;
+	memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap32(v);
+#endif
+	return v;
+}
+
+/* Product of a and b modulo POLY */
+static uint32_t multmodp(uint32_t a, uint32_t b)
+{
+	uint32_t m = 1ul << 31;
+	uint32_t p = 0;
+	for (;;) {
+		if (a & m) {
+			p ^= b;
+			if ((a & (m - 1)) == 0)
+				break;
+		}
+		m >>= 1;
+		b = (b & 1 ? (b >> 1) ^ POLY : b >> 1);
+	}
+	return p;
+}
+
+/* x^(8n) mod POLY */
+static uint32_t x8nmodp(uint64_t n)
+{
+	uint32_t p = 1ul << 31;
+	for (int k = 3; n; n >>= 1, ++k) {
+		if (n & 1)
+			p = multmodp(x2n[k], p);
+	}
+	return p;
+}
+
+static void make_shift_table(uint32_t t[4][256], uint64_t n)
+{
+	const uint32_t op = x8nmodp(n);
+	for (uint32_t b = 0; b < 256; ++b) {
+		for (int j = 0; j < 4; ++j)
+			t[j][b] = multmodp(op, b << (8 * j));
+	}
+}
+
+static inline uint32_t shift(uint32_t t[4][256], uint32_t c)
+{
+	return t[0][c & 0xff] ^ t[1][(c >> 8) & 0xff]
+		^ t[2][(c >> 16) & 0xff] ^ t[3][c >> 24];
+}
+
+static void init(void)
+{
+	for (uint32_t n = 0; n < 256; ++n) {
+		uint32_t c = n;
+		for (int k = 0; k < 8; ++k)
+			c = (c & 1 ? (c >> 1) ^ POLY : c >> 1);
+		tbl[0][n] = c;
+	}
+	for (uint32_t n = 0; n < 256; ++n) {
+		for (int k = 1; k < 8; ++k) {
+			const uint32_t c = tbl[k - 1][n];
+			tbl[k][n] = (c >> 8) ^ tbl[0][c & 0xff];
+		}
+	}
+
+	uint32_t p = 1ul << 30;		/* x^1 */
+	x2n[0] = p;
+	for (size_t k = 1; k < sizeof(x2n) / sizeof(x2n[0]); ++k)
+		x2n[k] = p = multmodp(p, p);
+
+	make_shift_table(tbl_long, LONG);
+	make_shift_table(tbl_short, SHORT);
+
+#ifdef HAVE_X86_CRC
+	__builtin_cpu_init();
+	use_hw = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#ifdef CSNIP_CONF__SUPPORT_THREADING
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+#define ensure_init()	pthread_once(&init_once, init)
+#else
+static _Bool init_done = 0;
+#define ensure_init() \
+	do { \
+		if (!init_done) { \
+			init(); \
+			init_done = 1; \
+		} \
+	} while (0)
+#endif
+
+/* Slicing-by-8 */
+static uint32_t crc_sw(uint32_t c, const unsigned char* p, size_t n)
+{
+	while (n >= 8) {
+		const uint64_t w = r64(p) ^ c;
+		c = tbl[7][w & 0xff] ^ tbl[6][(w >> 8) & 0xff]
+			^ tbl[5][(w >> 16) & 0xff] ^ tbl[4][(w >> 24) & 0xff]
+			^ tbl[3][(w >> 32) & 0xff] ^ tbl[2][(w >> 40) & 0xff]
+			^ tbl[1][(w >> 48) & 0xff] ^ tbl[0][w >> 56];
+		p += 8;
+		n -= 8;
+	}
+	while (n--)
+		c = tbl[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+	return c;
+}
+
+#ifdef HAVE_X86_CRC
+
+#if defined(__x86_64__)
+#define WSZ		8
+#define crcw(c, p)	((uint32_t)_mm_crc32_u64((c), r64(p)))
+#else
+#define WSZ		4
+#define crcw(c, p)	_mm_crc32_u32((c), r32(p))
+#endif
+
+/* Three streams of len bytes each, shifted together with t */
+#define crc_3way(c, p, n, len, t) \
+	while ((n) >= 3 * (len)) { \
+		uint32_t c1 = 0, c2 = 0; \
+		const unsigned char* end = (p) + (len); \
+		do { \
+			(c) = crcw((c), (p)); \
+			c1 = crcw(c1, (p) + (len)); \
+			c2 = crcw(c2, (p) + 2 * (len)); \
+			(p) += WSZ; \
+		} while ((p) < end); \
+		(c) = shift((t), (c)) ^ c1; \
+		(c) = shift((t), (c)) ^ c2; \
+		(p) += 2 * (len); \
+		(n) -= 3 * (len); \
+	}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc_hw(uint32_t c, const unsigned char* p, size_t n)
+{
+	crc_3way(c, p, n, LONG, tbl_long)
+	crc_3way(c, p, n, SHORT, tbl_short)
+	while (n >= WSZ) {
+		c = crcw(c, p);
+		p += WSZ;
+		n -= WSZ;
+	}
+	while (n--)
+		c = _mm_crc32_u8(c, *p++);
+	return c;
+}
+
+#endif /* HAVE_X86_CRC */
+
+uint32_t csnip_crc32c(uint32_t crc, const void* buf, size_t sz)
+{
+	ensure_init();
+#ifdef HAVE_X86_CRC
+	if (use_hw)
+		return ~crc_hw(~crc, (const unsigned char*)buf, sz);
+#endif
+	return ~crc_sw(~crc, (const unsigned char*)buf, sz);
+}
+
+uint32_t csnip_crc32c_sw(uint32_t crc, const void* buf, size_t sz)
+{
+	ensure_init();
+	return ~crc_sw(~crc, (const unsigned char*)buf, sz);
+}
+
+_Bool csnip_crc32c_has_hw(void)
+{
+	ensure_init();
+	return use_hw;
+}
+
+uint32_t csnip_crc32c_combine(uint32_t crc_a, uint32_t crc_b, uint64_t len_b)
+{
+	ensure_init();
+	return multmodp(x8nmodp(len_b), crc_a) ^ crc_b;
+}
@@ -0,0 +1,78 @@
+#ifndef CSNIP_CRC32C_H
+#define CSNIP_CRC32C_H
+
+/** @file crc32c.h
+ *  @addtogroup hash_functions	Hash functions
+ *  @{
+ *
+ *  CRC32C checksums
+ *
+ *  The CRC-32C (Castagnoli) checksum, as used by iSCSI, ext4, and
+ *  many storage formats.  On x86 processors with SSE4.2, the crc32
+ *  instruction is used, with three independent streams for large
+ *  buffers to hide the latency of the instruction.  Otherwise, a
+ *  slicing-by-8 table implementation is used.  The choice is made at
+ *  run time, on the first call.
+ *
+ *  The checksums of separately computed pieces can be combined with
+ *  csnip_crc32c_combine(), so that large buffers can be checksummed
+ *  in parallel.
+ *
+ *  References:
+ *	[1] RFC 3720, Appendix B.4
+ *	[2] M. Adler, crc32c.c, https://stackoverflow.com/a/17646775
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Compute CRC32C checksum.
+ *
+ *  @param	crc
+ *		Checksum of the preceding data; 0 when starting.  The
+ *		checksum of a concatenation of buffers is obtained by
+ *		chaining, i.e.,
+ *
+ *			c = csnip_crc32c(0, buf1, sz1);
+ *			c = csnip_crc32c(c, buf2, sz2);
+ *
+ *		gives the checksum of the concatenation of buf1 and
+ *		buf2.
+ *
+ *  @param	buf
+ *		Pointer to the buffer.
+ *
+ *  @param	sz
+ *		Size of the buffer in bytes.
+ */
+uint32_t csnip_crc32c(uint32_t crc, const void* buf, size_t sz);
+
+/** Compute CRC32C checksum in software.
+ *
+ *  Same as csnip_crc32c(), but always uses the table implementation.
+ */
+uint32_t csnip_crc32c_sw(uint32_t crc, const void* buf, size_t sz);
+
+/** Whether csnip_crc32c() uses hardware instructions. */
+_Bool csnip_crc32c_has_hw(void);
+
+/** Combine the checksums of two buffers.
+ *
+ *  Given the checksum crc_a of a buffer A, and the checksum crc_b of
+ *  a buffer B of length len_b, both computed starting from 0, returns
+ *  the checksum of the concatenation of A and B.  This takes
+ *  O(log len_b) time.
+ */
+uint32_t csnip_crc32c_combine(uint32_t crc_a, uint32_t crc_b, uint64_t len_b);
+
+/** @} */
+
+#endif /* CSNIP_CRC32C_H */
+
+#if defined(CSNIP_SHORT_NAMES) && !defined(CSNIP_CRC32C_HAVE_SHORT_NAMES)
+#define crc32c		csnip_crc32c
+#define crc32c_sw	csnip_crc32c_sw
+#define crc32c_has_hw	csnip_crc32c_has_hw
+#define crc32c_combine	csnip_crc32c_combine
+#define CSNIP_CRC32C_HAVE_SHORT_NAMES
+#endif /* CSNIP_SHORT_NAMES && !CSNIP_CRC32C_HAVE_SHORT_NAMES */
@@ -8,11 +8,30 @@
  *  Hash functions
  *
  *  Defines good non-cryptographic hashing functions.
- *  Included are the 32 and 64 bit variants of the FNV-1a hash.
+ *  Included are the 32 and 64 bit variants of the FNV-1a hash, and
+ *  the 64 bit mx64 hash, as well as integer mixing functions,
+ *  reductions of hash values to a range, and consistent hashing for
+ *  assigning keys to shards.
+ *
+ *  FNV-1a is simple, but processes a single byte per multiplication.
+ *  mx64 processes 32 bytes per step in two independent lanes, using
+ *  the multiply-and-fold (128 bit product, high half xor low half)
+ *  construction of wyhash, and is several times faster for keys
+ *  longer than a few bytes.  Its output is not compatible with
+ *  wyhash.
  *
  *  References:
  *	[1] https://tools.ietf.org/html/draft-eastlake-fnv-11
  *	[2] http://isthe.com/chongo/tech/comp/fnv/
+ *	[3] https://github.com/wangyi-fudan/wyhash
+ *	[4] https://github.com/aappleby/smhasher (MurmurHash3 fmix)
+ *	[5] D. Lemire, "A fast alternative to the modulo reduction",
+ *	    https://lemire.me/blog/2016/06/27/\
+ *	    a-fast-alternative-to-the-modulo-reduction/
+ *	[6] J. Lamping, E. Veach, "A Fast, Minimal Memory, Consistent
+ *	    Hash Algorithm", arXiv:1406.2294
+ *	[7] D. Thaler, C. Ravishankar, "Using Name-Based Mappings to
+ *	    Increase Hit Rates", IEEE/ACM Trans. Networking 6(1), 1998
  *
  *  Fairly interesting reads on the topic:
  *	http://programmers.stackexchange.com/questions/49550/\
@@ -107,6 +126,298 @@ uint64_t csnip_hash_fnv64_b(const void* buf, size_t sz, uint64_t h0);
  */
 uint64_t csnip_hash_fnv64_s(const char* str, uint64_t h0);
 
+/** Compute mx64 hash.
+ *
+ *  Compute the mx64 hash of a memory buffer.
+ *
+ *  @param	buf
+ *		pointer to memory buffer to hash
+ *
+ *  @param	sz
+ *		size of the memory buffer to hash
+ *
+ *  @param	seed
+ *		seed value; different seeds give unrelated hash
+ *		functions.  Unlike for the FNV hashes, this is not a
+ *		chaining value; use the csnip_hash_mx64_state functions
+ *		to hash a concatenation of buffers.
+ */
+uint64_t csnip_hash_mx64_b(const void* buf, size_t sz, uint64_t seed);
+
+/** Compute mx64 hash.
+ *
+ *  Compute the mx64 hash of a C string, without the terminating '\0'.
+ *  The result is the same as that of csnip_hash_mx64_b() for the
+ *  characters of the string; the string is hashed in a single pass,
+ *  without determining its length first.
+ */
+uint64_t csnip_hash_mx64_s(const char* str, uint64_t seed);
+
+/** Compute the mx64 hashes of several buffers.
+ *
+ *  Stores csnip_hash_mx64_b(keys[i], lens[i], seed) in out[i] for i <
+ *  n.  The seed dependent setup is only done once, and the keys are
+ *  hashed in independent computations that the processor overlaps,
+ *  which is noticeably faster than separate calls for short keys.
+ */
+void csnip_hash_mx64_many(const void* const* keys,
+			const size_t* lens,
+			size_t n,
+			uint64_t seed,
+			uint64_t* out);
+
+/** Compute the mx64 hashes of an array of 64 bit integers.
+ *
+ *  Stores the mx64 hash of the 8 byte little endian representation
+ *  of keys[i] in out[i], for i < n.  On little endian machines, this
+ *  is csnip_hash_mx64_b(&keys[i], 8, seed).
+ */
+void csnip_hash_mx64_u64_many(const uint64_t* keys,
+			size_t n,
+			uint64_t seed,
+			uint64_t* out);
+
+/** Compute the mx64 hashes of an array of 32 bit integers.
+ *
+ *  The same as csnip_hash_mx64_u64_many(), for the 4 byte little
+ *  endian representations of the keys.
+ */
+void csnip_hash_mx64_u32_many(const uint32_t* keys,
+			size_t n,
+			uint64_t seed,
+			uint64_t* out);
+
+/** Streaming mx64 state.
+ *
+ *  Hashes data given in several pieces.  The result is the same as
+ *  the one of csnip_hash_mx64_b() for the concatenation of the
+ *  pieces.
+ */
+typedef struct {
+	uint64_t s0;		/**< Lane 0 */
+	uint64_t s1;		/**< Lane 1 */
+	uint64_t len;		/**< Number of bytes hashed */
+	unsigned char buf[32];	/**< Bytes not yet processed */
+	size_t nbuf;		/**< Number of bytes in buf */
+} csnip_hash_mx64_state;
+
+/** Initialize a streaming mx64 state with the given seed. */
+void csnip_hash_mx64_init(csnip_hash_mx64_state* S, uint64_t seed);
+
+/** Add a buffer to a streaming mx64 hash. */
+void csnip_hash_mx64_update(csnip_hash_mx64_state* S,
+			const void* buf,
+			size_t sz);
+
+/** Return the hash of the data added so far.
+ *
+ *  The state is not modified, so that more data can be added
+ *  afterwards.
+ */
+uint64_t csnip_hash_mx64_final(const csnip_hash_mx64_state* S);
+
+/** @name Integer mixing
+ *
+ *  Finalizers turning integers into well distributed hash values.
+ *
+ *  Integer and pointer keys are often used directly as hash values;
+ *  that works poorly whenever the keys share their low bits, as
+ *  aligned pointers or multiples of a stride do, since tables with a
+ *  power of two capacity only use the low bits.  The mixing functions
+ *  are bijections, so distinct keys still give distinct hashes, and
+ *  every input bit affects every output bit.
+ *  @{
+ */
+
+/** MurmurHash3 32 bit finalizer. */
+static inline uint32_t csnip_hash_fmix32(uint32_t h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6bul;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35ul;
+	h ^= h >> 16;
+	return h;
+}
+
+/** MurmurHash3 64 bit finalizer. */
+static inline uint64_t csnip_hash_fmix64(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+/** splitmix64 finalizer.
+ *
+ *  The output function of the splitmix64 generator, with slightly
+ *  better avalanche behaviour than csnip_hash_fmix64().
+ */
+static inline uint64_t csnip_hash_splitmix64(uint64_t h)
+{
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+	return h ^ (h >> 31);
+}
+
+/** Derive two hash values for double hashing.
+ *
+ *  Splits the hash value @a h into @a h1 and an odd @a h2, both mixed
+ *  with csnip_hash_splitmix64(), for probe sequences of the form
+ *  h1 + i * h2, as used by Bloom filters and sketches.
+ */
+static inline void csnip_hash_split64(uint64_t h, uint64_t* h1, uint64_t* h2)
+{
+	*h1 = csnip_hash_splitmix64(h);
+	*h2 = csnip_hash_splitmix64(h ^ 0x9e3779b97f4a7c15ull) | 1;
+}
+
+/** Mix a size_t value.
+ *
+ *  Uses csnip_hash_fmix64() or csnip_hash_fmix32() depending on the
+ *  width of size_t.  This is the natural post-mixing function for
+ *  hash tables; see CSNIP_LPHASH_TABLE_POSTMIX.
+ */
+static inline size_t csnip_hash_mix_size(size_t h)
+{
+#if SIZE_MAX > 0xfffffffful
+	return (size_t)csnip_hash_fmix64(h);
+#else
+	return (size_t)csnip_hash_fmix32(h);
+#endif
+}
+
+/** Hash a pointer. */
+static inline size_t csnip_hash_ptr(const void* p)
+{
+	return csnip_hash_mix_size((size_t)(uintptr_t)p);
+}
+
+/** @} */
+
+/** @name Range reduction
+ *
+ *  Maps hash values to table indices.
+ *
+ *  Fibonacci hashing multiplies by 2^w / phi and takes the top bits,
+ *  giving an index into a table of power of two size; the
+ *  multiplication spreads the low bits of the input into the high
+ *  bits, so it is a cheap fix for weak hashes.
+ *
+ *  The multiply-shift reduction [5] maps to [0, n) for arbitrary n,
+ *  as h % n does, but with a multiplication instead of a division.
+ *  It uses the high bits of h, which hence need to be well mixed.
+ *  @{
+ */
+
+/** Fibonacci hashing to lg bits, 1 <= lg <= 32. */
+static inline uint32_t csnip_hash_fib32(uint32_t h, unsigned lg)
+{
+	return (uint32_t)(h * 0x9e3779b9ul) >> (32 - lg);
+}
+
+/** Fibonacci hashing to lg bits, 1 <= lg <= 64. */
+static inline uint64_t csnip_hash_fib64(uint64_t h, unsigned lg)
+{
+	return (h * 0x9e3779b97f4a7c15ull) >> (64 - lg);
+}
+
+/** Reduce a 32 bit hash to the range [0, n). */
+static inline uint32_t csnip_hash_range32(uint32_t h, uint32_t n)
+{
+	return (uint32_t)(((uint64_t)h * n) >> 32);
+}
+
+/** Reduce a 64 bit hash to the range [0, n). */
+static inline uint64_t csnip_hash_range64(uint64_t h, uint64_t n)
+{
+#if defined(__SIZEOF_INT128__)
+	return (uint64_t)(((unsigned __int128)h * n) >> 64);
+#else
+	/* High half of the 128 bit product */
+	const uint64_t hh = h >> 32, hl = (uint32_t)h;
+	const uint64_t nh = n >> 32, nl = (uint32_t)n;
+	const uint64_t ll = hl * nl, lh = hl * nh, hl_ = hh * nl;
+	const uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl_;
+	return hh * nh + (lh >> 32) + (hl_ >> 32) + (mid >> 32);
+#endif
+}
+
+/** @} */
+
+/** @name Consistent hashing
+ *
+ *  Assignment of keys to shards.
+ *
+ *  With h % n, changing the number of shards n reassigns almost all
+ *  keys.  The functions here only move the keys that have to move:
+ *  when a shard is added, it takes its share of the keys from the
+ *  other shards, and when one is removed, only its keys are
+ *  reassigned.
+ *
+ *  Jump consistent hashing [6] assigns to shards numbered 0 to n - 1
+ *  in O(log n) time without memory, but shards can only be added or
+ *  removed at the end.  Rendezvous (highest random weight) hashing
+ *  [7] assigns to arbitrary sets of shards identified by 64 bit ids,
+ *  optionally weighted, in O(n) time.
+ *
+ *  The keys are 64 bit hashes of the actual keys.
+ *  @{
+ */
+
+/** Jump consistent hash.
+ *
+ *  Returns the shard in [0, nshards) for the key; 0 if nshards is 0.
+ */
+uint32_t csnip_hash_jump(uint64_t key, uint32_t nshards);
+
+/** Jump consistent hash of several keys.
+ *
+ *  Stores csnip_hash_jump(keys[i], nshards) in shard[i] for i <
+ *  nkeys.  The keys are processed in groups, so that their
+ *  iterations overlap.
+ */
+void csnip_hash_jump_many(const uint64_t* keys,
+			size_t nkeys,
+			uint32_t nshards,
+			uint32_t* shard);
+
+/** Rendezvous hash.
+ *
+ *  Returns the index in [0, nshards) of the shard with the highest
+ *  score for the key, among the shards with ids ids[0] to
+ *  ids[nshards - 1].  The result depends on the set of ids, but not
+ *  on their order.
+ *
+ *  @param	weight
+ *		relative weights of the shards, or NULL for equal
+ *		weights.  A shard receives a fraction of the keys
+ *		proportional to its weight.  Shards with a weight of 0
+ *		or less receive no keys; if there are no shards with
+ *		positive weight, nshards is returned.
+ */
+size_t csnip_hash_hrw(uint64_t key,
+			const uint64_t* ids,
+			const double* weight,
+			size_t nshards);
+
+/** Rendezvous hash of several keys.
+ *
+ *  Stores csnip_hash_hrw(keys[i], ids, weight, nshards) in shard[i]
+ *  for i < nkeys.
+ */
+void csnip_hash_hrw_many(const uint64_t* keys,
+			size_t nkeys,
+			const uint64_t* ids,
+			const double* weight,
+			size_t nshards,
+			size_t* shard);
+
+/** @} */
+
 /** @} */
 
 #endif /* CSNIP_HASH_H */
@@ -118,6 +429,29 @@ uint64_t csnip_hash_fnv64_s(const char* str, uint64_t h0);
 #define hash_fnv32_s	csnip_hash_fnv32_s
 #define hash_fnv64_b	csnip_hash_fnv64_b
 #define hash_fnv64_s	csnip_hash_fnv64_s
+#define hash_mx64_b	csnip_hash_mx64_b
+#define hash_mx64_s	csnip_hash_mx64_s
+#define hash_mx64_many	csnip_hash_mx64_many
+#define hash_mx64_u64_many	csnip_hash_mx64_u64_many
+#define hash_mx64_u32_many	csnip_hash_mx64_u32_many
+#define hash_mx64_state	csnip_hash_mx64_state
+#define hash_mx64_init	csnip_hash_mx64_init
+#define hash_mx64_update	csnip_hash_mx64_update
+#define hash_mx64_final	csnip_hash_mx64_final
+#define hash_fmix32	csnip_hash_fmix32
+#define hash_fmix64	csnip_hash_fmix64
+#define hash_splitmix64	csnip_hash_splitmix64
+#define hash_split64	csnip_hash_split64
+#define hash_mix_size	csnip_hash_mix_size
+#define hash_ptr	csnip_hash_ptr
+#define hash_fib32	csnip_hash_fib32
+#define hash_fib64	csnip_hash_fib64
+#define hash_range32	csnip_hash_range32
+#define hash_range64	csnip_hash_range64
+#define hash_jump	csnip_hash_jump
+#define hash_jump_many	csnip_hash_jump_many
+#define hash_hrw	csnip_hash_hrw
+#define hash_hrw_many	csnip_hash_hrw_many
 #define CSNIP_HASH_HAVE_SHORT_NAMES
 #endif /* CSNIP_SHORT_NAMES && !CSNIP_HASH_HAVE_SHORT_NAMES */
 
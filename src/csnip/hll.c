@@ -0,0 +1,305 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/err.h>
+#include <csnip/hash.h>
+#include <csnip/hll.h>
+#include <csnip/mem.h>
+
+/* Sparse representation.
+ *
+ * The sparse list consists of a sorted prefix of nsorted entries with
+ * distinct indices, followed by an unsorted tail.  When the tail is
+ * full, it is sorted and merged into the prefix.  The tail holds
+ * nsorted / 8 entries, but at least TAIL and at most TAIL_MAX, so that
+ * the merges take a small number of word moves per entry, and a
+ * sorted copy of the tail fits on the stack.  The sketch is converted
+ * to dense registers when the prefix exceeds 2^p / 4 entries, at
+ * which point it takes about as much memory as the registers.
+ */
+#define TAIL		64
+#define TAIL_MAX	1024
+
+#define ENTRY(idx, rank)	(((uint32_t)(idx) << 8) | (uint32_t)(rank))
+#define ENTRY_IDX(e)		((e) >> 8)
+#define ENTRY_RANK(e)		((int)((e) & 0xff))
+
+/* Number of leading zeros of x, which must be nonzero */
+static int clz64(uint64_t x)
+{
+#if defined(__GNUC__)
+	return __builtin_clzll(x);
+#else
+	int n = 0;
+	while (!(x & (1ull << 63))) {
+		x <<= 1;
+		++n;
+	}
+	return n;
+#endif
+}
+
+static size_t sparse_limit(const hll* H)
+{
+	return ((size_t)1 << H->p) / 4;
+}
+
+/* Maximum tail length for a prefix of nsorted entries */
+static size_t tail_limit(size_t nsorted)
+{
+	const size_t n = nsorted / 8;
+	return (n < TAIL ? TAIL : n > TAIL_MAX ? TAIL_MAX : n);
+}
+
+hll* hll_make(int p, int* err)
+{
+	if (err) *err = 0;
+
+	if (p < CSNIP_HLL_MIN_P || p > CSNIP_HLL_MAX_P) {
+		csnip_err_Raise(err_INVAL, *err);
+		return NULL;
+	}
+	hll* H;
+	mem_Alloc(1, H, *err);
+	if (err && *err)
+		return NULL;
+	H->p = p;
+	H->reg = NULL;
+	H->sparse = NULL;
+	H->nsparse = 0;
+	H->nsorted = 0;
+	H->capsparse = 0;
+	return H;
+}
+
+void hll_free(hll* H)
+{
+	mem_Free(H->reg);
+	mem_Free(H->sparse);
+	mem_Free(H);
+}
+
+void hll_clear(hll* H)
+{
+	mem_Free(H->reg);
+	mem_Free(H->sparse);
+	H->reg = NULL;
+	H->sparse = NULL;
+	H->nsparse = 0;
+	H->nsorted = 0;
+	H->capsparse = 0;
+}
+
+bool hll_is_sparse(const hll* H)
+{
+	return H->reg == NULL;
+}
+
+static int cmp_entry(const void* a, const void* b)
+{
+	const uint32_t x = *(const uint32_t*)a;
+	const uint32_t y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+
+/* Copy the tail to t, and sort it */
+static size_t sorted_tail(const hll* H, uint32_t t[TAIL_MAX])
+{
+	const size_t nt = H->nsparse - H->nsorted;
+	memcpy(t, H->sparse + H->nsorted, nt * sizeof(uint32_t));
+	qsort(t, nt, sizeof(uint32_t), cmp_entry);
+	return nt;
+}
+
+/* Sort the tail and merge it into the sorted prefix.  Of several
+ * entries with the same index, the one with the highest rank is
+ * kept, which is the last one in sort order.
+ */
+static void flush_tail(hll* H)
+{
+	uint32_t t[TAIL_MAX];
+	uint32_t* a = H->sparse;
+	const size_t ns = H->nsorted;
+	const size_t nt = sorted_tail(H, t);
+
+	/* Merge backwards in place, keeping the first entry seen of each
+	 * index.  The write position w never drops below the number of
+	 * entries left to read, so no unread prefix entry is
+	 * overwritten. */
+	size_t i = ns, j = nt, w = ns + nt;
+	while (j > 0) {
+		uint32_t e;
+		if (i > 0 && a[i - 1] > t[j - 1])
+			e = a[--i];
+		else
+			e = t[--j];
+		if (w < ns + nt && ENTRY_IDX(a[w]) == ENTRY_IDX(e))
+			continue;
+		a[--w] = e;
+	}
+	if (i > 0 && w < ns + nt && ENTRY_IDX(a[i - 1]) == ENTRY_IDX(a[w]))
+		--i;
+
+	/* Close the gap left by dropped duplicates */
+	if (w > i)
+		memmove(a + i, a + w, (ns + nt - w) * sizeof(uint32_t));
+	H->nsorted = H->nsparse = i + (ns + nt - w);
+}
+
+static void densify(hll* H, int* err)
+{
+	uint8_t* reg;
+	mem_Alloc0((size_t)1 << H->p, reg, *err);
+	if (err && *err)
+		return;
+	for (size_t i = 0; i < H->nsparse; ++i) {
+		const uint32_t e = H->sparse[i];
+		if (reg[ENTRY_IDX(e)] < ENTRY_RANK(e))
+			reg[ENTRY_IDX(e)] = (uint8_t)ENTRY_RANK(e);
+	}
+	mem_Free(H->sparse);
+	H->sparse = NULL;
+	H->nsparse = H->nsorted = H->capsparse = 0;
+	H->reg = reg;
+}
+
+static void add_entry(hll* H, uint32_t idx, int rank, int* err)
+{
+	if (H->reg) {
+		if (H->reg[idx] < rank)
+			H->reg[idx] = (uint8_t)rank;
+		return;
+	}
+
+	if (H->nsparse - H->nsorted == tail_limit(H->nsorted)) {
+		flush_tail(H);
+		if (H->nsorted > sparse_limit(H)) {
+			densify(H, err);
+			if (err && *err)
+				return;
+			add_entry(H, idx, rank, err);
+			return;
+		}
+	}
+	if (H->nsparse == H->capsparse) {
+		const size_t lim = sparse_limit(H);
+		size_t cap = (H->capsparse ? 2 * H->capsparse : TAIL);
+		if (cap > lim + tail_limit(lim))
+			cap = lim + tail_limit(lim);
+		mem_Realloc(cap, H->sparse, *err);
+		if (err && *err)
+			return;
+		H->capsparse = cap;
+	}
+	H->sparse[H->nsparse++] = ENTRY(idx, rank);
+}
+
+void hll_add(hll* H, uint64_t h, int* err)
+{
+	if (err) *err = 0;
+
+	h = hash_splitmix64(h);
+	const uint32_t idx = (uint32_t)(h >> (64 - H->p));
+	const uint64_t w = (h << H->p) | (1ull << (H->p - 1));
+	add_entry(H, idx, clz64(w) + 1, err);
+}
+
+void hll_add_b(hll* H, const void* buf, size_t sz, int* err)
+{
+	hll_add(H, hash_fnv64_b(buf, sz, FNV64_INIT), err);
+}
+
+void hll_add_many(hll* H, const uint64_t* h, size_t n, int* err)
+{
+	if (err) *err = 0;
+
+	for (size_t i = 0; i < n; ++i) {
+		hll_add(H, h[i], err);
+		if (err && *err)
+			return;
+	}
+}
+
+double hll_estimate(const hll* H)
+{
+	const size_t m = (size_t)1 << H->p;
+
+	/* Sum of 2^-rank over the registers, and number of zero
+	 * registers */
+	double sum = 0.0;
+	size_t zeros = 0;
+	if (H->reg) {
+		for (size_t i = 0; i < m; ++i) {
+			sum += ldexp(1.0, -H->reg[i]);
+			zeros += (H->reg[i] == 0);
+		}
+	} else {
+		/* Walk the prefix and a sorted copy of the tail in merged
+		 * order; the last entry of each index has its rank */
+		uint32_t t[TAIL_MAX];
+		const uint32_t* a = H->sparse;
+		const size_t ns = H->nsorted;
+		const size_t nt = sorted_tail(H, t);
+		sum = (double)m;
+		zeros = m;
+		size_t i = 0, j = 0;
+		while (i < ns || j < nt) {
+			const uint32_t e = (j == nt || (i < ns && a[i] < t[j])
+						? a[i++] : t[j++]);
+			const _Bool last = !((i < ns
+				&& ENTRY_IDX(a[i]) == ENTRY_IDX(e))
+			  || (j < nt && ENTRY_IDX(t[j]) == ENTRY_IDX(e)));
+			if (last) {
+				sum += ldexp(1.0, -ENTRY_RANK(e)) - 1.0;
+				--zeros;
+			}
+		}
+	}
+
+	double alpha;
+	switch (m) {
+		case 16:	alpha = 0.673; break;
+		case 32:	alpha = 0.697; break;
+		case 64:	alpha = 0.709; break;
+		default:	alpha = 0.7213 / (1.0 + 1.079 / (double)m);
+	}
+	const double dm = (double)m;
+	double E = alpha * dm * dm / sum;
+
+	/* Small range correction: linear counting */
+	if (E <= 2.5 * dm && zeros > 0)
+		E = dm * log(dm / (double)zeros);
+	return E;
+}
+
+void hll_merge(hll* into, const hll* other, int* err)
+{
+	if (err) *err = 0;
+
+	if (into->p != other->p) {
+		csnip_err_Raise(err_INVAL, *err);
+		return;
+	}
+	if (other->reg) {
+		if (into->reg == NULL) {
+			densify(into, err);
+			if (err && *err)
+				return;
+		}
+		const size_t m = (size_t)1 << into->p;
+		for (size_t i = 0; i < m; ++i) {
+			if (into->reg[i] < other->reg[i])
+				into->reg[i] = other->reg[i];
+		}
+	} else {
+		for (size_t i = 0; i < other->nsparse; ++i) {
+			const uint32_t e = other->sparse[i];
+			add_entry(into, ENTRY_IDX(e), ENTRY_RANK(e), err);
+			if (err && *err)
+				return;
+		}
+	}
+}
@@ -0,0 +1,122 @@
+#ifndef CSNIP_HLL_H
+#define CSNIP_HLL_H
+
+/**	@file hll.h
+ *	@brief			HyperLogLog cardinality estimation
+ *	@defgroup hll		HyperLogLog cardinality estimation
+ *	@{
+ *
+ *	@brief HyperLogLog cardinality estimation.
+ *
+ *	A HyperLogLog sketch estimates the number of distinct keys in a
+ *	stream with 2^p small registers, independent of the number of
+ *	keys.  The relative standard error is about 1.04 / sqrt(2^p),
+ *	e.g., 1.6% for p = 12, which takes 4 KiB.
+ *
+ *	A sketch starts in sparse mode, in which only the nonzero
+ *	registers are stored in a list; it is converted to the dense
+ *	array of registers when that list would take more memory than
+ *	the array.  The estimates are the same in both modes, so the
+ *	sparse mode only saves memory for sketches of small sets.
+ *
+ *	Sketches with the same precision can be merged, giving the
+ *	sketch of the union of the streams.  This allows, e.g., to
+ *	count in per-thread sketches and combine them afterwards, as
+ *	csnip_meanvar_merge() does for mean and variance accumulators.
+ *
+ *	Keys are given as 64 bit hash values, which are remixed before
+ *	use, so that integer keys can also be passed directly;
+ *	csnip_hll_add_b() hashes a buffer with csnip_hash_fnv64_b().
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**	Smallest supported precision. */
+#define CSNIP_HLL_MIN_P		4
+
+/**	Largest supported precision. */
+#define CSNIP_HLL_MAX_P		18
+
+/**	HyperLogLog sketch. */
+typedef struct {
+	int p;			/**< Precision; there are 2^p registers */
+	uint8_t* reg;		/**< Dense registers, or NULL if sparse */
+	uint32_t* sparse;	/**< Sparse entries, (index << 8) | rank */
+	size_t nsparse;		/**< Number of sparse entries */
+	size_t nsorted;		/**< Length of the sorted prefix */
+	size_t capsparse;	/**< Capacity of the sparse list */
+} csnip_hll;
+
+/**	Create a sketch.
+ *
+ *	@param	p
+ *		Precision, between CSNIP_HLL_MIN_P and CSNIP_HLL_MAX_P.
+ *
+ *	@param	err
+ *		Error return.  csnip_err_INVAL for an invalid
+ *		precision, csnip_err_NOMEM if out of memory.
+ */
+csnip_hll* csnip_hll_make(int p, int* err);
+
+/**	Free a sketch. */
+void csnip_hll_free(csnip_hll* H);
+
+/**	Reset a sketch to the empty, sparse state. */
+void csnip_hll_clear(csnip_hll* H);
+
+/**	Add a key, given by its hash value.
+ *
+ *	This only allocates memory in sparse mode, in which case
+ *	csnip_err_NOMEM can be raised.
+ */
+void csnip_hll_add(csnip_hll* H, uint64_t h, int* err);
+
+/**	Add a key given by a buffer. */
+void csnip_hll_add_b(csnip_hll* H, const void* buf, size_t sz, int* err);
+
+/**	Add several keys. */
+void csnip_hll_add_many(csnip_hll* H,
+			const uint64_t* h,
+			size_t n,
+			int* err);
+
+/**	Estimate the number of distinct keys added. */
+double csnip_hll_estimate(const csnip_hll* H);
+
+/**	Merge sketches.
+ *
+ *	Make @a into the sketch of the union of the keys added to both
+ *	sketches.  The sketches must have the same precision, otherwise
+ *	csnip_err_INVAL is raised.
+ */
+void csnip_hll_merge(csnip_hll* into, const csnip_hll* other, int* err);
+
+/**	Whether the sketch is in sparse mode. */
+_Bool csnip_hll_is_sparse(const csnip_hll* H);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+
+#endif /* CSNIP_HLL_H */
+
+#if defined(CSNIP_SHORT_NAMES) && !defined(CSNIP_HLL_HAVE_SHORT_NAMES)
+#define hll				csnip_hll
+#define hll_make			csnip_hll_make
+#define hll_free			csnip_hll_free
+#define hll_clear			csnip_hll_clear
+#define hll_add				csnip_hll_add
+#define hll_add_b			csnip_hll_add_b
+#define hll_add_many			csnip_hll_add_many
+#define hll_estimate			csnip_hll_estimate
+#define hll_merge			csnip_hll_merge
+#define hll_is_sparse			csnip_hll_is_sparse
+#define CSNIP_HLL_HAVE_SHORT_NAMES
+#endif /* CSNIP_SHORT_NAMES && !CSNIP_HLL_HAVE_SHORT_NAMES */
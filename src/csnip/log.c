@@ -19,6 +19,7 @@
 #define CSNIP_SHORT_NAMES
 #include <csnip/cext.h>
 #include <csnip/fmt.h>
+#include <csnip/hash.h>
 #include <csnip/list.h>
 #include <csnip/log.h>
 #include <csnip/lphash_table.h>
@@ -103,7 +104,7 @@ CSNIP_LPHASH_TABLE_DEF_FUNCS(cext_unused static,	/* scope */
 			comp_prio,			/* entrytype */
 			struct priotbl,			/* tbltype */
 			k1, k2, e,			/* dummy vars */
-			(size_t)k1,			/* hash(k1) */
+			csnip_hash_ptr(k1),		/* hash(k1) */
 			strcmp(k1, k2) == 0,		/* is_match(k1, k2) */
 			(e).component)			/* get_key(e) */
 
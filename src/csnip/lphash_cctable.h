@@ -0,0 +1,549 @@
+#ifndef CSNIP_LPHASH_CCTABLE_H
+#define CSNIP_LPHASH_CCTABLE_H
+
+/**	@file lphash_cctable.h
+ *	@addtogroup hash_tables		Hash tables
+ *	@{
+ *	@defgroup lphash_cctable	Concurrent Hash Table
+ *	@{
+ *
+ *	Linear probing hash tables for concurrent access.
+ *
+ *	The table is split into 2^CSNIP_LPHASH_CCTABLE_SHARD_BITS
+ *	shards, each of which is a linear probing hash table of its own.
+ *	The low bits of the hash value select the shard, and the
+ *	remaining bits the home slot within the shard.
+ *
+ *	Writers (insertions and removals) lock the mutex of their
+ *	shard, so writers on different shards proceed in parallel.
+ *
+ *	Readers do not lock or write any shared memory.  Each shard has
+ *	a sequence counter that writers increment before and after
+ *	modifying the shard (a "seqlock").  Readers copy each entry
+ *	they probe, and check that the counter has not changed before
+ *	they evaluate is_match on the copy;  if it did change, the
+ *	lookup is restarted.  Therefore lookups return copies of the
+ *	entries rather than pointers into the table.
+ *
+ *	When a shard grows, a new backing array is built while readers
+ *	continue to use the old one, which is still valid, and then
+ *	published with an atomic pointer store.  The old arrays are
+ *	retired, but only released when the table is freed, so that
+ *	readers never access freed memory.  Since arrays grow
+ *	geometrically, the retired arrays take less memory than the
+ *	current ones.
+ *
+ *	Some remarks on usage:
+ *
+ *	* The hash function needs to be of good quality in all bits,
+ *	  since the low bits select the shard.
+ *
+ *	* If entries refer to other memory, e.g., for string keys, that
+ *	  memory must remain valid as long as concurrent readers might
+ *	  access it, even after the entry was removed.
+ *
+ *	* This module requires C11 atomics and POSIX threads.
+ */
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#else
+#include <sched.h>
+#endif
+
+#include <csnip/err.h>
+#include <csnip/mem.h>
+#include <csnip/lphash.h>
+
+/**	Number of bits of the hash value used to select a shard. */
+#ifndef CSNIP_LPHASH_CCTABLE_SHARD_BITS
+#define CSNIP_LPHASH_CCTABLE_SHARD_BITS	6
+#endif
+
+/**	Number of shards. */
+#define CSNIP_LPHASH_CCTABLE_NSHARDS \
+	((size_t)1 << CSNIP_LPHASH_CCTABLE_SHARD_BITS)
+
+/** @cond */
+/* Backing arrays of a shard.  cap and the array pointers never change
+ * once the block is published.
+ */
+struct csnip_lphash_cctable_block {
+	size_t cap;
+	unsigned char* occ;
+	void* entry;
+	struct csnip_lphash_cctable_block* prev;	/* Retired block */
+};
+
+/* A shard.  Aligned to avoid false sharing between shards. */
+struct csnip_lphash_cctable_shard {
+	_Alignas(64) atomic_uint seq;
+	_Atomic(struct csnip_lphash_cctable_block*) blk;
+	atomic_size_t size;
+	pthread_mutex_t lock;
+};
+
+/* Seqlock writer side */
+#define csnip_lphash_cctable__WriteBegin(S) \
+	do { \
+		atomic_store_explicit(&(S)->seq, \
+		  atomic_load_explicit(&(S)->seq, memory_order_relaxed) + 1, \
+		  memory_order_relaxed); \
+		atomic_thread_fence(memory_order_release); \
+	} while (0)
+
+#define csnip_lphash_cctable__WriteEnd(S) \
+	atomic_store_explicit(&(S)->seq, \
+	  atomic_load_explicit(&(S)->seq, memory_order_relaxed) + 1, \
+	  memory_order_release)
+
+/* Back off before a reader retries */
+#if defined(__x86_64__) || defined(__i386__)
+#define csnip_lphash_cctable__Pause()	_mm_pause()
+#else
+#define csnip_lphash_cctable__Pause()	((void)sched_yield())
+#endif
+/** @endcond */
+
+/**	Defines a concurrent hash table type.
+ *
+ *	@param	struct_tbltype
+ *		Name of the struct to be defined.
+ *
+ *	@param	entrytype
+ *		Type of the hash table entries.  It does not affect the
+ *		layout of the table struct, but is given for uniformity
+ *		with the other hash table types.
+ */
+#define CSNIP_LPHASH_CCTABLE_DEF_TYPE(struct_tbltype, \
+				entrytype) \
+	struct struct_tbltype { \
+		struct csnip_lphash_cctable_shard \
+			shard[CSNIP_LPHASH_CCTABLE_NSHARDS]; \
+	};
+
+/**	Declare concurrent hash table functions.
+ *
+ *	@sa CSNIP_LPHASH_CCTABLE_DEF_FUNCS()
+ */
+#define CSNIP_LPHASH_CCTABLE_DECL_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				entrytype, \
+				tbltype) \
+	/* Creation & Deletion */ \
+	scope tbltype* prefix##make(int* err); \
+	scope void prefix##free(tbltype* tbl); \
+	\
+	/* Element manipulation */ \
+	scope int prefix##insert( \
+			tbltype* tbl, \
+			int* err, \
+			entrytype E); \
+	scope int prefix##insert_or_assign( \
+			tbltype* tbl, \
+			int* err, \
+			entrytype E, \
+			entrytype* ret_old); \
+	scope _Bool prefix##remove( \
+			tbltype* tbl, \
+			int* err, \
+			keytype key, \
+			entrytype* ret_old); \
+	scope _Bool prefix##find( \
+			const tbltype* tbl, \
+			keytype key, \
+			entrytype* ret); \
+	\
+	/* Size and capacity */ \
+	scope size_t prefix##size(const tbltype* tbl); \
+	scope size_t prefix##capacity(const tbltype* tbl);
+
+/**	Define concurrent hash table functions.
+ *
+ *	The arguments are the same as for CSNIP_LPHASH_TABLE_DEF_FUNCS(),
+ *	but the table type is defined with
+ *	CSNIP_LPHASH_CCTABLE_DEF_TYPE().  All of the generated functions
+ *	can be called concurrently from different threads, except for
+ *	`free`.
+ *
+ *	The following functions will be generated:
+ *
+ *	* `make`: `tbltype* make(int* err);`  Create a table.
+ *	* `free`: `void free(tbltype* tbl);`  Free the table.
+ *	* `insert`: `int insert(tbltype* tbl, int* err, entrytype
+ *	  E);`  Insert an entry if no entry with the same key exists.
+ *	  Returns 1 if the entry was inserted, and 0 otherwise.
+ *	* `insert_or_assign`: `int insert_or_assign(tbltype* tbl, int*
+ *	  err, entrytype E, entrytype* ret_old);`  Insert an entry, or
+ *	  replace the entry with the same key.  In the latter case, the
+ *	  old entry is returned in `*ret_old` if `ret_old` is non-NULL.
+ *	  Returns 0 if an entry was replaced, and 1 otherwise.
+ *	* `remove`: `_Bool remove(tbltype* tbl, int* err, keytype key,
+ *	  entrytype* ret_old);`  Remove the entry with the given key.
+ *	  If it exists and `ret_old` is non-NULL, it is returned in
+ *	  `*ret_old`.  Returns true if an entry was removed.
+ *	* `find`: `_Bool find(const tbltype* tbl, keytype key,
+ *	  entrytype* ret);`  Find the entry with the given key, and
+ *	  copy it to `*ret`, if `ret` is non-NULL.  Returns true if
+ *	  the entry exists.
+ *	* `size`: `size_t size(const tbltype* tbl);`  Number of
+ *	  entries.  With concurrent writers, this is a snapshot of
+ *	  the individual shard sizes taken at slightly different times.
+ *	* `capacity`: `size_t capacity(const tbltype* tbl);`  Total
+ *	  capacity of the shards.
+ */
+#define CSNIP_LPHASH_CCTABLE_DEF_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				entrytype, \
+				tbltype, \
+				k1, k2,		/* key dummy vars */ \
+				e,		/* entry dummy var */ \
+				hash,		/* evaluate to hash(k1) */ \
+				is_match,	/* Check whether k1 and k2 match */ \
+				get_key)	/* evaluate to the key of e */ \
+	\
+	/* Declare functions in case they weren't yet. */ \
+	CSNIP_LPHASH_CCTABLE_DECL_FUNCS(scope, prefix, keytype, entrytype, \
+	  tbltype) \
+	\
+	/* Private methods.  These are called with the shard locked. */ \
+	\
+	static size_t prefix##_internal_findloc( \
+				const struct csnip_lphash_cctable_block* B, \
+				keytype key, \
+				int* state_) \
+	{ \
+		size_t ret_; \
+		const entrytype* ent_ = (const entrytype*)B->entry; \
+		entrytype e; \
+		keytype k2; \
+		csnip_lphash_Find(B->cap, keytype, k1, u, \
+				((size_t)(hash) \
+				  >> CSNIP_LPHASH_CCTABLE_SHARD_BITS), \
+				!B->occ[u], \
+				(e = ent_[u], k2 = (get_key), (is_match)), \
+				(e = ent_[u], (get_key)), \
+				key, \
+				ret_, \
+				*state_); \
+		return ret_; \
+	} \
+	\
+	static void prefix##_internal_deleteloc( \
+				struct csnip_lphash_cctable_block* B, \
+				size_t loc) \
+	{ \
+		entrytype* ent_ = (entrytype*)B->entry; \
+		entrytype e; \
+		csnip_lphash_Delete(B->cap, keytype, k1, u, v, \
+				((size_t)(hash) \
+				  >> CSNIP_LPHASH_CCTABLE_SHARD_BITS), \
+				!B->occ[u], \
+				(e = ent_[u], (get_key)), \
+				(ent_[v] = ent_[u], B->occ[v] = B->occ[u]), \
+				B->occ[u] = 0, \
+				loc); \
+	} \
+	\
+	/* Grow the shard if needed; returns its current block. */ \
+	static struct csnip_lphash_cctable_block* prefix##_internal_grow( \
+				struct csnip_lphash_cctable_shard* S, \
+				int* err, \
+				size_t min_size) \
+	{ \
+		struct csnip_lphash_cctable_block* B = \
+			atomic_load_explicit(&S->blk, memory_order_relaxed); \
+		const size_t cap = (B ? B->cap : 0); \
+		if (min_size * 3 <= cap * 2) \
+			return B; \
+		\
+		/* Allocate new block */ \
+		size_t newcap = (cap ? cap : 8); \
+		while (min_size * 3 > newcap * 2) \
+			newcap *= 2; \
+		struct csnip_lphash_cctable_block* N; \
+		entrytype* newarr; \
+		csnip_mem_Alloc(1, N, *err); \
+		if (err && *err) \
+			return NULL; \
+		csnip_mem_Alloc(newcap, newarr, *err); \
+		if (err && *err) { \
+			csnip_mem_Free(N); \
+			return NULL; \
+		} \
+		csnip_mem_Alloc0(newcap, N->occ, *err); \
+		if (err && *err) { \
+			csnip_mem_Free(newarr); \
+			csnip_mem_Free(N); \
+			return NULL; \
+		} \
+		N->cap = newcap; \
+		N->entry = newarr; \
+		N->prev = B; \
+		\
+		/* Copy entries.  The old block remains unchanged, so
+		 * readers can keep using it meanwhile. */ \
+		for (size_t i = 0; i < cap; ++i) { \
+			if (B->occ[i]) { \
+				int r; \
+				entrytype e = ((entrytype*)B->entry)[i]; \
+				const size_t l = prefix##_internal_findloc( \
+						N, (get_key), &r); \
+				assert(r == 1); \
+				newarr[l] = e; \
+				N->occ[l] = 1; \
+			} \
+		} \
+		\
+		/* Publish */ \
+		atomic_store_explicit(&S->blk, N, memory_order_release); \
+		return N; \
+	} \
+	\
+	/* Creation / Deletion */ \
+	scope tbltype* prefix##make(int* err) \
+	{ \
+		if (err) *err = 0; \
+		\
+		tbltype* T; \
+		csnip_mem_AlignedAlloc(1, 64, T, *err); \
+		if (err && *err) \
+			return NULL; \
+		for (size_t i = 0; i < CSNIP_LPHASH_CCTABLE_NSHARDS; ++i) { \
+			struct csnip_lphash_cctable_shard* S = &T->shard[i]; \
+			atomic_init(&S->seq, 0); \
+			atomic_init(&S->blk, NULL); \
+			atomic_init(&S->size, 0); \
+			const int rc_ = pthread_mutex_init(&S->lock, NULL); \
+			if (rc_ != 0) { \
+				while (i-- > 0) \
+					pthread_mutex_destroy( \
+						&T->shard[i].lock); \
+				csnip_mem_AlignedFree(T); \
+				errno = rc_; \
+				csnip_err_Raise(csnip_err_ERRNO, *err); \
+				return NULL; \
+			} \
+		} \
+		return T; \
+	} \
+	\
+	scope void prefix##free(tbltype* T) \
+	{ \
+		for (size_t i = 0; i < CSNIP_LPHASH_CCTABLE_NSHARDS; ++i) { \
+			struct csnip_lphash_cctable_shard* S = &T->shard[i]; \
+			struct csnip_lphash_cctable_block* B = \
+				atomic_load(&S->blk); \
+			while (B) { \
+				struct csnip_lphash_cctable_block* P = B->prev; \
+				csnip_mem_Free(B->entry); \
+				csnip_mem_Free(B->occ); \
+				csnip_mem_Free(B); \
+				B = P; \
+			} \
+			pthread_mutex_destroy(&S->lock); \
+		} \
+		csnip_mem_AlignedFree(T); \
+	} \
+	\
+	/* Element manipulation */ \
+	\
+	scope int prefix##insert(tbltype* T, int* err, entrytype e) \
+	{ \
+		if (err) *err = 0; \
+		\
+		keytype k1 = (get_key); \
+		struct csnip_lphash_cctable_shard* S = \
+			&T->shard[(size_t)(hash) \
+				& (CSNIP_LPHASH_CCTABLE_NSHARDS - 1)]; \
+		pthread_mutex_lock(&S->lock); \
+		const size_t n = atomic_load_explicit(&S->size, \
+					memory_order_relaxed); \
+		struct csnip_lphash_cctable_block* B = \
+			prefix##_internal_grow(S, err, n + 1); \
+		if (err && *err) { \
+			pthread_mutex_unlock(&S->lock); \
+			return 0; \
+		} \
+		\
+		int r; \
+		const size_t loc = prefix##_internal_findloc(B, k1, &r); \
+		assert(r < 2); \
+		if (r == 1) { \
+			csnip_lphash_cctable__WriteBegin(S); \
+			((entrytype*)B->entry)[loc] = e; \
+			B->occ[loc] = 1; \
+			csnip_lphash_cctable__WriteEnd(S); \
+			atomic_store_explicit(&S->size, n + 1, \
+					memory_order_relaxed); \
+		} \
+		pthread_mutex_unlock(&S->lock); \
+		return r; \
+	} \
+	\
+	scope int prefix##insert_or_assign(tbltype* T, \
+				int* err, \
+				entrytype e, \
+				entrytype* old) \
+	{ \
+		if (err) *err = 0; \
+		\
+		keytype k1 = (get_key); \
+		struct csnip_lphash_cctable_shard* S = \
+			&T->shard[(size_t)(hash) \
+				& (CSNIP_LPHASH_CCTABLE_NSHARDS - 1)]; \
+		pthread_mutex_lock(&S->lock); \
+		const size_t n = atomic_load_explicit(&S->size, \
+					memory_order_relaxed); \
+		struct csnip_lphash_cctable_block* B = \
+			prefix##_internal_grow(S, err, n + 1); \
+		if (err && *err) { \
+			pthread_mutex_unlock(&S->lock); \
+			return 0; \
+		} \
+		\
+		int r; \
+		const size_t loc = prefix##_internal_findloc(B, k1, &r); \
+		assert(r < 2); \
+		entrytype* E = &((entrytype*)B->entry)[loc]; \
+		if (r == 0 && old) \
+			*old = *E; \
+		csnip_lphash_cctable__WriteBegin(S); \
+		*E = e; \
+		B->occ[loc] = 1; \
+		csnip_lphash_cctable__WriteEnd(S); \
+		if (r == 1) { \
+			atomic_store_explicit(&S->size, n + 1, \
+					memory_order_relaxed); \
+		} \
+		pthread_mutex_unlock(&S->lock); \
+		return r; \
+	} \
+	\
+	scope _Bool prefix##remove(tbltype* T, \
+				int* err, \
+				keytype key, \
+				entrytype* old) \
+	{ \
+		if (err) *err = 0; \
+		\
+		keytype k1 = key; \
+		struct csnip_lphash_cctable_shard* S = \
+			&T->shard[(size_t)(hash) \
+				& (CSNIP_LPHASH_CCTABLE_NSHARDS - 1)]; \
+		pthread_mutex_lock(&S->lock); \
+		struct csnip_lphash_cctable_block* B = \
+			atomic_load_explicit(&S->blk, memory_order_relaxed); \
+		int r = 2; \
+		if (B) { \
+			const size_t loc = prefix##_internal_findloc(B, \
+							key, &r); \
+			if (r == 0) { \
+				if (old) \
+					*old = ((entrytype*)B->entry)[loc]; \
+				csnip_lphash_cctable__WriteBegin(S); \
+				prefix##_internal_deleteloc(B, loc); \
+				csnip_lphash_cctable__WriteEnd(S); \
+				atomic_store_explicit(&S->size, \
+				  atomic_load_explicit(&S->size, \
+				    memory_order_relaxed) - 1, \
+				  memory_order_relaxed); \
+			} \
+		} \
+		pthread_mutex_unlock(&S->lock); \
+		return r == 0; \
+	} \
+	\
+	scope _Bool prefix##find(const tbltype* T, \
+				keytype key, \
+				entrytype* ret) \
+	{ \
+		keytype k1 = key; \
+		const size_t h_ = (size_t)(hash); \
+		const struct csnip_lphash_cctable_shard* S = \
+			&T->shard[h_ & (CSNIP_LPHASH_CCTABLE_NSHARDS - 1)]; \
+		for (;;) { \
+			const unsigned s0 = atomic_load_explicit(&S->seq, \
+						memory_order_acquire); \
+			if (s0 & 1) { \
+				/* Writer active */ \
+				csnip_lphash_cctable__Pause(); \
+				continue; \
+			} \
+			const struct csnip_lphash_cctable_block* B = \
+				atomic_load_explicit(&S->blk, \
+						memory_order_acquire); \
+			if (B == NULL) \
+				return 0; \
+			\
+			const entrytype* ent_ = (const entrytype*)B->entry; \
+			const size_t mask_ = B->cap - 1; \
+			size_t u = (h_ >> CSNIP_LPHASH_CCTABLE_SHARD_BITS) \
+				& mask_; \
+			int r = -1; \
+			for (size_t i = 0; i <= mask_; ++i) { \
+				if (!B->occ[u]) { \
+					r = 0; \
+					break; \
+				} \
+				entrytype e = ent_[u]; \
+				\
+				/* Validate the copy before using it */ \
+				atomic_thread_fence(memory_order_acquire); \
+				if (atomic_load_explicit(&S->seq, \
+				  memory_order_relaxed) != s0) \
+					break; \
+				keytype k2 = (get_key); \
+				if (is_match) { \
+					if (ret) *ret = e; \
+					return 1; \
+				} \
+				u = (u + 1) & mask_; \
+			} \
+			\
+			/* Validate the absence */ \
+			atomic_thread_fence(memory_order_acquire); \
+			if (r == 0 && atomic_load_explicit(&S->seq, \
+			  memory_order_relaxed) == s0) \
+				return 0; \
+			csnip_lphash_cctable__Pause(); \
+		} \
+	} \
+	\
+	/* Size and capacity */ \
+	scope size_t prefix##size(const tbltype* T) \
+	{ \
+		size_t n = 0; \
+		for (size_t i = 0; i < CSNIP_LPHASH_CCTABLE_NSHARDS; ++i) { \
+			n += atomic_load_explicit(&T->shard[i].size, \
+					memory_order_relaxed); \
+		} \
+		return n; \
+	} \
+	\
+	scope size_t prefix##capacity(const tbltype* T) \
+	{ \
+		size_t c = 0; \
+		for (size_t i = 0; i < CSNIP_LPHASH_CCTABLE_NSHARDS; ++i) { \
+			const struct csnip_lphash_cctable_block* B = \
+				atomic_load_explicit(&T->shard[i].blk, \
+						memory_order_acquire); \
+			if (B) c += B->cap; \
+		} \
+		return c; \
+	}
+
+/** @}
+ *  @}
+ */
+
+#endif /* CSNIP_LPHASH_CCTABLE_H */
@@ -0,0 +1,721 @@
+#ifndef CSNIP_LPHASH_CUCKOOTABLE_H
+#define CSNIP_LPHASH_CUCKOOTABLE_H
+
+/**	@file lphash_cuckootable.h
+ *	@addtogroup hash_tables		Hash tables
+ *	@{
+ *	@defgroup lphash_cuckootable	Bucketized Cuckoo Hash Table
+ *	@{
+ *
+ *	Cuckoo hash tables with buckets of several slots.
+ *
+ *	This is an alternative implementation of the table functions from
+ *	lphash_table.h, generating the same functions with the same
+ *	signatures as declared by CSNIP_LPHASH_TABLE_DECL_FUNCS(), but
+ *	requiring a table type defined with
+ *	CSNIP_LPHASH_CUCKOOTABLE_DEF_TYPE().
+ *
+ *	The table consists of buckets of CSNIP_LPHASH_CUCKOOTABLE_SLOTS
+ *	slots each.  Every key has two candidate buckets, derived from
+ *	its hash value, and is stored in one of them, or, rarely, in a
+ *	small overflow array (the "stash").  A lookup thus inspects at
+ *	most two buckets, which is a hard bound independent of the load
+ *	and of clustering, and the second bucket is prefetched while
+ *	the first one is searched.  The stash is only examined when it
+ *	is nonempty.  Buckets are padded and aligned to 16, 32 or 64
+ *	bytes, whichever is the smallest to hold them, so that a bucket
+ *	of up to 64 bytes lies within a single cache line; larger
+ *	buckets take up a whole number of cache lines.
+ *
+ *	Insertions into a full bucket pair move existing entries to
+ *	their alternate buckets, choosing the shortest sequence of moves
+ *	with a breadth-first search.  If no such sequence is found, the
+ *	entry goes to the stash, and if that is full, the table grows.
+ *	The maximum load is 9/10.
+ *
+ *	Both candidate buckets are computed from one hash value, so the
+ *	hash function needs to be of good quality in all bits.  If the
+ *	hash function has too few distinct values for the keys to be
+ *	placed, insertions fail with csnip_err_RANGE.
+ *
+ *	Entries move during insertions, so that entry addresses and
+ *	slot numbers are invalidated by any insertion.  The slots of the
+ *	stash are numbered after those of the buckets.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <csnip/cext.h>
+#include <csnip/err.h>
+#include <csnip/mem.h>
+#include <csnip/lphash_table.h>
+
+/**	Number of slots per bucket.
+ *
+ *	Values from 4 to 8 are reasonable; larger buckets allow higher
+ *	loads, but take longer to search.
+ */
+#ifndef CSNIP_LPHASH_CUCKOOTABLE_SLOTS
+#define CSNIP_LPHASH_CUCKOOTABLE_SLOTS		4
+#endif
+
+/**	Number of stash slots. */
+#ifndef CSNIP_LPHASH_CUCKOOTABLE_STASH
+#define CSNIP_LPHASH_CUCKOOTABLE_STASH		4
+#endif
+
+/**	Maximum number of buckets visited by the displacement search. */
+#ifndef CSNIP_LPHASH_CUCKOOTABLE_BFS_MAX
+#define CSNIP_LPHASH_CUCKOOTABLE_BFS_MAX	256
+#endif
+
+/** @cond */
+#define CSNIP_LPHASH_CUCKOOTABLE__FULL \
+	((1u << CSNIP_LPHASH_CUCKOOTABLE_SLOTS) - 1)
+
+/* Secondary bucket for hash value h and primary bucket b1 */
+#define csnip_lphash_cuckootable__Alt(h, b1, nb) \
+	csnip_lphash_cuckootable__alt((uint64_t)(h), (b1), (nb))
+
+/* Bucket alignment.  The size of a bucket is at most the bound
+ * below, as the padding after the occupancy bits is less than the
+ * entry alignment.  Aligning to the next power of two of that bound,
+ * up to 64, makes the bucket stride a divisor or a multiple of 64. */
+#define CSNIP_LPHASH_CUCKOOTABLE__BSZ(entrytype) \
+	((sizeof(entrytype) > sizeof(unsigned int) \
+	  ? sizeof(entrytype) : sizeof(unsigned int)) \
+	  + CSNIP_LPHASH_CUCKOOTABLE_SLOTS * sizeof(entrytype))
+#define CSNIP_LPHASH_CUCKOOTABLE__BALIGN(entrytype) \
+	(CSNIP_LPHASH_CUCKOOTABLE__BSZ(entrytype) <= 16 ? 16 \
+	  : CSNIP_LPHASH_CUCKOOTABLE__BSZ(entrytype) <= 32 ? 32 : 64)
+
+static inline size_t csnip_lphash_cuckootable__alt(uint64_t x,
+						size_t b1,
+						size_t nb)
+{
+	x ^= x >> 31;
+	x *= 0x7fb5d329728ea185ull;
+	x ^= x >> 27;
+	size_t b2 = (size_t)(x >> 16) & (nb - 1);
+	if (b2 == b1)
+		b2 ^= 1;
+	return b2;
+}
+/** @endcond */
+
+/**	Defines a cuckoo hash table type.
+ *
+ *	@param	struct_tbltype
+ *		Name of the struct to be defined.
+ *
+ *	@param	entrytype
+ *		Type of the hash table entries.
+ */
+#define CSNIP_LPHASH_CUCKOOTABLE_DEF_TYPE(struct_tbltype, \
+				entrytype) \
+	struct struct_tbltype { \
+		size_t nbuckets;	/* Number of buckets */ \
+		size_t size;		/* Number of used entries */ \
+		struct { \
+			_Alignas(CSNIP_LPHASH_CUCKOOTABLE__BALIGN(entrytype)) \
+			unsigned int occ;	/* Occupancy bits */ \
+			entrytype entry[CSNIP_LPHASH_CUCKOOTABLE_SLOTS]; \
+		} *bucket;		/* The buckets */ \
+		size_t nstash;		/* Number of stash entries */ \
+		entrytype stash[CSNIP_LPHASH_CUCKOOTABLE_STASH]; \
+	};
+
+/**	Define cuckoo hash table functions.
+ *
+ *	This takes the same arguments as CSNIP_LPHASH_TABLE_DEF_FUNCS(),
+ *	and generates the same functions, see there for the
+ *	documentation.  The table type is defined with
+ *	CSNIP_LPHASH_CUCKOOTABLE_DEF_TYPE().
+ *
+ *	The capacity includes the stash slots, unless the table has no
+ *	buckets, in which case it is 0.  Since deletion does not
+ *	move entries in buckets, removeatslot() returns the next
+ *	occupied slot after the removed one, except in the stash.
+ */
+#define CSNIP_LPHASH_CUCKOOTABLE_DEF_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				entrytype, \
+				tbltype, \
+				k1, k2,		/* key dummy vars */ \
+				e,		/* entry dummy var */ \
+				hash,		/* evaluate to hash(k1) */ \
+				is_match,	/* Check whether k1 and k2 match */ \
+				get_key)	/* evaluate to the key of e */ \
+	\
+	/* Declare functions in case they weren't yet. */ \
+	CSNIP_LPHASH_TABLE_DECL_FUNCS(scope, prefix, keytype, entrytype, \
+	  tbltype) \
+	\
+	/* Private methods */ \
+	\
+	/* Find a key with hash value h_.  Returns the slot number, or
+	 * the capacity if not found.
+	 */ \
+	static size_t prefix##_internal_findloc_hash( \
+				const tbltype* T, \
+				keytype key, \
+				size_t h_) \
+	{ \
+		if (T->nbuckets == 0) \
+			return 0; \
+		const size_t cap_ = T->nbuckets \
+			* CSNIP_LPHASH_CUCKOOTABLE_SLOTS \
+			+ CSNIP_LPHASH_CUCKOOTABLE_STASH; \
+		\
+		keytype k1 = key; \
+		keytype k2; \
+		entrytype e; \
+		const size_t b1_ = h_ & (T->nbuckets - 1); \
+		const size_t b2_ = csnip_lphash_cuckootable__Alt(h_, b1_, \
+						T->nbuckets); \
+		csnip_cext_prefetch(&T->bucket[b2_]); \
+		for (int j_ = 0; j_ < 2; ++j_) { \
+			const size_t b_ = (j_ == 0 ? b1_ : b2_); \
+			const unsigned int occ_ = T->bucket[b_].occ; \
+			for (int s_ = 0; \
+			  s_ < CSNIP_LPHASH_CUCKOOTABLE_SLOTS; ++s_) \
+			{ \
+				if (!(occ_ & (1u << s_))) \
+					continue; \
+				e = T->bucket[b_].entry[s_]; \
+				k2 = (get_key); \
+				if (is_match) { \
+					return b_ \
+					  * CSNIP_LPHASH_CUCKOOTABLE_SLOTS \
+					  + (size_t)s_; \
+				} \
+			} \
+		} \
+		for (size_t i_ = 0; i_ < T->nstash; ++i_) { \
+			e = T->stash[i_]; \
+			k2 = (get_key); \
+			if (is_match) { \
+				return T->nbuckets \
+				  * CSNIP_LPHASH_CUCKOOTABLE_SLOTS + i_; \
+			} \
+		} \
+		return cap_; \
+	} \
+	\
+	static size_t prefix##_internal_findloc(const tbltype* T, \
+				keytype key) \
+	{ \
+		keytype k1 = key; \
+		return prefix##_internal_findloc_hash(T, key, \
+						(size_t)(hash)); \
+	} \
+	\
+	/* Place an entry, known not to be in the table yet.  Returns
+	 * the slot number, or the capacity if there was no room.
+	 */ \
+	static size_t prefix##_internal_place(tbltype* T, \
+				entrytype newent, \
+				size_t h_) \
+	{ \
+		const size_t nb_ = T->nbuckets; \
+		struct { \
+			size_t b;	/* Bucket */ \
+			int parent;	/* Parent node */ \
+			int slot;	/* Slot in the parent bucket */ \
+		} q_[CSNIP_LPHASH_CUCKOOTABLE_BFS_MAX]; \
+		int qn_ = 0; \
+		\
+		if (nb_ == 0) \
+			return 0; \
+		const size_t b1_ = h_ & (nb_ - 1); \
+		q_[qn_].b = b1_; \
+		q_[qn_].parent = -1; \
+		q_[qn_++].slot = -1; \
+		q_[qn_].b = csnip_lphash_cuckootable__Alt(h_, b1_, nb_); \
+		q_[qn_].parent = -1; \
+		q_[qn_++].slot = -1; \
+		\
+		/* Breadth-first search for a bucket with a free slot */ \
+		for (int qi_ = 0; qi_ < qn_; ++qi_) { \
+			const unsigned int occ_ = T->bucket[q_[qi_].b].occ; \
+			if (occ_ != CSNIP_LPHASH_CUCKOOTABLE__FULL) { \
+				/* Found; move the entries along the path */ \
+				int s_ = 0; \
+				while (occ_ & (1u << s_)) \
+					++s_; \
+				int n_ = qi_; \
+				size_t db_ = q_[n_].b; \
+				int ds_ = s_; \
+				while (q_[n_].parent >= 0) { \
+					const int p_ = q_[n_].parent; \
+					const size_t sb_ = q_[p_].b; \
+					const int ss_ = q_[n_].slot; \
+					T->bucket[db_].entry[ds_] = \
+						T->bucket[sb_].entry[ss_]; \
+					T->bucket[db_].occ |= 1u << ds_; \
+					db_ = sb_; \
+					ds_ = ss_; \
+					n_ = p_; \
+				} \
+				T->bucket[db_].entry[ds_] = newent; \
+				T->bucket[db_].occ |= 1u << ds_; \
+				return db_ * CSNIP_LPHASH_CUCKOOTABLE_SLOTS \
+					+ (size_t)ds_; \
+			} \
+			\
+			/* Enqueue the alternate buckets of the entries */ \
+			for (int s_ = 0; s_ < CSNIP_LPHASH_CUCKOOTABLE_SLOTS \
+			  && qn_ < CSNIP_LPHASH_CUCKOOTABLE_BFS_MAX; ++s_) \
+			{ \
+				entrytype e = T->bucket[q_[qi_].b].entry[s_]; \
+				keytype k1 = (get_key); \
+				const size_t eh_ = (size_t)(hash); \
+				const size_t eb1_ = eh_ & (nb_ - 1); \
+				size_t alt_ = eb1_; \
+				if (alt_ == q_[qi_].b) { \
+					alt_ = csnip_lphash_cuckootable__Alt( \
+						eh_, eb1_, nb_); \
+				} \
+				\
+				/* Skip buckets already on the path, since
+				 * their slots would be moved twice. */ \
+				int on_path_ = 0; \
+				for (int a_ = qi_; a_ >= 0; \
+				  a_ = q_[a_].parent) \
+				{ \
+					if (q_[a_].b == alt_) { \
+						on_path_ = 1; \
+						break; \
+					} \
+				} \
+				if (on_path_) \
+					continue; \
+				q_[qn_].b = alt_; \
+				q_[qn_].parent = qi_; \
+				q_[qn_++].slot = s_; \
+			} \
+		} \
+		\
+		/* Use the stash */ \
+		const size_t cap_ = nb_ * CSNIP_LPHASH_CUCKOOTABLE_SLOTS; \
+		if (T->nstash < CSNIP_LPHASH_CUCKOOTABLE_STASH) { \
+			T->stash[T->nstash] = newent; \
+			return cap_ + T->nstash++; \
+		} \
+		return cap_ + CSNIP_LPHASH_CUCKOOTABLE_STASH; \
+	} \
+	\
+	/* Smallest number of buckets for the given number of entries */ \
+	static size_t prefix##_internal_nbfor(size_t min_size) \
+	{ \
+		size_t nb = 2; \
+		while (min_size * 10 \
+		  > nb * CSNIP_LPHASH_CUCKOOTABLE_SLOTS * 9) \
+			nb *= 2; \
+		return nb; \
+	} \
+	\
+	/* Rebuild the table with the given number of buckets, or more
+	 * if the entries can not be placed.  Gives up with
+	 * csnip_err_RANGE after a few doublings.
+	 */ \
+	static void prefix##_internal_rehash(tbltype* T, \
+						int* err, \
+						size_t nb) \
+	{ \
+		for (int attempt = 0; attempt < 4; ++attempt, nb *= 2) { \
+			tbltype N = { .nbuckets = nb, .size = T->size }; \
+			csnip_mem_AlignedAlloc(nb, 64, N.bucket, *err); \
+			if (err && *err) \
+				return; \
+			for (size_t i = 0; i < nb; ++i) \
+				N.bucket[i].occ = 0; \
+			\
+			/* Place entries */ \
+			const size_t ncap = nb * CSNIP_LPHASH_CUCKOOTABLE_SLOTS \
+				+ CSNIP_LPHASH_CUCKOOTABLE_STASH; \
+			_Bool ok = 1; \
+			for (size_t i = 0; ok && i < T->nbuckets; ++i) { \
+				for (int s = 0; \
+				  s < CSNIP_LPHASH_CUCKOOTABLE_SLOTS; ++s) \
+				{ \
+					if (!(T->bucket[i].occ & (1u << s))) \
+						continue; \
+					entrytype e = T->bucket[i].entry[s]; \
+					keytype k1 = (get_key); \
+					if (prefix##_internal_place(&N, e, \
+					  (size_t)(hash)) == ncap) \
+					{ \
+						ok = 0; \
+						break; \
+					} \
+				} \
+			} \
+			for (size_t i = 0; ok && i < T->nstash; ++i) { \
+				entrytype e = T->stash[i]; \
+				keytype k1 = (get_key); \
+				if (prefix##_internal_place(&N, e, \
+				  (size_t)(hash)) == ncap) \
+					ok = 0; \
+			} \
+			if (!ok) { \
+				csnip_mem_AlignedFree(N.bucket); \
+				continue; \
+			} \
+			\
+			/* Replace old table with new one, and free */ \
+			if (T->bucket) csnip_mem_AlignedFree(T->bucket); \
+			*T = N; \
+			return; \
+		} \
+		csnip_err_Raise(csnip_err_RANGE, *err); \
+	} \
+	\
+	static _Bool prefix##_internal_grow(tbltype* T, \
+						int* err, \
+						size_t min_size) \
+	{ \
+		if (min_size * 10 <= T->nbuckets \
+		  * CSNIP_LPHASH_CUCKOOTABLE_SLOTS * 9) \
+		{ \
+			/* No need to grow */ \
+			return 0; \
+		} \
+		\
+		prefix##_internal_rehash(T, err, \
+			prefix##_internal_nbfor(min_size)); \
+		return 1; \
+	} \
+	\
+	/* Insert an entry known not to be in the table, growing as
+	 * necessary.  Returns the slot.
+	 */ \
+	static size_t prefix##_internal_insert(tbltype* T, \
+						int* err, \
+						entrytype newent, \
+						size_t h_) \
+	{ \
+		prefix##_internal_grow(T, err, T->size + 1); \
+		if (err && *err) \
+			return 0; \
+		for (int attempt = 0; ; ++attempt) { \
+			const size_t cap_ = prefix##capacity(T); \
+			const size_t loc = prefix##_internal_place(T, \
+							newent, h_); \
+			if (loc < cap_) { \
+				++T->size; \
+				return loc; \
+			} \
+			if (attempt == 4) { \
+				csnip_err_Raise(csnip_err_RANGE, *err); \
+				return 0; \
+			} \
+			prefix##_internal_rehash(T, err, 2 * T->nbuckets); \
+			if (err && *err) \
+				return 0; \
+		} \
+	} \
+	\
+	static void prefix##_internal_deleteloc(tbltype* T, size_t loc) \
+	{ \
+		const size_t bcap_ = T->nbuckets \
+			* CSNIP_LPHASH_CUCKOOTABLE_SLOTS; \
+		if (loc < bcap_) { \
+			T->bucket[loc / CSNIP_LPHASH_CUCKOOTABLE_SLOTS].occ &= \
+			  ~(1u << (loc % CSNIP_LPHASH_CUCKOOTABLE_SLOTS)); \
+		} else { \
+			T->stash[loc - bcap_] = T->stash[--T->nstash]; \
+		} \
+		--T->size; \
+	} \
+	\
+	/* Creation / Deletion */ \
+	scope tbltype* prefix##make(int* err) \
+	{ \
+		if (err) *err = 0; \
+		\
+		tbltype* T; \
+		csnip_mem_Alloc(1, T, *err); \
+		if (err && *err) \
+			return NULL; \
+		T->nbuckets = 0; \
+		T->size = 0; \
+		T->bucket = NULL; \
+		T->nstash = 0; \
+		return T; \
+	} \
+	\
+	scope tbltype* prefix##make_with_cap(int* err, size_t min_size) \
+	{ \
+		tbltype* T = prefix##make(err); \
+		if (T == NULL) \
+			return NULL; \
+		prefix##reserve(T, err, min_size); \
+		if (err && *err) { \
+			prefix##free(T); \
+			return NULL; \
+		} \
+		return T; \
+	} \
+	\
+	scope void prefix##free(tbltype* T) \
+	{ \
+		if (T->bucket) csnip_mem_AlignedFree(T->bucket); \
+		csnip_mem_Free(T); \
+	} \
+	\
+	/* Element manipulation */ \
+	\
+	scope int prefix##insert(tbltype* T, int* err, entrytype e) \
+	{ \
+		if (err) *err = 0; \
+		\
+		keytype k1 = (get_key); \
+		const size_t h_ = (size_t)(hash); \
+		if (prefix##_internal_findloc_hash(T, k1, h_) \
+		  < prefix##capacity(T)) \
+			return 0; \
+		prefix##_internal_insert(T, err, e, h_); \
+		if (err && *err) \
+			return 0; \
+		return 1; \
+	} \
+	\
+	scope int prefix##insert_or_assign(tbltype* T, \
+				int* err, \
+				entrytype e, \
+				entrytype* old) \
+	{ \
+		if (err) *err = 0; \
+		\
+		keytype k1 = (get_key); \
+		const size_t h_ = (size_t)(hash); \
+		const size_t loc = prefix##_internal_findloc_hash(T, k1, h_); \
+		if (loc < prefix##capacity(T)) { \
+			entrytype* E = prefix##getslotentryaddress(T, loc); \
+			if (old) *old = *E; \
+			*E = e; \
+			return 0; \
+		} \
+		prefix##_internal_insert(T, err, e, h_); \
+		if (err && *err) \
+			return 0; \
+		return 1; \
+	} \
+	\
+	scope entrytype* prefix##find_or_insert(tbltype* T, \
+					int* err, \
+					entrytype e) \
+	{ \
+		if (err) *err = 0; \
+		\
+		keytype k1 = (get_key); \
+		const size_t h_ = (size_t)(hash); \
+		size_t loc = prefix##_internal_findloc_hash(T, k1, h_); \
+		if (loc >= prefix##capacity(T)) { \
+			loc = prefix##_internal_insert(T, err, e, h_); \
+			if (err && *err) \
+				return NULL; \
+		} \
+		return prefix##getslotentryaddress(T, loc); \
+	} \
+	\
+	scope _Bool prefix##remove(tbltype* T, int* err, keytype key) \
+	{ \
+		if (err) *err = 0; \
+		\
+		const size_t loc = prefix##_internal_findloc(T, key); \
+		if (loc < prefix##capacity(T)) { \
+			prefix##_internal_deleteloc(T, loc); \
+			return 1; \
+		} \
+		return 0; \
+	} \
+	\
+	scope entrytype* prefix##find(const tbltype* T, keytype key) \
+	{ \
+		const size_t loc = prefix##_internal_findloc(T, key); \
+		if (loc < prefix##capacity(T)) \
+			return prefix##getslotentryaddress(T, loc); \
+		return NULL; \
+	} \
+	\
+	/* Batched operations */ \
+	scope size_t prefix##find_many(const tbltype* T, \
+				keytype const* keys, \
+				size_t n, \
+				entrytype** out) \
+	{ \
+		size_t h[CSNIP_LPHASH_TABLE_PREFETCH_DIST]; \
+		size_t nfound = 0; \
+		for (size_t b = 0; b < n; \
+		  b += CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+		{ \
+			size_t m = n - b; \
+			if (m > CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+				m = CSNIP_LPHASH_TABLE_PREFETCH_DIST; \
+			\
+			/* Hash and prefetch */ \
+			for (size_t i = 0; i < m; ++i) { \
+				keytype k1 = keys[b + i]; \
+				h[i] = (size_t)(hash); \
+				if (T->nbuckets) { \
+					csnip_cext_prefetch(&T->bucket[ \
+					  h[i] & (T->nbuckets - 1)]); \
+				} \
+			} \
+			\
+			/* Resolve */ \
+			for (size_t i = 0; i < m; ++i) { \
+				const size_t loc = \
+					prefix##_internal_findloc_hash(T, \
+						keys[b + i], h[i]); \
+				if (loc < prefix##capacity(T)) { \
+					out[b + i] = \
+					  prefix##getslotentryaddress(T, loc); \
+					++nfound; \
+				} else { \
+					out[b + i] = NULL; \
+				} \
+			} \
+		} \
+		return nfound; \
+	} \
+	\
+	scope size_t prefix##insert_many(tbltype* T, \
+				int* err, \
+				entrytype const* entries, \
+				size_t n) \
+	{ \
+		if (err) *err = 0; \
+		\
+		size_t ninserted = 0; \
+		for (size_t i = 0; i < n; ++i) { \
+			ninserted += prefix##insert(T, err, entries[i]); \
+			if (err && *err) \
+				break; \
+		} \
+		return ninserted; \
+	} \
+	\
+	/* Size and capacity */ \
+	scope size_t prefix##size(const tbltype* T) \
+	{ \
+		return T->size; \
+	} \
+	\
+	scope size_t prefix##capacity(const tbltype* T) \
+	{ \
+		if (T->nbuckets == 0) \
+			return 0; \
+		return T->nbuckets * CSNIP_LPHASH_CUCKOOTABLE_SLOTS \
+			+ CSNIP_LPHASH_CUCKOOTABLE_STASH; \
+	} \
+	\
+	scope void prefix##reserve(tbltype* T, int* err, size_t min_size) \
+	{ \
+		if (err) *err = 0; \
+		prefix##_internal_grow(T, err, min_size); \
+	} \
+	\
+	scope void prefix##shrink(tbltype* T, int* err) \
+	{ \
+		if (err) *err = 0; \
+		if (T->size == 0) { \
+			if (T->bucket) csnip_mem_AlignedFree(T->bucket); \
+			T->bucket = NULL; \
+			T->nbuckets = 0; \
+			T->nstash = 0; \
+			return; \
+		} \
+		const size_t nb = prefix##_internal_nbfor(T->size); \
+		if (nb < T->nbuckets) \
+			prefix##_internal_rehash(T, err, nb); \
+	} \
+	\
+	/* Slot functions */ \
+	scope size_t prefix##findslot(const tbltype* T, keytype key) \
+	{ \
+		return prefix##_internal_findloc(T, key); \
+	} \
+	\
+	scope _Bool prefix##isslotoccupied(const tbltype* T, size_t i) \
+	{ \
+		const size_t bcap_ = T->nbuckets \
+			* CSNIP_LPHASH_CUCKOOTABLE_SLOTS; \
+		assert(i < prefix##capacity(T)); \
+		if (i < bcap_) { \
+			return (T->bucket[i / CSNIP_LPHASH_CUCKOOTABLE_SLOTS].occ \
+			  >> (i % CSNIP_LPHASH_CUCKOOTABLE_SLOTS)) & 1; \
+		} \
+		return i - bcap_ < T->nstash; \
+	} \
+	\
+	scope entrytype* prefix##getslotentryaddress( \
+					const tbltype* T, \
+					size_t i) \
+	{ \
+		const size_t bcap_ = T->nbuckets \
+			* CSNIP_LPHASH_CUCKOOTABLE_SLOTS; \
+		if (i < bcap_) { \
+			return &T->bucket[i / CSNIP_LPHASH_CUCKOOTABLE_SLOTS] \
+				.entry[i % CSNIP_LPHASH_CUCKOOTABLE_SLOTS]; \
+		} \
+		return (entrytype*)&T->stash[i - bcap_]; \
+	} \
+	\
+	scope size_t prefix##getslotfromentryaddress( \
+					const tbltype* T, \
+					entrytype const* entry) \
+	{ \
+		const size_t bcap_ = T->nbuckets \
+			* CSNIP_LPHASH_CUCKOOTABLE_SLOTS; \
+		if (entry >= T->stash \
+		  && entry < T->stash + CSNIP_LPHASH_CUCKOOTABLE_STASH) \
+			return bcap_ + (size_t)(entry - T->stash); \
+		const size_t b_ = (size_t)((const char*)entry \
+			- (const char*)T->bucket) / sizeof(*T->bucket); \
+		return b_ * CSNIP_LPHASH_CUCKOOTABLE_SLOTS \
+			+ (size_t)(entry - T->bucket[b_].entry); \
+	} \
+	\
+	scope size_t prefix##removeatslot(tbltype* T, int* err, size_t i) \
+	{ \
+		if (err) *err = 0; \
+		\
+		if (prefix##isslotoccupied(T, i)) { \
+			prefix##_internal_deleteloc(T, i); \
+			if (i < prefix##capacity(T) \
+			  && prefix##isslotoccupied(T, i)) \
+				return i; \
+		} \
+		return prefix##nextoccupiedslot(T, i); \
+	} \
+	\
+	scope size_t prefix##firstoccupiedslot(const tbltype* T) \
+	{ \
+		const size_t cap_ = prefix##capacity(T); \
+		size_t r; \
+		for (r = 0; r < cap_; ++r) \
+			if (prefix##isslotoccupied(T, r)) break; \
+		return r; \
+	} \
+	\
+	scope size_t prefix##nextoccupiedslot( \
+					const tbltype* T, \
+					size_t r) \
+	{ \
+		const size_t cap_ = prefix##capacity(T); \
+		for (++r; r < cap_; ++r) \
+			if (prefix##isslotoccupied(T, r)) break; \
+		return r; \
+	}
+
+/** @}
+ *  @}
+ */
+
+#endif /* CSNIP_LPHASH_CUCKOOTABLE_H */
@@ -0,0 +1,603 @@
+#ifndef CSNIP_LPHASH_IRTABLE_H
+#define CSNIP_LPHASH_IRTABLE_H
+
+/**	@file lphash_irtable.h
+ *	@addtogroup hash_tables		Hash tables
+ *	@{
+ *	@defgroup lphash_irtable	Incrementally Rehashed Hash Table
+ *	@{
+ *
+ *	Linear probing hash tables with incremental rehashing.
+ *
+ *	The hash table from lphash_table.h rehashes all entries inside
+ *	the insertion that makes the table grow.  For large tables, that
+ *	can be a long pause.  The tables in this file instead keep the
+ *	old backing arrays around when growing, and migrate the entries
+ *	from the old to the new arrays a few slots at a time, with every
+ *	insertion and removal.  Lookups consult both arrays while a
+ *	migration is in progress.  This bounds the worst case latency of
+ *	insertions by the cost of allocating the new arrays.
+ *
+ *	The generated functions have the same signatures and semantics
+ *	as those declared by CSNIP_LPHASH_TABLE_DECL_FUNCS(), but the
+ *	table type is defined with CSNIP_LPHASH_IRTABLE_DEF_TYPE().
+ *
+ *	The slot functions address the slots of both arrays:  Slots
+ *	0 to cap - 1 are in the new array, and slots cap to
+ *	cap + ocap - 1 are in the old array, if any.  The capacity()
+ *	function returns the total number of slots.  Since
+ *	removeatslot() does not migrate any entries, the usual loop
+ *	removing the entries with removeatslot() works as expected.
+ *
+ *	The migration scans the old array in circular order, starting
+ *	at an empty slot.  All slots that were already scanned are
+ *	empty, so backward shifting on deletion from the old array only
+ *	moves entries within the part that remains to be scanned.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <csnip/mem.h>
+#include <csnip/lphash.h>
+#include <csnip/lphash_table.h>
+
+/**	Number of slots to migrate per operation.
+ *
+ *	Every insertion and removal examines up to this many slots of the
+ *	old array, migrating the entries found in them.  The default is
+ *	ample to complete the migration before the next growth is due.
+ */
+#ifndef CSNIP_LPHASH_IRTABLE_MIGRATE_SLOTS
+#define CSNIP_LPHASH_IRTABLE_MIGRATE_SLOTS	8
+#endif
+
+/**	Defines an incrementally rehashed hash table type.
+ *
+ *	This is the same as the type defined by
+ *	CSNIP_LPHASH_TABLE_DEF_TYPE(), with additional members for the
+ *	old backing arrays and the migration state.
+ *
+ *	@param	struct_tbltype
+ *		Name of the struct to be defined.
+ *
+ *	@param	entrytype
+ *		Type of the hash table entries.
+ */
+#define CSNIP_LPHASH_IRTABLE_DEF_TYPE(struct_tbltype, \
+				entrytype) \
+	struct struct_tbltype { \
+		size_t cap;		/* Capacity */ \
+		size_t size;		/* Number of used entries */ \
+		entrytype* entry;	/* The table entries */ \
+		unsigned char* occ;	/* Occupancy indicators */ \
+		size_t ocap;		/* Capacity of the old arrays */ \
+		size_t osize;		/* Entries left in the old arrays */ \
+		entrytype* oentry;	/* Old table entries */ \
+		unsigned char* oocc;	/* Old occupancy indicators */ \
+		size_t mig;		/* Migration position */ \
+	};
+
+/**	Define incrementally rehashed hash table functions.
+ *
+ *	This takes the same arguments as CSNIP_LPHASH_TABLE_DEF_FUNCS(),
+ *	and generates the same functions, see there for the
+ *	documentation.  The table type is defined with
+ *	CSNIP_LPHASH_IRTABLE_DEF_TYPE().
+ *
+ *	Pointers to entries are invalidated by insertions and
+ *	removals, as with lphash_table.h; in addition, this now
+ *	includes insertions and removals that do not grow the table.
+ *
+ *	The batched operations find_many() and insert_many() are
+ *	provided for compatibility, but do not prefetch.
+ *
+ *	Growing with reserve() is incremental as well, but shrink()
+ *	completes the migration before returning, since its purpose is
+ *	to release memory.
+ */
+#define CSNIP_LPHASH_IRTABLE_DEF_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				entrytype, \
+				tbltype, \
+				k1, k2,		/* key dummy vars */ \
+				e,		/* entry dummy var */ \
+				hash,		/* evaluate to hash(k1) */ \
+				is_match,	/* Check whether k1 and k2 match */ \
+				get_key)	/* evaluate to the key of e */ \
+	\
+	/* Declare functions in case they weren't yet. */ \
+	CSNIP_LPHASH_TABLE_DECL_FUNCS(scope, prefix, keytype, entrytype, \
+	  tbltype) \
+	\
+	/* Private methods */ \
+	\
+	/* Find a key in the backing arrays (cap_, entry_, occ_). */ \
+	static size_t prefix##_internal_findloc( \
+				size_t cap_, \
+				const entrytype* entry_, \
+				const unsigned char* occ_, \
+				keytype key, \
+				int* state_) \
+	{ \
+		size_t ret_; \
+		entrytype e; \
+		keytype k2; \
+		csnip_lphash_Find(cap_, keytype, k1, u, \
+				hash, \
+				!occ_[u], \
+				(e = entry_[u], k2 = (get_key), (is_match)), \
+				(e = entry_[u], (get_key)), \
+				key, \
+				ret_, \
+				*state_); \
+		return ret_; \
+	} \
+	\
+	static void prefix##_internal_deleteloc( \
+				size_t cap_, \
+				entrytype* entry_, \
+				unsigned char* occ_, \
+				size_t loc) \
+	{ \
+		entrytype e; \
+		csnip_lphash_Delete(cap_, keytype, k1, u, v, \
+				hash, \
+				!occ_[u], \
+				(e = entry_[u], (get_key)), \
+				(entry_[v] = entry_[u], occ_[v] = occ_[u]), \
+				occ_[u] = 0,\
+				loc); \
+	} \
+	\
+	/* Find a key in both arrays.
+	 *
+	 * Returns the slot index as used by the slot functions.  The
+	 * state is as for csnip_lphash_Find();  if the key is not
+	 * found, the returned location is an insertion location in the
+	 * new array.
+	 */ \
+	static size_t prefix##_internal_find(const tbltype* T, \
+					keytype key, \
+					int* state_) \
+	{ \
+		size_t loc = prefix##_internal_findloc(T->cap, T->entry, \
+						T->occ, key, state_); \
+		if (*state_ != 0 && T->osize > 0) { \
+			int r; \
+			size_t oloc = prefix##_internal_findloc(T->ocap, \
+						T->oentry, T->oocc, key, &r); \
+			if (r == 0) { \
+				*state_ = 0; \
+				return T->cap + oloc; \
+			} \
+		} \
+		return loc; \
+	} \
+	\
+	/* Delete the entry in the given slot (of either array). */ \
+	static void prefix##_internal_deleteslot(tbltype* T, size_t i) \
+	{ \
+		if (i < T->cap) { \
+			prefix##_internal_deleteloc(T->cap, T->entry, \
+						T->occ, i); \
+		} else { \
+			prefix##_internal_deleteloc(T->ocap, T->oentry, \
+						T->oocc, i - T->cap); \
+			if (--T->osize == 0) \
+				T->mig = 0; \
+		} \
+		--T->size; \
+	} \
+	\
+	/* Release the old arrays once they are empty. */ \
+	static void prefix##_internal_dropold(tbltype* T) \
+	{ \
+		if (T->oentry && T->osize == 0) { \
+			csnip_mem_Free(T->oentry); \
+			csnip_mem_Free(T->oocc); \
+			T->oentry = NULL; \
+			T->oocc = NULL; \
+			T->ocap = 0; \
+			T->mig = 0; \
+		} \
+	} \
+	\
+	/* Migrate the entries of up to nslots slots of the old array. */ \
+	static void prefix##_internal_migrate(tbltype* T, size_t nslots) \
+	{ \
+		while (T->osize > 0 && nslots-- > 0) { \
+			const size_t i = T->mig; \
+			if (T->oocc[i]) { \
+				int r; \
+				entrytype e = T->oentry[i]; \
+				size_t l = prefix##_internal_findloc(T->cap, \
+						T->entry, T->occ, \
+						(get_key), &r); \
+				assert(r == 1); \
+				T->entry[l] = e; \
+				T->occ[l] = 1; \
+				prefix##_internal_deleteloc(T->ocap, \
+						T->oentry, T->oocc, i); \
+				--T->osize; \
+				/* Slot i may have been refilled by the
+				 * deletion, so examine it again. */ \
+			} else { \
+				if (++T->mig == T->ocap) \
+					T->mig = 0; \
+			} \
+		} \
+		prefix##_internal_dropold(T); \
+	} \
+	\
+	/* Smallest capacity for the given number of entries */ \
+	static size_t prefix##_internal_capfor(size_t min_size) \
+	{ \
+		size_t cap = 8; \
+		while (min_size * 3 > cap * 2) { \
+			cap *= 2; \
+		} \
+		return cap; \
+	} \
+	\
+	/* Resize the table.
+	 *
+	 * Allocates new arrays, and makes the current ones the old
+	 * arrays to be migrated.
+	 */ \
+	static void prefix##_internal_resize(tbltype* T, \
+						int* err, \
+						size_t newcap) \
+	{ \
+		/* Allocate new arrays.  The occupancy array is
+		 * allocated zeroed, which avoids touching it here
+		 * with most allocators. */ \
+		entrytype* newarr; \
+		unsigned char* newocc; \
+		csnip_mem_Alloc(newcap, newarr, *err); \
+		if (err && *err) return; \
+		csnip_mem_Alloc0(newcap, newocc, *err); \
+		if (err && *err) { \
+			csnip_mem_Free(newarr); \
+			return; \
+		} \
+		\
+		/* A previous migration should have completed long
+		 * ago, unless growth was requested in a big step, or
+		 * the table was shrunk.  Complete it now. */ \
+		prefix##_internal_migrate(T, (size_t)-1); \
+		\
+		/* Turn the current arrays into the old ones */ \
+		if (T->size == 0) { \
+			if (T->entry) csnip_mem_Free(T->entry); \
+			if (T->occ) csnip_mem_Free(T->occ); \
+		} else { \
+			T->ocap = T->cap; \
+			T->osize = T->size; \
+			T->oentry = T->entry; \
+			T->oocc = T->occ; \
+			\
+			/* Start the migration after an empty slot */ \
+			size_t m = 0; \
+			while (T->oocc[m]) \
+				++m; \
+			T->mig = m; \
+		} \
+		T->cap = newcap; \
+		T->entry = newarr; \
+		T->occ = newocc; \
+	} \
+	\
+	/* Grow the table.  Returns 1 if slot locations changed. */ \
+	static _Bool prefix##_internal_grow(tbltype* T, \
+						int* err, \
+						size_t min_size) \
+	{ \
+		if (min_size * 3 <= T->cap * 2) { \
+			/* No need to grow */ \
+			return 0; \
+		} \
+		prefix##_internal_resize(T, err, \
+			prefix##_internal_capfor(min_size)); \
+		return 1; \
+	} \
+	\
+	/* Creation / Deletion */ \
+	scope tbltype* prefix##make(int* err) \
+	{ \
+		if (err) *err = 0; \
+		\
+		tbltype* T; \
+		csnip_mem_Alloc(1, T, *err); \
+		if (err && *err) \
+			return NULL; \
+		T->cap = 0; \
+		T->size = 0; \
+		T->entry = NULL; \
+		T->occ = NULL; \
+		T->ocap = 0; \
+		T->osize = 0; \
+		T->oentry = NULL; \
+		T->oocc = NULL; \
+		T->mig = 0; \
+		return T; \
+	} \
+	\
+	scope tbltype* prefix##make_with_cap(int* err, size_t min_size) \
+	{ \
+		tbltype* T = prefix##make(err); \
+		if (T == NULL) \
+			return NULL; \
+		prefix##reserve(T, err, min_size); \
+		if (err && *err) { \
+			prefix##free(T); \
+			return NULL; \
+		} \
+		return T; \
+	} \
+	\
+	scope void prefix##free(tbltype* T) \
+	{ \
+		if (T->entry)	csnip_mem_Free(T->entry); \
+		if (T->occ)	csnip_mem_Free(T->occ); \
+		if (T->oentry)	csnip_mem_Free(T->oentry); \
+		if (T->oocc)	csnip_mem_Free(T->oocc); \
+		csnip_mem_Free(T); \
+	} \
+	\
+	/* Element manipulation */ \
+	\
+	scope int prefix##insert(tbltype* T, int* err, entrytype e) \
+	{ \
+		if (err) *err = 0; \
+		\
+		/* Grow if necessary, and make progress migrating */ \
+		prefix##_internal_grow(T, err, T->size + 1); \
+		if (err && *err) \
+			return 0; \
+		prefix##_internal_migrate(T, \
+			CSNIP_LPHASH_IRTABLE_MIGRATE_SLOTS); \
+		\
+		/* Insert entry if not present */ \
+		int r; \
+		keytype key = (get_key); \
+		size_t loc = prefix##_internal_find(T, key, &r); \
+		assert(r < 2); \
+		if (r == 1) { \
+			T->entry[loc] = e; \
+			T->occ[loc] = 1; \
+			++T->size; \
+		} \
+		return r; \
+	} \
+	\
+	scope int prefix##insert_or_assign(tbltype* T, \
+				int* err, \
+				entrytype e, \
+				entrytype* old) \
+	{ \
+		if (err) *err = 0; \
+		\
+		/* Grow if necessary, and make progress migrating */ \
+		prefix##_internal_grow(T, err, T->size + 1); \
+		if (err && *err) \
+			return 0; \
+		prefix##_internal_migrate(T, \
+			CSNIP_LPHASH_IRTABLE_MIGRATE_SLOTS); \
+		\
+		/* Insert or assign entry */ \
+		int r; \
+		keytype key = (get_key); \
+		size_t loc = prefix##_internal_find(T, key, &r); \
+		assert(r < 2); \
+		entrytype* E = prefix##getslotentryaddress(T, loc); \
+		if (r == 0) { \
+			if (old) *old = *E; \
+		} else { \
+			++T->size; \
+			T->occ[loc] = 1; \
+		} \
+		*E = e; \
+		return r; \
+	} \
+	\
+	scope entrytype* prefix##find_or_insert(tbltype* T, \
+					int* err, \
+					entrytype entry) \
+	{ \
+		if (err) *err = 0; \
+		\
+		int r; \
+		entrytype e = entry; \
+		size_t loc = prefix##_internal_find(T, (get_key), &r); \
+		if (r >= 1) { \
+			/* Insert */ \
+			prefix##_internal_grow(T, err, T->size + 1); \
+			if (err && *err) \
+				return NULL; \
+			prefix##_internal_migrate(T, \
+				CSNIP_LPHASH_IRTABLE_MIGRATE_SLOTS); \
+			\
+			/* Search again, since entries may have moved */ \
+			loc = prefix##_internal_findloc(T->cap, T->entry, \
+					T->occ, (get_key), &r); \
+			assert(r == 1); \
+			\
+			T->entry[loc] = entry; \
+			T->occ[loc] = 1; \
+			++T->size; \
+		} \
+		return prefix##getslotentryaddress(T, loc); \
+	} \
+	\
+	scope _Bool prefix##remove(tbltype* T, int* err, keytype key) \
+	{ \
+		if (err) *err = 0; \
+		\
+		prefix##_internal_migrate(T, \
+			CSNIP_LPHASH_IRTABLE_MIGRATE_SLOTS); \
+		\
+		int r; \
+		const size_t loc = prefix##_internal_find(T, key, &r); \
+		if (r == 0) { \
+			prefix##_internal_deleteslot(T, loc); \
+			prefix##_internal_dropold(T); \
+		} \
+		return r == 0; \
+	} \
+	\
+	scope entrytype* prefix##find(const tbltype* T, keytype key) \
+	{ \
+		int r; \
+		const size_t loc = prefix##_internal_find(T, key, &r); \
+		if (r == 0) \
+			return prefix##getslotentryaddress(T, loc); \
+		return NULL; \
+	} \
+	\
+	/* Batched operations */ \
+	scope size_t prefix##find_many(const tbltype* T, \
+				keytype const* keys, \
+				size_t n, \
+				entrytype** out) \
+	{ \
+		size_t nfound = 0; \
+		for (size_t i = 0; i < n; ++i) { \
+			out[i] = prefix##find(T, keys[i]); \
+			nfound += (out[i] != NULL); \
+		} \
+		return nfound; \
+	} \
+	\
+	scope size_t prefix##insert_many(tbltype* T, \
+				int* err, \
+				entrytype const* entries, \
+				size_t n) \
+	{ \
+		if (err) *err = 0; \
+		\
+		size_t ninserted = 0; \
+		for (size_t i = 0; i < n; ++i) { \
+			ninserted += (size_t)prefix##insert(T, err, entries[i]); \
+			if (err && *err) \
+				break; \
+		} \
+		return ninserted; \
+	} \
+	\
+	/* Size and capacity */ \
+	scope size_t prefix##size(const tbltype* T) \
+	{ \
+		return T->size; \
+	} \
+	\
+	scope size_t prefix##capacity(const tbltype* T) \
+	{ \
+		return T->cap + T->ocap; \
+	} \
+	\
+	scope void prefix##reserve(tbltype* T, int* err, size_t min_size) \
+	{ \
+		if (err) *err = 0; \
+		prefix##_internal_grow(T, err, min_size); \
+	} \
+	\
+	scope void prefix##shrink(tbltype* T, int* err) \
+	{ \
+		if (err) *err = 0; \
+		if (T->size == 0) { \
+			T->osize = 0; \
+			prefix##_internal_dropold(T); \
+			if (T->entry) csnip_mem_Free(T->entry); \
+			if (T->occ) csnip_mem_Free(T->occ); \
+			T->entry = NULL; \
+			T->occ = NULL; \
+			T->cap = 0; \
+			return; \
+		} \
+		const size_t newcap = prefix##_internal_capfor(T->size); \
+		if (newcap < T->cap) { \
+			/* Release the memory right away */ \
+			prefix##_internal_resize(T, err, newcap); \
+			prefix##_internal_migrate(T, (size_t)-1); \
+		} \
+	} \
+	\
+	/* Slot functions */ \
+	scope size_t prefix##findslot(const tbltype* T, keytype key) \
+	{ \
+		int r; \
+		const size_t loc = prefix##_internal_find(T, key, &r); \
+		if (r == 0) \
+			return loc; \
+		return T->cap + T->ocap; \
+	} \
+	\
+	scope _Bool prefix##isslotoccupied(const tbltype* T, size_t i) \
+	{ \
+		assert(i < T->cap + T->ocap); \
+		if (i < T->cap) \
+			return T->occ[i]; \
+		return T->oocc[i - T->cap]; \
+	} \
+	\
+	scope entrytype* prefix##getslotentryaddress( \
+					const tbltype* T, \
+					size_t i) \
+	{ \
+		if (i < T->cap) \
+			return &T->entry[i]; \
+		return &T->oentry[i - T->cap]; \
+	} \
+	\
+	scope size_t prefix##getslotfromentryaddress( \
+					const tbltype* T, \
+					entrytype const* entry) \
+	{ \
+		if (T->oentry && entry >= T->oentry \
+		  && entry < T->oentry + T->ocap) \
+		{ \
+			return T->cap + (size_t)(entry - T->oentry); \
+		} \
+		return (size_t)(entry - T->entry); \
+	} \
+	\
+	scope size_t prefix##removeatslot(tbltype* T, int* err, size_t i) \
+	{ \
+		if (err) *err = 0; \
+		\
+		if (prefix##isslotoccupied(T, i)) { \
+			prefix##_internal_deleteslot(T, i); \
+			if (i < T->cap + T->ocap \
+			  && prefix##isslotoccupied(T, i)) \
+			{ \
+				return i; \
+			} \
+		} \
+		return prefix##nextoccupiedslot(T, i); \
+	} \
+	\
+	scope size_t prefix##firstoccupiedslot(const tbltype* T) \
+	{ \
+		size_t r; \
+		for (r = 0; r < T->cap + T->ocap; ++r) \
+			if (prefix##isslotoccupied(T, r)) break; \
+		return r; \
+	} \
+	\
+	scope size_t prefix##nextoccupiedslot( \
+					const tbltype* T, \
+					size_t r) \
+	{ \
+		for (++r; r < T->cap + T->ocap; ++r) \
+			if (prefix##isslotoccupied(T, r)) break; \
+		return r; \
+	}
+
+/** @}
+ *  @}
+ */
+
+#endif /* CSNIP_LPHASH_IRTABLE_H */
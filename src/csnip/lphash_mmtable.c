@@ -0,0 +1,312 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <csnip/csnip_conf.h>
+
+#ifdef CSNIP_CONF__HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/err.h>
+#include <csnip/mem.h>
+#include <csnip/lphash_mmtable.h>
+
+/* File format.
+ *
+ * The file starts with the header below, and the sections follow at
+ * the given offsets, each aligned to ALIGN bytes.  Since mappings are
+ * page aligned, the records in the sections are suitably aligned in
+ * memory as well.
+ */
+
+#define MAGIC		"csnLPHT"
+#define VERSION		2
+#define BYTEORDER	0x01020304u
+#define ALIGN		64
+
+struct file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteorder;
+	uint32_t hashsize;		/* sizeof(size_t), the hash width */
+	uint32_t reserved;
+	uint64_t tag;
+	uint64_t keysize;
+	uint64_t valsize;
+	uint64_t cap;
+	uint64_t size;
+	uint64_t ctrl_off;
+	uint64_t key_off;
+	uint64_t val_off;
+	uint64_t data_off;
+	uint64_t data_len;
+	uint64_t file_len;
+};
+
+static uint64_t align_up(uint64_t x)
+{
+	return (x + ALIGN - 1) & ~(uint64_t)(ALIGN - 1);
+}
+
+/* Write a section, padded to the given offset */
+static int write_section(FILE* fp, uint64_t* pos, uint64_t off,
+			const void* p, uint64_t len)
+{
+	static const char zeros[ALIGN];
+	while (*pos < off) {
+		uint64_t n = off - *pos;
+		if (n > ALIGN)
+			n = ALIGN;
+		if (fwrite(zeros, 1, n, fp) != n)
+			return -1;
+		*pos += n;
+	}
+	if (len > 0 && fwrite(p, 1, len, fp) != len)
+		return -1;
+	*pos += len;
+	return 0;
+}
+
+void lphash_mmtable_write(const lphash_mmtable* T,
+			const char* path,
+			uint64_t tag,
+			int* err)
+{
+	if (err) *err = 0;
+
+	struct file_header H;
+	memset(&H, 0, sizeof(H));
+	memcpy(H.magic, MAGIC, sizeof(H.magic));
+	H.version = VERSION;
+	H.byteorder = BYTEORDER;
+	H.hashsize = (uint32_t)sizeof(size_t);
+	H.tag = tag;
+	H.keysize = T->keysize;
+	H.valsize = T->valsize;
+	H.cap = T->cap;
+	H.size = T->size;
+	H.ctrl_off = align_up(sizeof(H));
+	H.key_off = align_up(H.ctrl_off + H.cap);
+	H.val_off = align_up(H.key_off + H.cap * H.keysize);
+	H.data_off = align_up(H.val_off + H.cap * H.valsize);
+	H.data_len = T->datalen;
+	H.file_len = H.data_off + H.data_len;
+
+	/* Write to a temporary file, and rename it into place, so that
+	 * processes that have the old file mapped are not affected. */
+	char* tmppath;
+	const size_t pathlen = strlen(path);
+	mem_Alloc(pathlen + 5, tmppath, *err);
+	if (err && *err)
+		return;
+	memcpy(tmppath, path, pathlen);
+	memcpy(tmppath + pathlen, ".tmp", 5);
+
+	FILE* fp = fopen(tmppath, "wb");
+	if (fp == NULL) {
+		mem_Free(tmppath);
+		csnip_err_Raise(err_ERRNO, *err);
+		return;
+	}
+	uint64_t pos = 0;
+	int r = write_section(fp, &pos, 0, &H, sizeof(H));
+	if (r == 0)
+		r = write_section(fp, &pos, H.ctrl_off, T->ctrl, H.cap);
+	if (r == 0) {
+		r = write_section(fp, &pos, H.key_off, T->key,
+			H.cap * H.keysize);
+	}
+	if (r == 0) {
+		r = write_section(fp, &pos, H.val_off, T->val,
+			H.cap * H.valsize);
+	}
+	if (r == 0) {
+		r = write_section(fp, &pos, H.data_off, T->data,
+			H.data_len);
+	}
+	if (fclose(fp) != 0)
+		r = -1;
+	if (r == 0 && rename(tmppath, path) != 0)
+		r = -1;
+	if (r != 0) {
+		const int e = errno;
+		remove(tmppath);
+		errno = e;
+		mem_Free(tmppath);
+		csnip_err_Raise(err_ERRNO, *err);
+		return;
+	}
+	mem_Free(tmppath);
+}
+
+/* Check that [off, off + len) lies within a file of length flen */
+static _Bool in_file(uint64_t off, uint64_t len, uint64_t flen)
+{
+	return off % ALIGN == 0 && off <= flen && len <= flen - off;
+}
+
+static _Bool check_header(const struct file_header* H,
+			uint64_t flen,
+			uint64_t tag,
+			size_t keysize,
+			size_t valsize)
+{
+	if (memcmp(H->magic, MAGIC, sizeof(H->magic)) != 0
+	  || H->version != VERSION
+	  || H->byteorder != BYTEORDER
+	  || H->hashsize != sizeof(size_t)
+	  || H->tag != tag
+	  || H->keysize != keysize
+	  || H->valsize != valsize
+	  || H->file_len != flen
+	  || (H->cap & (H->cap - 1)) != 0
+	  || H->size > H->cap)
+	{
+		return 0;
+	}
+	if ((keysize && H->cap > flen / keysize)
+	  || (valsize && H->cap > flen / valsize))
+	{
+		return 0;
+	}
+	return in_file(H->ctrl_off, H->cap, flen)
+	  && in_file(H->key_off, H->cap * keysize, flen)
+	  && in_file(H->val_off, H->cap * valsize, flen)
+	  && in_file(H->data_off, H->data_len, flen);
+}
+
+/* Map or read the file.  Returns 0 on success, and -1 with errno set
+ * otherwise.
+ */
+static int load_file(lphash_mmtable* T, const char* path)
+{
+#ifdef CSNIP_CONF__HAVE_MMAP
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		const int e = errno;
+		close(fd);
+		errno = e;
+		return -1;
+	}
+	T->memlen = (size_t)st.st_size;
+	T->mem = NULL;
+	if (T->memlen > 0) {
+		void* p = mmap(NULL, T->memlen, PROT_READ, MAP_SHARED, fd, 0);
+		if (p == MAP_FAILED) {
+			const int e = errno;
+			close(fd);
+			errno = e;
+			return -1;
+		}
+		T->mem = p;
+	}
+	close(fd);
+	return 0;
+#else
+	FILE* fp = fopen(path, "rb");
+	if (fp == NULL)
+		return -1;
+	long len;
+	if (fseek(fp, 0, SEEK_END) != 0 || (len = ftell(fp)) < 0
+	  || fseek(fp, 0, SEEK_SET) != 0)
+	{
+		const int e = errno;
+		fclose(fp);
+		errno = e;
+		return -1;
+	}
+	int err = 0;
+	T->memlen = (size_t)len;
+	T->mem = NULL;
+	if (len > 0) {
+		char* p;
+		mem_AlignedAlloc(T->memlen, ALIGN, p, err);
+		if (err) {
+			fclose(fp);
+			errno = ENOMEM;
+			return -1;
+		}
+		if (fread(p, 1, T->memlen, fp) != T->memlen) {
+			fclose(fp);
+			mem_AlignedFree(p);
+			errno = EIO;
+			return -1;
+		}
+		T->mem = p;
+	}
+	fclose(fp);
+	return 0;
+#endif
+}
+
+static void unload_file(lphash_mmtable* T)
+{
+	if (T->mem == NULL)
+		return;
+#ifdef CSNIP_CONF__HAVE_MMAP
+	munmap(T->mem, T->memlen);
+#else
+	mem_AlignedFree(T->mem);
+#endif
+}
+
+lphash_mmtable* lphash_mmtable_open(const char* path,
+			uint64_t tag,
+			size_t keysize,
+			size_t valsize,
+			int* err)
+{
+	if (err) *err = 0;
+
+	lphash_mmtable* T;
+	mem_Alloc(1, T, *err);
+	if (err && *err)
+		return NULL;
+	if (load_file(T, path) != 0) {
+		mem_Free(T);
+		csnip_err_Raise(err_ERRNO, *err);
+		return NULL;
+	}
+
+	/* Check and interpret the header */
+	struct file_header H;
+	if (T->memlen < sizeof(H)) {
+		unload_file(T);
+		mem_Free(T);
+		csnip_err_Raise(err_FORMAT, *err);
+		return NULL;
+	}
+	memcpy(&H, T->mem, sizeof(H));
+	if (!check_header(&H, T->memlen, tag, keysize, valsize)) {
+		unload_file(T);
+		mem_Free(T);
+		csnip_err_Raise(err_FORMAT, *err);
+		return NULL;
+	}
+	const char* base = T->mem;
+	T->cap = (size_t)H.cap;
+	T->size = (size_t)H.size;
+	T->keysize = keysize;
+	T->valsize = valsize;
+	T->ctrl = (const unsigned char*)(base + H.ctrl_off);
+	T->key = base + H.key_off;
+	T->val = base + H.val_off;
+	T->data = base + H.data_off;
+	T->datalen = (size_t)H.data_len;
+	return T;
+}
+
+void lphash_mmtable_close(lphash_mmtable* T)
+{
+	unload_file(T);
+	mem_Free(T);
+}
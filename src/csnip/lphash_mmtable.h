@@ -0,0 +1,586 @@
+#ifndef CSNIP_LPHASH_MMTABLE_H
+#define CSNIP_LPHASH_MMTABLE_H
+
+/**	@file lphash_mmtable.h
+ *	@addtogroup hash_tables		Hash tables
+ *	@{
+ *	@defgroup lphash_mmtable	Memory Mapped Read-only Hash Table
+ *	@{
+ *
+ *	Read-only linear probing hash tables stored in files.
+ *
+ *	A table is built once with a builder, and saved to a file.  The
+ *	file is then loaded with csnip_lphash_mmtable_open(), which maps
+ *	it into memory read-only.  Lookups work directly on the mapped
+ *	file, without any deserialization, so loading the table is
+ *	cheap, and the pages are shared by all processes that map the
+ *	same file.  On systems without mmap(), the file is read into
+ *	memory instead.
+ *
+ *	The file consists of a header, followed by the control bytes,
+ *	the key records and the value records of the slots, and finally
+ *	a data area for variable length data.  Key and value records
+ *	are fixed size types given by the user;  they must not contain
+ *	pointers, but can refer to the data area with
+ *	csnip_lphash_mmtable_ref offsets.  The control byte of a slot is
+ *	0 if the slot is empty, and otherwise contains 7 bits of the
+ *	hash value, so that most non-matching slots are skipped without
+ *	comparing keys.
+ *
+ *	The files are in the native byte order and layout, and the hash
+ *	function used for building and for lookups must be the same.
+ *	The byte order and the width of size_t, which is the width of
+ *	the hash values, are checked on loading.  A
+ *	user supplied tag is stored in the header and checked on
+ *	loading, to detect tables built with a different record layout
+ *	or hash function.  Hash functions that depend on the process,
+ *	e.g., on addresses or random seeds, can not be used.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <csnip/err.h>
+#include <csnip/mem.h>
+
+/**	Reference to variable length data.
+ *
+ *	A reference to a byte range in the data area of the table,
+ *	for use in key and value records.
+ */
+typedef struct {
+	uint64_t off;		/**< Offset from the data area start */
+	uint64_t len;		/**< Length in bytes */
+} csnip_lphash_mmtable_ref;
+
+/**	A loaded read-only table.
+ *
+ *	This is the untyped representation of a table loaded from a
+ *	file; the typed accessors are created with
+ *	CSNIP_LPHASH_MMTABLE_DEF_FUNCS().  The same struct also serves
+ *	as a view of a builder's table for writing.
+ */
+typedef struct {
+	size_t cap;			/**< Number of slots */
+	size_t size;			/**< Number of entries */
+	size_t keysize;			/**< Size of a key record */
+	size_t valsize;			/**< Size of a value record */
+	const unsigned char* ctrl;	/**< Control bytes */
+	const void* key;		/**< Key records */
+	const void* val;		/**< Value records */
+	const char* data;		/**< Data area */
+	size_t datalen;			/**< Length of the data area */
+
+	/* Backing memory */
+	void* mem;
+	size_t memlen;
+} csnip_lphash_mmtable;
+
+/**	Open a table file.
+ *
+ *	Maps the file read-only and checks its header.
+ *
+ *	@param	path
+ *		path of the file.
+ *
+ *	@param	tag
+ *		tag as given when the file was written; a different
+ *		tag in the file is an error.
+ *
+ *	@param	keysize, valsize
+ *		sizes of the key and the value records.
+ *
+ *	@param	err
+ *		error return.  csnip_err_ERRNO if the file could not be
+ *		opened or mapped, csnip_err_FORMAT if the file is not a
+ *		valid table file, or does not match the tag or record
+ *		sizes.
+ *
+ *	@return	the table, or NULL on error.
+ */
+csnip_lphash_mmtable* csnip_lphash_mmtable_open(const char* path,
+				uint64_t tag,
+				size_t keysize,
+				size_t valsize,
+				int* err);
+
+/**	Close a table file.
+ *
+ *	Unmaps the file and frees the table.  Pointers into the table
+ *	become invalid.
+ */
+void csnip_lphash_mmtable_close(csnip_lphash_mmtable* T);
+
+/**	Write a table to a file.
+ *
+ *	This is used by the generated builder functions and is not
+ *	usually called directly.
+ */
+void csnip_lphash_mmtable_write(const csnip_lphash_mmtable* T,
+				const char* path,
+				uint64_t tag,
+				int* err);
+
+/**	Resolve a data reference.
+ *
+ *	Returns a pointer to the referenced data in the data area, or
+ *	NULL if the reference is out of range.
+ */
+static inline const void* csnip_lphash_mmtable_data(
+				const csnip_lphash_mmtable* T,
+				csnip_lphash_mmtable_ref ref)
+{
+	if (ref.off > T->datalen || ref.len > T->datalen - ref.off)
+		return NULL;
+	return T->data + ref.off;
+}
+
+/** @cond */
+/* Control byte for a hash value */
+#define csnip_lphash_mmtable__Ctrl(h) \
+	((unsigned char)(0x80 | ((size_t)(h) >> (sizeof(size_t) * 8 - 7))))
+/** @endcond */
+
+/**	Defines a table builder type.
+ *
+ *	@param	struct_bldtype
+ *		Name of the struct to be defined.
+ *
+ *	@param	rkeytype
+ *		Type of the key records.
+ *
+ *	@param	rvaltype
+ *		Type of the value records.
+ */
+#define CSNIP_LPHASH_MMTABLE_DEF_TYPE(struct_bldtype, \
+				rkeytype, \
+				rvaltype) \
+	struct struct_bldtype { \
+		size_t cap;		/* Capacity */ \
+		size_t size;		/* Number of entries */ \
+		unsigned char* ctrl;	/* Control bytes */ \
+		size_t* hval;		/* Hash values */ \
+		rkeytype* key;		/* Key records */ \
+		rvaltype* val;		/* Value records */ \
+		char* data;		/* Data area */ \
+		size_t datalen;		/* Data area length */ \
+		size_t datacap;		/* Data area capacity */ \
+	};
+
+/**	Declare table functions.
+ *
+ *	@sa CSNIP_LPHASH_MMTABLE_DEF_FUNCS()
+ */
+#define CSNIP_LPHASH_MMTABLE_DECL_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				rkeytype, \
+				rvaltype, \
+				bldtype) \
+	/* Builder */ \
+	scope bldtype* prefix##builder_make(int* err); \
+	scope void prefix##builder_free(bldtype* bld); \
+	scope csnip_lphash_mmtable_ref prefix##builder_adddata( \
+			bldtype* bld, \
+			int* err, \
+			const void* p, \
+			size_t len); \
+	scope int prefix##builder_insert( \
+			bldtype* bld, \
+			int* err, \
+			keytype key, \
+			rkeytype rkey, \
+			rvaltype rval); \
+	scope void prefix##builder_save( \
+			const bldtype* bld, \
+			int* err, \
+			const char* path, \
+			uint64_t tag); \
+	\
+	/* Loaded tables */ \
+	scope csnip_lphash_mmtable* prefix##open( \
+			const char* path, \
+			uint64_t tag, \
+			int* err); \
+	scope const rvaltype* prefix##find( \
+			const csnip_lphash_mmtable* tbl, \
+			keytype key); \
+	scope size_t prefix##size(const csnip_lphash_mmtable* tbl); \
+	scope size_t prefix##capacity(const csnip_lphash_mmtable* tbl); \
+	\
+	/* Slot functions */ \
+	scope size_t prefix##findslot( \
+			const csnip_lphash_mmtable* tbl, \
+			keytype key); \
+	scope const rkeytype* prefix##getslotkeyaddress( \
+			const csnip_lphash_mmtable* tbl, \
+			size_t i); \
+	scope const rvaltype* prefix##getslotvalueaddress( \
+			const csnip_lphash_mmtable* tbl, \
+			size_t i); \
+	scope size_t prefix##firstoccupiedslot( \
+			const csnip_lphash_mmtable* tbl); \
+	scope size_t prefix##nextoccupiedslot( \
+			const csnip_lphash_mmtable* tbl, \
+			size_t i);
+
+/**	Define table functions.
+ *
+ *	@param	scope
+ *		scope of function declarations.
+ *
+ *	@param	prefix
+ *		function name prefix to add to generated functions.
+ *
+ *	@param	keytype
+ *		the type of keys used for lookups, e.g., `const char*`
+ *		for string keys.
+ *
+ *	@param	rkeytype
+ *		the type of the key records stored in the table, e.g.,
+ *		csnip_lphash_mmtable_ref for string keys.  Can be the
+ *		same as @a keytype for keys without pointers.
+ *
+ *	@param	rvaltype
+ *		the type of the value records stored in the table.
+ *
+ *	@param	bldtype
+ *		the builder type, as defined with
+ *		CSNIP_LPHASH_MMTABLE_DEF_TYPE().
+ *
+ *	@param	k1
+ *		dummy variable of type keytype.
+ *
+ *	@param	k2
+ *		dummy variable of type rkeytype.
+ *
+ *	@param	d
+ *		dummy variable for the start of the data area, of type
+ *		`const char*`.
+ *
+ *	@param	hash
+ *		an expression evaluating to a hash of @a k1.
+ *
+ *	@param	is_match
+ *		an expression evaluating to true if the key @a k1
+ *		matches the key record @a k2, and false otherwise.  The
+ *		data referenced by @a k2 starts at `d + k2.off`.
+ *
+ *	The following functions will be generated:
+ *
+ *	Building:
+ *		* `builder_make`: `bldtype* builder_make(int* err);`
+ *		  Create an empty builder.
+ *		* `builder_free`: `void builder_free(bldtype* bld);`
+ *		  Free a builder.
+ *		* `builder_adddata`: `csnip_lphash_mmtable_ref
+ *		  builder_adddata(bldtype* bld, int* err, const void* p,
+ *		  size_t len);`  Append `len` bytes to the data area,
+ *		  and return a reference to them.
+ *		* `builder_insert`: `int builder_insert(bldtype* bld,
+ *		  int* err, keytype key, rkeytype rkey, rvaltype rval);`
+ *		  Insert an entry with lookup key `key`, stored as key
+ *		  record `rkey`, and value record `rval`.  Returns 1 if
+ *		  the entry was inserted, and 0 if an entry matching key
+ *		  was already present.
+ *		* `builder_save`: `void builder_save(const bldtype* bld,
+ *		  int* err, const char* path, uint64_t tag);`  Write the
+ *		  table to a file.
+ *
+ *	Lookup:
+ *		* `open`: `csnip_lphash_mmtable* open(const char* path,
+ *		  uint64_t tag, int* err);`  Load a table file, see
+ *		  csnip_lphash_mmtable_open().  Close it with
+ *		  csnip_lphash_mmtable_close().
+ *		* `find`: `const rvaltype* find(const
+ *		  csnip_lphash_mmtable* T, keytype key);`  Find the
+ *		  value record for the given key, or return NULL.
+ *		* `size`, `capacity`:  Number of entries and slots.
+ *		* `findslot`, `getslotkeyaddress`,
+ *		  `getslotvalueaddress`, `firstoccupiedslot`,
+ *		  `nextoccupiedslot`:  Slot functions as for
+ *		  lphash_soatable, for iteration over the entries.
+ */
+#define CSNIP_LPHASH_MMTABLE_DEF_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				rkeytype, \
+				rvaltype, \
+				bldtype, \
+				k1, k2,		/* key dummy vars */ \
+				d,		/* data area dummy var */ \
+				hash,		/* evaluate to hash(k1) */ \
+				is_match)	/* Check whether k1 matches k2 */ \
+	\
+	/* Declare functions in case they weren't yet. */ \
+	CSNIP_LPHASH_MMTABLE_DECL_FUNCS(scope, prefix, keytype, rkeytype, \
+	  rvaltype, bldtype) \
+	\
+	/* Private methods */ \
+	\
+	/* Find a key in either a builder or a loaded table. */ \
+	static size_t prefix##_internal_findloc( \
+				size_t cap_, \
+				const unsigned char* ctrl_, \
+				const rkeytype* key_, \
+				const char* d, \
+				keytype key, \
+				int* state_) \
+	{ \
+		if (cap_ == 0) { \
+			*state_ = 2; \
+			return 0; \
+		} \
+		\
+		keytype k1 = key; \
+		const size_t h_ = (size_t)(hash); \
+		const unsigned char c_ = csnip_lphash_mmtable__Ctrl(h_); \
+		const size_t mask_ = cap_ - 1; \
+		size_t u = h_ & mask_; \
+		for (size_t i = 0; i < cap_; ++i) { \
+			if (!ctrl_[u]) { \
+				*state_ = 1; \
+				return u; \
+			} \
+			if (ctrl_[u] == c_) { \
+				rkeytype k2 = key_[u]; \
+				if (is_match) { \
+					*state_ = 0; \
+					return u; \
+				} \
+			} \
+			u = (u + 1) & mask_; \
+		} \
+		(void)d; \
+		*state_ = 2; \
+		return u; \
+	} \
+	\
+	/* Grow the builder table */ \
+	static void prefix##_internal_grow(bldtype* B, int* err) \
+	{ \
+		const size_t newcap = (B->cap ? 2 * B->cap : 8); \
+		bldtype N = *B; \
+		N.cap = newcap; \
+		csnip_mem_Alloc0(newcap, N.ctrl, *err); \
+		if (err && *err) return; \
+		csnip_mem_Alloc(newcap, N.hval, *err); \
+		if (err && *err) goto fail_hash; \
+		csnip_mem_Alloc0(newcap, N.key, *err); \
+		if (err && *err) goto fail_key; \
+		csnip_mem_Alloc0(newcap, N.val, *err); \
+		if (err && *err) goto fail_val; \
+		\
+		for (size_t i = 0; i < B->cap; ++i) { \
+			if (!B->ctrl[i]) \
+				continue; \
+			size_t u = B->hval[i] & (newcap - 1); \
+			while (N.ctrl[u]) \
+				u = (u + 1) & (newcap - 1); \
+			N.ctrl[u] = B->ctrl[i]; \
+			N.hval[u] = B->hval[i]; \
+			N.key[u] = B->key[i]; \
+			N.val[u] = B->val[i]; \
+		} \
+		if (B->ctrl) csnip_mem_Free(B->ctrl); \
+		if (B->hval) csnip_mem_Free(B->hval); \
+		if (B->key) csnip_mem_Free(B->key); \
+		if (B->val) csnip_mem_Free(B->val); \
+		*B = N; \
+		return; \
+	fail_val: \
+		csnip_mem_Free(N.key); \
+	fail_key: \
+		csnip_mem_Free(N.hval); \
+	fail_hash: \
+		csnip_mem_Free(N.ctrl); \
+	} \
+	\
+	/* Builder */ \
+	scope bldtype* prefix##builder_make(int* err) \
+	{ \
+		if (err) *err = 0; \
+		\
+		bldtype* B; \
+		csnip_mem_Alloc(1, B, *err); \
+		if (err && *err) \
+			return NULL; \
+		*B = (bldtype){ 0 }; \
+		return B; \
+	} \
+	\
+	scope void prefix##builder_free(bldtype* B) \
+	{ \
+		if (B->ctrl) csnip_mem_Free(B->ctrl); \
+		if (B->hval) csnip_mem_Free(B->hval); \
+		if (B->key) csnip_mem_Free(B->key); \
+		if (B->val) csnip_mem_Free(B->val); \
+		if (B->data) csnip_mem_Free(B->data); \
+		csnip_mem_Free(B); \
+	} \
+	\
+	scope csnip_lphash_mmtable_ref prefix##builder_adddata( \
+				bldtype* B, \
+				int* err, \
+				const void* p, \
+				size_t len) \
+	{ \
+		if (err) *err = 0; \
+		\
+		csnip_lphash_mmtable_ref ref = { B->datalen, len }; \
+		if (B->datalen + len > B->datacap) { \
+			size_t newcap = (B->datacap ? B->datacap : 64); \
+			while (B->datalen + len > newcap) \
+				newcap *= 2; \
+			csnip_mem_Realloc(newcap, B->data, *err); \
+			if (err && *err) \
+				return ref; \
+			B->datacap = newcap; \
+		} \
+		memcpy(B->data + B->datalen, p, len); \
+		B->datalen += len; \
+		return ref; \
+	} \
+	\
+	scope int prefix##builder_insert(bldtype* B, \
+				int* err, \
+				keytype key, \
+				rkeytype rkey, \
+				rvaltype rval) \
+	{ \
+		if (err) *err = 0; \
+		\
+		if ((B->size + 1) * 3 > B->cap * 2) { \
+			prefix##_internal_grow(B, err); \
+			if (err && *err) \
+				return 0; \
+		} \
+		\
+		int r; \
+		const size_t loc = prefix##_internal_findloc(B->cap, \
+				B->ctrl, B->key, B->data, key, &r); \
+		assert(r < 2); \
+		if (r == 1) { \
+			keytype k1 = key; \
+			B->hval[loc] = (size_t)(hash); \
+			B->ctrl[loc] = csnip_lphash_mmtable__Ctrl( \
+						B->hval[loc]); \
+			B->key[loc] = rkey; \
+			B->val[loc] = rval; \
+			++B->size; \
+		} \
+		return r; \
+	} \
+	\
+	scope void prefix##builder_save(const bldtype* B, \
+				int* err, \
+				const char* path, \
+				uint64_t tag) \
+	{ \
+		const csnip_lphash_mmtable V = { \
+			.cap = B->cap, \
+			.size = B->size, \
+			.keysize = sizeof(rkeytype), \
+			.valsize = sizeof(rvaltype), \
+			.ctrl = B->ctrl, \
+			.key = B->key, \
+			.val = B->val, \
+			.data = B->data, \
+			.datalen = B->datalen \
+		}; \
+		csnip_lphash_mmtable_write(&V, path, tag, err); \
+	} \
+	\
+	/* Loaded tables */ \
+	scope csnip_lphash_mmtable* prefix##open(const char* path, \
+				uint64_t tag, \
+				int* err) \
+	{ \
+		return csnip_lphash_mmtable_open(path, tag, \
+			sizeof(rkeytype), sizeof(rvaltype), err); \
+	} \
+	\
+	scope const rvaltype* prefix##find(const csnip_lphash_mmtable* T, \
+				keytype key) \
+	{ \
+		int r; \
+		const size_t loc = prefix##_internal_findloc(T->cap, \
+				T->ctrl, (const rkeytype*)T->key, T->data, \
+				key, &r); \
+		if (r == 0) \
+			return &((const rvaltype*)T->val)[loc]; \
+		return NULL; \
+	} \
+	\
+	scope size_t prefix##size(const csnip_lphash_mmtable* T) \
+	{ \
+		return T->size; \
+	} \
+	\
+	scope size_t prefix##capacity(const csnip_lphash_mmtable* T) \
+	{ \
+		return T->cap; \
+	} \
+	\
+	/* Slot functions */ \
+	scope size_t prefix##findslot(const csnip_lphash_mmtable* T, \
+				keytype key) \
+	{ \
+		int r; \
+		const size_t loc = prefix##_internal_findloc(T->cap, \
+				T->ctrl, (const rkeytype*)T->key, T->data, \
+				key, &r); \
+		if (r == 0) \
+			return loc; \
+		return T->cap; \
+	} \
+	\
+	scope const rkeytype* prefix##getslotkeyaddress( \
+				const csnip_lphash_mmtable* T, \
+				size_t i) \
+	{ \
+		return &((const rkeytype*)T->key)[i]; \
+	} \
+	\
+	scope const rvaltype* prefix##getslotvalueaddress( \
+				const csnip_lphash_mmtable* T, \
+				size_t i) \
+	{ \
+		return &((const rvaltype*)T->val)[i]; \
+	} \
+	\
+	scope size_t prefix##firstoccupiedslot( \
+				const csnip_lphash_mmtable* T) \
+	{ \
+		size_t r; \
+		for (r = 0; r < T->cap; ++r) \
+			if (T->ctrl[r]) break; \
+		return r; \
+	} \
+	\
+	scope size_t prefix##nextoccupiedslot( \
+				const csnip_lphash_mmtable* T, \
+				size_t r) \
+	{ \
+		for (++r; r < T->cap; ++r) \
+			if (T->ctrl[r]) break; \
+		return r; \
+	}
+
+/** @}
+ *  @}
+ */
+
+#endif /* CSNIP_LPHASH_MMTABLE_H */
+
+#if defined(CSNIP_SHORT_NAMES) && !defined(CSNIP_LPHASH_MMTABLE_HAVE_SHORT_NAMES)
+#define lphash_mmtable			csnip_lphash_mmtable
+#define lphash_mmtable_ref		csnip_lphash_mmtable_ref
+#define lphash_mmtable_open		csnip_lphash_mmtable_open
+#define lphash_mmtable_close		csnip_lphash_mmtable_close
+#define lphash_mmtable_write		csnip_lphash_mmtable_write
+#define lphash_mmtable_data		csnip_lphash_mmtable_data
+#define CSNIP_LPHASH_MMTABLE_HAVE_SHORT_NAMES
+#endif /* CSNIP_SHORT_NAMES && !CSNIP_LPHASH_MMTABLE_HAVE_SHORT_NAMES */
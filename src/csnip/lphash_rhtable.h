@@ -0,0 +1,647 @@
+#ifndef CSNIP_LPHASH_RHTABLE_H
+#define CSNIP_LPHASH_RHTABLE_H
+
+/**	@file lphash_rhtable.h
+ *	@addtogroup hash_tables		Hash tables
+ *	@{
+ *	@defgroup lphash_rhtable	Robin Hood Linear Probing Hash Table
+ *	@{
+ *
+ *	Linear probing hash tables with Robin Hood insertion.
+ *
+ *	This is an alternative implementation of the table functions from
+ *	lphash_table.h.  It uses the same table type, as defined by
+ *	CSNIP_LPHASH_TABLE_DEF_TYPE(), and generates the same functions
+ *	with the same signatures and semantics, as declared by
+ *	CSNIP_LPHASH_TABLE_DECL_FUNCS().  It is therefore possible to
+ *	switch between the two implementations by replacing
+ *	CSNIP_LPHASH_TABLE_DEF_FUNCS() with
+ *	CSNIP_LPHASH_RHTABLE_DEF_FUNCS() or vice versa.
+ *
+ *	The difference is in how the entries are arranged in the table.
+ *	With Robin Hood insertion, an entry being inserted displaces
+ *	entries that are closer to their home slot ("richer") than
+ *	itself.  As a result, the entries of a cluster are ordered by
+ *	their home slot, and the variance of probe lengths is greatly
+ *	reduced.  The occupancy byte of each slot stores the probe
+ *	distance plus one (0 meaning empty).  This allows for:
+ *
+ *	* Early termination of unsuccessful lookups:  As soon as a slot
+ *	  with a smaller probe distance than the current one is
+ *	  encountered, the key cannot be in the table.
+ *
+ *	* Cheap filtering:  The key comparison (is_match) is only
+ *	  evaluated for slots whose stored distance equals the current
+ *	  distance, since an entry with an equal key necessarily has
+ *	  the same home slot.
+ *
+ *	* Higher load factors:  The table is grown only when the load
+ *	  factor exceeds 9/10, rather than 2/3 as in lphash_table.h.
+ *
+ *	Deletion uses backward shifting, so no tombstones are needed.
+ *
+ *	Since the probe distance is stored in a byte, it is limited to
+ *	CSNIP_LPHASH_RHTABLE_MAX_DIST.  If an insertion would exceed
+ *	that, the table is grown regardless of its load.  With any
+ *	reasonable hash function, that never happens in practice.  If
+ *	the load is already below 1/8 when that happens, growing is
+ *	pointless, and csnip_err_RANGE is raised instead.
+ *
+ *	The capacity of the table is always a power of 2.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <csnip/err.h>
+#include <csnip/mem.h>
+#include <csnip/lphash_table.h>
+
+/**	Maximum probe distance.
+ *
+ *	The occupancy byte of a slot stores the probe distance plus 1,
+ *	hence the limit.
+ */
+#define CSNIP_LPHASH_RHTABLE_MAX_DIST	254
+
+/**	Define Robin Hood hash table functions.
+ *
+ *	This takes the same arguments as CSNIP_LPHASH_TABLE_DEF_FUNCS(),
+ *	and generates the same functions, see there for the
+ *	documentation.  The table type is defined with
+ *	CSNIP_LPHASH_TABLE_DEF_TYPE().
+ *
+ *	The only observable difference, other than performance, is that
+ *	removeatslot() will more often return the same slot index that
+ *	was passed in, since backward shifting moves the successor of
+ *	a removed entry into its slot.
+ */
+#define CSNIP_LPHASH_RHTABLE_DEF_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				entrytype, \
+				tbltype, \
+				k1, k2,		/* key dummy vars */ \
+				e,		/* entry dummy var */ \
+				hash,		/* evaluate to hash(k1) */ \
+				is_match,	/* Check whether k1 and k2 match */ \
+				get_key)	/* evaluate to the key of e */ \
+	\
+	/* Declare functions in case they weren't yet. */ \
+	CSNIP_LPHASH_TABLE_DECL_FUNCS(scope, prefix, keytype, entrytype, \
+	  tbltype) \
+	\
+	/* Private methods */ \
+	\
+	/* Find a key.
+	 *
+	 * Returns the location, and sets *state_ to 0 if found, 1 if
+	 * not found, in which case the location is the insertion point,
+	 * and *dist_ the probe distance plus 1 an entry at that point
+	 * has.  If the insertion point would exceed the maximum probe
+	 * distance, *state_ is set to 2.  h_ is the hash of the key.
+	 */ \
+	static size_t prefix##_internal_findloc_hash( \
+				const tbltype* T, \
+				keytype key, \
+				size_t h_, \
+				int* state_, \
+				unsigned* dist_) \
+	{ \
+		*dist_ = 0; \
+		if (T->cap == 0) { \
+			*state_ = 2; \
+			return (size_t)-1; \
+		} \
+		\
+		const size_t mask_ = T->cap - 1; \
+		keytype k1 = key; \
+		size_t u = h_ & mask_; \
+		unsigned d = 1; \
+		while (T->occ[u] >= d) { \
+			if (T->occ[u] == d) { \
+				entrytype e = T->entry[u]; \
+				keytype k2 = (get_key); \
+				if (is_match) { \
+					*state_ = 0; \
+					return u; \
+				} \
+			} \
+			u = (u + 1) & mask_; \
+			++d; \
+		} \
+		*state_ = (d <= CSNIP_LPHASH_RHTABLE_MAX_DIST + 1 ? 1 : 2); \
+		*dist_ = d; \
+		return u; \
+	} \
+	\
+	static size_t prefix##_internal_findloc( \
+				const tbltype* T, \
+				keytype key, \
+				int* state_, \
+				unsigned* dist_) \
+	{ \
+		keytype k1 = key; \
+		return prefix##_internal_findloc_hash(T, key, \
+					(size_t)(hash), state_, dist_); \
+	} \
+	\
+	/* Make room at insertion point loc by shifting the remainder
+	 * of the cluster back by one slot.
+	 *
+	 * Returns 0 if this would exceed the maximum probe distance; the
+	 * table is unmodified in that case.
+	 */ \
+	static _Bool prefix##_internal_makeroom(tbltype* T, \
+						size_t loc, \
+						unsigned dist) \
+	{ \
+		const size_t mask_ = T->cap - 1; \
+		\
+		/* Find the end of the cluster and check distances */ \
+		size_t u = loc; \
+		while (T->occ[u]) { \
+			if (T->occ[u] > CSNIP_LPHASH_RHTABLE_MAX_DIST) \
+				return 0; \
+			u = (u + 1) & mask_; \
+		} \
+		\
+		/* Shift */ \
+		while (u != loc) { \
+			const size_t v = (u - 1) & mask_; \
+			T->entry[u] = T->entry[v]; \
+			T->occ[u] = (unsigned char)(T->occ[v] + 1); \
+			u = v; \
+		} \
+		T->occ[loc] = (unsigned char)dist; \
+		return 1; \
+	} \
+	\
+	static void prefix##_internal_deleteloc(tbltype* T, \
+						size_t loc) \
+	{ \
+		const size_t mask_ = T->cap - 1; \
+		size_t u = loc; \
+		size_t v = (u + 1) & mask_; \
+		while (T->occ[v] > 1) { \
+			T->entry[u] = T->entry[v]; \
+			T->occ[u] = (unsigned char)(T->occ[v] - 1); \
+			u = v; \
+			v = (v + 1) & mask_; \
+		} \
+		T->occ[u] = 0; \
+	} \
+	\
+	/* Rebuild the table with the given capacity, which must be a
+	 * power of 2 large enough to hold all entries.
+	 */ \
+	static void prefix##_internal_rehash(tbltype* T, \
+						int* err, \
+						size_t newcap) \
+	{ \
+		for (;;) { \
+			/* Allocate new hashing table */ \
+			entrytype* newarr; \
+			unsigned char* newocc; \
+			csnip_mem_Alloc(newcap, newarr, *err); \
+			if (err && *err) return; \
+			csnip_mem_Alloc(newcap, newocc, *err); \
+			if (err && *err) { \
+				csnip_mem_Free(newarr); \
+				return; \
+			} \
+			tbltype N = { \
+				.cap = newcap, \
+				.size = T->size, \
+				.entry = newarr, \
+				.occ = newocc \
+			}; \
+			for (size_t i = 0; i < newcap; ++i) { \
+				newocc[i] = 0; \
+			} \
+			\
+			/* Copy from old to new */ \
+			size_t i; \
+			for (i = 0; i < T->cap; ++i) { \
+				if (T->occ[i]) { \
+					size_t l; \
+					int r; \
+					unsigned d; \
+					entrytype e = T->entry[i]; \
+					l = prefix##_internal_findloc(&N, \
+							(get_key), &r, &d); \
+					assert(r != 0); \
+					if (r == 2 || !prefix##_internal_makeroom( \
+							&N, l, d)) \
+						break; \
+					newarr[l] = T->entry[i]; \
+				} \
+			} \
+			if (i < T->cap) { \
+				/* Pathological clustering, try larger */ \
+				csnip_mem_Free(newarr); \
+				csnip_mem_Free(newocc); \
+				newcap *= 2; \
+				if (newcap / 8 > T->size) { \
+					csnip_err_Raise(csnip_err_RANGE, \
+						*err); \
+					return; \
+				} \
+				continue; \
+			} \
+			\
+			/* Replace old table with new one, and free */ \
+			if (T->entry) csnip_mem_Free(T->entry); \
+			if (T->occ) csnip_mem_Free(T->occ); \
+			*T = N; \
+			return; \
+		} \
+	} \
+	\
+	/* Smallest capacity for the given number of entries */ \
+	static size_t prefix##_internal_capfor(size_t min_size) \
+	{ \
+		size_t cap = 8; \
+		while (min_size * 10 > cap * 9) { \
+			cap *= 2; \
+		} \
+		return cap; \
+	} \
+	\
+	static _Bool prefix##_internal_grow(tbltype* T, \
+						int* err, \
+						size_t min_size) \
+	{ \
+		if (min_size * 10 <= T->cap * 9) { \
+			/* No need to grow */ \
+			return 0; \
+		} \
+		\
+		prefix##_internal_rehash(T, err, \
+			prefix##_internal_capfor(min_size)); \
+		return 1; \
+	} \
+	\
+	/* Find or create an empty slot for key.
+	 *
+	 * Returns the slot; *r is set to 0 if the key was found, and
+	 * to 1 if an empty slot was made for it.  In the latter case,
+	 * the caller must fill in the entry and increase the size.
+	 */ \
+	static size_t prefix##_internal_findorinsertloc_hash(tbltype* T, \
+						int* err, \
+						keytype key, \
+						size_t h, \
+						int* r) \
+	{ \
+		size_t loc; \
+		unsigned d; \
+		\
+		/* Grow if necessary */ \
+		prefix##_internal_grow(T, err, T->size + 1); \
+		if (err && *err) \
+			return 0; \
+		\
+		for (;;) { \
+			loc = prefix##_internal_findloc_hash(T, key, h, r, &d); \
+			if (*r == 0) \
+				return loc; \
+			if (*r == 1 && prefix##_internal_makeroom(T, \
+							loc, d)) \
+				return loc; \
+			\
+			/* Probe distance exhausted, grow.  If the load
+			 * is already low, growing does not help: the
+			 * hash function is not good enough.
+			 */ \
+			if (T->cap / 8 > T->size) { \
+				csnip_err_Raise(csnip_err_RANGE, *err); \
+				return 0; \
+			} \
+			prefix##_internal_rehash(T, err, T->cap * 2); \
+			if (err && *err) \
+				return 0; \
+		} \
+	} \
+	\
+	static size_t prefix##_internal_findorinsertloc(tbltype* T, \
+						int* err, \
+						keytype key, \
+						int* r) \
+	{ \
+		keytype k1 = key; \
+		return prefix##_internal_findorinsertloc_hash(T, err, key, \
+						(size_t)(hash), r); \
+	} \
+	\
+	/* Creation / Deletion */ \
+	scope tbltype* prefix##make(int* err) \
+	{ \
+		if (err) *err = 0; \
+		\
+		tbltype* T; \
+		csnip_mem_Alloc(1, T, *err); \
+		if (err && *err) \
+			return NULL; \
+		T->cap = 0; \
+		T->size = 0; \
+		T->entry = NULL; \
+		T->occ = NULL; \
+		return T; \
+	} \
+	\
+	scope tbltype* prefix##make_with_cap(int* err, size_t min_size) \
+	{ \
+		tbltype* T = prefix##make(err); \
+		if (T == NULL) \
+			return NULL; \
+		prefix##reserve(T, err, min_size); \
+		if (err && *err) { \
+			prefix##free(T); \
+			return NULL; \
+		} \
+		return T; \
+	} \
+	\
+	scope void prefix##free(tbltype* T) \
+	{ \
+		if (T->entry)	csnip_mem_Free(T->entry); \
+		if (T->occ)	csnip_mem_Free(T->occ); \
+		csnip_mem_Free(T); \
+	} \
+	\
+	/* Element manipulation */ \
+	\
+	scope int prefix##insert(tbltype* T, int* err, entrytype e) \
+	{ \
+		if (err) *err = 0; \
+		\
+		int r; \
+		size_t loc = prefix##_internal_findorinsertloc(T, err, \
+							(get_key), &r); \
+		if (err && *err) \
+			return 0; \
+		if (r == 1) { \
+			T->entry[loc] = e; \
+			++T->size; \
+		} \
+		return r; \
+	} \
+	\
+	scope int prefix##insert_or_assign(tbltype* T, \
+				int* err, \
+				entrytype e, \
+				entrytype* old) \
+	{ \
+		if (err) *err = 0; \
+		\
+		int r; \
+		size_t loc = prefix##_internal_findorinsertloc(T, err, \
+							(get_key), &r); \
+		if (err && *err) \
+			return 0; \
+		if (r == 0) { \
+			if (old) *old = T->entry[loc]; \
+		} else { \
+			++T->size; \
+		} \
+		T->entry[loc] = e; \
+		return r; \
+	} \
+	\
+	scope entrytype* prefix##find_or_insert(tbltype* T, \
+					int* err, \
+					entrytype entry) \
+	{ \
+		if (err) *err = 0; \
+		\
+		int r; \
+		unsigned d; \
+		entrytype e = entry; \
+		size_t loc = prefix##_internal_findloc(T, (get_key), &r, &d); \
+		if (r >= 1) { \
+			loc = prefix##_internal_findorinsertloc(T, err, \
+							(get_key), &r); \
+			if (err && *err) \
+				return NULL; \
+			assert(r == 1); \
+			T->entry[loc] = entry; \
+			++T->size; \
+		} \
+		return &T->entry[loc]; \
+	} \
+	\
+	scope _Bool prefix##remove(tbltype* T, int* err, keytype key) \
+	{ \
+		int r; \
+		unsigned d; \
+		const size_t loc = prefix##_internal_findloc(T, key, &r, &d); \
+		if (r == 0) { \
+			prefix##_internal_deleteloc(T, loc); \
+			--T->size; \
+		}  \
+		return r == 0; \
+	} \
+	\
+	scope entrytype* prefix##find(const tbltype* T, keytype key) \
+	{ \
+		int r; \
+		unsigned d; \
+		const size_t loc = prefix##_internal_findloc(T, key, &r, &d); \
+		if (r == 0) \
+			return &T->entry[loc]; \
+		return NULL; \
+	} \
+	\
+	/* Batched operations */ \
+	scope size_t prefix##find_many(const tbltype* T, \
+				keytype const* keys, \
+				size_t n, \
+				entrytype** out) \
+	{ \
+		size_t h[CSNIP_LPHASH_TABLE_PREFETCH_DIST]; \
+		size_t nfound = 0; \
+		for (size_t b = 0; b < n; \
+		  b += CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+		{ \
+			size_t m = n - b; \
+			if (m > CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+				m = CSNIP_LPHASH_TABLE_PREFETCH_DIST; \
+			\
+			/* Hash and prefetch */ \
+			for (size_t i = 0; i < m; ++i) { \
+				keytype k1 = keys[b + i]; \
+				h[i] = (size_t)(hash); \
+				if (T->cap) { \
+					const size_t u = h[i] & (T->cap - 1); \
+					csnip_cext_prefetch(&T->occ[u]); \
+					csnip_cext_prefetch(&T->entry[u]); \
+				} \
+			} \
+			\
+			/* Resolve */ \
+			for (size_t i = 0; i < m; ++i) { \
+				int r; \
+				unsigned d; \
+				const size_t loc = \
+					prefix##_internal_findloc_hash(T, \
+						keys[b + i], h[i], &r, &d); \
+				if (r == 0) { \
+					out[b + i] = &T->entry[loc]; \
+					++nfound; \
+				} else { \
+					out[b + i] = NULL; \
+				} \
+			} \
+		} \
+		return nfound; \
+	} \
+	\
+	scope size_t prefix##insert_many(tbltype* T, \
+				int* err, \
+				entrytype const* entries, \
+				size_t n) \
+	{ \
+		if (err) *err = 0; \
+		\
+		size_t h[CSNIP_LPHASH_TABLE_PREFETCH_DIST]; \
+		size_t ninserted = 0; \
+		for (size_t b = 0; b < n; \
+		  b += CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+		{ \
+			size_t m = n - b; \
+			if (m > CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+				m = CSNIP_LPHASH_TABLE_PREFETCH_DIST; \
+			prefix##_internal_grow(T, err, T->size + m); \
+			if (err && *err) \
+				return ninserted; \
+			\
+			/* Hash and prefetch */ \
+			for (size_t i = 0; i < m; ++i) { \
+				entrytype e = entries[b + i]; \
+				keytype k1 = (get_key); \
+				h[i] = (size_t)(hash); \
+				const size_t u = h[i] & (T->cap - 1); \
+				csnip_cext_prefetch(&T->occ[u]); \
+				csnip_cext_prefetch(&T->entry[u]); \
+			} \
+			\
+			/* Resolve */ \
+			for (size_t i = 0; i < m; ++i) { \
+				int r; \
+				entrytype e = entries[b + i]; \
+				const size_t loc = \
+					prefix##_internal_findorinsertloc_hash( \
+						T, err, (get_key), h[i], &r); \
+				if (err && *err) \
+					return ninserted; \
+				if (r == 1) { \
+					T->entry[loc] = e; \
+					++T->size; \
+					++ninserted; \
+				} \
+			} \
+		} \
+		return ninserted; \
+	} \
+	\
+	/* Size and capacity */ \
+	scope size_t prefix##size(const tbltype* T) \
+	{ \
+		return T->size; \
+	} \
+	\
+	scope size_t prefix##capacity(const tbltype* T) \
+	{ \
+		return T->cap; \
+	} \
+	\
+	scope void prefix##reserve(tbltype* T, int* err, size_t min_size) \
+	{ \
+		if (err) *err = 0; \
+		prefix##_internal_grow(T, err, min_size); \
+	} \
+	\
+	scope void prefix##shrink(tbltype* T, int* err) \
+	{ \
+		if (err) *err = 0; \
+		if (T->size == 0) { \
+			if (T->entry) csnip_mem_Free(T->entry); \
+			if (T->occ) csnip_mem_Free(T->occ); \
+			T->entry = NULL; \
+			T->occ = NULL; \
+			T->cap = 0; \
+			return; \
+		} \
+		const size_t newcap = prefix##_internal_capfor(T->size); \
+		if (newcap < T->cap) \
+			prefix##_internal_rehash(T, err, newcap); \
+	} \
+	\
+	/* Slot functions */ \
+	scope size_t prefix##findslot(const tbltype* T, keytype key) \
+	{ \
+		int r; \
+		unsigned d; \
+		const size_t loc = prefix##_internal_findloc(T, key, &r, &d); \
+		if (r == 0) \
+			return loc; \
+		return T->cap; \
+	} \
+	\
+	scope _Bool prefix##isslotoccupied(const tbltype* T, size_t i) \
+	{ \
+		assert(i < T->cap); \
+		return T->occ[i] != 0; \
+	} \
+	\
+	scope entrytype* prefix##getslotentryaddress( \
+					const tbltype* T, \
+					size_t i) \
+	{ \
+		return &T->entry[i]; \
+	} \
+	\
+	scope size_t prefix##getslotfromentryaddress( \
+					const tbltype* T, \
+					entrytype const* entry) \
+	{ \
+		return (size_t)(entry - T->entry); \
+	} \
+	\
+	scope size_t prefix##removeatslot(tbltype* T, int* err, size_t i) \
+	{ \
+		if (err) *err = 0; \
+		\
+		if (T->occ[i]) { \
+			prefix##_internal_deleteloc(T, i); \
+			--T->size; \
+			if (T->occ[i]) \
+				return i; \
+		} \
+		return prefix##nextoccupiedslot(T, i); \
+	} \
+	\
+	scope size_t prefix##firstoccupiedslot(const tbltype* T) \
+	{ \
+		size_t r; \
+		for (r = 0; r < T->cap; ++r) \
+			if (T->occ[r]) break; \
+		return r; \
+	} \
+	\
+	scope size_t prefix##nextoccupiedslot( \
+					const tbltype* T, \
+					size_t r) \
+	{ \
+		for (++r; r < T->cap; ++r) \
+			if (T->occ[r]) break; \
+		return r; \
+	}
+
+/** @}
+ *  @}
+ */
+
+#endif /* CSNIP_LPHASH_RHTABLE_H */
@@ -0,0 +1,543 @@
+#ifndef CSNIP_LPHASH_SOATABLE_H
+#define CSNIP_LPHASH_SOATABLE_H
+
+/**	@file lphash_soatable.h
+ *	@addtogroup hash_tables		Hash tables
+ *	@{
+ *	@defgroup lphash_soatable	Split Key/Value Hash Table
+ *	@{
+ *
+ *	Linear probing hash tables with keys and values in separate
+ *	arrays.
+ *
+ *	This is a variant of the tables from lphash_table.h for maps
+ *	with small keys and large values.  Rather than an array of
+ *	entries, the table keeps a dense array of keys, and a parallel
+ *	array of values.  A probe sequence then only scans the keys,
+ *	with many keys per cache line, and the value array is accessed
+ *	only for the matching slot.  For large values, this reduces
+ *	the memory traffic of lookups considerably, in particular that
+ *	of unsuccessful ones.
+ *
+ *	Since there is no entry type, the generated functions take keys
+ *	and values as separate arguments, and the slot functions give
+ *	access to the key and the value of a slot separately.  The
+ *	slots are numbered as in lphash_table.h, and the same index
+ *	addresses the key and the value array.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <csnip/cext.h>
+#include <csnip/mem.h>
+#include <csnip/lphash.h>
+
+/**	Defines a split key/value hash table type.
+ *
+ *	@param	struct_tbltype
+ *		Name of the struct to be defined.
+ *
+ *	@param	keytype
+ *		Type of the keys.
+ *
+ *	@param	valtype
+ *		Type of the values.
+ */
+#define CSNIP_LPHASH_SOATABLE_DEF_TYPE(struct_tbltype, \
+				keytype, \
+				valtype) \
+	struct struct_tbltype { \
+		size_t cap;		/* Capacity */ \
+		size_t size;		/* Number of used entries */ \
+		keytype* key;		/* The keys */ \
+		valtype* val;		/* The values */ \
+		unsigned char* occ;	/* Occupancy indicators */ \
+	};
+
+/**	Declare split key/value hash table functions.
+ *
+ *	@sa CSNIP_LPHASH_SOATABLE_DEF_FUNCS()
+ */
+#define CSNIP_LPHASH_SOATABLE_DECL_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				valtype, \
+				tbltype) \
+	/* Creation & Deletion */ \
+	scope tbltype* prefix##make(int* err); \
+	scope tbltype* prefix##make_with_cap(int* err, size_t min_size); \
+	scope void prefix##free(tbltype* tbl); \
+	\
+	/* Element manipulation */ \
+	scope int prefix##insert( \
+			tbltype* tbl, \
+			int* err, \
+			keytype key, \
+			valtype val); \
+	scope int prefix##insert_or_assign( \
+			tbltype* tbl, \
+			int* err, \
+			keytype key, \
+			valtype val, \
+			valtype* ret_old); \
+	scope valtype* prefix##find_or_insert( \
+			tbltype* tbl, \
+			int* err, \
+			keytype key, \
+			valtype val); \
+	scope _Bool prefix##remove( \
+			tbltype* tbl, \
+			int* err, \
+			keytype key); \
+	scope valtype* prefix##find( \
+			const tbltype* tbl, \
+			keytype key); \
+	\
+	/* Size and capacity */ \
+	scope size_t prefix##size(const tbltype* tbl); \
+	scope size_t prefix##capacity(const tbltype* tbl); \
+	scope void prefix##reserve( \
+			tbltype* tbl, \
+			int* err, \
+			size_t min_size); \
+	scope void prefix##shrink(tbltype* tbl, int* err); \
+	\
+	/* Slot functions */ \
+	scope size_t prefix##findslot( \
+			const tbltype* tbl, \
+			keytype key); \
+	scope _Bool prefix##isslotoccupied( \
+			const tbltype* tbl, \
+			size_t i); \
+	scope keytype const* prefix##getslotkeyaddress( \
+			const tbltype* tbl, \
+			size_t i); \
+	scope valtype* prefix##getslotvalueaddress( \
+			const tbltype* tbl, \
+			size_t i); \
+	scope size_t prefix##getslotfromvalueaddress( \
+			const tbltype* tbl, \
+			valtype const* val); \
+	scope size_t prefix##removeatslot( \
+			tbltype* tbl, \
+			int* err, \
+			size_t i); \
+	scope size_t prefix##firstoccupiedslot( \
+			const tbltype* tbl); \
+	scope size_t prefix##nextoccupiedslot( \
+			const tbltype* tbl, \
+			size_t i);
+
+/**	Define split key/value hash table functions.
+ *
+ *	@param	scope
+ *		scope of function declarations.
+ *
+ *	@param	prefix
+ *		function name prefix to add to generated functions.
+ *
+ *	@param	keytype
+ *		the type of the keys.
+ *
+ *	@param	valtype
+ *		the type of the values.
+ *
+ *	@param	tbltype
+ *		the type of the hash table itself, as generated with
+ *		CSNIP_LPHASH_SOATABLE_DEF_TYPE().
+ *
+ *	@param	k1, k2
+ *		dummy variables representing keys.
+ *
+ *	@param	hash
+ *		an expression evaluating to a hash of @a k1.
+ *
+ *	@param	is_match
+ *		an expression evaluation to true if @a k1 and @a k2
+ *		compare equal, and false otherwise.
+ *
+ *	The generated functions correspond to those of
+ *	CSNIP_LPHASH_TABLE_DEF_FUNCS(), with the following differences:
+ *
+ *	* `insert`, `insert_or_assign` and `find_or_insert` take the
+ *	  key and the value as separate arguments, e.g.,
+ *	  `int insert(tbltype* tbl, int* err, keytype key, valtype
+ *	  val);`.  `insert_or_assign` returns the old value in
+ *	  `*ret_old`, and `find_or_insert` returns a pointer to the
+ *	  value.
+ *	* `find`: `valtype* find(const tbltype* T, keytype key);`
+ *	  returns a pointer to the value for the given key, or NULL.
+ *	* `getslotentryaddress` is replaced by `getslotkeyaddress`,
+ *	  `keytype const* getslotkeyaddress(const tbltype* T, size_t
+ *	  i);`, and `getslotvalueaddress`, `valtype*
+ *	  getslotvalueaddress(const tbltype* T, size_t i);`.  The keys
+ *	  must not be modified through the returned pointer.
+ *	* `getslotfromentryaddress` is replaced by
+ *	  `getslotfromvalueaddress`, `size_t
+ *	  getslotfromvalueaddress(const tbltype* T, valtype const*
+ *	  val);`.
+ *
+ *	The maximum load factor is 2/3, as with lphash_table.
+ */
+#define CSNIP_LPHASH_SOATABLE_DEF_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				valtype, \
+				tbltype, \
+				k1, k2,		/* key dummy vars */ \
+				hash,		/* evaluate to hash(k1) */ \
+				is_match)	/* Check whether k1 and k2 match */ \
+	\
+	/* Declare functions in case they weren't yet. */ \
+	CSNIP_LPHASH_SOATABLE_DECL_FUNCS(scope, prefix, keytype, valtype, \
+	  tbltype) \
+	\
+	/* Private methods */ \
+	static size_t prefix##_internal_findloc( \
+				const tbltype* T, \
+				keytype key, \
+				int* state_) \
+	{ \
+		size_t ret_; \
+		keytype k2; \
+		csnip_lphash_Find(T->cap, keytype, k1, u, \
+				hash, \
+				!T->occ[u], \
+				(k2 = T->key[u], (is_match)), \
+				T->key[u], \
+				key, \
+				ret_, \
+				*state_); \
+		return ret_; \
+	} \
+	\
+	static void prefix##_internal_deleteloc(tbltype* T, \
+						size_t loc) \
+	{ \
+		csnip_lphash_Delete(T->cap, keytype, k1, u, v, \
+				hash, \
+				!T->occ[u], \
+				T->key[u], \
+				(T->key[v] = T->key[u], \
+				 T->val[v] = T->val[u], \
+				 T->occ[v] = T->occ[u]), \
+				T->occ[u] = 0, \
+				loc); \
+	} \
+	\
+	/* Smallest capacity for the given number of entries */ \
+	static size_t prefix##_internal_capfor(size_t min_size) \
+	{ \
+		size_t cap = 8; \
+		while (min_size * 3 > cap * 2) \
+			cap *= 2; \
+		return cap; \
+	} \
+	\
+	/* Rebuild the table with the given capacity. */ \
+	static void prefix##_internal_rehash(tbltype* T, \
+						int* err, \
+						size_t newcap) \
+	{ \
+		/* Allocate new hashing table */ \
+		tbltype N = { .cap = newcap, .size = T->size }; \
+		csnip_mem_Alloc(newcap, N.key, *err); \
+		if (err && *err) return; \
+		csnip_mem_Alloc(newcap, N.val, *err); \
+		if (err && *err) { \
+			csnip_mem_Free(N.key); \
+			return; \
+		} \
+		csnip_mem_Alloc0(newcap, N.occ, *err); \
+		if (err && *err) { \
+			csnip_mem_Free(N.key); \
+			csnip_mem_Free(N.val); \
+			return; \
+		} \
+		\
+		/* Copy from old to new */ \
+		for (size_t i = 0; i < T->cap; ++i) { \
+			if (T->occ[i]) { \
+				int r; \
+				const size_t l = prefix##_internal_findloc(&N, \
+						T->key[i], &r); \
+				assert(r == 1); \
+				N.key[l] = T->key[i]; \
+				N.val[l] = T->val[i]; \
+				N.occ[l] = 1; \
+			} \
+		} \
+		\
+		/* Replace old table with new one, and free */ \
+		if (T->key) csnip_mem_Free(T->key); \
+		if (T->val) csnip_mem_Free(T->val); \
+		if (T->occ) csnip_mem_Free(T->occ); \
+		*T = N; \
+	} \
+	\
+	static _Bool prefix##_internal_grow(tbltype* T, \
+						int* err, \
+						size_t min_size) \
+	{ \
+		if (min_size * 3 <= T->cap * 2) { \
+			/* No need to grow */ \
+			return 0; \
+		} \
+		\
+		prefix##_internal_rehash(T, err, \
+			prefix##_internal_capfor(min_size)); \
+		return 1; \
+	} \
+	\
+	/* Creation / Deletion */ \
+	scope tbltype* prefix##make(int* err) \
+	{ \
+		if (err) *err = 0; \
+		\
+		tbltype* T; \
+		csnip_mem_Alloc(1, T, *err); \
+		if (err && *err) \
+			return NULL; \
+		T->cap = 0; \
+		T->size = 0; \
+		T->key = NULL; \
+		T->val = NULL; \
+		T->occ = NULL; \
+		return T; \
+	} \
+	\
+	scope tbltype* prefix##make_with_cap(int* err, size_t min_size) \
+	{ \
+		tbltype* T = prefix##make(err); \
+		if (T == NULL) \
+			return NULL; \
+		prefix##reserve(T, err, min_size); \
+		if (err && *err) { \
+			prefix##free(T); \
+			return NULL; \
+		} \
+		return T; \
+	} \
+	\
+	scope void prefix##free(tbltype* T) \
+	{ \
+		if (T->key)	csnip_mem_Free(T->key); \
+		if (T->val)	csnip_mem_Free(T->val); \
+		if (T->occ)	csnip_mem_Free(T->occ); \
+		csnip_mem_Free(T); \
+	} \
+	\
+	/* Element manipulation */ \
+	\
+	scope int prefix##insert(tbltype* T, \
+				int* err, \
+				keytype key, \
+				valtype val) \
+	{ \
+		if (err) *err = 0; \
+		\
+		/* Grow if necessary */ \
+		prefix##_internal_grow(T, err, T->size + 1); \
+		if (err && *err) \
+			return 0; \
+		\
+		int r; \
+		const size_t loc = prefix##_internal_findloc(T, key, &r); \
+		assert(r < 2); \
+		if (r == 1) { \
+			T->key[loc] = key; \
+			T->val[loc] = val; \
+			T->occ[loc] = 1; \
+			++T->size; \
+		} \
+		return r; \
+	} \
+	\
+	scope int prefix##insert_or_assign(tbltype* T, \
+				int* err, \
+				keytype key, \
+				valtype val, \
+				valtype* old) \
+	{ \
+		if (err) *err = 0; \
+		\
+		/* Grow if necessary */ \
+		prefix##_internal_grow(T, err, T->size + 1); \
+		if (err && *err) \
+			return 0; \
+		\
+		int r; \
+		const size_t loc = prefix##_internal_findloc(T, key, &r); \
+		assert(r < 2); \
+		if (r == 0) { \
+			if (old) *old = T->val[loc]; \
+		} else { \
+			++T->size; \
+			T->occ[loc] = 1; \
+		} \
+		T->key[loc] = key; \
+		T->val[loc] = val; \
+		return r; \
+	} \
+	\
+	scope valtype* prefix##find_or_insert(tbltype* T, \
+				int* err, \
+				keytype key, \
+				valtype val) \
+	{ \
+		if (err) *err = 0; \
+		\
+		int r; \
+		size_t loc = prefix##_internal_findloc(T, key, &r); \
+		if (r >= 1) { \
+			/* Insert */ \
+			if (prefix##_internal_grow(T, err, T->size + 1)) { \
+				/* Need to search again, since we
+				 * rehashed
+				 */ \
+				loc = prefix##_internal_findloc(T, key, &r); \
+				assert(r == 1); \
+			} \
+			\
+			if (err && *err) \
+				return NULL; \
+			\
+			T->key[loc] = key; \
+			T->val[loc] = val; \
+			T->occ[loc] = 1; \
+			++T->size; \
+		} \
+		return &T->val[loc]; \
+	} \
+	\
+	scope _Bool prefix##remove(tbltype* T, int* err, keytype key) \
+	{ \
+		if (err) *err = 0; \
+		\
+		int r; \
+		const size_t loc = prefix##_internal_findloc(T, key, &r); \
+		if (r == 0) { \
+			prefix##_internal_deleteloc(T, loc); \
+			--T->size; \
+		} \
+		return r == 0; \
+	} \
+	\
+	scope valtype* prefix##find(const tbltype* T, keytype key) \
+	{ \
+		int r; \
+		const size_t loc = prefix##_internal_findloc(T, key, &r); \
+		if (r == 0) \
+			return &T->val[loc]; \
+		return NULL; \
+	} \
+	\
+	/* Size and capacity */ \
+	scope size_t prefix##size(const tbltype* T) \
+	{ \
+		return T->size; \
+	} \
+	\
+	scope size_t prefix##capacity(const tbltype* T) \
+	{ \
+		return T->cap; \
+	} \
+	\
+	scope void prefix##reserve(tbltype* T, int* err, size_t min_size) \
+	{ \
+		if (err) *err = 0; \
+		prefix##_internal_grow(T, err, min_size); \
+	} \
+	\
+	scope void prefix##shrink(tbltype* T, int* err) \
+	{ \
+		if (err) *err = 0; \
+		if (T->size == 0) { \
+			if (T->key) csnip_mem_Free(T->key); \
+			if (T->val) csnip_mem_Free(T->val); \
+			if (T->occ) csnip_mem_Free(T->occ); \
+			T->key = NULL; \
+			T->val = NULL; \
+			T->occ = NULL; \
+			T->cap = 0; \
+			return; \
+		} \
+		const size_t newcap = prefix##_internal_capfor(T->size); \
+		if (newcap < T->cap) \
+			prefix##_internal_rehash(T, err, newcap); \
+	} \
+	\
+	/* Slot functions */ \
+	scope size_t prefix##findslot(const tbltype* T, keytype key) \
+	{ \
+		int r; \
+		const size_t loc = prefix##_internal_findloc(T, key, &r); \
+		if (r == 0) \
+			return loc; \
+		return T->cap; \
+	} \
+	\
+	scope _Bool prefix##isslotoccupied(const tbltype* T, size_t i) \
+	{ \
+		assert(i < T->cap); \
+		return T->occ[i]; \
+	} \
+	\
+	scope keytype const* prefix##getslotkeyaddress( \
+					const tbltype* T, \
+					size_t i) \
+	{ \
+		return &T->key[i]; \
+	} \
+	\
+	scope valtype* prefix##getslotvalueaddress( \
+					const tbltype* T, \
+					size_t i) \
+	{ \
+		return &T->val[i]; \
+	} \
+	\
+	scope size_t prefix##getslotfromvalueaddress( \
+					const tbltype* T, \
+					valtype const* val) \
+	{ \
+		return (size_t)(val - T->val); \
+	} \
+	\
+	scope size_t prefix##removeatslot(tbltype* T, int* err, size_t i) \
+	{ \
+		if (err) *err = 0; \
+		\
+		if (T->occ[i]) { \
+			prefix##_internal_deleteloc(T, i); \
+			--T->size; \
+			if (T->occ[i]) \
+				return i; \
+		} \
+		return prefix##nextoccupiedslot(T, i); \
+	} \
+	\
+	scope size_t prefix##firstoccupiedslot(const tbltype* T) \
+	{ \
+		size_t r; \
+		for (r = 0; r < T->cap; ++r) \
+			if (T->occ[r]) break; \
+		return r; \
+	} \
+	\
+	scope size_t prefix##nextoccupiedslot( \
+					const tbltype* T, \
+					size_t r) \
+	{ \
+		for (++r; r < T->cap; ++r) \
+			if (T->occ[r]) break; \
+		return r; \
+	}
+
+/** @}
+ *  @}
+ */
+
+#endif /* CSNIP_LPHASH_SOATABLE_H */
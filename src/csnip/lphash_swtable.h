@@ -0,0 +1,695 @@
+#ifndef CSNIP_LPHASH_SWTABLE_H
+#define CSNIP_LPHASH_SWTABLE_H
+
+/**	@file lphash_swtable.h
+ *	@addtogroup hash_tables		Hash tables
+ *	@{
+ *	@defgroup lphash_swtable	Group Probing Hash Table
+ *	@{
+ *
+ *	Hash tables with fingerprinted control bytes and group probing.
+ *
+ *	This is an alternative implementation of the table functions from
+ *	lphash_table.h, in the style of the "Swiss tables" of Google's
+ *	Abseil library.  It generates the same functions with the same
+ *	signatures and semantics, as declared by
+ *	CSNIP_LPHASH_TABLE_DECL_FUNCS(), but requires a table type
+ *	defined with CSNIP_LPHASH_SWTABLE_DEF_TYPE().
+ *
+ *	The slots are divided into groups of
+ *	CSNIP_LPHASH_SWTABLE_GROUP (16) consecutive slots, and the
+ *	groups are probed linearly.  For each slot, the occupancy array
+ *	contains a control byte, which is one of:
+ *
+ *	* 0 for an empty slot,
+ *	* 1 for a deleted slot (a "tombstone"),
+ *	* 0x80 | h2 for an occupied slot, where h2 is a 7 bit
+ *	  fingerprint taken from the low bits of the hash value.
+ *
+ *	The remaining bits of the hash value select the home group.
+ *	A lookup compares all 16 control bytes of a group with the
+ *	fingerprint at once (using SSE2 if available), and evaluates the
+ *	is_match expression only for the slots where the fingerprint
+ *	matches; this happens with probability 1/128 for a nonmatching
+ *	entry.  This is particularly beneficial when is_match is
+ *	expensive, e.g., a strcmp().  A lookup stops at the first group
+ *	that has an empty slot.
+ *
+ *	Unsuccessful lookups benefit the most.  A successful lookup in a
+ *	table that is not in cache needs to load the control bytes
+ *	before it knows which entry to load, so the two cache misses
+ *	are not overlapped the way they are in lphash_table.h.
+ *
+ *	Since the fingerprint and group are taken from different bits of
+ *	the hash value, the hash function needs to be of good quality in
+ *	all bits.  E.g., using the identity function as a hash for
+ *	integers is not a good choice here.
+ *
+ *	Entries never move except when the table is rehashed;  deletion
+ *	leaves a tombstone unless the group has an empty slot.
+ *	Tombstones count towards the load, which is kept below 7/8.
+ *	When rehashing is necessary and the table is mostly tombstones,
+ *	it is rehashed without growing.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CSNIP_LPHASH_SWTABLE_HAVE_SSE2
+#endif
+
+#include <csnip/err.h>
+#include <csnip/mem.h>
+#include <csnip/lphash_table.h>
+
+/**	Number of slots per group. */
+#define CSNIP_LPHASH_SWTABLE_GROUP	16
+
+/**	Defines a group probing hash table type.
+ *
+ *	This is the same as the type defined by
+ *	CSNIP_LPHASH_TABLE_DEF_TYPE(), with an additional count of
+ *	tombstones.
+ *
+ *	@param	struct_tbltype
+ *		Name of the struct to be defined.
+ *
+ *	@param	entrytype
+ *		Type of the hash table entries.
+ */
+#define CSNIP_LPHASH_SWTABLE_DEF_TYPE(struct_tbltype, \
+				entrytype) \
+	struct struct_tbltype { \
+		size_t cap;		/* Capacity */ \
+		size_t size;		/* Number of used entries */ \
+		entrytype* entry;	/* The table entries */ \
+		unsigned char* occ;	/* Control bytes */ \
+		size_t ndel;		/* Number of tombstones */ \
+	};
+
+/**	Define group probing hash table functions.
+ *
+ *	This takes the same arguments as CSNIP_LPHASH_TABLE_DEF_FUNCS(),
+ *	and generates the same functions, see there for the
+ *	documentation.  The table type is defined with
+ *	CSNIP_LPHASH_SWTABLE_DEF_TYPE().
+ *
+ *	Since deletion does not move entries, removeatslot() always
+ *	returns the next occupied slot after the removed one.
+ */
+#define CSNIP_LPHASH_SWTABLE_DEF_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				entrytype, \
+				tbltype, \
+				k1, k2,		/* key dummy vars */ \
+				e,		/* entry dummy var */ \
+				hash,		/* evaluate to hash(k1) */ \
+				is_match,	/* Check whether k1 and k2 match */ \
+				get_key)	/* evaluate to the key of e */ \
+	\
+	/* Declare functions in case they weren't yet. */ \
+	CSNIP_LPHASH_TABLE_DECL_FUNCS(scope, prefix, keytype, entrytype, \
+	  tbltype) \
+	\
+	/* Private methods */ \
+	\
+	/* Find a key.
+	 *
+	 * Returns the location, and sets *state_ to 0 if found, or to
+	 * 1 if not found, in which case the location is a free slot
+	 * where the key can be inserted.  *state_ is set to 2 if the
+	 * key is not found and there is no free slot.
+	 *
+	 * *ctrl_ is set to the control byte for the key, whose hash
+	 * is h_.
+	 */ \
+	static size_t prefix##_internal_findloc_hash( \
+				const tbltype* T, \
+				keytype key, \
+				size_t h_, \
+				int* state_, \
+				unsigned char* ctrl_) \
+	{ \
+		keytype k1 = key; \
+		*ctrl_ = (unsigned char)(0x80 | (h_ & 0x7f)); \
+		if (T->cap == 0) { \
+			*state_ = 2; \
+			return (size_t)-1; \
+		} \
+		\
+		const size_t ng_ = T->cap / CSNIP_LPHASH_SWTABLE_GROUP; \
+		size_t g = (h_ >> 7) & (ng_ - 1); \
+		size_t ins = (size_t)-1; \
+		for (size_t p_ = 0; p_ < ng_; ++p_) { \
+			const unsigned char* c_ = \
+				&T->occ[g * CSNIP_LPHASH_SWTABLE_GROUP]; \
+			unsigned m_ = csnip_lphash_swtable__Match(c_, *ctrl_); \
+			while (m_) { \
+				const size_t u = g * CSNIP_LPHASH_SWTABLE_GROUP \
+					+ (size_t)csnip_lphash_swtable__Ctz(m_); \
+				entrytype e = T->entry[u]; \
+				keytype k2 = (get_key); \
+				if (is_match) { \
+					*state_ = 0; \
+					return u; \
+				} \
+				m_ &= m_ - 1; \
+			} \
+			\
+			/* Remember first free slot */ \
+			const unsigned f_ = csnip_lphash_swtable__MatchFree(c_); \
+			if (ins == (size_t)-1 && f_) { \
+				ins = g * CSNIP_LPHASH_SWTABLE_GROUP \
+					+ (size_t)csnip_lphash_swtable__Ctz(f_); \
+			} \
+			\
+			/* Stop at groups with empty slots */ \
+			if (csnip_lphash_swtable__Match(c_, 0)) \
+				break; \
+			\
+			g = (g + 1) & (ng_ - 1); \
+		} \
+		*state_ = (ins == (size_t)-1 ? 2 : 1); \
+		return ins; \
+	} \
+	\
+	static size_t prefix##_internal_findloc( \
+				const tbltype* T, \
+				keytype key, \
+				int* state_, \
+				unsigned char* ctrl_) \
+	{ \
+		keytype k1 = key; \
+		return prefix##_internal_findloc_hash(T, key, \
+					(size_t)(hash), state_, ctrl_); \
+	} \
+	\
+	static void prefix##_internal_deleteloc(tbltype* T, \
+						size_t loc) \
+	{ \
+		const unsigned char* c_ = &T->occ[loc \
+			/ CSNIP_LPHASH_SWTABLE_GROUP \
+			* CSNIP_LPHASH_SWTABLE_GROUP]; \
+		if (csnip_lphash_swtable__Match(c_, 0)) { \
+			/* No probe sequence continues past this group */ \
+			T->occ[loc] = 0; \
+		} else { \
+			T->occ[loc] = 1; \
+			++T->ndel; \
+		} \
+	} \
+	\
+	/* Rebuild the table with the given capacity. */ \
+	static void prefix##_internal_rehash(tbltype* T, \
+						int* err, \
+						size_t newcap) \
+	{ \
+		entrytype* newarr; \
+		unsigned char* newocc; \
+		csnip_mem_Alloc(newcap, newarr, *err); \
+		if (err && *err) return; \
+		csnip_mem_Alloc(newcap, newocc, *err); \
+		if (err && *err) { \
+			csnip_mem_Free(newarr); \
+			return; \
+		} \
+		tbltype N = { \
+			.cap = newcap, \
+			.size = T->size, \
+			.entry = newarr, \
+			.occ = newocc, \
+			.ndel = 0 \
+		}; \
+		for (size_t i = 0; i < newcap; ++i) { \
+			newocc[i] = 0; \
+		} \
+		\
+		/* Copy from old to new */ \
+		for (size_t i = 0; i < T->cap; ++i) { \
+			if (T->occ[i] & 0x80) { \
+				size_t l; \
+				int r; \
+				unsigned char c; \
+				entrytype e = T->entry[i]; \
+				l = prefix##_internal_findloc(&N, \
+						(get_key), &r, &c); \
+				assert(r == 1); \
+				newarr[l] = T->entry[i]; \
+				newocc[l] = c; \
+			} \
+		} \
+		\
+		/* Replace old table with new one, and free */ \
+		if (T->entry) csnip_mem_Free(T->entry); \
+		if (T->occ) csnip_mem_Free(T->occ); \
+		*T = N; \
+	} \
+	\
+	static _Bool prefix##_internal_grow(tbltype* T, \
+						int* err, \
+						size_t min_size) \
+	{ \
+		if ((min_size + T->ndel) * 8 <= T->cap * 7) { \
+			/* No need to grow */ \
+			return 0; \
+		} \
+		\
+		/* Compute new capacity.  If at most half of the slots
+		 * are in use without tombstones, rehash in place.
+		 */ \
+		size_t newcap = (T->cap ? T->cap : CSNIP_LPHASH_SWTABLE_GROUP); \
+		while (min_size * 2 > newcap) { \
+			newcap *= 2; \
+		} \
+		prefix##_internal_rehash(T, err, newcap); \
+		return 1; \
+	} \
+	\
+	/* Smallest capacity for the given number of entries */ \
+	static size_t prefix##_internal_capfor(size_t min_size) \
+	{ \
+		size_t cap = CSNIP_LPHASH_SWTABLE_GROUP; \
+		while (min_size * 8 > cap * 7) { \
+			cap *= 2; \
+		} \
+		return cap; \
+	} \
+	\
+	/* Find or create an empty slot for key.
+	 *
+	 * Returns the slot; *r is set to 0 if the key was found, and
+	 * to 1 if a slot was made for it.  In the latter case, the
+	 * slot is marked as occupied, and the size increased; the
+	 * caller must fill in the entry.
+	 */ \
+	static size_t prefix##_internal_findorinsertloc_hash(tbltype* T, \
+						int* err, \
+						keytype key, \
+						size_t h, \
+						int* r) \
+	{ \
+		unsigned char c; \
+		size_t loc = prefix##_internal_findloc_hash(T, key, h, r, &c); \
+		if (*r == 0) \
+			return loc; \
+		\
+		if (prefix##_internal_grow(T, err, T->size + 1)) { \
+			if (err && *err) \
+				return 0; \
+			loc = prefix##_internal_findloc_hash(T, key, h, r, &c); \
+		} \
+		assert(*r == 1); \
+		if (T->occ[loc] == 1) \
+			--T->ndel; \
+		T->occ[loc] = c; \
+		++T->size; \
+		return loc; \
+	} \
+	\
+	static size_t prefix##_internal_findorinsertloc(tbltype* T, \
+						int* err, \
+						keytype key, \
+						int* r) \
+	{ \
+		keytype k1 = key; \
+		return prefix##_internal_findorinsertloc_hash(T, err, key, \
+						(size_t)(hash), r); \
+	} \
+	\
+	/* Prefetch the home group of a hash value */ \
+	static void prefix##_internal_prefetch(const tbltype* T, size_t h) \
+	{ \
+		if (T->cap) { \
+			const size_t ng_ = T->cap / CSNIP_LPHASH_SWTABLE_GROUP; \
+			const size_t u = ((h >> 7) & (ng_ - 1)) \
+				* CSNIP_LPHASH_SWTABLE_GROUP; \
+			csnip_cext_prefetch(&T->occ[u]); \
+			csnip_cext_prefetch(&T->entry[u]); \
+		} \
+	} \
+	\
+	/* Creation / Deletion */ \
+	scope tbltype* prefix##make(int* err) \
+	{ \
+		if (err) *err = 0; \
+		\
+		tbltype* T; \
+		csnip_mem_Alloc(1, T, *err); \
+		if (err && *err) \
+			return NULL; \
+		T->cap = 0; \
+		T->size = 0; \
+		T->entry = NULL; \
+		T->occ = NULL; \
+		T->ndel = 0; \
+		return T; \
+	} \
+	\
+	scope tbltype* prefix##make_with_cap(int* err, size_t min_size) \
+	{ \
+		tbltype* T = prefix##make(err); \
+		if (T == NULL) \
+			return NULL; \
+		prefix##reserve(T, err, min_size); \
+		if (err && *err) { \
+			prefix##free(T); \
+			return NULL; \
+		} \
+		return T; \
+	} \
+	\
+	scope void prefix##free(tbltype* T) \
+	{ \
+		if (T->entry)	csnip_mem_Free(T->entry); \
+		if (T->occ)	csnip_mem_Free(T->occ); \
+		csnip_mem_Free(T); \
+	} \
+	\
+	/* Element manipulation */ \
+	\
+	scope int prefix##insert(tbltype* T, int* err, entrytype e) \
+	{ \
+		if (err) *err = 0; \
+		\
+		int r; \
+		size_t loc = prefix##_internal_findorinsertloc(T, err, \
+							(get_key), &r); \
+		if (err && *err) \
+			return 0; \
+		if (r == 1) \
+			T->entry[loc] = e; \
+		return r; \
+	} \
+	\
+	scope int prefix##insert_or_assign(tbltype* T, \
+				int* err, \
+				entrytype e, \
+				entrytype* old) \
+	{ \
+		if (err) *err = 0; \
+		\
+		int r; \
+		size_t loc = prefix##_internal_findorinsertloc(T, err, \
+							(get_key), &r); \
+		if (err && *err) \
+			return 0; \
+		if (r == 0 && old) \
+			*old = T->entry[loc]; \
+		T->entry[loc] = e; \
+		return r; \
+	} \
+	\
+	scope entrytype* prefix##find_or_insert(tbltype* T, \
+					int* err, \
+					entrytype entry) \
+	{ \
+		if (err) *err = 0; \
+		\
+		int r; \
+		entrytype e = entry; \
+		size_t loc = prefix##_internal_findorinsertloc(T, err, \
+							(get_key), &r); \
+		if (err && *err) \
+			return NULL; \
+		if (r == 1) \
+			T->entry[loc] = entry; \
+		return &T->entry[loc]; \
+	} \
+	\
+	scope _Bool prefix##remove(tbltype* T, int* err, keytype key) \
+	{ \
+		int r; \
+		unsigned char c; \
+		const size_t loc = prefix##_internal_findloc(T, key, &r, &c); \
+		if (r == 0) { \
+			prefix##_internal_deleteloc(T, loc); \
+			--T->size; \
+		}  \
+		return r == 0; \
+	} \
+	\
+	scope entrytype* prefix##find(const tbltype* T, keytype key) \
+	{ \
+		int r; \
+		unsigned char c; \
+		const size_t loc = prefix##_internal_findloc(T, key, &r, &c); \
+		if (r == 0) \
+			return &T->entry[loc]; \
+		return NULL; \
+	} \
+	\
+	/* Batched operations */ \
+	scope size_t prefix##find_many(const tbltype* T, \
+				keytype const* keys, \
+				size_t n, \
+				entrytype** out) \
+	{ \
+		size_t h[CSNIP_LPHASH_TABLE_PREFETCH_DIST]; \
+		size_t nfound = 0; \
+		for (size_t b = 0; b < n; \
+		  b += CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+		{ \
+			size_t m = n - b; \
+			if (m > CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+				m = CSNIP_LPHASH_TABLE_PREFETCH_DIST; \
+			\
+			/* Hash and prefetch */ \
+			for (size_t i = 0; i < m; ++i) { \
+				keytype k1 = keys[b + i]; \
+				h[i] = (size_t)(hash); \
+				prefix##_internal_prefetch(T, h[i]); \
+			} \
+			\
+			/* Resolve */ \
+			for (size_t i = 0; i < m; ++i) { \
+				int r; \
+				unsigned char c; \
+				const size_t loc = \
+					prefix##_internal_findloc_hash(T, \
+						keys[b + i], h[i], &r, &c); \
+				if (r == 0) { \
+					out[b + i] = &T->entry[loc]; \
+					++nfound; \
+				} else { \
+					out[b + i] = NULL; \
+				} \
+			} \
+		} \
+		return nfound; \
+	} \
+	\
+	scope size_t prefix##insert_many(tbltype* T, \
+				int* err, \
+				entrytype const* entries, \
+				size_t n) \
+	{ \
+		if (err) *err = 0; \
+		\
+		size_t h[CSNIP_LPHASH_TABLE_PREFETCH_DIST]; \
+		size_t ninserted = 0; \
+		for (size_t b = 0; b < n; \
+		  b += CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+		{ \
+			size_t m = n - b; \
+			if (m > CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+				m = CSNIP_LPHASH_TABLE_PREFETCH_DIST; \
+			prefix##_internal_grow(T, err, T->size + m); \
+			if (err && *err) \
+				return ninserted; \
+			\
+			/* Hash and prefetch */ \
+			for (size_t i = 0; i < m; ++i) { \
+				entrytype e = entries[b + i]; \
+				keytype k1 = (get_key); \
+				h[i] = (size_t)(hash); \
+				prefix##_internal_prefetch(T, h[i]); \
+			} \
+			\
+			/* Resolve */ \
+			for (size_t i = 0; i < m; ++i) { \
+				int r; \
+				entrytype e = entries[b + i]; \
+				const size_t loc = \
+					prefix##_internal_findorinsertloc_hash( \
+						T, err, (get_key), h[i], &r); \
+				if (err && *err) \
+					return ninserted; \
+				if (r == 1) { \
+					T->entry[loc] = e; \
+					++ninserted; \
+				} \
+			} \
+		} \
+		return ninserted; \
+	} \
+	\
+	/* Size and capacity */ \
+	scope size_t prefix##size(const tbltype* T) \
+	{ \
+		return T->size; \
+	} \
+	\
+	scope size_t prefix##capacity(const tbltype* T) \
+	{ \
+		return T->cap; \
+	} \
+	\
+	scope void prefix##reserve(tbltype* T, int* err, size_t min_size) \
+	{ \
+		if (err) *err = 0; \
+		if ((min_size + T->ndel) * 8 <= T->cap * 7) \
+			return; \
+		size_t newcap = prefix##_internal_capfor(min_size); \
+		if (newcap < T->cap) \
+			newcap = T->cap; \
+		prefix##_internal_rehash(T, err, newcap); \
+	} \
+	\
+	scope void prefix##shrink(tbltype* T, int* err) \
+	{ \
+		if (err) *err = 0; \
+		if (T->size == 0) { \
+			if (T->entry) csnip_mem_Free(T->entry); \
+			if (T->occ) csnip_mem_Free(T->occ); \
+			T->entry = NULL; \
+			T->occ = NULL; \
+			T->cap = 0; \
+			T->ndel = 0; \
+			return; \
+		} \
+		const size_t newcap = prefix##_internal_capfor(T->size); \
+		if (newcap < T->cap) \
+			prefix##_internal_rehash(T, err, newcap); \
+	} \
+	\
+	/* Slot functions */ \
+	scope size_t prefix##findslot(const tbltype* T, keytype key) \
+	{ \
+		int r; \
+		unsigned char c; \
+		const size_t loc = prefix##_internal_findloc(T, key, &r, &c); \
+		if (r == 0) \
+			return loc; \
+		return T->cap; \
+	} \
+	\
+	scope _Bool prefix##isslotoccupied(const tbltype* T, size_t i) \
+	{ \
+		assert(i < T->cap); \
+		return (T->occ[i] & 0x80) != 0; \
+	} \
+	\
+	scope entrytype* prefix##getslotentryaddress( \
+					const tbltype* T, \
+					size_t i) \
+	{ \
+		return &T->entry[i]; \
+	} \
+	\
+	scope size_t prefix##getslotfromentryaddress( \
+					const tbltype* T, \
+					entrytype const* entry) \
+	{ \
+		return (size_t)(entry - T->entry); \
+	} \
+	\
+	scope size_t prefix##removeatslot(tbltype* T, int* err, size_t i) \
+	{ \
+		if (err) *err = 0; \
+		\
+		if (T->occ[i] & 0x80) { \
+			prefix##_internal_deleteloc(T, i); \
+			--T->size; \
+		} \
+		return prefix##nextoccupiedslot(T, i); \
+	} \
+	\
+	scope size_t prefix##firstoccupiedslot(const tbltype* T) \
+	{ \
+		size_t r; \
+		for (r = 0; r < T->cap; ++r) \
+			if (T->occ[r] & 0x80) break; \
+		return r; \
+	} \
+	\
+	scope size_t prefix##nextoccupiedslot( \
+					const tbltype* T, \
+					size_t r) \
+	{ \
+		for (++r; r < T->cap; ++r) \
+			if (T->occ[r] & 0x80) break; \
+		return r; \
+	}
+
+/** @cond */
+
+/* Bit mask of the slots in the group g whose control byte is c. */
+#ifdef CSNIP_LPHASH_SWTABLE_HAVE_SSE2
+#define csnip_lphash_swtable__Match(g, c) \
+	((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8( \
+		_mm_loadu_si128((const __m128i*)(g)), \
+		_mm_set1_epi8((char)(c)))))
+#else
+#define csnip_lphash_swtable__Match(g, c) \
+	csnip_lphash_swtable__match_portable((g), (c))
+static inline unsigned csnip_lphash_swtable__match_portable(
+		const unsigned char* g, unsigned char c)
+{
+	unsigned m = 0;
+	for (int i = 0; i < CSNIP_LPHASH_SWTABLE_GROUP; ++i) {
+		if (g[i] == c)
+			m |= 1u << i;
+	}
+	return m;
+}
+#endif
+
+/* Bit mask of the slots in the group g that are empty or deleted. */
+#ifdef CSNIP_LPHASH_SWTABLE_HAVE_SSE2
+#define csnip_lphash_swtable__MatchFree(g) \
+	(~(unsigned)_mm_movemask_epi8( \
+		_mm_loadu_si128((const __m128i*)(g))) & 0xffffu)
+#else
+#define csnip_lphash_swtable__MatchFree(g) \
+	csnip_lphash_swtable__matchfree_portable(g)
+static inline unsigned csnip_lphash_swtable__matchfree_portable(
+		const unsigned char* g)
+{
+	unsigned m = 0;
+	for (int i = 0; i < CSNIP_LPHASH_SWTABLE_GROUP; ++i) {
+		if (!(g[i] & 0x80))
+			m |= 1u << i;
+	}
+	return m;
+}
+#endif
+
+/* Index of the lowest set bit in a nonzero mask. */
+#if defined(__GNUC__) || defined(__clang__)
+#define csnip_lphash_swtable__Ctz(m)	__builtin_ctz(m)
+#else
+#define csnip_lphash_swtable__Ctz(m) \
+	csnip_lphash_swtable__ctz_portable(m)
+static inline int csnip_lphash_swtable__ctz_portable(unsigned m)
+{
+	int r = 0;
+	while (!(m & 1u)) {
+		m >>= 1;
+		++r;
+	}
+	return r;
+}
+#endif
+
+/** @endcond */
+
+/** @}
+ *  @}
+ */
+
+#endif /* CSNIP_LPHASH_SWTABLE_H */
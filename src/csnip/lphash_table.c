@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <time.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/lphash_table.h>
+#include <csnip/x.h>
+
+double csnip_lphash_stats__now(void)
+{
+	struct timespec ts;
+	x_clock_gettime(X_CLOCK_MAYBE_MONOTONIC, &ts);
+	return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+void csnip_lphash_stats_dump(FILE* fp,
+			const char* name,
+			const csnip_lphash_stats* S)
+{
+	const double load = S->cap ? (double)S->size / (double)S->cap : 0.0;
+	const uint64_t nsearch = S->nhit + S->nmiss;
+
+	fprintf(fp, "%s%ssize %zu, capacity %zu, load %.3f\n",
+		name ? name : "", name ? ": " : "",
+		S->size, S->cap, load);
+	fprintf(fp, "  searches %llu: %llu hits, %llu misses\n",
+		(unsigned long long)nsearch,
+		(unsigned long long)S->nhit,
+		(unsigned long long)S->nmiss);
+
+	/* Mean probe lengths, and those expected for linear probing
+	 * with uniform hashing (Knuth) */
+	if (nsearch > 0 && load < 1.0) {
+		const double a = 1.0 / (1.0 - load);
+		if (S->nhit > 0) {
+			fprintf(fp, "  mean probes (hit):  %8.2f"
+				"  (expected %.2f)\n",
+				(double)S->nprobe_hit / (double)S->nhit,
+				0.5 * (1.0 + a));
+		}
+		if (S->nmiss > 0) {
+			fprintf(fp, "  mean probes (miss): %8.2f"
+				"  (expected %.2f)\n",
+				(double)S->nprobe_miss / (double)S->nmiss,
+				0.5 * (1.0 + a * a));
+		}
+		fprintf(fp, "  max probes: %zu\n", S->maxprobe);
+	}
+
+	/* Histogram */
+	for (int i = 0; i < CSNIP_LPHASH_STATS_NHIST; ++i) {
+		if (S->probehist[i] == 0)
+			continue;
+		const unsigned long long lo = 1ull << i;
+		if (i == CSNIP_LPHASH_STATS_NHIST - 1) {
+			fprintf(fp, "  probes %7llu+       : ", lo);
+		} else {
+			fprintf(fp, "  probes %7llu-%-7llu: ",
+				lo, 2 * lo - 1);
+		}
+		fprintf(fp, "%12llu  (%5.1f%%)\n",
+			(unsigned long long)S->probehist[i],
+			100.0 * (double)S->probehist[i] / (double)nsearch);
+	}
+
+	fprintf(fp, "  rehashes %llu, %.6f s\n",
+		(unsigned long long)S->nrehash, S->rehash_time);
+}
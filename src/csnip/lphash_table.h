@@ -13,11 +13,210 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdio.h>
 
+#include <csnip/cext.h>
 #include <csnip/mem.h>
 #include <csnip/preproc.h>
 #include <csnip/lphash.h>
 
+/**	Number of keys in flight in batched operations.
+ *
+ *	The batched operations find_many() and insert_many() process the
+ *	keys in blocks of this size:  First the hashes of all keys in a
+ *	block are computed and their home slots prefetched, and then the
+ *	lookups are resolved.  This should be large enough to cover the
+ *	memory latency with independent accesses.
+ */
+#ifndef CSNIP_LPHASH_TABLE_PREFETCH_DIST
+#define CSNIP_LPHASH_TABLE_PREFETCH_DIST	16
+#endif
+
+/**	Post-mixing of hash values.
+ *
+ *	The hash values computed by the hash expressions given to
+ *	CSNIP_LPHASH_TABLE_DEF_FUNCS() are passed through this macro
+ *	before being reduced to a slot.  By default, the hashes are used
+ *	as they are.  Since the table capacities are powers of two, only
+ *	the low bits of the hash determine the slot; hashes such as the
+ *	identity on integers or pointers, whose low bits are often all
+ *	the same, then cause long probe sequences.  Defining
+ *
+ *		#define CSNIP_LPHASH_TABLE_POSTMIX(h) \
+ *			csnip_hash_mix_size(h)
+ *
+ *	(from hash.h) makes the tables mix their hash values.  The macro
+ *	is expanded with CSNIP_LPHASH_TABLE_DEF_FUNCS(), so it can be
+ *	defined before including lphash_table.h to affect all tables, or
+ *	undefined and redefined between instantiations to select tables
+ *	individually.
+ */
+#ifndef CSNIP_LPHASH_TABLE_POSTMIX
+#define CSNIP_LPHASH_TABLE_POSTMIX(h)	(h)
+#endif
+
+/**	Memory allocation.
+ *
+ *	The functions generated by CSNIP_LPHASH_TABLE_DEF_FUNCS()
+ *	allocate and release the table and its slot arrays with these
+ *	macros, which take the same arguments as csnip_mem_Alloc() and
+ *	csnip_mem_Free().  Like CSNIP_LPHASH_TABLE_POSTMIX, they are
+ *	expanded with CSNIP_LPHASH_TABLE_DEF_FUNCS(), and can be
+ *	redefined to take the memory from elsewhere, e.g., from an arena
+ *	(arena.h), or from huge pages, which reduce the TLB misses of
+ *	lookups in large tables:
+ *
+ *		#define CSNIP_LPHASH_TABLE_ALLOC(nMember, ptr, err) \
+ *			csnip_mem_HugeAlloc(nMember, 0, ptr, err)
+ *		#define CSNIP_LPHASH_TABLE_FREE(ptr) \
+ *			csnip_mem_HugeFree(ptr)
+ */
+#ifndef CSNIP_LPHASH_TABLE_ALLOC
+#define CSNIP_LPHASH_TABLE_ALLOC(nMember, ptr, err) \
+	csnip_mem_Alloc(nMember, ptr, err)
+#endif
+
+/**	Memory release, @sa CSNIP_LPHASH_TABLE_ALLOC */
+#ifndef CSNIP_LPHASH_TABLE_FREE
+#define CSNIP_LPHASH_TABLE_FREE(ptr)	csnip_mem_Free(ptr)
+#endif
+
+/**	@def	CSNIP_LPHASH_TABLE_STATS
+ *	Enable statistics collection.
+ *
+ *	If this macro is defined before lphash_table.h is included, the
+ *	table type gets a statistics member, and the functions generated
+ *	by CSNIP_LPHASH_TABLE_DEF_FUNCS() count the key searches, their
+ *	probe lengths, and the rehashes, which can then be retrieved with
+ *	the generated `stats` function.  The `stats` and `resetstats`
+ *	functions are only generated if the macro is defined.
+ *
+ *	The counters are updated without synchronization, also by
+ *	lookups, so tables that are read concurrently from several
+ *	threads give inaccurate counts.
+ */
+
+/**	Number of bins of the probe length histogram. */
+#define CSNIP_LPHASH_STATS_NHIST	20
+
+/**	Hash table statistics.
+ *
+ *	The searches counted are those of all the functions looking up a
+ *	key, including insertions and removals.  The probe length of a
+ *	search is the number of slots inspected.
+ */
+typedef struct {
+	size_t size;		/**< Number of entries */
+	size_t cap;		/**< Capacity */
+	uint64_t nhit;		/**< Searches finding the key */
+	uint64_t nmiss;		/**< Searches not finding the key */
+	uint64_t nprobe_hit;	/**< Total probe length of hits */
+	uint64_t nprobe_miss;	/**< Total probe length of misses */
+	size_t maxprobe;	/**< Longest probe sequence */
+
+	/**	Probe length histogram.
+	 *
+	 *	Bin i counts the searches with a probe length in
+	 *	[2^i, 2^(i + 1)); the last bin also counts all longer
+	 *	ones.
+	 */
+	uint64_t probehist[CSNIP_LPHASH_STATS_NHIST];
+
+	uint64_t nrehash;	/**< Number of rehashes */
+	double rehash_time;	/**< Time spent rehashing, in seconds */
+} csnip_lphash_stats;
+
+/**	Print hash table statistics.
+ *
+ *	Writes a human readable summary of the statistics to @a fp.  The
+ *	mean probe lengths are shown along with those expected for
+ *	linear probing with an ideal hash function at the current load;
+ *	means far above the expected values indicate a poor hash
+ *	function.
+ *
+ *	@param	fp
+ *		stream to write to.
+ *
+ *	@param	name
+ *		name of the table to print, or NULL.
+ *
+ *	@param	S
+ *		the statistics, as returned by the `stats` function.
+ */
+void csnip_lphash_stats_dump(FILE* fp,
+			const char* name,
+			const csnip_lphash_stats* S);
+
+/** @cond */
+double csnip_lphash_stats__now(void);
+
+static inline void csnip_lphash_stats__search(csnip_lphash_stats* S,
+						size_t nprobe,
+						int state)
+{
+	if (state == 0) {
+		++S->nhit;
+		S->nprobe_hit += nprobe;
+	} else {
+		++S->nmiss;
+		S->nprobe_miss += nprobe;
+	}
+	if (nprobe > S->maxprobe)
+		S->maxprobe = nprobe;
+	if (nprobe > 0) {
+		int b = 0;
+		while (b < CSNIP_LPHASH_STATS_NHIST - 1 && (nprobe >> 1)) {
+			nprobe >>= 1;
+			++b;
+		}
+		++S->probehist[b];
+	}
+}
+
+/* Hooks used by the generated functions; they expand to nothing if
+ * statistics are disabled. */
+#ifdef CSNIP_LPHASH_TABLE_STATS
+#define CSNIP_LPHASH_TABLE__STATS_MEMBER	csnip_lphash_stats stats;
+#define CSNIP_LPHASH_TABLE__STATS_CLEAR(T) \
+	(T)->stats = (csnip_lphash_stats){ 0 };
+#define CSNIP_LPHASH_TABLE__STATS_KEEP(N, T)	(N).stats = (T)->stats;
+#define CSNIP_LPHASH_TABLE__STATS_DECL(n)	size_t n = 0;
+#define CSNIP_LPHASH_TABLE__STATS_COUNT(n)	++(n),
+#define CSNIP_LPHASH_TABLE__STATS_SEARCH(T, n, state) \
+	csnip_lphash_stats__search( \
+		(csnip_lphash_stats*)&(T)->stats, \
+		(n) > 0 ? (n) - 1 : 0, (state));
+#define CSNIP_LPHASH_TABLE__STATS_TSTART(t) \
+	const double t = csnip_lphash_stats__now();
+#define CSNIP_LPHASH_TABLE__STATS_REHASH(T, t) \
+	++(T)->stats.nrehash; \
+	(T)->stats.rehash_time += csnip_lphash_stats__now() - (t);
+#define CSNIP_LPHASH_TABLE__STATS_FUNCS(scope, prefix, tbltype) \
+	scope csnip_lphash_stats prefix##stats(const tbltype* T) \
+	{ \
+		csnip_lphash_stats S = T->stats; \
+		S.size = T->size; \
+		S.cap = T->cap; \
+		return S; \
+	} \
+	\
+	scope void prefix##resetstats(tbltype* T) \
+	{ \
+		CSNIP_LPHASH_TABLE__STATS_CLEAR(T) \
+	}
+#else
+#define CSNIP_LPHASH_TABLE__STATS_MEMBER
+#define CSNIP_LPHASH_TABLE__STATS_CLEAR(T)
+#define CSNIP_LPHASH_TABLE__STATS_KEEP(N, T)
+#define CSNIP_LPHASH_TABLE__STATS_DECL(n)
+#define CSNIP_LPHASH_TABLE__STATS_COUNT(n)
+#define CSNIP_LPHASH_TABLE__STATS_SEARCH(T, n, state)
+#define CSNIP_LPHASH_TABLE__STATS_TSTART(t)
+#define CSNIP_LPHASH_TABLE__STATS_REHASH(T, t)
+#define CSNIP_LPHASH_TABLE__STATS_FUNCS(scope, prefix, tbltype)
+#endif
+/** @endcond */
+
 /**	Defines a hash table type.
  *
  *	This defines a struct tbltype type, suitable for use as a hash
@@ -36,6 +235,7 @@
 		size_t size;		/* Number of used entries */ \
 		entrytype* entry;	/* The table entries */ \
 		unsigned char* occ;	/* Occupancy indicators */ \
+		CSNIP_LPHASH_TABLE__STATS_MEMBER \
 	};
 
 /** Declare hash table functions.
@@ -52,6 +252,7 @@
 				tbltype) \
 	/* Creation & Deletion */ \
 	scope tbltype* prefix##make(int* err); \
+	scope tbltype* prefix##make_with_cap(int* err, size_t min_size); \
 	scope void prefix##free(tbltype* tbl); \
 	\
 	/* Element manipulation */ \
@@ -76,9 +277,26 @@
 			const tbltype* tbl, \
 			keytype key); \
 	\
+	/* Batched operations */ \
+	scope size_t prefix##find_many( \
+			const tbltype* tbl, \
+			keytype const* keys, \
+			size_t n, \
+			entrytype** out_entries); \
+	scope size_t prefix##insert_many( \
+			tbltype* tbl, \
+			int* err, \
+			entrytype const* entries, \
+			size_t n); \
+	\
 	/* Size and capacity */ \
 	scope size_t prefix##size(const tbltype* tbl); \
 	scope size_t prefix##capacity(const tbltype* tbl); \
+	scope void prefix##reserve( \
+			tbltype* tbl, \
+			int* err, \
+			size_t min_size); \
+	scope void prefix##shrink(tbltype* tbl, int* err); \
 	\
 	/* Slot functions */ \
 	scope size_t prefix##findslot( \
@@ -103,6 +321,25 @@
 			const tbltype* tbl, \
 			size_t i);
 
+/** Declare hash table statistics functions.
+ *
+ *  The statistics functions are only generated for the tables of
+ *  lphash_table.h, and only if CSNIP_LPHASH_TABLE_STATS is defined;
+ *  they are therefore declared separately.  Without
+ *  CSNIP_LPHASH_TABLE_STATS, this macro expands to nothing.
+ *
+ *  @sa CSNIP_LPHASH_TABLE_DEF_FUNCS()
+ */
+#ifdef CSNIP_LPHASH_TABLE_STATS
+#define CSNIP_LPHASH_TABLE_DECL_STATS_FUNCS(scope, \
+				prefix, \
+				tbltype) \
+	scope csnip_lphash_stats prefix##stats(const tbltype* tbl); \
+	scope void prefix##resetstats(tbltype* tbl);
+#else
+#define CSNIP_LPHASH_TABLE_DECL_STATS_FUNCS(scope, prefix, tbltype)
+#endif
+
 /**	Define hashing table functions.
  *
  *	Generator macro to define functions to access and manipulate the
@@ -134,7 +371,8 @@
  *		dummy variables representing entries
  *
  *	@param	hash
- *		an expression evaluating to a hash of @a k1.
+ *		an expression evaluating to a hash of @a k1.  It is
+ *		post-processed with CSNIP_LPHASH_TABLE_POSTMIX().
  *
  *	@param	is_match
  *		an expression evaluation to true if @a k1 and @a k2
@@ -153,6 +391,10 @@
  *		  set to the error code and `NULL` is returned.  If
  *		  `err` is NULL, an error is raised via
  *		  csnip_err_Raise().
+ *		* `make_with_cap`:  `tbltype* make_with_cap(int* err,
+ *		  size_t min_size);`  Create a table with sufficient
+ *		  capacity to hold `min_size` entries without growing.
+ *		  Error handling is as for `make`.
  *		* `free`:  `void free(tbltype* tbl);`  Free the memory
  *		  associated with the hashing table `tbl`.
  *
@@ -184,12 +426,41 @@
  *		  pointer to the entry is returned.  Otherwise, `NULL`
  *		  is returned.
  *
+ *	Batched operations:
+ *		* `find_many`: `size_t find_many(tbltype* T, keytype
+ *		  const* keys, size_t n, entrytype** out_entries);`
+ *		  Look up the `n` keys, and store the results as `find`
+ *		  would return them in `out_entries[0]` to
+ *		  `out_entries[n - 1]`.  Returns the number of keys
+ *		  found.
+ *		* `insert_many`: `size_t insert_many(tbltype* T, int*
+ *		  err, entrytype const* entries, size_t n);`  Insert
+ *		  the `n` entries as `insert` would.  Returns the number
+ *		  of entries inserted.  On error, the entries before
+ *		  the failing one have been inserted.
+ *
+ *		  Both functions prefetch the home slots of
+ *		  CSNIP_LPHASH_TABLE_PREFETCH_DIST keys at a time before
+ *		  probing, so that the cache misses of several lookups
+ *		  overlap.  This is much faster than individual calls
+ *		  for tables that do not fit into the cache.
+ *
  *	Size and capacity:
  *		* `size`: `size_t size(tbltype* tbl);`  Retrieve the
  *		  number of entries in the hash table.
  *		* `capacity`: `size_t capacity(tbltype* tbl);`  Retrieve
  *		  the capacity of the hash table, i.e., the size of the
  *		  underlying backing array.
+ *		* `reserve`: `void reserve(tbltype* tbl, int* err,
+ *		  size_t min_size);`  Grow the table, if necessary, so
+ *		  that it can hold `min_size` entries without further
+ *		  growing.  This avoids the repeated rehashing when
+ *		  the number of entries to be inserted is known in
+ *		  advance.
+ *		* `shrink`: `void shrink(tbltype* tbl, int* err);`
+ *		  Reduce the capacity to the smallest one that can hold
+ *		  the current entries, e.g., after many removals.
+ *		  An empty table releases its backing arrays.
  *
  *	Slot and entry access:
  *		* findslot
@@ -210,6 +481,13 @@
  *		  T, size_t i);`  Find the next occupied slot after slot
  *		  `i`.  If no occupied slots remain, returns the table
  *		  capacity.
+ *
+ *	Statistics, only if CSNIP_LPHASH_TABLE_STATS is defined:
+ *		* `stats`: `csnip_lphash_stats stats(const tbltype* T);`
+ *		  Return the statistics collected since the creation of
+ *		  the table or the last `resetstats`.
+ *		* `resetstats`: `void resetstats(tbltype* T);`  Reset
+ *		  the counters to 0.
  */
 #define CSNIP_LPHASH_TABLE_DEF_FUNCS(scope, \
 				prefix, \
@@ -221,10 +499,47 @@
 				hash,		/* evaluate to hash(k1) */ \
 				is_match,	/* Check whether k1 and k2 match */ \
 				get_key)	/* evaluate to the key of e */ \
+	CSNIP_LPHASH_TABLE_DEF_FUNCS_WITH_LOAD(scope, prefix, keytype, \
+	  entrytype, tbltype, k1, k2, e, hash, is_match, get_key, 2, 3)
+
+/**	Define hashing table functions with a given maximum load.
+ *
+ *	This is the same as CSNIP_LPHASH_TABLE_DEF_FUNCS(), with two
+ *	additional parameters giving the maximum load factor as the
+ *	fraction @a load_num / @a load_den, which must be strictly
+ *	between 0 and 1.  The table grows when an insertion would
+ *	exceed that load.  CSNIP_LPHASH_TABLE_DEF_FUNCS() uses a
+ *	maximum load of 2/3.  The bounds are checked at compile time.
+ *
+ *	Lower loads mean shorter probe sequences, especially for
+ *	unsuccessful searches, at the expense of memory.
+ *
+ *	@param	load_num
+ *		numerator of the maximum load factor.
+ *
+ *	@param	load_den
+ *		denominator of the maximum load factor.
+ */
+#define CSNIP_LPHASH_TABLE_DEF_FUNCS_WITH_LOAD(scope, \
+				prefix, \
+				keytype, \
+				entrytype, \
+				tbltype, \
+				k1, k2,		/* key dummy vars */ \
+				e,		/* entry dummy var */ \
+				hash,		/* evaluate to hash(k1) */ \
+				is_match,	/* Check whether k1 and k2 match */ \
+				get_key,	/* evaluate to the key of e */ \
+				load_num,	/* Max. load numerator */ \
+				load_den)	/* Max. load denominator */ \
+	\
+	_Static_assert(0 < (load_num) && (load_num) < (load_den), \
+			"maximum load needs to be strictly between 0 and 1"); \
 	\
 	/* Declare functions in case they weren't yet. */ \
 	CSNIP_LPHASH_TABLE_DECL_FUNCS(scope, prefix, keytype, entrytype, \
 	  tbltype) \
+	CSNIP_LPHASH_TABLE_DECL_STATS_FUNCS(scope, prefix, tbltype) \
 	\
 	/* Private methods */ \
 	static size_t prefix##_internal_findloc( \
@@ -235,14 +550,41 @@
 		size_t ret_; \
 		entrytype e; \
 		keytype k2; \
+		CSNIP_LPHASH_TABLE__STATS_DECL(np_) \
 		csnip_lphash_Find(T->cap, keytype, k1, u, \
-				hash, \
-				!T->occ[u], \
+				CSNIP_LPHASH_TABLE_POSTMIX(hash), \
+				(CSNIP_LPHASH_TABLE__STATS_COUNT(np_) \
+				  !T->occ[u]), \
 				(e = T->entry[u], k2 = (get_key), (is_match)), \
 				(e = T->entry[u], (get_key)), \
 				key, \
 				ret_, \
 				*state_); \
+		CSNIP_LPHASH_TABLE__STATS_SEARCH(T, np_, *state_) \
+		return ret_; \
+	} \
+	\
+	/* Find a key, given its home slot */ \
+	static size_t prefix##_internal_findloc_home( \
+				const tbltype* T, \
+				keytype key, \
+				size_t home_, \
+				int* state_) \
+	{ \
+		size_t ret_; \
+		entrytype e; \
+		keytype k2; \
+		CSNIP_LPHASH_TABLE__STATS_DECL(np_) \
+		csnip_lphash_Find(T->cap, keytype, k1, u, \
+				home_, \
+				(CSNIP_LPHASH_TABLE__STATS_COUNT(np_) \
+				  !T->occ[u]), \
+				(e = T->entry[u], k2 = (get_key), (is_match)), \
+				(e = T->entry[u], (get_key)), \
+				key, \
+				ret_, \
+				*state_); \
+		CSNIP_LPHASH_TABLE__STATS_SEARCH(T, np_, *state_) \
 		return ret_; \
 	} \
 	\
@@ -251,7 +593,7 @@
 	{ \
 		entrytype e; \
 		csnip_lphash_Delete(T->cap, keytype, k1, u, v, \
-				hash, \
+				CSNIP_LPHASH_TABLE_POSTMIX(hash), \
 				!T->occ[u], \
 				(e = T->entry[u], (get_key)), \
 				(T->entry[v] = T->entry[u], T->occ[v] = T->occ[u]), \
@@ -259,29 +601,34 @@
 				loc); \
 	} \
 	\
-	static _Bool prefix##_internal_grow(tbltype* T, \
-						int* err, \
-						size_t min_size) \
+	/* Smallest capacity for the given number of entries */ \
+	static size_t prefix##_internal_capfor(size_t min_size) \
 	{ \
-		if (min_size * 3 <= T->cap * 2) { \
-			/* No need to grow */ \
-			return 0; \
-		} \
-		\
-		/* Compute new capacity */ \
-		size_t newcap = (T->cap ? T->cap : 8); \
-		while (min_size * 3 > newcap * 2) { \
-			newcap *= 2; \
+		size_t cap = 8; \
+		while (min_size * (load_den) > cap * (load_num)) { \
+			cap *= 2; \
 			/* XXX: Check overflow in the above */ \
 		} \
+		return cap; \
+	} \
+	\
+	/* Rebuild the table with the given capacity. */ \
+	static void prefix##_internal_rehash(tbltype* T, \
+						int* err, \
+						size_t newcap) \
+	{ \
+		CSNIP_LPHASH_TABLE__STATS_TSTART(t0_) \
 		\
 		/* Allocate new hashing table */ \
 		entrytype* newarr; \
 		unsigned char* newocc; \
-		csnip_mem_Alloc(newcap, newarr, *err); \
-		if (err && *err) return 0; \
-		csnip_mem_Alloc(newcap, newocc, *err); \
-		if (err && *err) return 0; \
+		CSNIP_LPHASH_TABLE_ALLOC(newcap, newarr, *err); \
+		if (err && *err) return; \
+		CSNIP_LPHASH_TABLE_ALLOC(newcap, newocc, *err); \
+		if (err && *err) { \
+			CSNIP_LPHASH_TABLE_FREE(newarr); \
+			return; \
+		} \
 		tbltype N = { \
 			.cap = newcap, \
 			.size = T->size, \
@@ -307,10 +654,24 @@
 		} \
 		\
 		/* Replace old table with new one, and free */ \
-		if (T->entry) csnip_mem_Free(T->entry); \
-		if (T->occ) csnip_mem_Free(T->occ); \
+		if (T->entry) CSNIP_LPHASH_TABLE_FREE(T->entry); \
+		if (T->occ) CSNIP_LPHASH_TABLE_FREE(T->occ); \
+		CSNIP_LPHASH_TABLE__STATS_KEEP(N, T) \
 		*T = N; \
+		CSNIP_LPHASH_TABLE__STATS_REHASH(T, t0_) \
+	} \
+	\
+	static _Bool prefix##_internal_grow(tbltype* T, \
+						int* err, \
+						size_t min_size) \
+	{ \
+		if (min_size * (load_den) <= T->cap * (load_num)) { \
+			/* No need to grow */ \
+			return 0; \
+		} \
 		\
+		prefix##_internal_rehash(T, err, \
+			prefix##_internal_capfor(min_size)); \
 		return 1; \
 	} \
 	\
@@ -320,21 +681,35 @@
 		if (err) *err = 0; \
 		\
 		tbltype* T; \
-		csnip_mem_Alloc(1, T, *err); \
+		CSNIP_LPHASH_TABLE_ALLOC(1, T, *err); \
 		if (err && *err) \
 			return NULL; \
 		T->cap = 0; \
 		T->size = 0; \
 		T->entry = NULL; \
 		T->occ = NULL; \
+		CSNIP_LPHASH_TABLE__STATS_CLEAR(T) \
+		return T; \
+	} \
+	\
+	scope tbltype* prefix##make_with_cap(int* err, size_t min_size) \
+	{ \
+		tbltype* T = prefix##make(err); \
+		if (T == NULL) \
+			return NULL; \
+		prefix##reserve(T, err, min_size); \
+		if (err && *err) { \
+			prefix##free(T); \
+			return NULL; \
+		} \
 		return T; \
 	} \
 	\
 	scope void prefix##free(tbltype* T) \
 	{ \
-		if (T->entry)	csnip_mem_Free(T->entry); \
-		if (T->occ)	csnip_mem_Free(T->occ); \
-		csnip_mem_Free(T); \
+		if (T->entry)	CSNIP_LPHASH_TABLE_FREE(T->entry); \
+		if (T->occ)	CSNIP_LPHASH_TABLE_FREE(T->occ); \
+		CSNIP_LPHASH_TABLE_FREE(T); \
 	} \
 	\
 	/* Element manipulation */ \
@@ -447,6 +822,103 @@
 		return NULL; \
 	} \
 	\
+	/* Batched operations */ \
+	scope size_t prefix##find_many(const tbltype* T, \
+				keytype const* keys, \
+				size_t n, \
+				entrytype** out) \
+	{ \
+		size_t home[CSNIP_LPHASH_TABLE_PREFETCH_DIST]; \
+		size_t nfound = 0; \
+		for (size_t b = 0; b < n; \
+		  b += CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+		{ \
+			size_t m = n - b; \
+			if (m > CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+				m = CSNIP_LPHASH_TABLE_PREFETCH_DIST; \
+			if (T->cap == 0) { \
+				for (size_t i = 0; i < m; ++i) \
+					out[b + i] = NULL; \
+				continue; \
+			} \
+			\
+			/* Hash and prefetch */ \
+			for (size_t i = 0; i < m; ++i) { \
+				keytype k1 = keys[b + i]; \
+				home[i] = CSNIP_LPHASH_TABLE_POSTMIX(hash) \
+					% T->cap; \
+				csnip_cext_prefetch(&T->occ[home[i]]); \
+				csnip_cext_prefetch(&T->entry[home[i]]); \
+			} \
+			\
+			/* Resolve */ \
+			for (size_t i = 0; i < m; ++i) { \
+				int r; \
+				const size_t loc = \
+					prefix##_internal_findloc_home(T, \
+						keys[b + i], home[i], &r); \
+				if (r == 0) { \
+					out[b + i] = &T->entry[loc]; \
+					++nfound; \
+				} else { \
+					out[b + i] = NULL; \
+				} \
+			} \
+		} \
+		return nfound; \
+	} \
+	\
+	scope size_t prefix##insert_many(tbltype* T, \
+				int* err, \
+				entrytype const* entries, \
+				size_t n) \
+	{ \
+		if (err) *err = 0; \
+		\
+		size_t home[CSNIP_LPHASH_TABLE_PREFETCH_DIST]; \
+		size_t ninserted = 0; \
+		for (size_t b = 0; b < n; \
+		  b += CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+		{ \
+			size_t m = n - b; \
+			if (m > CSNIP_LPHASH_TABLE_PREFETCH_DIST) \
+				m = CSNIP_LPHASH_TABLE_PREFETCH_DIST; \
+			\
+			/* Make room for the whole block, so that the
+			 * home slots remain valid. */ \
+			prefix##_internal_grow(T, err, T->size + m); \
+			if (err && *err) \
+				return ninserted; \
+			\
+			/* Hash and prefetch */ \
+			for (size_t i = 0; i < m; ++i) { \
+				entrytype e = entries[b + i]; \
+				keytype k1 = (get_key); \
+				home[i] = CSNIP_LPHASH_TABLE_POSTMIX(hash) \
+					% T->cap; \
+				csnip_cext_prefetch(&T->occ[home[i]]); \
+				csnip_cext_prefetch(&T->entry[home[i]]); \
+			} \
+			\
+			/* Resolve */ \
+			for (size_t i = 0; i < m; ++i) { \
+				int r; \
+				entrytype e = entries[b + i]; \
+				const size_t loc = \
+					prefix##_internal_findloc_home(T, \
+						(get_key), home[i], &r); \
+				assert(r < 2); \
+				if (r == 1) { \
+					T->entry[loc] = e; \
+					T->occ[loc] = 1; \
+					++T->size; \
+					++ninserted; \
+				} \
+			} \
+		} \
+		return ninserted; \
+	} \
+	\
 	/* Size and capacity */ \
 	scope size_t prefix##size(const tbltype* T) \
 	{ \
@@ -458,6 +930,28 @@
 		return T->cap; \
 	} \
 	\
+	scope void prefix##reserve(tbltype* T, int* err, size_t min_size) \
+	{ \
+		if (err) *err = 0; \
+		prefix##_internal_grow(T, err, min_size); \
+	} \
+	\
+	scope void prefix##shrink(tbltype* T, int* err) \
+	{ \
+		if (err) *err = 0; \
+		if (T->size == 0) { \
+			if (T->entry) CSNIP_LPHASH_TABLE_FREE(T->entry); \
+			if (T->occ) CSNIP_LPHASH_TABLE_FREE(T->occ); \
+			T->entry = NULL; \
+			T->occ = NULL; \
+			T->cap = 0; \
+			return; \
+		} \
+		const size_t newcap = prefix##_internal_capfor(T->size); \
+		if (newcap < T->cap) \
+			prefix##_internal_rehash(T, err, newcap); \
+	} \
+	\
 	/* Slot functions */ \
 	scope size_t prefix##findslot(const tbltype* T, keytype key) \
 	{ \
@@ -516,10 +1010,19 @@
 		for (++r; r < T->cap; ++r) \
 			if (T->occ[r]) break; \
 		return r; \
-	}
+	} \
+	\
+	/* Statistics */ \
+	CSNIP_LPHASH_TABLE__STATS_FUNCS(scope, prefix, tbltype)
 
 /** @}
  *  @}
  */
 
 #endif /* CSNIP_LPHASH_TABLE */
+
+#if defined(CSNIP_SHORT_NAMES) && !defined(CSNIP_LPHASH_TABLE_HAVE_SHORT_NAMES)
+#define lphash_stats			csnip_lphash_stats
+#define lphash_stats_dump		csnip_lphash_stats_dump
+#define CSNIP_LPHASH_TABLE_HAVE_SHORT_NAMES
+#endif /* CSNIP_SHORT_NAMES && !CSNIP_LPHASH_TABLE_HAVE_SHORT_NAMES */
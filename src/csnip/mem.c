@@ -1,13 +1,25 @@
 #include <csnip/csnip_conf.h>
 
 #include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #if defined(CSNIP_CONF__HAVE_MEMALIGN) \
 	|| defined(CSNIP_CONF__HAVE_ALIGNED_MALLOC)
 #include <malloc.h>
 #endif
 
+#ifdef CSNIP_CONF__HAVE_MMAP
+#include <sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS	MAP_ANON
+#endif
+#if defined(MAP_ANONYMOUS)
+#define HAVE_HUGE_MAP
+#endif
+#endif
+
 #include <csnip/err.h>
 #include <csnip/mem.h>
 
@@ -128,3 +140,145 @@ void csnip_mem_aligned_free(void* mem)
 }
 
 #endif /* CSNIP_CONF__HAVE_ALIGNED_MALLOC */
+
+/* Huge page backed allocations.
+ *
+ * The allocations start with a header, padded to a cache line, that
+ * records how the memory was obtained.
+ */
+
+#define HUGE_HDR_SZ	64
+
+enum { HUGE_HEAP, HUGE_MAP };
+
+typedef struct {
+	size_t len;		/* Length of the mapping */
+	size_t cap;		/* Usable size */
+	int kind;
+} huge_hdr;
+
+static inline huge_hdr* huge_hdr_of(void* p)
+{
+	return (huge_hdr*)((char*)p - HUGE_HDR_SZ);
+}
+
+#ifdef HAVE_HUGE_MAP
+/* Map len bytes, a multiple of the huge page size.  Returns NULL on
+ * failure. */
+static void* huge_map(size_t len, int flags)
+{
+	const size_t hp = CSNIP_MEM_HUGE_PAGE_SZ;
+	const int prot = PROT_READ | PROT_WRITE;
+	const int mflags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+	if (flags & csnip_mem_HUGE_TLB) {
+		void* p = mmap(NULL, len, prot, mflags | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED)
+			return p;
+	}
+#else
+	(void)flags;
+#endif
+
+	/* Map with room to align to the huge page size, and unmap the
+	 * excess */
+	if (len > SIZE_MAX - hp)
+		return NULL;
+	char* m = mmap(NULL, len + hp, prot, mflags, -1, 0);
+	if (m == MAP_FAILED)
+		return NULL;
+	char* p = (char*)(((uintptr_t)m + hp - 1) & ~(uintptr_t)(hp - 1));
+	if (p > m)
+		munmap(m, (size_t)(p - m));
+	if (p + len < m + len + hp)
+		munmap(p + len, (size_t)(m + len + hp - (p + len)));
+#ifdef MADV_HUGEPAGE
+	madvise(p, len, MADV_HUGEPAGE);
+#endif
+	return p;
+}
+#endif
+
+void* csnip_mem_huge_alloc(size_t n, size_t size, int flags, int* err)
+{
+	if (err) *err = 0;
+	const size_t sz = compute_alloc_amount(n, size);
+	if (sz == 0 || sz > SIZE_MAX - HUGE_HDR_SZ - CSNIP_MEM_HUGE_PAGE_SZ) {
+		csnip_err_Raise(csnip_err_RANGE, *err);
+		return NULL;
+	}
+	const size_t need = HUGE_HDR_SZ + sz;
+
+#ifdef HAVE_HUGE_MAP
+	if (need >= CSNIP_MEM_HUGE_PAGE_SZ) {
+		const size_t hp = CSNIP_MEM_HUGE_PAGE_SZ;
+		const size_t len = (need + hp - 1) / hp * hp;
+		char* m = huge_map(len, flags);
+		if (m) {
+			huge_hdr* h = (huge_hdr*)m;
+			h->len = len;
+			h->cap = len - HUGE_HDR_SZ;
+			h->kind = HUGE_MAP;
+			return m + HUGE_HDR_SZ;
+		}
+		/* Fall back to the heap */
+	}
+#else
+	(void)flags;
+#endif
+
+	int err2 = 0;
+	char* m = csnip_mem_aligned_alloc(HUGE_HDR_SZ, 1, need, &err2);
+	if (m == NULL) {
+		csnip_err_Raise(err2 ? err2 : csnip_err_NOMEM, *err);
+		return NULL;
+	}
+	huge_hdr* h = (huge_hdr*)m;
+	h->len = need;
+	h->cap = sz;
+	h->kind = HUGE_HEAP;
+	return m + HUGE_HDR_SZ;
+}
+
+void* csnip_mem_huge_realloc(void* p,
+			size_t n,
+			size_t size,
+			int flags,
+			int* err)
+{
+	if (p == NULL)
+		return csnip_mem_huge_alloc(n, size, flags, err);
+	if (err) *err = 0;
+	const size_t sz = compute_alloc_amount(n, size);
+	if (sz == 0) {
+		csnip_err_Raise(csnip_err_RANGE, *err);
+		return NULL;
+	}
+	huge_hdr* h = huge_hdr_of(p);
+	if (sz <= h->cap)
+		return p;
+
+	int err2;
+	void* q = csnip_mem_huge_alloc(1, sz, flags, &err2);
+	if (q == NULL) {
+		csnip_err_Raise(err2, *err);
+		return NULL;
+	}
+	memcpy(q, p, h->cap);
+	csnip_mem_huge_free(p);
+	return q;
+}
+
+void csnip_mem_huge_free(void* p)
+{
+	if (p == NULL)
+		return;
+	huge_hdr* h = huge_hdr_of(p);
+#ifdef HAVE_HUGE_MAP
+	if (h->kind == HUGE_MAP) {
+		munmap(h, h->len);
+		return;
+	}
+#endif
+	csnip_mem_aligned_free(h);
+}
@@ -74,6 +74,65 @@ void* csnip_mem_aligned_alloc(size_t nAlign, size_t n, size_t size, int* err);
  */
 void csnip_mem_aligned_free(void* mem);
 
+/**	Huge page size.
+ *
+ *	Allocations with csnip_mem_huge_alloc() of at least this size
+ *	are mapped directly, aligned to this size.
+ */
+#define CSNIP_MEM_HUGE_PAGE_SZ		(2 * 1024 * 1024)
+
+/**	Flag for csnip_mem_huge_alloc():  use explicit huge pages.
+ *
+ *	Explicit huge pages (MAP_HUGETLB on Linux) come from a pool the
+ *	administrator reserves;  when none are available, the allocation
+ *	falls back to normal pages.
+ */
+#define csnip_mem_HUGE_TLB		1
+
+/**	Allocate memory backed by huge pages.
+ *
+ *	For large arrays that are accessed randomly, such as hash
+ *	tables, huge pages reduce TLB misses.  Allocations of at least
+ *	CSNIP_MEM_HUGE_PAGE_SZ bytes are mapped with mmap(), aligned to
+ *	the huge page size, and the kernel is asked to back them with
+ *	transparent huge pages (madvise(MADV_HUGEPAGE)), or with
+ *	explicit huge pages if @a flags contains csnip_mem_HUGE_TLB.
+ *	Smaller allocations, and all allocations on systems without
+ *	mmap(), are taken from the heap.  In all cases, the memory is
+ *	aligned to a cache line (64 bytes).
+ *
+ *	The memory needs to be freed with csnip_mem_huge_free().
+ *
+ *	@param	n, size
+ *		Number and size of the members.
+ *
+ *	@param	flags
+ *		0 or csnip_mem_HUGE_TLB.
+ *
+ *	@param	err
+ *		Error return.
+ */
+void* csnip_mem_huge_alloc(size_t n, size_t size, int flags, int* err);
+
+/**	Resize memory allocated with csnip_mem_huge_alloc().
+ *
+ *	Grows in place if the allocation was rounded up sufficiently,
+ *	and otherwise moves the contents to a new allocation.  If @a p
+ *	is NULL, this is csnip_mem_huge_alloc().  On error, @a p remains
+ *	valid.
+ */
+void* csnip_mem_huge_realloc(void* p,
+			size_t n,
+			size_t size,
+			int flags,
+			int* err);
+
+/**	Free memory allocated with csnip_mem_huge_alloc().
+ *
+ *	If @a p is NULL, no action occurs.
+ */
+void csnip_mem_huge_free(void* p);
+
 #ifdef __cplusplus
 }
 #endif
@@ -244,6 +303,60 @@ void csnip_mem_aligned_free(void* mem);
 		(ptr) = NULL; \
 	} while (0)
 
+/**	Allocate huge page backed memory.
+ *
+ *	Macro version of csnip_mem_huge_alloc(), in the manner of
+ *	csnip_mem_AlignedAlloc().
+ */
+#define csnip_mem_HugeAlloc(nMember, flags, ptr, err) \
+	csnip_mem__HugeAlloc((nMember), (flags), ptr, (err), csnip__err)
+
+/** @cond */
+#define csnip_mem__HugeAlloc(nMember, flags, ptr, err,		err2) \
+	do { \
+		int err2; \
+		(ptr) = csnip_mem__cxxcast(ptr, \
+			csnip_mem_huge_alloc((nMember), sizeof(*(ptr)), \
+				(flags), &err2)); \
+		if ((ptr) == NULL) \
+			csnip_err_Raise(err2, err); \
+	} while(0)
+/** @endcond */
+
+/**	Resize huge page backed memory.
+ *
+ *	Macro version of csnip_mem_huge_realloc().  If the reallocation
+ *	fails, @a ptr remains unchanged.
+ */
+#define csnip_mem_HugeRealloc(nMember, flags, ptr, err) \
+	csnip_mem__HugeRealloc((nMember), (flags), ptr, (err), \
+				csnip__p, csnip__err)
+
+/** @cond */
+#define csnip_mem__HugeRealloc(nMember, flags, ptr, err,	p, err2) \
+	do { \
+		int err2; \
+		void* p = csnip_mem_huge_realloc((ptr), (nMember), \
+				sizeof(*(ptr)), (flags), &err2); \
+		if (p == NULL) { \
+			csnip_err_Raise(err2, err); \
+			break; \
+		} \
+		(ptr) = csnip_mem__cxxcast(ptr, p); \
+	} while(0)
+/** @endcond */
+
+/**	Free huge page backed memory.
+ *
+ *	Frees memory allocated with csnip_mem_HugeAlloc() or
+ *	csnip_mem_huge_alloc(), and clears the pointer.
+ */
+#define csnip_mem_HugeFree(ptr) \
+	do { \
+		csnip_mem_huge_free(ptr); \
+		(ptr) = NULL; \
+	} while (0)
+
 /** @} */
 
 #ifdef __cplusplus
@@ -268,5 +381,12 @@ void csnip_mem_aligned_free(void* mem);
 #define mem_Realloc		csnip_mem_Realloc
 #define mem_Free		csnip_mem_Free
 #define mem_AlignedFree		csnip_mem_AlignedFree
+#define mem_huge_alloc		csnip_mem_huge_alloc
+#define mem_huge_realloc	csnip_mem_huge_realloc
+#define mem_huge_free		csnip_mem_huge_free
+#define mem_HUGE_TLB		csnip_mem_HUGE_TLB
+#define mem_HugeAlloc		csnip_mem_HugeAlloc
+#define mem_HugeRealloc		csnip_mem_HugeRealloc
+#define mem_HugeFree		csnip_mem_HugeFree
 #define CSNIP_MEM_HAVE_SHORT_NAMES
 #endif
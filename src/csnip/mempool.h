@@ -19,24 +19,75 @@
  *	If the required capacity is known ahead of time, pool
  *	allocations and deallocations are O(1) time.  When the capacity
  *	is not known, they become amortized O(1) time.
+ *
+ *	The pool grows by adding slabs, i.e., arrays of items, and keeps
+ *	track of them.  Slabs are only returned to the system when the
+ *	pool is deinitialized, or when trim() is called and they hold
+ *	no allocated items; thus, calling trim() after phases of high
+ *	memory use makes the memory use follow the working set.
  */
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include <csnip/arr.h>
+#include <csnip/err.h>
 #include <csnip/mem.h>
+#include <csnip/search.h>
+#include <csnip/sort.h>
+#include <csnip/util.h>
+
+/**	Memory allocation of the slabs.
+ *
+ *	The functions generated by CSNIP_MEMPOOL_DEF_FUNCS() allocate
+ *	and release the slabs with these macros, which take the same
+ *	arguments as csnip_mem_Alloc() and csnip_mem_Free().  They are
+ *	expanded with CSNIP_MEMPOOL_DEF_FUNCS(), and can be redefined
+ *	between instantiations, e.g., to back the slabs of a large pool
+ *	with huge pages:
+ *
+ *		#define CSNIP_MEMPOOL_SLAB_ALLOC(nMember, ptr, err) \
+ *			csnip_mem_HugeAlloc(nMember, 0, ptr, err)
+ *		#define CSNIP_MEMPOOL_SLAB_FREE(ptr) \
+ *			csnip_mem_HugeFree(ptr)
+ */
+#ifndef CSNIP_MEMPOOL_SLAB_ALLOC
+#define CSNIP_MEMPOOL_SLAB_ALLOC(nMember, ptr, err) \
+	csnip_mem_Alloc(nMember, ptr, err)
+#endif
+
+/**	Slab release, @sa CSNIP_MEMPOOL_SLAB_ALLOC */
+#ifndef CSNIP_MEMPOOL_SLAB_FREE
+#define CSNIP_MEMPOOL_SLAB_FREE(ptr)	csnip_mem_Free(ptr)
+#endif
 
+/**	Define a memory pool type.
+ *
+ *	@param	struct_pooltype
+ *		Name of the pool struct.
+ *
+ *	@param	itemtype
+ *		Type of the items.  It needs to be at least as large
+ *		as a pointer, and have at least the alignment of a
+ *		pointer.
+ */
 #define CSNIP_MEMPOOL_DEF_TYPE(struct_pooltype, itemtype) \
 	struct struct_pooltype { \
 		itemtype** slabs; \
+		size_t* slab_sz; /* Number of items in each slab */ \
 		size_t n_slabs; \
 		size_t cap_slabs; \
 		\
 		size_t n_items; /* Number of items allocated */ \
+		size_t cap_items; /* Number of items in the slabs */ \
 		itemtype* first_free; \
 	}; \
 
+/**	Declare memory pool functions.
+ *
+ *	@sa CSNIP_MEMPOOL_DEF_FUNCS()
+ */
 #define CSNIP_MEMPOOL_DECL_FUNCS(scope, \
 		prefix, \
 		itemtype, \
@@ -45,11 +96,36 @@
 	scope pooltype prefix##init_empty(void); \
 	scope pooltype prefix##init_with_cap(size_t cap, int* err); \
 	scope void prefix##deinit(pooltype* pool); \
+	scope size_t prefix##trim(pooltype* pool, int* err); \
 	\
 	/* Item allocation and release */ \
 	scope itemtype* prefix##alloc_item(pooltype* pool, int* err); \
 	scope void prefix##free_item(pooltype* pool, itemtype* e);
 
+/**	Define memory pool functions.
+ *
+ *	The following functions will be generated:
+ *
+ *	* `init_empty`: `pooltype init_empty(void);`  Return an empty
+ *	  pool.
+ *	* `init_with_cap`: `pooltype init_with_cap(size_t cap, int*
+ *	  err);`  Return a pool with room for cap items.
+ *	* `deinit`: `void deinit(pooltype* pool);`  Release the memory
+ *	  of the pool, including all of its items.
+ *	* `trim`: `size_t trim(pooltype* pool, int* err);`  Return the
+ *	  slabs that have no allocated items to the system, and return
+ *	  the number of items they held.  This takes O(F log S) time,
+ *	  for F free items and S slabs, and is meant to be called
+ *	  occasionally, e.g., after a burst of allocations was freed.
+ *	  Memory for the bookkeeping is allocated temporarily; if that
+ *	  fails, nothing is released.
+ *	* `alloc_item`: `itemtype* alloc_item(pooltype* pool, int*
+ *	  err);`  Allocate an item.  Returns NULL if no memory is
+ *	  available.  When the pool is full, a slab with as many items
+ *	  as the pool already has, but at least 8, is added.
+ *	* `free_item`: `void free_item(pooltype* pool, itemtype* e);`
+ *	  Release an item.
+ */
 #define CSNIP_MEMPOOL_DEF_FUNCS(scope, \
 		prefix, \
 		itemtype, \
@@ -64,7 +140,7 @@
 	scope itemtype* prefix##get_slab(size_t n_items, int* err) \
 	{ \
 		itemtype* sl = NULL; \
-		csnip_mem_Alloc(n_items, sl, *err); \
+		CSNIP_MEMPOOL_SLAB_ALLOC(n_items, sl, *err); \
 		if (sl == NULL) \
 			return NULL; \
 		for (size_t i = 0; i < n_items - 1; ++i) \
@@ -73,6 +149,37 @@
 		return sl; \
 	} \
 	\
+	/* Add a slab of sz items to the pool, and its items to the \
+	 * free list.  Returns 0 on success. */ \
+	static int prefix##_internal_add_slab(pooltype* pool, \
+					size_t sz, \
+					int* err) \
+	{ \
+		if (pool->n_slabs == pool->cap_slabs) { \
+			const size_t c = (pool->cap_slabs ? \
+					2 * pool->cap_slabs : 4); \
+			int e = 0; \
+			csnip_mem_Realloc(c, pool->slabs, e); \
+			if (e == 0) \
+				csnip_mem_Realloc(c, pool->slab_sz, e); \
+			if (e) { \
+				csnip_err_Raise(e, *err); \
+				return -1; \
+			} \
+			pool->cap_slabs = c; \
+		} \
+		itemtype* sl = prefix##get_slab(sz, err); \
+		if (sl == NULL) \
+			return -1; \
+		*((itemtype**)&sl[sz - 1]) = pool->first_free; \
+		pool->first_free = sl; \
+		pool->slabs[pool->n_slabs] = sl; \
+		pool->slab_sz[pool->n_slabs] = sz; \
+		++pool->n_slabs; \
+		pool->cap_items += sz; \
+		return 0; \
+	} \
+	\
 	scope pooltype prefix##init_empty(void) \
 	{ \
 		return (pooltype) { NULL }; \
@@ -80,36 +187,97 @@
 	\
 	scope pooltype prefix##init_with_cap(size_t cap, int* err) \
 	{ \
-		itemtype* sl = prefix##get_slab(cap, err); \
-		itemtype** slabs; \
-		csnip_mem_Alloc(1, slabs, *err); \
-		slabs[0] = sl; \
-		return (pooltype) { \
-			.slabs = slabs, \
-			.n_slabs = 1, \
-			.cap_slabs = 1, \
-			.n_items = 0, \
-			.first_free = sl, \
-		}; \
+		if (err) *err = 0; \
+		pooltype pool = { NULL }; \
+		if (cap > 0) \
+			prefix##_internal_add_slab(&pool, cap, err); \
+		return pool; \
 	} \
 	\
 	scope void prefix##deinit(pooltype* pool) \
 	{ \
 		for (size_t i = 0; i < pool->n_slabs; ++i) { \
-			csnip_mem_Free(pool->slabs[i]); \
+			CSNIP_MEMPOOL_SLAB_FREE(pool->slabs[i]); \
 		} \
 		csnip_mem_Free(pool->slabs); \
+		csnip_mem_Free(pool->slab_sz); \
 		*pool = (pooltype) { NULL }; \
 	} \
 	\
+	scope size_t prefix##trim(pooltype* pool, int* err) \
+	{ \
+		if (err) *err = 0; \
+		const size_t S = pool->n_slabs; \
+		if (pool->n_items == pool->cap_items || S == 0) \
+			return 0; \
+		size_t* nfree; \
+		csnip_mem_Alloc0(S, nfree, *err); \
+		if (nfree == NULL) \
+			return 0; \
+		\
+		/* Sort the slabs by address, and count the free items \
+		 * of each */ \
+		csnip_Qsort(u, v, \
+			(uintptr_t)pool->slabs[u] < (uintptr_t)pool->slabs[v], \
+			do { \
+				csnip_Tswap(itemtype*, pool->slabs[u], \
+						pool->slabs[v]); \
+				csnip_Tswap(size_t, pool->slab_sz[u], \
+						pool->slab_sz[v]); \
+			} while (0), \
+			S); \
+		for (itemtype* it = pool->first_free; it; \
+			it = *((itemtype**)it)) \
+		{ \
+			size_t j; \
+			csnip_Bsearch(size_t, u, \
+				(uintptr_t)pool->slabs[u] <= (uintptr_t)it, \
+				S, j); \
+			++nfree[j - 1]; \
+		} \
+		\
+		/* Unlink the items of empty slabs from the free list */ \
+		itemtype** link = &pool->first_free; \
+		while (*link) { \
+			itemtype* it = *link; \
+			size_t j; \
+			csnip_Bsearch(size_t, u, \
+				(uintptr_t)pool->slabs[u] <= (uintptr_t)it, \
+				S, j); \
+			if (nfree[j - 1] == pool->slab_sz[j - 1]) \
+				*link = *((itemtype**)it); \
+			else \
+				link = (itemtype**)it; \
+		} \
+		\
+		/* Release the empty slabs */ \
+		size_t n = 0, released = 0; \
+		for (size_t i = 0; i < S; ++i) { \
+			if (nfree[i] == pool->slab_sz[i]) { \
+				CSNIP_MEMPOOL_SLAB_FREE(pool->slabs[i]); \
+				released += pool->slab_sz[i]; \
+			} else { \
+				pool->slabs[n] = pool->slabs[i]; \
+				pool->slab_sz[n] = pool->slab_sz[i]; \
+				++n; \
+			} \
+		} \
+		pool->n_slabs = n; \
+		pool->cap_items -= released; \
+		csnip_mem_Free(nfree); \
+		return released; \
+	} \
+	\
 	/* Item allocation and release */ \
 	scope itemtype* prefix##alloc_item(pooltype* pool, int* err) \
 	{ \
 		/* More memory needed ? */ \
 		if (pool->first_free == NULL) { \
-			size_t sz = pool->n_items; \
+			if (err) *err = 0; \
+			size_t sz = pool->cap_items; \
 			if (sz < 8) sz = 8; \
-			pool->first_free = prefix##get_slab(sz, err); \
+			if (prefix##_internal_add_slab(pool, sz, err) != 0) \
+				return NULL; \
 		} \
 		\
 		/* Alloc and return */ \
@@ -124,6 +292,7 @@
 	{ \
 		*((itemtype**)e) = pool->first_free; \
 		pool->first_free = e; \
+		--pool->n_items; \
 	}
 
 /** @} */
@@ -0,0 +1,241 @@
+#include <string.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/hash.h>
+
+/* The mx64 hash.
+ *
+ * The data is processed in blocks of 32 bytes, the last block being
+ * the final 1 to 32 bytes, so that the blocks of streaming and
+ * one-shot hashing agree.  Each block contributes two
+ * multiply-and-fold steps on two lanes, which are independent, so
+ * that their multiplications overlap.  The final block is mixed with
+ * the lanes, and the length as in wyhash.
+ */
+
+#define P0	0xa0761d6478bd642full
+#define P1	0xe7037ed1a0b428dbull
+#define P2	0x8ebc6af09c88c6e3ull
+#define P3	0x589965cc75374cc3ull
+
+/* Multiply and fold: xor of the halves of the 128 bit product */
+static inline uint64_t mum(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+	const unsigned __int128 r = (unsigned __int128)a * b;
+	return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+	const uint64_t ha = a >> 32, la = (uint32_t)a;
+	const uint64_t hb = b >> 32, lb = (uint32_t)b;
+	const uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+	const uint64_t mid = (ll >> 32) + (uint32_t)hl + (uint32_t)lh;
+	const uint64_t lo = (mid << 32) | (uint32_t)ll;
+	const uint64_t hi = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+	return lo ^ hi;
+#endif
+}
+
+/* Little endian reads */
+static inline uint64_t r64(const unsigned char* p)
+{
+	uint64_t v;
+	memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+static inline uint64_t r32(const unsigned char* p)
+{
+	uint32_t v;
+	memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap32(v);
+#endif
+	return v;
+}
+
+static inline void init_lanes(uint64_t seed, uint64_t* s0, uint64_t* s1)
+{
+	*s0 = seed ^ mum(seed ^ P0, P1);
+	*s1 = *s0 ^ P2;
+}
+
+static inline void block(uint64_t* s0, uint64_t* s1, const unsigned char* p)
+{
+	*s0 = mum(r64(p) ^ P1, r64(p + 8) ^ *s0);
+	*s1 = mum(r64(p + 16) ^ P2, r64(p + 24) ^ *s1);
+}
+
+/* Mix the final t bytes at p, 0 <= t <= 32, for a total length of
+ * len bytes */
+static inline uint64_t finish(uint64_t s0,
+			uint64_t s1,
+			uint64_t len,
+			const unsigned char* p,
+			size_t t)
+{
+	uint64_t s = (len > 32 ? mum(s0 ^ P3, s1 ^ P0) : s0);
+	uint64_t a, b;
+	if (t <= 16) {
+		if (t >= 4) {
+			const size_t o = (t >> 3) << 2;
+			a = (r32(p) << 32) | r32(p + o);
+			b = (r32(p + t - 4) << 32) | r32(p + t - 4 - o);
+		} else if (t > 0) {
+			a = ((uint64_t)p[0] << 16)
+				| ((uint64_t)p[t >> 1] << 8)
+				| p[t - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		s = mum(r64(p) ^ P1, r64(p + 8) ^ s);
+		a = r64(p + t - 16);
+		b = r64(p + t - 8);
+	}
+	return mum(P1 ^ len, mum(a ^ P1, b ^ s));
+}
+
+/* Hash of a buffer, given the initial lanes */
+static inline uint64_t hash_lanes(uint64_t s0,
+				uint64_t s1,
+				const unsigned char* p,
+				size_t sz)
+{
+	size_t n = sz;
+	while (n > 32) {
+		block(&s0, &s1, p);
+		p += 32;
+		n -= 32;
+	}
+	return finish(s0, s1, sz, p, n);
+}
+
+uint64_t csnip_hash_mx64_b(const void* buf, size_t sz, uint64_t seed)
+{
+	uint64_t s0, s1;
+	init_lanes(seed, &s0, &s1);
+	return hash_lanes(s0, s1, (const unsigned char*)buf, sz);
+}
+
+uint64_t csnip_hash_mx64_s(const char* str, uint64_t seed)
+{
+	const unsigned char* p = (const unsigned char*)str;
+	uint64_t s0, s1;
+	init_lanes(seed, &s0, &s1);
+
+	/* A full block is only processed once it is known not to be
+	 * the last one.  memchr() stops at the terminator (C11
+	 * 7.24.5.1), so that no bytes beyond the string are read. */
+	const unsigned char* pend = NULL;
+	uint64_t len = 0;
+	for (;;) {
+		const unsigned char* q = memchr(p, 0, 32);
+		if (q == NULL) {
+			if (pend)
+				block(&s0, &s1, pend);
+			pend = p;
+			p += 32;
+			len += 32;
+			continue;
+		}
+		const size_t t = (size_t)(q - p);
+		if (t == 0 && pend)
+			return finish(s0, s1, len, pend, 32);
+		if (pend)
+			block(&s0, &s1, pend);
+		return finish(s0, s1, len + t, p, t);
+	}
+}
+
+void csnip_hash_mx64_init(hash_mx64_state* S, uint64_t seed)
+{
+	init_lanes(seed, &S->s0, &S->s1);
+	S->len = 0;
+	S->nbuf = 0;
+}
+
+void csnip_hash_mx64_update(hash_mx64_state* S, const void* buf, size_t sz)
+{
+	if (sz == 0)
+		return;
+	const unsigned char* p = (const unsigned char*)buf;
+	S->len += sz;
+	if (S->nbuf + sz <= 32) {
+		memcpy(S->buf + S->nbuf, p, sz);
+		S->nbuf += sz;
+		return;
+	}
+
+	/* More than a block: complete and process the buffered one */
+	if (S->nbuf > 0) {
+		const size_t f = 32 - S->nbuf;
+		memcpy(S->buf + S->nbuf, p, f);
+		block(&S->s0, &S->s1, S->buf);
+		p += f;
+		sz -= f;
+	}
+	while (sz > 32) {
+		block(&S->s0, &S->s1, p);
+		p += 32;
+		sz -= 32;
+	}
+	memcpy(S->buf, p, sz);
+	S->nbuf = sz;
+}
+
+uint64_t csnip_hash_mx64_final(const hash_mx64_state* S)
+{
+	return finish(S->s0, S->s1, S->len, S->buf, S->nbuf);
+}
+
+/* Batched hashing.
+ *
+ * The lanes only depend on the seed, so they are computed once.  The
+ * hashes of the keys are then independent computations, which the
+ * processor overlaps.  For the fixed width keys, the final block
+ * mixing reduces to two multiplications; see finish(). */
+
+void csnip_hash_mx64_many(const void* const* keys,
+			const size_t* lens,
+			size_t n,
+			uint64_t seed,
+			uint64_t* out)
+{
+	uint64_t s0, s1;
+	init_lanes(seed, &s0, &s1);
+	for (size_t i = 0; i < n; ++i) {
+		out[i] = hash_lanes(s0, s1,
+			(const unsigned char*)keys[i], lens[i]);
+	}
+}
+
+void csnip_hash_mx64_u64_many(const uint64_t* keys,
+			size_t n,
+			uint64_t seed,
+			uint64_t* out)
+{
+	uint64_t s0, s1;
+	init_lanes(seed, &s0, &s1);
+	for (size_t i = 0; i < n; ++i) {
+		const uint64_t k = keys[i];
+		const uint64_t a = (k << 32) | (k >> 32);
+		out[i] = mum(P1 ^ 8, mum(a ^ P1, k ^ s0));
+	}
+}
+
+void csnip_hash_mx64_u32_many(const uint32_t* keys,
+			size_t n,
+			uint64_t seed,
+			uint64_t* out)
+{
+	uint64_t s0, s1;
+	init_lanes(seed, &s0, &s1);
+	for (size_t i = 0; i < n; ++i) {
+		const uint64_t a = ((uint64_t)keys[i] << 32) | keys[i];
+		out[i] = mum(P1 ^ 4, mum(a ^ P1, a ^ s0));
+	}
+}
@@ -0,0 +1,326 @@
+#ifndef CSNIP_RADIX_HEAP_H
+#define CSNIP_RADIX_HEAP_H
+
+/**	@file radix_heap.h
+ *	@brief			Radix heaps
+ *	@defgroup radix_heap	Radix heaps
+ *	@{
+ *
+ *	@brief Monotone priority queues with unsigned integer keys.
+ *
+ *	A radix heap is a priority queue for the special case where the
+ *	keys are unsigned integers, and where the keys extracted from
+ *	the queue never decrease.  In other words, a key pushed into
+ *	the queue must never be smaller than the last key popped from
+ *	the queue.  Such monotone queues occur, for example, in
+ *	Dijkstra's shortest path algorithm with nonnegative integer edge
+ *	weights and in discrete event simulations.
+ *
+ *	Entries are kept in B + 1 buckets, where B is the number of
+ *	bits of the key type.  Bucket 0 contains the entries whose key
+ *	equals the last extracted key, and bucket i > 0 contains those
+ *	entries whose key differs from the last extracted key in bit
+ *	i - 1 as the highest differing bit.  When bucket 0 runs empty,
+ *	the first nonempty bucket is redistributed into lower buckets.
+ *	Since each entry can only ever move to a lower bucket, push and
+ *	pop have amortized cost O(B), independently of the number of
+ *	entries in the queue; in practice the constant is very small.
+ *
+ *	Compared to the comparison based heaps from heap.h, radix heaps
+ *	do not need to compare the keys of different entries at all,
+ *	and most operations touch memory sequentially.
+ *
+ *	Each entry carries a payload of arbitrary type in addition to
+ *	the key, e.g., a node index or a pointer to a user record.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <csnip/arr.h>
+#include <csnip/err.h>
+#include <csnip/mem.h>
+
+/**	Number of buckets for a given key type. */
+#define CSNIP_RADIXHEAP_NBUCKETS(keytype) \
+	(sizeof(keytype) * CHAR_BIT + 1)
+
+/**	Define a radix heap type.
+ *
+ *	@param	struct_heaptype
+ *		Name of the struct to be defined.
+ *
+ *	@param	keytype
+ *		Type of the keys.  This must be an unsigned integer type
+ *		of at most 64 bits, typically uint32_t or uint64_t.
+ *
+ *	@param	valtype
+ *		Type of the payload attached to each entry.
+ */
+#define CSNIP_RADIXHEAP_DEF_TYPE(struct_heaptype, keytype, valtype) \
+	struct struct_heaptype { \
+		keytype last;		/* Last extracted key */ \
+		size_t size;		/* Number of entries */ \
+		struct { \
+			keytype key; \
+			valtype val; \
+		} *b[CSNIP_RADIXHEAP_NBUCKETS(keytype)]; /* Buckets */ \
+		size_t n[CSNIP_RADIXHEAP_NBUCKETS(keytype)]; \
+		size_t cap[CSNIP_RADIXHEAP_NBUCKETS(keytype)]; \
+	};
+
+/**	Declare radix heap functions.
+ *
+ *	@sa CSNIP_RADIXHEAP_DEF_FUNCS()
+ */
+#define CSNIP_RADIXHEAP_DECL_FUNCS(scope, prefix, keytype, valtype, \
+				heaptype) \
+	scope void prefix##init(heaptype* H); \
+	scope void prefix##deinit(heaptype* H); \
+	scope size_t prefix##size(const heaptype* H); \
+	scope void prefix##push(heaptype* H, \
+			int* err, \
+			keytype key, \
+			valtype val); \
+	scope keytype prefix##top(heaptype* H, \
+			int* err, \
+			valtype* val); \
+	scope keytype prefix##pop(heaptype* H, \
+			int* err, \
+			valtype* val);
+
+/**	Define radix heap functions.
+ *
+ *	@param	scope
+ *		scope of the function definitions.
+ *
+ *	@param	prefix
+ *		function name prefix.
+ *
+ *	@param	keytype
+ *		the (unsigned integer) key type.
+ *
+ *	@param	valtype
+ *		the payload type.
+ *
+ *	@param	heaptype
+ *		the heap type as defined with CSNIP_RADIXHEAP_DEF_TYPE().
+ *
+ *	The following functions are generated:
+ *
+ *	* `init`: `void init(heaptype* H);`  Initialize an empty heap.
+ *	  No memory is allocated.
+ *
+ *	* `deinit`: `void deinit(heaptype* H);`  Release the memory
+ *	  associated with the heap.  The heap is left empty and may be
+ *	  reused.
+ *
+ *	* `size`: `size_t size(const heaptype* H);`  Number of entries.
+ *
+ *	* `push`: `void push(heaptype* H, int* err, keytype key,
+ *	  valtype val);`  Add an entry.  If @a key is smaller than the
+ *	  last key popped, csnip_err_RANGE is raised; on allocation
+ *	  failure csnip_err_NOMEM is raised.
+ *
+ *	* `top`: `keytype top(heaptype* H, int* err, valtype* val);`
+ *	  Return the smallest key, and, if @a val is non-NULL, the
+ *	  corresponding payload, without removing the entry.  Raises
+ *	  csnip_err_UNDERFLOW if the heap is empty.
+ *
+ *	* `pop`: `keytype pop(heaptype* H, int* err, valtype* val);`
+ *	  Like top, but also remove the entry.
+ *
+ *	Among entries with the same key, the one pushed last is
+ *	returned first.
+ */
+#define CSNIP_RADIXHEAP_DEF_FUNCS(scope, prefix, keytype, valtype, \
+				heaptype) \
+	\
+	CSNIP_RADIXHEAP_DECL_FUNCS(scope, prefix, keytype, valtype, \
+				heaptype) \
+	\
+	/* Private methods */ \
+	static size_t prefix##_internal_bucket(keytype last, keytype key) \
+	{ \
+		uint_least64_t x = (uint_least64_t)(last ^ key); \
+		if (x == 0) \
+			return 0; \
+		return (size_t)csnip_radixheap__Bitlen(x); \
+	} \
+	\
+	/* Make sure bucket 0 is nonempty; the heap must be nonempty.
+	 * Returns 0 on success, and an error code on failure, in which
+	 * case the heap is left unchanged.
+	 */ \
+	static int prefix##_internal_settle(heaptype* H) \
+	{ \
+		if (H->n[0] > 0) \
+			return 0; \
+		\
+		/* Find the first nonempty bucket */ \
+		size_t i = 1; \
+		while (H->n[i] == 0) { \
+			++i; \
+			assert(i < CSNIP_RADIXHEAP_NBUCKETS(keytype)); \
+		} \
+		\
+		/* Its minimum becomes the new last key */ \
+		keytype m = H->b[i][0].key; \
+		for (size_t j = 1; j < H->n[i]; ++j) { \
+			if (H->b[i][j].key < m) \
+				m = H->b[i][j].key; \
+		} \
+		\
+		/* Reserve room in the target buckets.  All entries go
+		 * to buckets < i.  Bucket capacities are kept until
+		 * deinit(), so this rarely allocates in steady state.
+		 */ \
+		size_t cnt[CSNIP_RADIXHEAP_NBUCKETS(keytype)] = { 0 }; \
+		for (size_t j = 0; j < H->n[i]; ++j) { \
+			++cnt[prefix##_internal_bucket(m, H->b[i][j].key)]; \
+		} \
+		for (size_t t = 0; t < i; ++t) { \
+			if (H->n[t] + cnt[t] > H->cap[t]) { \
+				int err2 = 0; \
+				csnip_arr_Reserve(H->b[t], H->n[t], \
+					H->cap[t], H->n[t] + cnt[t], err2); \
+				if (err2) \
+					return err2; \
+			} \
+		} \
+		\
+		/* Redistribute */ \
+		H->last = m; \
+		for (size_t j = 0; j < H->n[i]; ++j) { \
+			size_t t = prefix##_internal_bucket(m, \
+						H->b[i][j].key); \
+			assert(t < i); \
+			H->b[t][H->n[t]++] = H->b[i][j]; \
+		} \
+		H->n[i] = 0; \
+		return 0; \
+	} \
+	\
+	scope void prefix##init(heaptype* H) \
+	{ \
+		H->last = 0; \
+		H->size = 0; \
+		for (size_t i = 0; i < CSNIP_RADIXHEAP_NBUCKETS(keytype); \
+			++i) \
+		{ \
+			H->b[i] = NULL; \
+			H->n[i] = 0; \
+			H->cap[i] = 0; \
+		} \
+	} \
+	\
+	scope void prefix##deinit(heaptype* H) \
+	{ \
+		for (size_t i = 0; i < CSNIP_RADIXHEAP_NBUCKETS(keytype); \
+			++i) \
+		{ \
+			csnip_arr_Deinit(H->b[i], H->n[i], H->cap[i]); \
+		} \
+		H->last = 0; \
+		H->size = 0; \
+	} \
+	\
+	scope size_t prefix##size(const heaptype* H) \
+	{ \
+		return H->size; \
+	} \
+	\
+	scope void prefix##push(heaptype* H, \
+			int* err, \
+			keytype key, \
+			valtype val) \
+	{ \
+		if (err) *err = 0; \
+		if (key < H->last) { \
+			csnip_err_Raise(csnip_err_RANGE, *err); \
+			return; \
+		} \
+		\
+		const size_t i = prefix##_internal_bucket(H->last, key); \
+		if (H->n[i] + 1 > H->cap[i]) { \
+			int err2 = 0; \
+			csnip_arr_Reserve(H->b[i], H->n[i], H->cap[i], \
+						H->n[i] + 1, err2); \
+			if (err2) { \
+				csnip_err_Raise(err2, *err); \
+				return; \
+			} \
+		} \
+		H->b[i][H->n[i]].key = key; \
+		H->b[i][H->n[i]].val = val; \
+		++H->n[i]; \
+		++H->size; \
+	} \
+	\
+	scope keytype prefix##top(heaptype* H, \
+			int* err, \
+			valtype* val) \
+	{ \
+		if (err) *err = 0; \
+		if (H->size == 0) { \
+			csnip_err_Raise(csnip_err_UNDERFLOW, *err); \
+			return 0; \
+		} \
+		int err2 = prefix##_internal_settle(H); \
+		if (err2) { \
+			csnip_err_Raise(err2, *err); \
+			return 0; \
+		} \
+		if (val) \
+			*val = H->b[0][H->n[0] - 1].val; \
+		return H->last; \
+	} \
+	\
+	scope keytype prefix##pop(heaptype* H, \
+			int* err, \
+			valtype* val) \
+	{ \
+		if (err) *err = 0; \
+		if (H->size == 0) { \
+			csnip_err_Raise(csnip_err_UNDERFLOW, *err); \
+			return 0; \
+		} \
+		int err2 = prefix##_internal_settle(H); \
+		if (err2) { \
+			csnip_err_Raise(err2, *err); \
+			return 0; \
+		} \
+		--H->n[0]; \
+		--H->size; \
+		if (val) \
+			*val = H->b[0][H->n[0]].val; \
+		return H->last; \
+	}
+
+/** @cond */
+
+/* Number of significant bits in a nonzero 64 bit value. */
+#if defined(__GNUC__) || defined(__clang__)
+#define csnip_radixheap__Bitlen(x) \
+	(64 - __builtin_clzll((unsigned long long)(x)))
+#else
+#define csnip_radixheap__Bitlen(x) \
+	csnip_radixheap__bitlen_portable(x)
+static inline int csnip_radixheap__bitlen_portable(uint_least64_t x)
+{
+	int r = 0;
+	while (x) {
+		x >>= 1;
+		++r;
+	}
+	return r;
+}
+#endif
+
+/** @endcond */
+
+/** @} */
+
+#endif /* CSNIP_RADIX_HEAP_H */
@@ -0,0 +1,118 @@
+#include <math.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/hash.h>
+
+/* Consistent hashing: jump consistent hash and rendezvous hashing. */
+
+/* Number of keys processed together by hash_jump_many */
+#define JUMP_GROUP	8
+
+/* One step of the jump hash: the next shard index after b, for key
+ * state k, which is advanced. */
+#define jump_step(k, b) \
+	((k) = (k) * 2862933555777941757ull + 1, \
+	 (int64_t)((double)((b) + 1) \
+		* ((double)(1ll << 31) / (double)(((k) >> 33) + 1))))
+
+uint32_t csnip_hash_jump(uint64_t key, uint32_t nshards)
+{
+	int64_t b = -1, j = 0;
+	while (j < (int64_t)nshards) {
+		b = j;
+		j = jump_step(key, b);
+	}
+	return (uint32_t)(b < 0 ? 0 : b);
+}
+
+void csnip_hash_jump_many(const uint64_t* keys,
+			size_t nkeys,
+			uint32_t nshards,
+			uint32_t* shard)
+{
+	size_t i = 0;
+	for (; i + JUMP_GROUP <= nkeys; i += JUMP_GROUP) {
+		uint64_t k[JUMP_GROUP];
+		int64_t b[JUMP_GROUP], j[JUMP_GROUP];
+		for (int l = 0; l < JUMP_GROUP; ++l) {
+			k[l] = keys[i + l];
+			b[l] = -1;
+			j[l] = 0;
+		}
+
+		/* Iterate all keys until the last one is done */
+		_Bool active;
+		do {
+			active = 0;
+			for (int l = 0; l < JUMP_GROUP; ++l) {
+				if (j[l] < (int64_t)nshards) {
+					b[l] = j[l];
+					j[l] = jump_step(k[l], b[l]);
+					active = 1;
+				}
+			}
+		} while (active);
+
+		for (int l = 0; l < JUMP_GROUP; ++l)
+			shard[i + l] = (uint32_t)(b[l] < 0 ? 0 : b[l]);
+	}
+	for (; i < nkeys; ++i)
+		shard[i] = csnip_hash_jump(keys[i], nshards);
+}
+
+/* Pseudo-random value for the key and shard id pair */
+static inline uint64_t hrw_hash(uint64_t key, uint64_t id)
+{
+	return hash_splitmix64(key ^ hash_fmix64(id));
+}
+
+size_t csnip_hash_hrw(uint64_t key,
+			const uint64_t* ids,
+			const double* weight,
+			size_t nshards)
+{
+	size_t best = nshards;
+	if (weight == NULL) {
+		uint64_t hbest = 0;
+		for (size_t i = 0; i < nshards; ++i) {
+			const uint64_t h = hrw_hash(key, ids[i]);
+			if (best == nshards || h > hbest
+			  || (h == hbest && ids[i] < ids[best]))
+			{
+				best = i;
+				hbest = h;
+			}
+		}
+		return best;
+	}
+
+	/* For u uniform in (0, 1), -log(u) / w is exponentially
+	 * distributed with rate w, and the minimum over the shards is
+	 * attained by shard i with probability w_i / sum w. */
+	double sbest = 0.0;
+	for (size_t i = 0; i < nshards; ++i) {
+		if (!(weight[i] > 0.0))
+			continue;
+		const uint64_t h = hrw_hash(key, ids[i]);
+		const double u = ((double)(h >> 11) + 0.5) * 0x1p-53;
+		const double s = -log(u) / weight[i];
+		if (best == nshards || s < sbest
+		  || (s == sbest && ids[i] < ids[best]))
+		{
+			best = i;
+			sbest = s;
+		}
+	}
+	return best;
+}
+
+void csnip_hash_hrw_many(const uint64_t* keys,
+			size_t nkeys,
+			const uint64_t* ids,
+			const double* weight,
+			size_t nshards,
+			size_t* shard)
+{
+	for (size_t i = 0; i < nkeys; ++i)
+		shard[i] = csnip_hash_hrw(keys[i], ids, weight, nshards);
+}
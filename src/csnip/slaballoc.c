@@ -0,0 +1,283 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/err.h>
+#include <csnip/mem.h>
+#include <csnip/slaballoc.h>
+
+/* Slab header.
+ *
+ * The header sits at the start of each slab, and of each large block,
+ * followed by the objects.  Slabs with free objects are on the
+ * doubly linked partial list of their class;  all slabs and large
+ * blocks are on the allocator's list of all blocks, so that they can
+ * be released with the allocator.
+ */
+typedef struct slab slab;
+struct slab {
+	slab* next;			/* Partial list, or spare list */
+	slab* prev;
+	slab* all_next;			/* List of all blocks */
+	slab* all_prev;
+	slaballoc* owner;
+	size_t obj_sz;			/* Size of the objects */
+	void* free;			/* Freed objects */
+	char* bump;			/* First object not yet carved */
+	char* end;			/* End of the slab */
+	size_t nlive;			/* Number of allocated objects */
+	int cls;			/* Size class, or -1 for large blocks */
+	_Bool listed;			/* Whether on the partial list */
+};
+
+/* Header size, keeping the objects cache line aligned */
+#define HDR_SZ		((sizeof(slab) + 63) & ~(size_t)63)
+
+struct csnip_slaballoc_s {
+	slab* partial[CSNIP_SLABALLOC_NCLASS];
+	slab* all;
+	slab* spare;
+	int nspare;
+};
+
+static inline slab* slab_of(const void* p)
+{
+	return (slab*)((uintptr_t)p
+			& ~(uintptr_t)(CSNIP_SLABALLOC_SLAB_SZ - 1));
+}
+
+/* Size classes:  multiples of 16 up to 128, and 8 per power of two
+ * beyond. */
+
+static inline int floor_log2(size_t x)
+{
+#if defined(__GNUC__)
+	return (int)(sizeof(unsigned long long) * 8 - 1)
+		- __builtin_clzll((unsigned long long)x);
+#else
+	int l = 0;
+	while (x >>= 1)
+		++l;
+	return l;
+#endif
+}
+
+static inline int size_class(size_t sz)
+{
+	if (sz <= 128)
+		return (sz == 0 ? 0 : (int)((sz - 1) >> 4));
+	const size_t s = sz - 1;
+	const int lg = floor_log2(s);
+	return 8 + (lg - 7) * 8
+		+ (int)((s - ((size_t)1 << lg)) >> (lg - 3));
+}
+
+static inline size_t class_size(int c)
+{
+	if (c < 8)
+		return 16 * (size_t)(c + 1);
+	const int lg = 7 + (c - 8) / 8;
+	const size_t k = (size_t)((c - 8) % 8 + 1);
+	return ((size_t)1 << lg) + (k << (lg - 3));
+}
+
+/* List maintenance */
+
+static void link_all(slaballoc* S, slab* s)
+{
+	s->all_prev = NULL;
+	s->all_next = S->all;
+	if (S->all)
+		S->all->all_prev = s;
+	S->all = s;
+}
+
+static void unlink_all(slaballoc* S, slab* s)
+{
+	if (s->all_prev)
+		s->all_prev->all_next = s->all_next;
+	else
+		S->all = s->all_next;
+	if (s->all_next)
+		s->all_next->all_prev = s->all_prev;
+}
+
+static void list_partial(slaballoc* S, slab* s)
+{
+	slab** head = &S->partial[s->cls];
+	s->prev = NULL;
+	s->next = *head;
+	if (*head)
+		(*head)->prev = s;
+	*head = s;
+	s->listed = 1;
+}
+
+static void unlist_partial(slaballoc* S, slab* s)
+{
+	if (s->prev)
+		s->prev->next = s->next;
+	else
+		S->partial[s->cls] = s->next;
+	if (s->next)
+		s->next->prev = s->prev;
+	s->listed = 0;
+}
+
+/* Slabs */
+
+static slab* new_slab(slaballoc* S, int c, int* err)
+{
+	slab* s = S->spare;
+	if (s) {
+		S->spare = s->next;
+		--S->nspare;
+	} else {
+		char* mem;
+		mem_AlignedAlloc(CSNIP_SLABALLOC_SLAB_SZ,
+			CSNIP_SLABALLOC_SLAB_SZ, mem, *err);
+		if (mem == NULL)
+			return NULL;
+		s = (slab*)mem;
+	}
+	s->owner = S;
+	s->obj_sz = class_size(c);
+	s->free = NULL;
+	s->bump = (char*)s + HDR_SZ;
+	s->end = (char*)s + CSNIP_SLABALLOC_SLAB_SZ;
+	s->nlive = 0;
+	s->cls = c;
+	link_all(S, s);
+	list_partial(S, s);
+	return s;
+}
+
+static void release_slab(slaballoc* S, slab* s)
+{
+	if (s->listed)
+		unlist_partial(S, s);
+	unlink_all(S, s);
+	if (S->nspare < CSNIP_SLABALLOC_KEEP) {
+		s->next = S->spare;
+		S->spare = s;
+		++S->nspare;
+	} else {
+		mem_aligned_free(s);
+	}
+}
+
+static void* alloc_large(slaballoc* S, size_t sz, int* err)
+{
+	if (sz > SIZE_MAX - HDR_SZ) {
+		csnip_err_Raise(csnip_err_NOMEM, *err);
+		return NULL;
+	}
+	char* mem;
+	mem_AlignedAlloc(HDR_SZ + sz, CSNIP_SLABALLOC_SLAB_SZ, mem, *err);
+	if (mem == NULL)
+		return NULL;
+	slab* s = (slab*)mem;
+	s->owner = S;
+	s->obj_sz = sz;
+	s->nlive = 1;
+	s->cls = -1;
+	s->listed = 0;
+	link_all(S, s);
+	return mem + HDR_SZ;
+}
+
+/* Interface */
+
+slaballoc* csnip_slaballoc_make(int* err)
+{
+	if (err) *err = 0;
+	slaballoc* S;
+	mem_Alloc(1, S, *err);
+	if (err && *err)
+		return NULL;
+	for (int c = 0; c < CSNIP_SLABALLOC_NCLASS; ++c)
+		S->partial[c] = NULL;
+	S->all = NULL;
+	S->spare = NULL;
+	S->nspare = 0;
+	return S;
+}
+
+void csnip_slaballoc_free(slaballoc* S)
+{
+	while (S->all) {
+		slab* s = S->all;
+		S->all = s->all_next;
+		mem_aligned_free(s);
+	}
+	while (S->spare) {
+		slab* s = S->spare;
+		S->spare = s->next;
+		mem_aligned_free(s);
+	}
+	mem_Free(S);
+}
+
+void* csnip_slaballoc_alloc_item(slaballoc* S, size_t sz, int* err)
+{
+	if (err) *err = 0;
+	if (sz > CSNIP_SLABALLOC_MAX_SMALL)
+		return alloc_large(S, sz, err);
+
+	const int c = size_class(sz);
+	slab* s = S->partial[c];
+	if (s == NULL) {
+		s = new_slab(S, c, err);
+		if (s == NULL)
+			return NULL;
+	}
+
+	void* p;
+	if (s->free) {
+		p = s->free;
+		s->free = *(void**)p;
+	} else {
+		p = s->bump;
+		s->bump += s->obj_sz;
+	}
+	++s->nlive;
+	if (s->free == NULL && (size_t)(s->end - s->bump) < s->obj_sz)
+		unlist_partial(S, s);
+	return p;
+}
+
+void csnip_slaballoc_free_item(slaballoc* S, void* p)
+{
+	if (p == NULL)
+		return;
+	slab* s = slab_of(p);
+	assert(s->owner == S);
+	if (s->cls < 0) {
+		unlink_all(S, s);
+		mem_aligned_free(s);
+		return;
+	}
+
+	*(void**)p = s->free;
+	s->free = p;
+	if (!s->listed)
+		list_partial(S, s);
+	if (--s->nlive == 0 && (s->prev || s->next)) {
+		/* Keep the last slab of the class, to avoid releasing and
+		 * reallocating it when a burst of objects comes and goes */
+		release_slab(S, s);
+	}
+}
+
+size_t csnip_slaballoc_usable_size(const void* p)
+{
+	return slab_of(p)->obj_sz;
+}
+
+size_t csnip_slaballoc_good_size(size_t sz)
+{
+	if (sz > CSNIP_SLABALLOC_MAX_SMALL)
+		return sz;
+	return class_size(size_class(sz));
+}
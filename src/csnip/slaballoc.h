@@ -0,0 +1,128 @@
+#ifndef CSNIP_SLABALLOC_H
+#define CSNIP_SLABALLOC_H
+
+/**	@file slaballoc.h
+ *	@brief			Size class slab allocator
+ *	@defgroup slaballoc	Size class slab allocator
+ *	@{
+ *
+ *	@brief Allocator for small objects of varying sizes.
+ *
+ *	Requests are rounded up to one of a set of size classes, and
+ *	each class is served from its own slabs, in the manner of
+ *	mempool.h.  The classes are the multiples of 16 bytes up to 128
+ *	bytes, and from there on 8 classes per power of two, i.e., steps
+ *	of at most 12.5%, up to CSNIP_SLABALLOC_MAX_SMALL.  Larger
+ *	requests get a block of their own.
+ *
+ *	Slabs are CSNIP_SLABALLOC_SLAB_SZ bytes large and aligned to
+ *	their size, and start with a header describing the slab.  An
+ *	object is freed by locating the header from the object address,
+ *	so csnip_slaballoc_free_item() needs no size argument.  Both
+ *	allocation and release take constant time.  Objects are carved
+ *	from a slab only when needed, so that the memory of a partially
+ *	used slab is not touched beyond its high water mark.
+ *
+ *	A slab whose objects are all freed is returned to the system,
+ *	unless it is the last slab of its class, or one of the
+ *	CSNIP_SLABALLOC_KEEP empty slabs kept for any class.  This avoids
+ *	allocating and releasing slabs over and over when objects are
+ *	allocated and freed in bursts.
+ *
+ *	The allocator is not thread safe; for concurrent use of fixed
+ *	size objects, see ccmempool.h.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**	Slab size and alignment, in bytes.  A power of two. */
+#define CSNIP_SLABALLOC_SLAB_SZ		(256 * 1024)
+
+/**	Largest size served from slabs. */
+#define CSNIP_SLABALLOC_MAX_SMALL	(32 * 1024)
+
+/**	Number of size classes. */
+#define CSNIP_SLABALLOC_NCLASS		72
+
+/**	Number of empty slabs kept for reuse. */
+#define CSNIP_SLABALLOC_KEEP		4
+
+/**	Slab allocator.
+ *
+ *	Opaque type.
+ */
+typedef struct csnip_slaballoc_s csnip_slaballoc;
+
+/**	Create an allocator. */
+csnip_slaballoc* csnip_slaballoc_make(int* err);
+
+/**	Free an allocator.
+ *
+ *	This releases all memory of the allocator, including the objects
+ *	still allocated.
+ */
+void csnip_slaballoc_free(csnip_slaballoc* S);
+
+/**	Allocate an object.
+ *
+ *	The object is aligned to 16 bytes.
+ *
+ *	@param	S
+ *		The allocator.
+ *
+ *	@param	sz
+ *		Size in bytes.
+ *
+ *	@param	err
+ *		Error return.
+ *
+ *	@return	The object, or NULL on error.
+ */
+void* csnip_slaballoc_alloc_item(csnip_slaballoc* S, size_t sz, int* err);
+
+/**	Free an object.
+ *
+ *	@param	S
+ *		The allocator the object was allocated from.
+ *
+ *	@param	p
+ *		The object, or NULL.
+ */
+void csnip_slaballoc_free_item(csnip_slaballoc* S, void* p);
+
+/**	Usable size of an object.
+ *
+ *	The size of the size class of the object, which may exceed the
+ *	size requested.
+ */
+size_t csnip_slaballoc_usable_size(const void* p);
+
+/**	Size actually allocated for a request.
+ *
+ *	The size class of a request of @a sz bytes, or @a sz for large
+ *	requests.
+ */
+size_t csnip_slaballoc_good_size(size_t sz);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+
+#endif /* CSNIP_SLABALLOC_H */
+
+#if defined(CSNIP_SHORT_NAMES) && !defined(CSNIP_SLABALLOC_HAVE_SHORT_NAMES)
+#define slaballoc			csnip_slaballoc
+#define slaballoc_make			csnip_slaballoc_make
+#define slaballoc_free			csnip_slaballoc_free
+#define slaballoc_alloc_item		csnip_slaballoc_alloc_item
+#define slaballoc_free_item		csnip_slaballoc_free_item
+#define slaballoc_usable_size		csnip_slaballoc_usable_size
+#define slaballoc_good_size		csnip_slaballoc_good_size
+#define CSNIP_SLABALLOC_HAVE_SHORT_NAMES
+#endif /* CSNIP_SHORT_NAMES && !CSNIP_SLABALLOC_HAVE_SHORT_NAMES */
@@ -0,0 +1,492 @@
+#ifndef CSNIP_SPACESAVING_H
+#define CSNIP_SPACESAVING_H
+
+/**	@file spacesaving.h
+ *	@brief			Heavy hitters with the Space-Saving algorithm
+ *	@defgroup spacesaving	Heavy hitters with the Space-Saving algorithm
+ *	@{
+ *
+ *	@brief Track the most frequent keys of a stream in bounded memory.
+ *
+ *	The Space-Saving algorithm (Metwally, Agrawal and El Abbadi)
+ *	monitors at most k keys with a counter each.  When a key that is
+ *	not monitored arrives and all counters are in use, the key with
+ *	the smallest count is evicted, and the new key takes over its
+ *	counter, inheriting the count as its error bound.  Thus, for
+ *	each monitored key, the counter overestimates the true count
+ *	by at most its error err, and err is at most total / k, where
+ *	total is the sum of all weights offered.  Every key with a true
+ *	count above total / k is guaranteed to be monitored.
+ *
+ *	The counters are kept in the "stream summary" structure:  a
+ *	doubly linked list of buckets in ascending order of count, each
+ *	holding the doubly linked list of counters with that count (see
+ *	list.h).  An offer with weight 1 moves a counter to the next
+ *	bucket, or to a new bucket after it, in O(1) time; larger
+ *	weights walk the buckets from there.  The minimum counter to
+ *	evict is the head of the first bucket.  An lphash_table
+ *	(lphash_table.h) maps keys to their counters; it is defined by
+ *	the user, with the key type and hash function of the summary,
+ *	and pointers to counters as entries.
+ *
+ *	Summaries can be merged, e.g., to combine per-thread summaries;
+ *	the result monitors at most k keys and keeps the error
+ *	guarantees, with respect to the total of both streams.
+ *
+ *	Example:
+ *	@code{.c}
+ *	CSNIP_LPHASH_TABLE_DEF_TYPE(topk_index, struct topk_counter*)
+ *	CSNIP_SPACESAVING_DEF_TYPE(topk, uint64_t, struct topk_index)
+ *
+ *	CSNIP_LPHASH_TABLE_DEF_FUNCS(static, topk_index_, uint64_t,
+ *		struct topk_counter*, struct topk_index,
+ *		k1, k2, e, csnip_hash_fmix64(k1), k1 == k2, e->key)
+ *	CSNIP_SPACESAVING_DEF_FUNCS(static, topk_, uint64_t,
+ *		struct topk, struct topk_counter, struct topk_bucket,
+ *		topk_index_)
+ *	@endcode
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <csnip/err.h>
+#include <csnip/list.h>
+#include <csnip/mem.h>
+#include <csnip/sort.h>
+#include <csnip/util.h>
+
+/**	Define the summary types.
+ *
+ *	Defines struct struct_sstype, and the types struct
+ *	struct_sstype_counter and struct struct_sstype_bucket of its
+ *	counters and buckets.  The counter type has the public members
+ *
+ *		* `key`:  the monitored key;
+ *		* `count`:  the estimated count of the key, which is at
+ *		  least the true count;
+ *		* `err`:  the maximum overestimate, i.e., the true count
+ *		  is at least `count - err`.
+ *
+ *	@param	struct_sstype
+ *		Name of the summary struct to be defined.
+ *
+ *	@param	keytype
+ *		Type of the keys.
+ *
+ *	@param	idxtype
+ *		Type of the key index, an lphash_table with entries of
+ *		type `struct struct_sstype_counter*`.
+ */
+#define CSNIP_SPACESAVING_DEF_TYPE(struct_sstype, keytype, idxtype) \
+	struct struct_sstype##_bucket; \
+	struct struct_sstype##_counter { \
+		keytype key;		/* Monitored key */ \
+		uint64_t count;		/* Estimated count */ \
+		uint64_t err;		/* Maximum overestimate */ \
+		struct struct_sstype##_bucket* bucket; \
+		struct struct_sstype##_counter* prev; \
+		struct struct_sstype##_counter* next; \
+	}; \
+	struct struct_sstype##_bucket { \
+		uint64_t count;		/* Count of the counters */ \
+		struct struct_sstype##_counter* head; \
+		struct struct_sstype##_counter* tail; \
+		struct struct_sstype##_bucket* prev; \
+		struct struct_sstype##_bucket* next; \
+	}; \
+	struct struct_sstype { \
+		size_t k;		/* Number of counters */ \
+		size_t size;		/* Counters in use */ \
+		uint64_t total;		/* Sum of the weights */ \
+		struct struct_sstype##_counter* counter; \
+		struct struct_sstype##_bucket* bucket; \
+		struct struct_sstype##_bucket* bmin; /* Bucket list */ \
+		struct struct_sstype##_bucket* bmax; \
+		struct struct_sstype##_bucket* bfree; /* Unused buckets */ \
+		struct struct_sstype##_bucket* bfree_tail; \
+		idxtype* index;		/* Key -> counter */ \
+	};
+
+/**	Declare summary functions.
+ *
+ *	@sa CSNIP_SPACESAVING_DEF_FUNCS()
+ */
+#define CSNIP_SPACESAVING_DECL_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				sstype, \
+				countertype) \
+	scope sstype* prefix##make(size_t k, int* err); \
+	scope void prefix##free(sstype* S); \
+	scope void prefix##clear(sstype* S); \
+	scope const countertype* prefix##offer( \
+			sstype* S, \
+			int* err, \
+			keytype key, \
+			uint64_t w); \
+	scope const countertype* prefix##find( \
+			const sstype* S, \
+			keytype key); \
+	scope size_t prefix##topk( \
+			const sstype* S, \
+			countertype* out, \
+			size_t n); \
+	scope void prefix##merge( \
+			sstype* into, \
+			int* err, \
+			const sstype* other); \
+	scope size_t prefix##size(const sstype* S); \
+	scope size_t prefix##capacity(const sstype* S); \
+	scope uint64_t prefix##total(const sstype* S); \
+	scope uint64_t prefix##min_count(const sstype* S);
+
+/**	Define summary functions.
+ *
+ *	@param	scope
+ *		scope of function declarations.
+ *
+ *	@param	prefix
+ *		function name prefix to add to generated functions.
+ *
+ *	@param	keytype
+ *		the type of the keys.
+ *
+ *	@param	sstype
+ *		the summary type, as defined with
+ *		CSNIP_SPACESAVING_DEF_TYPE().
+ *
+ *	@param	countertype, buckettype
+ *		the counter and bucket types defined with the summary
+ *		type.
+ *
+ *	@param	idxprefix
+ *		function name prefix of the key index, whose functions
+ *		are generated with CSNIP_LPHASH_TABLE_DEF_FUNCS().
+ *
+ *	The following functions will be generated:
+ *
+ *	Creation and destruction:
+ *		* `make`:  `sstype* make(size_t k, int* err);`  Create
+ *		  an empty summary with k counters.  k = 0 raises
+ *		  csnip_err_INVAL.
+ *		* `free`:  `void free(sstype* S);`
+ *		* `clear`:  `void clear(sstype* S);`  Remove all keys.
+ *
+ *	Updates:
+ *		* `offer`:  `const countertype* offer(sstype* S, int*
+ *		  err, keytype key, uint64_t w);`  Add weight w to the
+ *		  count of the key, evicting the minimum key if the key
+ *		  was not monitored and all counters are in use.
+ *		  Returns the counter of the key, which is valid until
+ *		  the next update.
+ *		* `merge`:  `void merge(sstype* into, int* err, const
+ *		  sstype* other);`  Make @a into the summary of both
+ *		  streams.  Keys missing from one summary are assumed to
+ *		  have the minimum count of that summary there, which
+ *		  is added to their count and error bound.  Of the
+ *		  combined keys, the k with the highest counts are kept.
+ *		  Needs temporary memory, and can therefore raise
+ *		  csnip_err_NOMEM.
+ *
+ *	Queries:
+ *		* `find`:  `const countertype* find(const sstype* S,
+ *		  keytype key);`  Return the counter of the key, or NULL
+ *		  if it is not monitored, in which case its true count
+ *		  is at most `min_count(S)`.
+ *		* `topk`:  `size_t topk(const sstype* S, countertype*
+ *		  out, size_t n);`  Copy the counters of the up to n
+ *		  keys with the highest counts to @a out, in descending
+ *		  order of count, and return their number.  Only the
+ *		  members key, count and err of the copies are
+ *		  meaningful.  Key `out[i].key` is guaranteed to be
+ *		  among the n most frequent keys if `out[i].count -
+ *		  out[i].err` is at least the count of the first key
+ *		  not returned, or `min_count(S)` if all were returned.
+ *		* `size`:  Number of monitored keys.
+ *		* `capacity`:  Number of counters, k.
+ *		* `total`:  Sum of all weights offered.
+ *		* `min_count`:  The smallest count if all counters are
+ *		  in use, else 0.  This bounds the true count of keys
+ *		  that are not monitored, and is at most total / k.
+ */
+#define CSNIP_SPACESAVING_DEF_FUNCS(scope, \
+				prefix, \
+				keytype, \
+				sstype, \
+				countertype, \
+				buckettype, \
+				idxprefix) \
+	\
+	/* Declare functions in case they weren't yet. */ \
+	CSNIP_SPACESAVING_DECL_FUNCS(scope, prefix, keytype, sstype, \
+	  countertype) \
+	\
+	/* Private methods */ \
+	\
+	/* Remove counter c from its bucket, and free the bucket if it
+	 * becomes empty.  Returns the last bucket with a count below
+	 * the one of c, or NULL.
+	 */ \
+	static buckettype* prefix##_internal_detach(sstype* S, \
+						countertype* c) \
+	{ \
+		buckettype* b_ = c->bucket; \
+		csnip_dlist_Remove(b_->head, b_->tail, prev, next, c); \
+		if (b_->head != NULL) \
+			return b_; \
+		buckettype* p_ = b_->prev; \
+		csnip_dlist_Remove(S->bmin, S->bmax, prev, next, b_); \
+		csnip_dlist_PushHead(S->bfree, S->bfree_tail, \
+					prev, next, b_); \
+		return p_; \
+	} \
+	\
+	/* Put counter c into the bucket for its count, searching the
+	 * bucket list upwards after bucket after_, which has a smaller
+	 * count, or from the start if after_ is NULL.
+	 */ \
+	static void prefix##_internal_attach(sstype* S, \
+						countertype* c, \
+						buckettype* after_) \
+	{ \
+		buckettype* b_ = (after_ ? after_->next : S->bmin); \
+		while (b_ && b_->count < c->count) { \
+			after_ = b_; \
+			b_ = b_->next; \
+		} \
+		if (b_ == NULL || b_->count != c->count) { \
+			b_ = S->bfree; \
+			csnip_dlist_PopHead(S->bfree, S->bfree_tail, \
+						prev, next); \
+			b_->count = c->count; \
+			csnip_dlist_Init(b_->head, b_->tail, prev, next); \
+			csnip_dlist_InsertAfter(S->bmin, S->bmax, \
+						prev, next, after_, b_); \
+		} \
+		csnip_dlist_PushTail(b_->head, b_->tail, prev, next, c); \
+		c->bucket = b_; \
+	} \
+	\
+	/* Take the next unused counter for key, with the given count
+	 * and error, and put it into the index and the bucket list.
+	 */ \
+	static countertype* prefix##_internal_newcounter(sstype* S, \
+						int* err, \
+						keytype key, \
+						uint64_t count_, \
+						uint64_t err_, \
+						buckettype* after_) \
+	{ \
+		countertype* c_ = &S->counter[S->size]; \
+		c_->key = key; \
+		c_->count = count_; \
+		c_->err = err_; \
+		idxprefix##insert(S->index, err, c_); \
+		if (err && *err) \
+			return NULL; \
+		++S->size; \
+		prefix##_internal_attach(S, c_, after_); \
+		return c_; \
+	} \
+	\
+	/* Creation and destruction */ \
+	scope sstype* prefix##make(size_t k, int* err) \
+	{ \
+		if (err) *err = 0; \
+		\
+		if (k == 0) { \
+			csnip_err_Raise(csnip_err_INVAL, *err); \
+			return NULL; \
+		} \
+		sstype* S; \
+		csnip_mem_Alloc(1, S, *err); \
+		if (err && *err) \
+			return NULL; \
+		S->k = k; \
+		S->counter = NULL; \
+		S->bucket = NULL; \
+		S->index = NULL; \
+		csnip_mem_Alloc(k, S->counter, *err); \
+		if (err && *err) \
+			goto fail; \
+		csnip_mem_Alloc(k, S->bucket, *err); \
+		if (err && *err) \
+			goto fail; \
+		S->index = idxprefix##make_with_cap(err, k); \
+		if (err && *err) \
+			goto fail; \
+		S->size = 0; \
+		prefix##clear(S); \
+		return S; \
+	fail: \
+		csnip_mem_Free(S->counter); \
+		csnip_mem_Free(S->bucket); \
+		csnip_mem_Free(S); \
+		return NULL; \
+	} \
+	\
+	scope void prefix##free(sstype* S) \
+	{ \
+		idxprefix##free(S->index); \
+		csnip_mem_Free(S->counter); \
+		csnip_mem_Free(S->bucket); \
+		csnip_mem_Free(S); \
+	} \
+	\
+	scope void prefix##clear(sstype* S) \
+	{ \
+		for (size_t i = 0; i < S->size; ++i) \
+			idxprefix##remove(S->index, NULL, S->counter[i].key); \
+		S->size = 0; \
+		S->total = 0; \
+		csnip_dlist_Init(S->bmin, S->bmax, prev, next); \
+		csnip_dlist_Init(S->bfree, S->bfree_tail, prev, next); \
+		for (size_t i = 0; i < S->k; ++i) { \
+			csnip_dlist_PushTail(S->bfree, S->bfree_tail, \
+						prev, next, &S->bucket[i]); \
+		} \
+	} \
+	\
+	/* Updates */ \
+	scope const countertype* prefix##offer(sstype* S, \
+						int* err, \
+						keytype key, \
+						uint64_t w) \
+	{ \
+		if (err) *err = 0; \
+		\
+		if (w == 0) \
+			return prefix##find(S, key); \
+		S->total += w; \
+		countertype** e_ = idxprefix##find(S->index, key); \
+		if (e_ != NULL) { \
+			countertype* c_ = *e_; \
+			buckettype* after_ = prefix##_internal_detach(S, c_); \
+			c_->count += w; \
+			prefix##_internal_attach(S, c_, after_); \
+			return c_; \
+		} \
+		if (S->size < S->k) { \
+			return prefix##_internal_newcounter(S, err, \
+						key, w, 0, NULL); \
+		} \
+		\
+		/* Evict the minimum */ \
+		countertype* c_ = S->bmin->head; \
+		const uint64_t min_ = c_->count; \
+		idxprefix##remove(S->index, err, c_->key); \
+		if (err && *err) \
+			return NULL; \
+		buckettype* after_ = prefix##_internal_detach(S, c_); \
+		c_->key = key; \
+		c_->count = min_ + w; \
+		c_->err = min_; \
+		idxprefix##insert(S->index, err, c_); \
+		if (err && *err) \
+			return NULL; \
+		prefix##_internal_attach(S, c_, after_); \
+		return c_; \
+	} \
+	\
+	scope void prefix##merge(sstype* into, \
+				int* err, \
+				const sstype* other) \
+	{ \
+		if (err) *err = 0; \
+		\
+		const uint64_t min_i = prefix##min_count(into); \
+		const uint64_t min_o = prefix##min_count(other); \
+		const size_t n_ = into->size + other->size; \
+		if (n_ == 0) \
+			return; \
+		countertype* tmp_; \
+		csnip_mem_Alloc(n_, tmp_, *err); \
+		if (err && *err) \
+			return; \
+		\
+		/* Combine the counters */ \
+		size_t m_ = 0; \
+		for (size_t i = 0; i < into->size; ++i) { \
+			tmp_[m_] = into->counter[i]; \
+			const countertype* o_ = \
+				prefix##find(other, tmp_[m_].key); \
+			tmp_[m_].count += (o_ ? o_->count : min_o); \
+			tmp_[m_].err += (o_ ? o_->err : min_o); \
+			++m_; \
+		} \
+		for (size_t i = 0; i < other->size; ++i) { \
+			if (prefix##find(into, other->counter[i].key)) \
+				continue; \
+			tmp_[m_] = other->counter[i]; \
+			tmp_[m_].count += min_i; \
+			tmp_[m_].err += min_i; \
+			++m_; \
+		} \
+		csnip_Qsort(u_, v_, \
+			tmp_[u_].count > tmp_[v_].count, \
+			csnip_Tswap(countertype, tmp_[u_], tmp_[v_]), \
+			m_); \
+		\
+		/* Rebuild with the k largest, in ascending order */ \
+		const uint64_t total_ = into->total + other->total; \
+		prefix##clear(into); \
+		into->total = total_; \
+		size_t i = (m_ < into->k ? m_ : into->k); \
+		while (i-- > 0) { \
+			buckettype* after_ = into->bmax; \
+			if (after_ && after_->count == tmp_[i].count) \
+				after_ = after_->prev; \
+			prefix##_internal_newcounter(into, err, tmp_[i].key, \
+				tmp_[i].count, tmp_[i].err, after_); \
+			if (err && *err) \
+				break; \
+		} \
+		csnip_mem_Free(tmp_); \
+	} \
+	\
+	/* Queries */ \
+	scope const countertype* prefix##find(const sstype* S, \
+						keytype key) \
+	{ \
+		countertype** e_ = idxprefix##find(S->index, key); \
+		return (e_ ? *e_ : NULL); \
+	} \
+	\
+	scope size_t prefix##topk(const sstype* S, \
+				countertype* out, \
+				size_t n) \
+	{ \
+		size_t i = 0; \
+		const buckettype* b_ = S->bmax; \
+		for (; b_ && i < n; b_ = b_->prev) { \
+			const countertype* c_ = b_->head; \
+			for (; c_ && i < n; c_ = c_->next) \
+				out[i++] = *c_; \
+		} \
+		return i; \
+	} \
+	\
+	scope size_t prefix##size(const sstype* S) \
+	{ \
+		return S->size; \
+	} \
+	\
+	scope size_t prefix##capacity(const sstype* S) \
+	{ \
+		return S->k; \
+	} \
+	\
+	scope uint64_t prefix##total(const sstype* S) \
+	{ \
+		return S->total; \
+	} \
+	\
+	scope uint64_t prefix##min_count(const sstype* S) \
+	{ \
+		return (S->size < S->k ? 0 : S->bmin->count); \
+	}
+
+/** @} */
+
+#endif /* CSNIP_SPACESAVING_H */
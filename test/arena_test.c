@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <csnip/arena.h>
+#include <csnip/cext.h>
+
+/*  Test for the arena allocator.
+ *
+ *  Checks alignment and disjointness of allocations across chunk
+ *  boundaries, that mark/reset releases exactly the later
+ *  allocations and that the released chunks are reused, in place
+ *  resizing of the most recent allocation, the arena with reserved
+ *  address space, typed allocation of over-aligned types, and the
+ *  adaptors for dynamic arrays and linear probing hash tables.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+/* Arena backed arrays */
+CSNIP_ARENA_ARRT_DEF_TYPE(IntArray, int)
+CSNIP_ARENA_ARRT_DEF_FUNCS(csnip_cext_unused static, IntArray_,
+	IntArray, int)
+
+/* Arena backed hash table */
+static csnip_arena* tbl_arena;
+#define CSNIP_LPHASH_TABLE_ALLOC(nMember, ptr, err) \
+	csnip_arena_Alloc(tbl_arena, nMember, ptr, err)
+#define CSNIP_LPHASH_TABLE_FREE(ptr)	((void)0)
+#include <csnip/lphash_table.h>
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(u64tbl, uint64_t)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(csnip_cext_unused static, tbl_,
+	uint64_t, uint64_t, struct u64tbl,
+	k1, k2, e, (size_t)(k1 * 0x9e3779b97f4a7c15ull), k1 == k2, e)
+
+/* Allocate n blocks of pseudo-random sizes and alignments, fill them,
+ * and check that they are intact */
+static void fill_check(csnip_arena* A, size_t n, unsigned seed)
+{
+	char** p = malloc(n * sizeof(char*));
+	size_t* sz = malloc(n * sizeof(size_t));
+	always_assert(p && sz);
+	uint32_t r = seed;
+	for (size_t i = 0; i < n; ++i) {
+		r = r * 1664525u + 1013904223u;
+		const size_t align = (size_t)1 << (r >> 29);
+		sz[i] = (r >> 8) % 300;
+		p[i] = csnip_arena_alloc(A, align, sz[i], NULL);
+		always_assert(((uintptr_t)p[i] & (align - 1)) == 0);
+		memset(p[i], (int)(i & 0xff), sz[i]);
+	}
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; j < sz[i]; ++j)
+			always_assert((unsigned char)p[i][j] == (i & 0xff));
+	}
+	free(sz);
+	free(p);
+}
+
+static _Bool basic_test(csnip_arena* A)
+{
+	fill_check(A, 10000, 1);
+
+	/* Typed allocation, and an allocation larger than a chunk */
+	double* d;
+	csnip_arena_Alloc(A, 3, d, _);
+	always_assert(((uintptr_t)d & (sizeof(double) - 1)) == 0);
+	char* big;
+	csnip_arena_Alloc(A, 4 * CSNIP_ARENA_CHUNK_SZ, big, _);
+	memset(big, 1, 4 * CSNIP_ARENA_CHUNK_SZ);
+	int err = 0;
+	char* huge;
+	csnip_arena_Alloc(A, SIZE_MAX, huge, err);
+	always_assert(err != 0);
+	(void)huge;
+	return 1;
+}
+
+static _Bool mark_test(csnip_arena* A)
+{
+	csnip_arena_reset(A);
+	int* x;
+	csnip_arena_Alloc(A, 10, x, _);
+	for (int i = 0; i < 10; ++i)
+		x[i] = i;
+
+	/* Allocations after the mark are released, those before stay */
+	const csnip_arena_mark m = csnip_arena_get_mark(A);
+	char* first = csnip_arena_alloc(A, 1, 100, NULL);
+	fill_check(A, 5000, 2);
+	csnip_arena_reset_to_mark(A, m);
+	char* again = csnip_arena_alloc(A, 1, 100, NULL);
+	always_assert(again == first);
+	for (int i = 0; i < 10; ++i)
+		always_assert(x[i] == i);
+
+	/* After a full reset, the chunks are reused */
+	csnip_arena_reset(A);
+	int* y;
+	csnip_arena_Alloc(A, 10, y, _);
+	always_assert(y == x);
+	fill_check(A, 5000, 3);
+	return 1;
+}
+
+static _Bool realloc_test(csnip_arena* A)
+{
+	csnip_arena_reset(A);
+	int* a = NULL;
+	size_t n = 0;
+	for (size_t cap = 1; cap <= 4096; cap *= 2) {
+		const _Bool fits = a
+			&& (size_t)(A->end - (char*)a) >= cap * sizeof(int);
+		int* b = a;
+		csnip_arena_Realloc(A, n, cap, b, _);
+		if (fits)
+			always_assert(b == a);
+		a = b;
+		for (size_t i = n; i < cap; ++i)
+			a[i] = (int)i;
+		n = cap;
+	}
+	for (size_t i = 0; i < n; ++i)
+		always_assert(a[i] == (int)i);
+
+	/* Not the most recent allocation:  moved */
+	int* c = csnip_arena_alloc(A, sizeof(int), sizeof(int), NULL);
+	int* b = a;
+	csnip_arena_Realloc(A, n, 2 * n, b, _);
+	always_assert(b != a && b != c);
+	for (size_t i = 0; i < n; ++i)
+		always_assert(b[i] == (int)i);
+	return 1;
+}
+
+static _Bool arr_test(csnip_arena* A)
+{
+	csnip_arena_reset(A);
+	IntArray X = { .arena = A };
+	IntArray_init(&X, NULL, 0);
+	for (int i = 0; i < 1000; ++i)
+		IntArray_push(&X, NULL, i);
+	IntArray_insert_at(&X, NULL, 0, -1);
+	IntArray_pop(&X, NULL);
+	always_assert(X.n == 1000);
+	always_assert(X.a[0] == -1);
+	for (int i = 1; i < 1000; ++i)
+		always_assert(X.a[i] == i - 1);
+	IntArray_deinit(&X, NULL);
+	always_assert(X.a == NULL && X.n == 0);
+
+	/* The macro interface */
+	double* d;
+	size_t n, cap;
+	csnip_arena_arr_Init(A, d, n, cap, 4, _);
+	for (int i = 0; i < 100; ++i)
+		csnip_arena_arr_Push(A, d, n, cap, 0.5 * i, _);
+	always_assert(n == 100 && cap >= 100);
+	for (int i = 0; i < 100; ++i)
+		always_assert(d[i] == 0.5 * i);
+	return 1;
+}
+
+static _Bool table_test(csnip_arena* A)
+{
+	csnip_arena_reset(A);
+	tbl_arena = A;
+	struct u64tbl* T = tbl_make(NULL);
+	for (uint64_t i = 0; i < 20000; ++i)
+		always_assert(tbl_insert(T, NULL, 3 * i) == 1);
+	for (uint64_t i = 0; i < 60000; ++i) {
+		const _Bool present = (i % 3 == 0);
+		always_assert((tbl_find(T, i) != NULL) == present);
+	}
+	tbl_free(T);
+	return 1;
+}
+
+static _Bool run_tests(const char* name, csnip_arena* A)
+{
+	printf("%s arena\n", name);
+	always_assert(A != NULL);
+	always_assert(basic_test(A));
+	always_assert(mark_test(A));
+	always_assert(realloc_test(A));
+	always_assert(arr_test(A));
+	always_assert(table_test(A));
+	csnip_arena_free(A);
+	return 1;
+}
+
+static _Bool reserved_limit_test(void)
+{
+	printf("Reserved arena limit\n");
+	csnip_arena* A = csnip_arena_make_reserved(1 << 20, NULL);
+	always_assert(A != NULL);
+	if (A->vbase == NULL) {
+		puts(" no reserved address space, skipped");
+		csnip_arena_free(A);
+		return 1;
+	}
+	char* p = csnip_arena_alloc(A, 1, 1 << 20, NULL);
+	memset(p, 1, 1 << 20);
+	int err = 0;
+	always_assert(csnip_arena_alloc(A, 1, 1, &err) == NULL);
+	always_assert(err == csnip_err_NOMEM);
+
+	/* Contiguous after a reset */
+	csnip_arena_reset(A);
+	char* q = csnip_arena_alloc(A, 1, 1000, NULL);
+	always_assert(q == p);
+	always_assert(csnip_arena_alloc(A, 1, 1000, NULL) == q + 1000);
+	csnip_arena_free(A);
+	return 1;
+}
+
+/* Cache line aligned element type */
+struct line { _Alignas(64) char c[64]; };
+
+static _Bool typed_alloc_test(void)
+{
+	printf("Typed allocation\n");
+	csnip_arena* A = csnip_arena_make(256, NULL);
+	always_assert(A != NULL);
+	for (int i = 0; i < 20; ++i) {
+		char* c;
+		csnip_arena_Alloc(A, 1, c, _);
+		struct line* l;
+		csnip_arena_Alloc(A, 3, l, _);
+		always_assert(((uintptr_t)l & 63) == 0);
+		csnip_arena_Realloc(A, 3, 5, l, _);
+		always_assert(((uintptr_t)l & 63) == 0);
+	}
+
+	/* Overflowing member count */
+	int err = 0;
+	always_assert(csnip_arena_alloc_n(A, 1, SIZE_MAX / 2, 4, &err)
+			== NULL);
+	always_assert(err == csnip_err_RANGE);
+	csnip_arena_free(A);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(run_tests("Chunked", csnip_arena_make(0, NULL)))
+	RUN_TEST(run_tests("Small chunk", csnip_arena_make(256, NULL)))
+	RUN_TEST(run_tests("Reserved",
+			csnip_arena_make_reserved(64 << 20, NULL)))
+	RUN_TEST(reserved_limit_test())
+	RUN_TEST(typed_alloc_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
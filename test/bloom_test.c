@@ -0,0 +1,213 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <csnip/bloom.h>
+#include <csnip/err.h>
+#include <csnip/hash.h>
+#include <csnip/mem.h>
+
+/*  Test for the Bloom filters.
+ *
+ *  For standard and blocked filters, it is checked that there are no
+ *  false negatives, that the false positive rate is close to the
+ *  requested one, and that the batched functions, union,
+ *  intersection and serialization give consistent results.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+/* Hash values of the keys; members are 0 .. n - 1 */
+static uint64_t key_hash(uint64_t i)
+{
+	return csnip_hash_fnv64_b(&i, sizeof(i), CSNIP_FNV64_INIT);
+}
+
+static _Bool fpr_test(int blocked, size_t n, double fpr)
+{
+	printf("%s filter: n = %zu, fpr = %g\n",
+		blocked ? "Blocked" : "Standard", n, fpr);
+	csnip_bloom* F = csnip_bloom_make_for(n, fpr, blocked, NULL);
+	printf(" %llu bits (%.1f per key), k = %d\n",
+		(unsigned long long)F->nbits,
+		(double)F->nbits / (double)n, F->k);
+	for (size_t i = 0; i < n; ++i)
+		csnip_bloom_add(F, key_hash(i));
+	for (size_t i = 0; i < n; ++i)
+		always_assert(csnip_bloom_test(F, key_hash(i)));
+
+	/* Measure false positives */
+	const size_t M = 200000;
+	size_t npos = 0;
+	for (size_t i = n; i < n + M; ++i)
+		npos += csnip_bloom_test(F, key_hash(i));
+	const double rate = (double)npos / (double)M;
+	printf(" measured fpr = %g, estimated = %g\n",
+		rate, csnip_bloom_fpr(F));
+	always_assert(rate < 1.5 * fpr);
+	always_assert(csnip_bloom_fpr(F) < 1.5 * fpr);
+	csnip_bloom_free(F);
+	return 1;
+}
+
+/* Sizing for rates below what the maximum k gives at optimal size */
+static _Bool small_fpr_test(size_t n, double fpr)
+{
+	printf("Standard filter sizing: n = %zu, fpr = %g\n", n, fpr);
+	csnip_bloom* F = csnip_bloom_make_for(n, fpr, 0, NULL);
+	const double dn = (double)n, m = (double)F->nbits;
+	const double pred = pow(1.0 - exp(-F->k * dn / m), F->k);
+	printf(" %llu bits (%.1f per key), k = %d, predicted fpr = %g\n",
+		(unsigned long long)F->nbits, m / dn, F->k, pred);
+	always_assert(F->k == CSNIP_BLOOM_MAX_K);
+	always_assert(pred <= fpr);
+
+	for (size_t i = 0; i < n; ++i)
+		csnip_bloom_add(F, key_hash(i));
+	always_assert(csnip_bloom_fpr(F) < 1.5 * fpr);
+	size_t npos = 0;
+	for (size_t i = n; i < n + 200000; ++i)
+		npos += csnip_bloom_test(F, key_hash(i));
+	always_assert(npos == 0);
+	csnip_bloom_free(F);
+	return 1;
+}
+
+static _Bool batch_test(int blocked, size_t n)
+{
+	printf("Batched operations: %s, n = %zu\n",
+		blocked ? "blocked" : "standard", n);
+	uint64_t* h;
+	_Bool* out;
+	csnip_mem_Alloc(2 * n, h, _);
+	csnip_mem_Alloc(2 * n, out, _);
+	for (size_t i = 0; i < 2 * n; ++i)
+		h[i] = key_hash(i);
+
+	csnip_bloom* F = csnip_bloom_make_for(n, 0.01, blocked, NULL);
+	csnip_bloom* G = csnip_bloom_make_for(n, 0.01, blocked, NULL);
+	csnip_bloom_add_many(F, h, n);
+	for (size_t i = 0; i < n; ++i)
+		csnip_bloom_add(G, h[i]);
+	always_assert(memcmp(F->bits, G->bits, F->nwords * 8) == 0);
+
+	const size_t npos = csnip_bloom_test_many(F, h, 2 * n, out);
+	size_t ctr = 0;
+	for (size_t i = 0; i < 2 * n; ++i) {
+		always_assert(out[i] == csnip_bloom_test(F, h[i]));
+		always_assert(i >= n || out[i]);
+		ctr += out[i];
+	}
+	always_assert(ctr == npos);
+
+	csnip_bloom_free(F);
+	csnip_bloom_free(G);
+	csnip_mem_Free(h);
+	csnip_mem_Free(out);
+	return 1;
+}
+
+static _Bool setop_test(int blocked, size_t n)
+{
+	printf("Union and intersection: %s, n = %zu\n",
+		blocked ? "blocked" : "standard", n);
+	/* F has keys [0, 2n), G has [n, 3n) */
+	csnip_bloom* F = csnip_bloom_make_for(3 * n, 0.01, blocked, NULL);
+	csnip_bloom* G = csnip_bloom_make_for(3 * n, 0.01, blocked, NULL);
+	csnip_bloom* U = csnip_bloom_make_for(3 * n, 0.01, blocked, NULL);
+	for (size_t i = 0; i < 2 * n; ++i)
+		csnip_bloom_add(F, key_hash(i));
+	for (size_t i = n; i < 3 * n; ++i)
+		csnip_bloom_add(G, key_hash(i));
+	for (size_t i = 0; i < 3 * n; ++i)
+		csnip_bloom_add(U, key_hash(i));
+
+	csnip_bloom* I = csnip_bloom_make_for(3 * n, 0.01, blocked, NULL);
+	csnip_bloom_union(I, F, NULL);
+	csnip_bloom_intersect(I, G, NULL);
+	for (size_t i = n; i < 2 * n; ++i)
+		always_assert(csnip_bloom_test(I, key_hash(i)));
+
+	/* The union is the same as the filter of all keys */
+	csnip_bloom_union(F, G, NULL);
+	always_assert(memcmp(F->bits, U->bits, F->nwords * 8) == 0);
+
+	/* Incompatible filters */
+	csnip_bloom* X = csnip_bloom_make_for(n, 0.01, !blocked, NULL);
+	int err;
+	csnip_bloom_union(F, X, &err);
+	always_assert(err == csnip_err_INVAL);
+	csnip_bloom_intersect(F, X, &err);
+	always_assert(err == csnip_err_INVAL);
+
+	csnip_bloom_free(F);
+	csnip_bloom_free(G);
+	csnip_bloom_free(U);
+	csnip_bloom_free(I);
+	csnip_bloom_free(X);
+	return 1;
+}
+
+static _Bool serialize_test(int blocked, size_t n)
+{
+	printf("Serialization: %s, n = %zu\n",
+		blocked ? "blocked" : "standard", n);
+	csnip_bloom* F = csnip_bloom_make_for(n, 0.05, blocked, NULL);
+	for (size_t i = 0; i < n; ++i)
+		csnip_bloom_add(F, key_hash(i));
+
+	const size_t sz = csnip_bloom_serialized_size(F);
+	unsigned char* buf;
+	csnip_mem_Alloc(sz, buf, _);
+	int err;
+	always_assert(csnip_bloom_serialize(F, buf, sz - 1, &err) == 0);
+	always_assert(err == csnip_err_RANGE);
+	always_assert(csnip_bloom_serialize(F, buf, sz, &err) == sz);
+	always_assert(err == 0);
+
+	csnip_bloom* G = csnip_bloom_deserialize(buf, sz, &err);
+	always_assert(G != NULL && err == 0);
+	always_assert(G->nbits == F->nbits && G->k == F->k
+		&& G->blocked == F->blocked);
+	always_assert(memcmp(F->bits, G->bits, F->nwords * 8) == 0);
+	csnip_bloom_free(G);
+
+	/* Malformed buffers */
+	always_assert(csnip_bloom_deserialize(buf, sz - 8, &err) == NULL);
+	always_assert(err == csnip_err_FORMAT);
+	buf[0] ^= 1;
+	always_assert(csnip_bloom_deserialize(buf, sz, &err) == NULL);
+	always_assert(err == csnip_err_FORMAT);
+
+	csnip_mem_Free(buf);
+	csnip_bloom_free(F);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	for (int blocked = 0; blocked < 2; ++blocked) {
+		RUN_TEST(fpr_test(blocked, 100000, 0.01))
+		RUN_TEST(fpr_test(blocked, 10000, 0.001))
+		RUN_TEST(batch_test(blocked, 10000))
+		RUN_TEST(setop_test(blocked, 5000))
+		RUN_TEST(serialize_test(blocked, 1000))
+	}
+	RUN_TEST(small_fpr_test(100000, 1e-9))
+	RUN_TEST(small_fpr_test(100000, 1e-12))
+
+	puts("-> tests passed.");
+	return 0;
+}
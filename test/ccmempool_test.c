@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include <pthread.h>
+
+#include <csnip/cext.h>
+#include <csnip/ccmempool.h>
+#include <csnip/mem.h>
+#include <csnip/sort.h>
+
+/*  Test for the concurrent memory pool.
+ *
+ *  First, a single cache allocates and frees items, checking that
+ *  live items are distinct and keep their contents, and that freed
+ *  items are reused.  Then several threads allocate and free items
+ *  concurrently, handing a part of their items to the next thread
+ *  through a locked mailbox, which frees them (remote frees).  Every
+ *  item holds a tag of its current owner, which the owner checks
+ *  before releasing it, to detect items handed out twice.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+typedef struct {
+	uint64_t owner;
+	uint64_t val;
+} item;
+
+CSNIP_CCMEMPOOL_DEF_TYPE(ipool, item)
+CSNIP_CCMEMPOOL_DEF_FUNCS(csnip_cext_unused static,
+			ipool_,
+			item,
+			struct ipool,
+			struct ipool_cache,
+			struct ipool_magazine)
+
+static _Bool sequential_test(size_t N)
+{
+	printf("Sequential: N = %zu\n", N);
+	struct ipool* P = ipool_make(NULL);
+	struct ipool_cache C = ipool_cache_init(P);
+
+	item** it;
+	csnip_mem_Alloc(N, it, _);
+	for (size_t i = 0; i < N; ++i) {
+		it[i] = ipool_alloc_item(&C, NULL);
+		always_assert(it[i] != NULL);
+		it[i]->val = i;
+	}
+
+	/* Distinct items */
+	item** s;
+	csnip_mem_Alloc(N, s, _);
+	for (size_t i = 0; i < N; ++i)
+		s[i] = it[i];
+	csnip_Qsort(u, v, (uintptr_t)s[u] < (uintptr_t)s[v],
+		csnip_Tswap(item*, s[u], s[v]), N);
+	for (size_t i = 1; i < N; ++i)
+		always_assert(s[i - 1] != s[i]);
+	for (size_t i = 0; i < N; ++i)
+		always_assert(it[i]->val == i);
+
+	/* Free and reallocate:  no new memory is needed */
+	const size_t carved = P->n_carved;
+	always_assert(carved >= N);
+	for (size_t i = 0; i < N; ++i)
+		ipool_free_item(&C, it[i]);
+	for (size_t i = 0; i < N; ++i)
+		it[i] = ipool_alloc_item(&C, NULL);
+	always_assert(P->n_carved == carved);
+
+	/* The items go back to the depot, and are reused by another
+	 * cache */
+	for (size_t i = 0; i < N; ++i)
+		ipool_free_item(&C, it[i]);
+	ipool_cache_deinit(&C);
+	struct ipool_cache D = ipool_cache_init(P);
+	for (size_t i = 0; i < N; ++i)
+		it[i] = ipool_alloc_item(&D, NULL);
+	always_assert(P->n_carved == carved);
+	ipool_cache_deinit(&D);
+
+	csnip_mem_Free(s);
+	csnip_mem_Free(it);
+	ipool_free(P);
+	return 1;
+}
+
+#define NTHREADS	4
+#define MAILBOX		256
+
+/* Mailboxes for passing items to the next thread */
+static struct {
+	pthread_mutex_t lock;
+	item* it[MAILBOX];
+	size_t n;
+} mbox[NTHREADS];
+
+static struct ipool* shared_pool;
+
+typedef struct {
+	int id;
+	size_t nops;
+	uint64_t nremote;
+} thread_arg;
+
+static void* worker(void* arg_)
+{
+	thread_arg* arg = arg_;
+	const uint64_t me = (uint64_t)arg->id + 1;
+	struct ipool_cache C = ipool_cache_init(shared_pool);
+	enum { NLIVE = 500 };
+	item* live[NLIVE] = { NULL };
+	uint64_t rng = 0x9e3779b97f4a7c15ull * me;
+
+	for (size_t op = 0; op < arg->nops; ++op) {
+		rng ^= rng << 13;
+		rng ^= rng >> 7;
+		rng ^= rng << 17;
+		const size_t j = (size_t)(rng % NLIVE);
+		if (live[j] == NULL) {
+			live[j] = ipool_alloc_item(&C, NULL);
+			always_assert(live[j] != NULL);
+			live[j]->owner = me;
+			live[j]->val = op;
+			continue;
+		}
+
+		always_assert(live[j]->owner == me);
+		if ((rng >> 32) & 1) {
+			/* Pass to the next thread, if there is room */
+			const int to = (arg->id + 1) % NTHREADS;
+			pthread_mutex_lock(&mbox[to].lock);
+			if (mbox[to].n < MAILBOX) {
+				live[j]->owner = (uint64_t)to + 1;
+				mbox[to].it[mbox[to].n++] = live[j];
+				live[j] = NULL;
+			}
+			pthread_mutex_unlock(&mbox[to].lock);
+		}
+		if (live[j]) {
+			live[j]->owner = 0;
+			ipool_free_item(&C, live[j]);
+			live[j] = NULL;
+		}
+
+		/* Free the items passed to us */
+		if ((op & 63) == 0) {
+			pthread_mutex_lock(&mbox[arg->id].lock);
+			for (size_t i = 0; i < mbox[arg->id].n; ++i) {
+				item* e = mbox[arg->id].it[i];
+				always_assert(e->owner == me);
+				e->owner = 0;
+				ipool_free_item(&C, e);
+				++arg->nremote;
+			}
+			mbox[arg->id].n = 0;
+			pthread_mutex_unlock(&mbox[arg->id].lock);
+		}
+	}
+
+	for (size_t j = 0; j < NLIVE; ++j) {
+		if (live[j]) {
+			always_assert(live[j]->owner == me);
+			ipool_free_item(&C, live[j]);
+		}
+	}
+	ipool_cache_deinit(&C);
+	return NULL;
+}
+
+static _Bool concurrent_test(size_t nops)
+{
+	printf("Concurrent: %d threads, %zu operations each\n",
+		NTHREADS, nops);
+	shared_pool = ipool_make(NULL);
+	for (int i = 0; i < NTHREADS; ++i) {
+		pthread_mutex_init(&mbox[i].lock, NULL);
+		mbox[i].n = 0;
+	}
+
+	pthread_t th[NTHREADS];
+	thread_arg args[NTHREADS];
+	for (int i = 0; i < NTHREADS; ++i) {
+		args[i] = (thread_arg) { .id = i, .nops = nops };
+		always_assert(pthread_create(&th[i], NULL, worker,
+					&args[i]) == 0);
+	}
+	uint64_t nremote = 0;
+	for (int i = 0; i < NTHREADS; ++i) {
+		pthread_join(th[i], NULL);
+		nremote += args[i].nremote;
+	}
+	printf(" %" PRIu64 " remote frees, %zu items carved\n",
+		nremote, shared_pool->n_carved);
+	always_assert(nremote > 0);
+
+	/* Items left in the mailboxes */
+	struct ipool_cache C = ipool_cache_init(shared_pool);
+	for (int i = 0; i < NTHREADS; ++i) {
+		for (size_t j = 0; j < mbox[i].n; ++j)
+			ipool_free_item(&C, mbox[i].it[j]);
+		pthread_mutex_destroy(&mbox[i].lock);
+	}
+	ipool_cache_deinit(&C);
+
+	/* All items are back:  the depot magazines hold every carved
+	 * item exactly once */
+	size_t n = 0;
+	for (struct ipool_magazine* M = shared_pool->full; M; M = M->next)
+		n += M->n;
+	for (item* e = shared_pool->first_free; e; e = *(item**)e)
+		++n;
+	always_assert(n == shared_pool->n_carved);
+
+	ipool_free(shared_pool);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(sequential_test(10))
+	RUN_TEST(sequential_test(10000))
+	RUN_TEST(concurrent_test(200000))
+
+	puts("-> tests passed.");
+	return 0;
+}
@@ -0,0 +1,204 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <csnip/cmsketch.h>
+#include <csnip/err.h>
+#include <csnip/mem.h>
+
+/*  Test for the count-min and count sketches.
+ *
+ *  A Zipf-like stream is fed into the sketches, and the estimates are
+ *  compared with the exact counts: the count-min sketch must never
+ *  underestimate and stay within its error bound for most keys, and
+ *  the count sketch must find the heavy hitters accurately.  Merging
+ *  is checked to give the sketch of the concatenated streams.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+#define NKEYS		10000
+
+/* Stream with key i occurring about N / (i + 1) times; the exact
+ * counts are added to cnt. */
+static size_t make_stream(uint64_t* s, size_t N, uint64_t* cnt)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < NKEYS && n < N; ++i) {
+		size_t c = N / 10 / (i + 1);
+		if (c == 0)
+			c = 1;
+		for (size_t j = 0; j < c && n < N; ++j) {
+			s[n++] = i;
+			++cnt[i];
+		}
+	}
+
+	/* Shuffle */
+	srand(42);
+	for (size_t i = n; i > 1; --i) {
+		const size_t j = (size_t)rand() % i;
+		const uint64_t t = s[i - 1];
+		s[i - 1] = s[j];
+		s[j] = t;
+	}
+	return n;
+}
+
+static _Bool cm_test(double eps, double delta)
+{
+	printf("Count-min: eps = %g, delta = %g\n", eps, delta);
+	const size_t N = 200000;
+	uint64_t* s;
+	uint64_t* cnt;
+	csnip_mem_Alloc(N, s, _);
+	csnip_mem_Alloc0(NKEYS, cnt, _);
+	const size_t n = make_stream(s, N, cnt);
+
+	csnip_cmsketch* S = csnip_cmsketch_make_for(eps, delta, NULL);
+	printf(" width = %zu, depth = %d\n", S->width, S->depth);
+	csnip_cmsketch_add_many(S, s, n);
+	always_assert(S->total == n);
+
+	size_t nbad = 0;
+	for (uint64_t i = 0; i < NKEYS; ++i) {
+		const uint64_t est = csnip_cmsketch_estimate(S, i);
+		always_assert(est >= cnt[i]);
+		if ((double)(est - cnt[i]) > eps * (double)n)
+			++nbad;
+	}
+	printf(" %zu of %d keys outside the error bound\n", nbad, NKEYS);
+	always_assert((double)nbad <= 2.0 * delta * NKEYS);
+
+	/* Merge of two halves */
+	csnip_cmsketch* A = csnip_cmsketch_make_for(eps, delta, NULL);
+	csnip_cmsketch* B = csnip_cmsketch_make_for(eps, delta, NULL);
+	for (size_t i = 0; i < n / 2; ++i)
+		csnip_cmsketch_add(A, s[i], 1);
+	for (size_t i = n / 2; i < n; ++i)
+		csnip_cmsketch_add(B, s[i], 1);
+	csnip_cmsketch_merge(A, B, NULL);
+	always_assert(A->total == S->total);
+	for (size_t i = 0; i < S->width * (size_t)S->depth; ++i)
+		always_assert(A->count[i] == S->count[i]);
+
+	csnip_cmsketch* X = csnip_cmsketch_make(S->width * 2, S->depth, NULL);
+	int err;
+	csnip_cmsketch_merge(A, X, &err);
+	always_assert(err == csnip_err_INVAL);
+
+	csnip_cmsketch_clear(S);
+	always_assert(S->total == 0 && csnip_cmsketch_estimate(S, 0) == 0);
+
+	csnip_cmsketch_free(S);
+	csnip_cmsketch_free(A);
+	csnip_cmsketch_free(B);
+	csnip_cmsketch_free(X);
+	csnip_mem_Free(s);
+	csnip_mem_Free(cnt);
+	return 1;
+}
+
+static _Bool cs_test(double eps, double delta)
+{
+	printf("Count sketch: eps = %g, delta = %g\n", eps, delta);
+	const size_t N = 200000;
+	uint64_t* s;
+	uint64_t* cnt;
+	csnip_mem_Alloc(N, s, _);
+	csnip_mem_Alloc0(NKEYS, cnt, _);
+	const size_t n = make_stream(s, N, cnt);
+
+	csnip_csketch* S = csnip_csketch_make_for(eps, delta, NULL);
+	printf(" width = %zu, depth = %d\n", S->width, S->depth);
+	always_assert(S->depth & 1);
+	csnip_csketch_add_many(S, s, n);
+
+	/* Error bound in terms of the L2 norm */
+	double l2 = 0.0;
+	for (size_t i = 0; i < NKEYS; ++i)
+		l2 += (double)cnt[i] * (double)cnt[i];
+	l2 = sqrt(l2);
+
+	size_t nbad = 0;
+	for (uint64_t i = 0; i < NKEYS; ++i) {
+		const int64_t est = csnip_csketch_estimate(S, i);
+		if (fabs((double)est - (double)cnt[i]) > eps * l2)
+			++nbad;
+	}
+	printf(" %zu of %d keys outside the error bound\n", nbad, NKEYS);
+	always_assert((double)nbad <= 2.0 * delta * NKEYS);
+
+	/* Heavy hitters are estimated to within 1% */
+	for (uint64_t i = 0; i < 10; ++i) {
+		const int64_t est = csnip_csketch_estimate(S, i);
+		always_assert(fabs((double)est - (double)cnt[i])
+			< 0.01 * (double)cnt[i]);
+	}
+
+	/* Removing the stream again gives zero counters */
+	csnip_csketch* A = csnip_csketch_make_for(eps, delta, NULL);
+	for (size_t i = 0; i < n; ++i)
+		csnip_csketch_add(A, s[i], -1);
+	csnip_csketch_merge(A, S, NULL);
+	for (size_t i = 0; i < A->width * (size_t)A->depth; ++i)
+		always_assert(A->count[i] == 0);
+
+	csnip_csketch* X = csnip_csketch_make(S->width, S->depth + 2, NULL);
+	int err;
+	csnip_csketch_merge(A, X, &err);
+	always_assert(err == csnip_err_INVAL);
+
+	csnip_csketch_free(S);
+	csnip_csketch_free(A);
+	csnip_csketch_free(X);
+	csnip_mem_Free(s);
+	csnip_mem_Free(cnt);
+	return 1;
+}
+
+static _Bool param_test(void)
+{
+	printf("Parameter checks\n");
+	int err;
+	always_assert(csnip_cmsketch_make(0, 4, &err) == NULL);
+	always_assert(err == csnip_err_INVAL);
+	always_assert(csnip_cmsketch_make(1024, 0, &err) == NULL);
+	always_assert(err == csnip_err_INVAL);
+	always_assert(csnip_csketch_make(1024,
+		CSNIP_CMSKETCH_MAX_DEPTH + 1, &err) == NULL);
+	always_assert(err == csnip_err_INVAL);
+	always_assert(csnip_cmsketch_make_for(0.0, 0.01, &err) == NULL);
+	always_assert(err == csnip_err_INVAL);
+	always_assert(csnip_csketch_make_for(0.01, 1.0, &err) == NULL);
+	always_assert(err == csnip_err_INVAL);
+
+	/* Width is rounded to a power of 2 */
+	csnip_cmsketch* S = csnip_cmsketch_make(1000, 3, &err);
+	always_assert(err == 0 && S->width == 1024);
+	csnip_cmsketch_free(S);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(cm_test(0.001, 0.01))
+	RUN_TEST(cm_test(0.0001, 0.001))
+	RUN_TEST(cs_test(0.01, 0.01))
+	RUN_TEST(cs_test(0.005, 0.05))
+	RUN_TEST(param_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/crc32c.h>
+
+/*  Test for the CRC32C checksum.
+ *
+ *  Checks known answers, including the ones from RFC 3720, that the
+ *  hardware and software implementations agree for all lengths and
+ *  alignments, also for buffers long enough for the interleaved
+ *  hardware path, and that chaining and combining checksums of pieces
+ *  give the checksum of the whole.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static uint64_t rnd(void)
+{
+	uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+static _Bool vector_test(void)
+{
+	printf("Known answers (hardware: %s)\n", crc32c_has_hw() ? "yes" : "no");
+	unsigned char b[32];
+
+	memset(b, 0, 32);
+	always_assert(crc32c(0, b, 32) == 0x8a9136aaul);
+	always_assert(crc32c_sw(0, b, 32) == 0x8a9136aaul);
+	memset(b, 0xff, 32);
+	always_assert(crc32c(0, b, 32) == 0x62a8ab43ul);
+	always_assert(crc32c_sw(0, b, 32) == 0x62a8ab43ul);
+	for (int i = 0; i < 32; ++i)
+		b[i] = (unsigned char)i;
+	always_assert(crc32c(0, b, 32) == 0x46dd794eul);
+	always_assert(crc32c_sw(0, b, 32) == 0x46dd794eul);
+	for (int i = 0; i < 32; ++i)
+		b[i] = (unsigned char)(31 - i);
+	always_assert(crc32c(0, b, 32) == 0x113fdb5cul);
+	always_assert(crc32c_sw(0, b, 32) == 0x113fdb5cul);
+
+	always_assert(crc32c(0, "123456789", 9) == 0xe3069283ul);
+	always_assert(crc32c_sw(0, "123456789", 9) == 0xe3069283ul);
+	always_assert(crc32c(0, "", 0) == 0);
+	always_assert(crc32c(0x12345678ul, "", 0) == 0x12345678ul);
+	return 1;
+}
+
+static _Bool agree_test(void)
+{
+	printf("Hardware and software agree\n");
+	const size_t N = 3 * 8192 * 2 + 3 * 256 * 3 + 100;
+	unsigned char* b = malloc(N + 8);
+	always_assert(b);
+	for (size_t i = 0; i < N + 8; ++i)
+		b[i] = (unsigned char)rnd();
+
+	for (size_t len = 0; len < 1000; ++len) {
+		for (size_t off = 0; off < 8; ++off) {
+			always_assert(crc32c(0, b + off, len)
+				== crc32c_sw(0, b + off, len));
+		}
+	}
+	for (int rep = 0; rep < 200; ++rep) {
+		const size_t off = rnd() % 8;
+		const size_t len = rnd() % N;
+		const uint32_t c0 = (uint32_t)rnd();
+		always_assert(crc32c(c0, b + off, len)
+			== crc32c_sw(c0, b + off, len));
+	}
+	free(b);
+	return 1;
+}
+
+static _Bool chain_combine_test(void)
+{
+	printf("Chaining and combining\n");
+	const size_t N = 100000;
+	unsigned char* b = malloc(N);
+	always_assert(b);
+	for (size_t i = 0; i < N; ++i)
+		b[i] = (unsigned char)rnd();
+
+	for (int rep = 0; rep < 200; ++rep) {
+		const size_t len = rnd() % N;
+		const size_t s = (len ? rnd() % (len + 1) : 0);
+		const uint32_t whole = crc32c(0, b, len);
+		const uint32_t a = crc32c(0, b, s);
+		const uint32_t c = crc32c(0, b + s, len - s);
+		always_assert(crc32c(a, b + s, len - s) == whole);
+		always_assert(crc32c_combine(a, c, len - s) == whole);
+	}
+
+	/* Several pieces, combined in order */
+	const size_t piece = N / 7;
+	uint32_t acc = 0;
+	size_t done = 0;
+	while (done < N) {
+		const size_t n = (N - done < piece ? N - done : piece);
+		acc = crc32c_combine(acc, crc32c(0, b + done, n), n);
+		done += n;
+	}
+	always_assert(acc == crc32c(0, b, N));
+
+	/* Combining with an empty buffer */
+	always_assert(crc32c_combine(0xdeadbeeful, 0, 0) == 0xdeadbeeful);
+	free(b);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(vector_test())
+	RUN_TEST(agree_test())
+	RUN_TEST(chain_combine_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
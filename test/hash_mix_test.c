@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define CSNIP_LPHASH_TABLE_STATS
+#define CSNIP_SHORT_NAMES
+#include <csnip/cext.h>
+#include <csnip/hash.h>
+#include <csnip/lphash_table.h>
+#include <csnip/sort.h>
+
+/*  Test for the integer mixing and range reduction functions.
+ *
+ *  Checks that the finalizers are collision free on strided keys and
+ *  avalanche, that the range reductions stay in range and spread
+ *  evenly, and that a table with CSNIP_LPHASH_TABLE_POSTMIX keeps
+ *  short probe sequences for aligned keys with an identity hash,
+ *  where the same table without post-mixing degenerates.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+/* Same table type, without and with post-mixing */
+CSNIP_LPHASH_TABLE_DEF_TYPE(u64tbl, uint64_t)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(csnip_cext_unused static, plain_,
+	uint64_t, uint64_t, struct u64tbl,
+	k1, k2, e, (size_t)k1, k1 == k2, e)
+#undef CSNIP_LPHASH_TABLE_POSTMIX
+#define CSNIP_LPHASH_TABLE_POSTMIX(h)	csnip_hash_mix_size(h)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(csnip_cext_unused static, mixed_,
+	uint64_t, uint64_t, struct u64tbl,
+	k1, k2, e, (size_t)k1, k1 == k2, e)
+
+static uint64_t rng_state = 0x2545f4914f6cdd1dull;
+
+static uint64_t rnd(void)
+{
+	return hash_splitmix64(rng_state += 0x9e3779b97f4a7c15ull);
+}
+
+static uint64_t f_fmix32(uint64_t x) { return hash_fmix32((uint32_t)x); }
+static uint64_t f_fmix64(uint64_t x) { return hash_fmix64(x); }
+static uint64_t f_splitmix64(uint64_t x) { return hash_splitmix64(x); }
+
+static _Bool mixer_test(const char* name, uint64_t (*f)(uint64_t),
+			int nbits)
+{
+	printf("Mixer %s\n", name);
+	always_assert(f(0) == 0);
+
+	/* Distinct on strided keys, e.g. aligned addresses */
+	const size_t N = 100000;
+	uint64_t* h = malloc(N * sizeof(uint64_t));
+	always_assert(h);
+	for (size_t i = 0; i < N; ++i)
+		h[i] = f((uint64_t)i << 6);
+	csnip_Qsort(u, v, h[u] < h[v], csnip_Tswap(uint64_t, h[u], h[v]), N);
+	for (size_t i = 1; i < N; ++i)
+		always_assert(h[i - 1] != h[i]);
+	free(h);
+
+	/* Avalanche */
+	const int nsample = 2000;
+	double worst = 0.0;
+	const uint64_t mask = (nbits == 64 ? ~0ull : (1ull << nbits) - 1);
+	for (int ib = 0; ib < nbits; ++ib) {
+		int flips[64] = { 0 };
+		for (int s = 0; s < nsample; ++s) {
+			const uint64_t x = rnd() & mask;
+			const uint64_t d = f(x) ^ f(x ^ (1ull << ib));
+			for (int ob = 0; ob < nbits; ++ob)
+				flips[ob] += (int)((d >> ob) & 1);
+		}
+		for (int ob = 0; ob < nbits; ++ob) {
+			const double p = (double)flips[ob] / nsample;
+			const double dev = (p > 0.5 ? p - 0.5 : 0.5 - p);
+			if (dev > worst)
+				worst = dev;
+		}
+	}
+	printf(" worst bias %.4f\n", worst);
+	always_assert(worst < 0.06);
+	return 1;
+}
+
+static _Bool range_test(void)
+{
+	printf("Range reduction\n");
+	static const uint64_t ns[] = { 1, 2, 3, 7, 10, 1000, 12345 };
+	for (size_t j = 0; j < sizeof(ns) / sizeof(ns[0]); ++j) {
+		const uint64_t n = ns[j];
+		size_t cnt32[12345] = { 0 };
+		size_t cnt64[12345] = { 0 };
+		const size_t N = 50 * n;
+		for (size_t i = 0; i < N; ++i) {
+			const uint64_t h = rnd();
+			const uint32_t r32 = hash_range32((uint32_t)h,
+							(uint32_t)n);
+			const uint64_t r64 = hash_range64(h, n);
+			always_assert(r32 < n && r64 < n);
+			++cnt32[r32];
+			++cnt64[r64];
+		}
+		for (uint64_t r = 0; r < n; ++r)
+			always_assert(cnt32[r] > 10 && cnt64[r] > 10);
+	}
+
+	/* Extreme values */
+	always_assert(hash_range64(~0ull, ~0ull) == ~0ull - 1);
+	always_assert(hash_range64(~0ull, 1) == 0);
+	always_assert(hash_range64(1ull << 63, 10) == 5);
+	always_assert(hash_range32(0xffffffffu, 7) == 6);
+
+	/* Fibonacci hashing of consecutive keys fills the table evenly */
+	for (unsigned lg = 1; lg <= 12; ++lg) {
+		const size_t n = (size_t)1 << lg;
+		size_t cnt[4096] = { 0 };
+		for (size_t i = 0; i < 8 * n; ++i) {
+			const uint64_t ix = hash_fib64(i, lg);
+			always_assert(ix < n);
+			always_assert(hash_fib32((uint32_t)i, lg) < n);
+			++cnt[ix];
+		}
+		for (size_t r = 0; r < n; ++r)
+			always_assert(cnt[r] >= 4 && cnt[r] <= 12);
+	}
+	return 1;
+}
+
+static _Bool postmix_test(void)
+{
+	printf("Table post-mixing\n");
+	const uint64_t N = 20000;
+	struct u64tbl* P = plain_make(NULL);
+	struct u64tbl* M = mixed_make(NULL);
+	for (uint64_t k = 0; k < N; ++k) {
+		plain_insert(P, NULL, k << 6);
+		mixed_insert(M, NULL, k << 6);
+	}
+	plain_resetstats(P);
+	mixed_resetstats(M);
+	for (uint64_t k = 0; k < N; ++k) {
+		always_assert(plain_find(P, k << 6) != NULL);
+		always_assert(mixed_find(M, k << 6) != NULL);
+		always_assert(mixed_find(M, (k << 6) + 1) == NULL);
+	}
+	const csnip_lphash_stats SP = plain_stats(P);
+	const csnip_lphash_stats SM = mixed_stats(M);
+	printf(" probes per hit: plain %.2f, mixed %.2f\n",
+		(double)SP.nprobe_hit / (double)SP.nhit,
+		(double)SM.nprobe_hit / (double)SM.nhit);
+	always_assert(SM.nhit == N && SM.nmiss == N);
+	always_assert(SM.nprobe_hit < 2 * N);
+	always_assert(SP.nprobe_hit > 10 * N);
+
+	/* Removal keeps the table consistent */
+	for (uint64_t k = 0; k < N; k += 2)
+		always_assert(mixed_remove(M, NULL, k << 6));
+	for (uint64_t k = 0; k < N; ++k)
+		always_assert((mixed_find(M, k << 6) != NULL) == (k & 1));
+
+	plain_free(P);
+	mixed_free(M);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(mixer_test("fmix32", f_fmix32, 32))
+	RUN_TEST(mixer_test("fmix64", f_fmix64, 64))
+	RUN_TEST(mixer_test("splitmix64", f_splitmix64, 64))
+	RUN_TEST(range_test())
+	RUN_TEST(postmix_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <csnip/cext.h>
+#include <csnip/hash.h>
+#include <csnip/lphash_table.h>
+#include <csnip/lphash_rhtable.h>
+#include <csnip/lphash_swtable.h>
+#include <csnip/lphash_irtable.h>
+#include <csnip/mem.h>
+
+/*  Test for the batched operations find_many() and insert_many().
+ *
+ *  For each of the hash table implementations, batches of random
+ *  entries (with duplicates, also within a batch) are inserted with
+ *  insert_many(), and the results compared with a reference bitmap.
+ *  Then batches of keys are looked up with find_many(), and the
+ *  results compared with find().
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+typedef struct {
+	uint32_t key;
+	uint32_t val;
+} u32map_entry;
+
+static uint32_t u32hash(uint32_t a)
+{
+	a ^= a >> 16;
+	a *= 0x7feb352dul;
+	a ^= a >> 15;
+	a *= 0x846ca68bul;
+	a ^= a >> 16;
+	return a;
+}
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(lptbl, u32map_entry)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(csnip_cext_unused static, lptbl_,
+	uint32_t, u32map_entry, struct lptbl,
+	k1, k2, e, u32hash(k1), k1 == k2, e.key)
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(rhtbl, u32map_entry)
+CSNIP_LPHASH_RHTABLE_DEF_FUNCS(csnip_cext_unused static, rhtbl_,
+	uint32_t, u32map_entry, struct rhtbl,
+	k1, k2, e, u32hash(k1), k1 == k2, e.key)
+
+CSNIP_LPHASH_SWTABLE_DEF_TYPE(swtbl, u32map_entry)
+CSNIP_LPHASH_SWTABLE_DEF_FUNCS(csnip_cext_unused static, swtbl_,
+	uint32_t, u32map_entry, struct swtbl,
+	k1, k2, e, u32hash(k1), k1 == k2, e.key)
+
+CSNIP_LPHASH_IRTABLE_DEF_TYPE(irtbl, u32map_entry)
+CSNIP_LPHASH_IRTABLE_DEF_FUNCS(csnip_cext_unused static, irtbl_,
+	uint32_t, u32map_entry, struct irtbl,
+	k1, k2, e, u32hash(k1), k1 == k2, e.key)
+
+/* String keys */
+CSNIP_LPHASH_TABLE_DEF_TYPE(strtbl, const char*)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(csnip_cext_unused static, strtbl_,
+	const char*, const char*, struct strtbl,
+	k1, k2, e, csnip_hash_fnv64_s(k1, CSNIP_FNV64_INIT),
+	strcmp(k1, k2) == 0, e)
+
+#define MAXBATCH 100
+
+#define DEF_TEST(name, prefix, tbltype) \
+	static _Bool name(const char* desc, uint32_t range, int nbatches) \
+	{ \
+		printf("%s: key range = %" PRIu32 "\n", desc, range); \
+		unsigned char* present; \
+		csnip_mem_Alloc0(range, present, _); \
+		tbltype* T = prefix##make(NULL); \
+		u32map_entry E[MAXBATCH]; \
+		uint32_t K[MAXBATCH]; \
+		u32map_entry* R[MAXBATCH]; \
+		size_t n = 0; \
+		srand(range); \
+		for (int b = 0; b < nbatches; ++b) { \
+			/* Insert a batch */ \
+			const size_t m = (size_t)rand() % MAXBATCH; \
+			size_t nnew = 0; \
+			for (size_t i = 0; i < m; ++i) { \
+				const uint32_t k = (uint32_t)rand() % range; \
+				E[i] = (u32map_entry){ k, 3 * k }; \
+				if (!present[k]) ++nnew; \
+				present[k] = 1; \
+			} \
+			always_assert(prefix##insert_many(T, NULL, E, m) \
+				== nnew); \
+			n += nnew; \
+			always_assert(prefix##size(T) == n); \
+			\
+			/* Look up a batch */ \
+			const size_t l = (size_t)rand() % MAXBATCH; \
+			size_t nfound = 0; \
+			for (size_t i = 0; i < l; ++i) { \
+				K[i] = (uint32_t)rand() % range; \
+				nfound += present[K[i]]; \
+			} \
+			always_assert(prefix##find_many(T, K, l, R) \
+				== nfound); \
+			for (size_t i = 0; i < l; ++i) { \
+				always_assert(R[i] == prefix##find(T, K[i])); \
+				always_assert(!R[i] || R[i]->val == 3 * K[i]); \
+			} \
+		} \
+		printf(" size = %zu\n", prefix##size(T)); \
+		\
+		/* Empty table and empty batch */ \
+		tbltype* U = prefix##make(NULL); \
+		always_assert(prefix##find_many(U, K, MAXBATCH, R) == 0); \
+		for (size_t i = 0; i < MAXBATCH; ++i) \
+			always_assert(R[i] == NULL); \
+		always_assert(prefix##insert_many(U, NULL, E, 0) == 0); \
+		prefix##free(U); \
+		\
+		prefix##free(T); \
+		csnip_mem_Free(present); \
+		return 1; \
+	}
+
+DEF_TEST(lp_test, lptbl_, struct lptbl)
+DEF_TEST(rh_test, rhtbl_, struct rhtbl)
+DEF_TEST(sw_test, swtbl_, struct swtbl)
+DEF_TEST(ir_test, irtbl_, struct irtbl)
+
+static _Bool string_test(int N)
+{
+	printf("String keys: N = %d\n", N);
+	char (*buf)[16];
+	const char** keys;
+	const char*** R;
+	csnip_mem_Alloc(2 * (size_t)N, buf, _);
+	csnip_mem_Alloc(2 * (size_t)N, keys, _);
+	csnip_mem_Alloc(2 * (size_t)N, R, _);
+	for (int i = 0; i < 2 * N; ++i) {
+		snprintf(buf[i], sizeof(buf[i]), "key-%d", i);
+		keys[i] = buf[i];
+	}
+
+	struct strtbl* T = strtbl_make(NULL);
+	always_assert(strtbl_insert_many(T, NULL, keys, N) == (size_t)N);
+	always_assert(strtbl_insert_many(T, NULL, keys, N) == 0);
+	always_assert(strtbl_find_many(T, keys, 2 * N, R) == (size_t)N);
+	for (int i = 0; i < 2 * N; ++i) {
+		always_assert((R[i] != NULL) == (i < N));
+		always_assert(!R[i] || strcmp(*R[i], keys[i]) == 0);
+	}
+	strtbl_free(T);
+
+	csnip_mem_Free(buf);
+	csnip_mem_Free(keys);
+	csnip_mem_Free(R);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(lp_test("lphash_table", 1000, 1000))
+	RUN_TEST(lp_test("lphash_table", 100000, 5000))
+	RUN_TEST(rh_test("lphash_rhtable", 1000, 1000))
+	RUN_TEST(rh_test("lphash_rhtable", 100000, 5000))
+	RUN_TEST(sw_test("lphash_swtable", 1000, 1000))
+	RUN_TEST(sw_test("lphash_swtable", 100000, 5000))
+	RUN_TEST(ir_test("lphash_irtable", 1000, 1000))
+	RUN_TEST(ir_test("lphash_irtable", 100000, 5000))
+	RUN_TEST(string_test(10000))
+
+	puts("-> tests passed.");
+	return 0;
+}
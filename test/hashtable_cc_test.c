@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+
+#include <pthread.h>
+
+#include <csnip/cext.h>
+#include <csnip/lphash_cctable.h>
+#include <csnip/mem.h>
+
+/*  Test for the concurrent hash table.
+ *
+ *  First, the table API is checked single threaded against a
+ *  reference bitmap.  Then several writer threads insert and remove
+ *  keys from disjoint key ranges, while reader threads look up random
+ *  keys.  Every entry satisfies val == ~key, which readers check to
+ *  detect torn or inconsistent reads;  writers check that they see
+ *  their own modifications.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+typedef struct {
+	uint32_t key;
+	uint32_t val;
+} u32map_entry;
+
+static uint32_t u32hash(uint32_t a)
+{
+	a ^= a >> 16;
+	a *= 0x7feb352dul;
+	a ^= a >> 15;
+	a *= 0x846ca68bul;
+	a ^= a >> 16;
+	return a;
+}
+
+CSNIP_LPHASH_CCTABLE_DEF_TYPE(u32map, u32map_entry)
+CSNIP_LPHASH_CCTABLE_DEF_FUNCS(csnip_cext_unused static,
+			u32map_,
+			uint32_t,
+			u32map_entry,
+			struct u32map,
+			k1, k2, e,
+			u32hash(k1),
+			k1 == k2,
+			e.key)
+
+static _Bool sequential_test(uint32_t range, int nrounds)
+{
+	printf("Sequential operations: key range = %" PRIu32 "\n", range);
+	unsigned char* present;
+	csnip_mem_Alloc0(range, present, _);
+	struct u32map* T = u32map_make(NULL);
+	size_t n = 0;
+	srand(range);
+	for (int round = 0; round < nrounds; ++round) {
+		for (uint32_t i = 0; i < range; ++i) {
+			const uint32_t k = (uint32_t)rand() % range;
+			const int op = rand() % 4;
+			u32map_entry E = { k, ~k }, O;
+			if (op == 0) {
+				_Bool r = u32map_remove(T, NULL, k, &O);
+				always_assert(r == present[k]);
+				always_assert(!r || O.key == k);
+				if (r) --n;
+				present[k] = 0;
+			} else if (op == 1) {
+				int r = u32map_insert_or_assign(T, NULL,
+					E, &O);
+				always_assert(r == !present[k]);
+				always_assert(r || O.key == k);
+				if (r) ++n;
+				present[k] = 1;
+			} else {
+				int r = u32map_insert(T, NULL, E);
+				always_assert(r == !present[k]);
+				if (r) ++n;
+				present[k] = 1;
+			}
+		}
+		always_assert(u32map_size(T) == n);
+		for (uint32_t k = 0; k < range; ++k) {
+			u32map_entry E;
+			_Bool r = u32map_find(T, k, &E);
+			always_assert(r == present[k]);
+			always_assert(!r || (E.key == k && E.val == ~k));
+		}
+	}
+	printf(" size = %zu, capacity = %zu\n",
+		u32map_size(T), u32map_capacity(T));
+	u32map_free(T);
+	csnip_mem_Free(present);
+	return 1;
+}
+
+/* Concurrent test */
+
+#define NWRITERS 4
+#define NREADERS 4
+#define KEYS_PER_WRITER 20000
+
+static struct u32map* ctbl;
+static atomic_int writers_done;
+
+static void* writer(void* arg)
+{
+	const uint32_t base = (uint32_t)(uintptr_t)arg * KEYS_PER_WRITER;
+	unsigned char* present;
+	csnip_mem_Alloc0(KEYS_PER_WRITER, present, _);
+	unsigned int seed = base + 1;
+	for (int i = 0; i < 4 * KEYS_PER_WRITER; ++i) {
+		const uint32_t j = (uint32_t)rand_r(&seed) % KEYS_PER_WRITER;
+		const uint32_t k = base + j;
+		if (rand_r(&seed) % 3 == 0) {
+			always_assert(u32map_remove(ctbl, NULL, k, NULL)
+				== present[j]);
+			present[j] = 0;
+		} else {
+			always_assert(u32map_insert(ctbl, NULL,
+				(u32map_entry){ k, ~k }) == !present[j]);
+			present[j] = 1;
+		}
+		u32map_entry E;
+		always_assert(u32map_find(ctbl, k, &E) == present[j]);
+	}
+
+	/* Final state of this writer's keys */
+	for (uint32_t j = 0; j < KEYS_PER_WRITER; ++j)
+		always_assert(u32map_find(ctbl, base + j, NULL) == present[j]);
+	csnip_mem_Free(present);
+	atomic_fetch_add(&writers_done, 1);
+	return NULL;
+}
+
+static void* reader(void* arg)
+{
+	unsigned int seed = (unsigned int)(uintptr_t)arg;
+	size_t nfound = 0, nlookups = 0;
+	while (atomic_load(&writers_done) < NWRITERS) {
+		for (int i = 0; i < 1000; ++i) {
+			const uint32_t k = (uint32_t)rand_r(&seed)
+				% (NWRITERS * KEYS_PER_WRITER);
+			u32map_entry E;
+			if (u32map_find(ctbl, k, &E)) {
+				always_assert(E.key == k && E.val == ~k);
+				++nfound;
+			}
+			++nlookups;
+		}
+	}
+	always_assert(nfound <= nlookups);
+	return NULL;
+}
+
+static _Bool concurrent_test(void)
+{
+	printf("Concurrent operations: %d writers, %d readers\n",
+		NWRITERS, NREADERS);
+	ctbl = u32map_make(NULL);
+	atomic_init(&writers_done, 0);
+	pthread_t thr[NWRITERS + NREADERS];
+	for (int i = 0; i < NREADERS; ++i) {
+		always_assert(pthread_create(&thr[NWRITERS + i], NULL,
+			reader, (void*)(uintptr_t)(i + 1)) == 0);
+	}
+	for (int i = 0; i < NWRITERS; ++i) {
+		always_assert(pthread_create(&thr[i], NULL,
+			writer, (void*)(uintptr_t)i) == 0);
+	}
+	for (int i = 0; i < NWRITERS + NREADERS; ++i)
+		pthread_join(thr[i], NULL);
+
+	size_t n = 0;
+	for (uint32_t k = 0; k < NWRITERS * KEYS_PER_WRITER; ++k)
+		n += u32map_find(ctbl, k, NULL);
+	printf(" size = %zu, capacity = %zu\n",
+		u32map_size(ctbl), u32map_capacity(ctbl));
+	always_assert(u32map_size(ctbl) == n);
+	u32map_free(ctbl);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(sequential_test(10, 20))
+	RUN_TEST(sequential_test(1000, 20))
+	RUN_TEST(sequential_test(50000, 4))
+	RUN_TEST(concurrent_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
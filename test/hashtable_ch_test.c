@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include <csnip/cext.h>
+#include <csnip/chhash_table.h>
+#include <csnip/mem.h>
+#include <csnip/mempool.h>
+
+/*  Test for the chained hash table.
+ *
+ *  A random sequence of insertions and deletions is performed on the
+ *  table and on a reference array of node pointers, which also
+ *  checks that node addresses are stable.  Caller allocated nodes are
+ *  linked and unlinked, and iteration is checked while a resize is
+ *  in progress.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+typedef struct {
+	csnip_chhash_link link;
+	uint32_t key;
+	uint32_t val;
+} node;
+
+static uint32_t u32hash(uint32_t a)
+{
+	a ^= a >> 16;
+	a *= 0x7feb352dul;
+	a ^= a >> 15;
+	a *= 0x846ca68bul;
+	a ^= a >> 16;
+	return a;
+}
+
+CSNIP_MEMPOOL_DEF_TYPE(nodepool, node)
+CSNIP_MEMPOOL_DECL_FUNCS(csnip_cext_unused static, nodepool_,
+	node, struct nodepool)
+CSNIP_MEMPOOL_DEF_FUNCS(csnip_cext_unused static, nodepool_,
+	node, struct nodepool)
+
+CSNIP_CHHASH_TABLE_DEF_TYPE(nodetbl, struct nodepool)
+CSNIP_CHHASH_TABLE_DEF_FUNCS(csnip_cext_unused static, nodetbl_,
+	uint32_t, node, struct nodetbl, nodepool_, link,
+	k1, k2, e, u32hash(k1), k1 == k2, e.key)
+
+static node mknode(uint32_t key, uint32_t val)
+{
+	node n = { .key = key, .val = val };
+	return n;
+}
+
+static _Bool random_test(uint32_t range, int nrounds)
+{
+	printf("Random operations: key range = %" PRIu32 "\n", range);
+	node** ref;
+	csnip_mem_Alloc0(range, ref, _);
+	struct nodetbl* T = nodetbl_make(NULL);
+	size_t n = 0;
+	srand(range);
+	for (int round = 0; round < nrounds; ++round) {
+		for (uint32_t i = 0; i < range; ++i) {
+			const uint32_t k = (uint32_t)rand() % range;
+			const int op = rand() % 4;
+			node O;
+			if (op == 0) {
+				_Bool r = nodetbl_remove(T, NULL, k);
+				always_assert(r == (ref[k] != NULL));
+				if (r) --n;
+				ref[k] = NULL;
+			} else if (op == 1) {
+				int r = nodetbl_insert_or_assign(T, NULL,
+					mknode(k, 3 * k), &O);
+				always_assert(r == (ref[k] == NULL));
+				always_assert(r || O.key == k);
+				if (r) {
+					++n;
+					ref[k] = nodetbl_find(T, k);
+				}
+			} else if (op == 2) {
+				node* P = nodetbl_find_or_insert(T, NULL,
+					mknode(k, 3 * k));
+				always_assert(P && P->key == k);
+				always_assert(!ref[k] || ref[k] == P);
+				if (!ref[k]) ++n;
+				ref[k] = P;
+			} else {
+				int r = nodetbl_insert(T, NULL,
+					mknode(k, 3 * k));
+				always_assert(r == (ref[k] == NULL));
+				if (r) {
+					++n;
+					ref[k] = nodetbl_find(T, k);
+				}
+			}
+		}
+
+		/* Nodes have not moved */
+		always_assert(nodetbl_size(T) == n);
+		for (uint32_t k = 0; k < range; ++k) {
+			node* P = nodetbl_find(T, k);
+			always_assert(P == ref[k]);
+			always_assert(!P || P->val == 3 * k);
+		}
+	}
+	printf(" size = %zu, buckets = %zu\n",
+		nodetbl_size(T), nodetbl_capacity(T));
+	nodetbl_free(T);
+	csnip_mem_Free(ref);
+	return 1;
+}
+
+static _Bool intrusive_test(uint32_t N)
+{
+	printf("Caller allocated nodes: N = %" PRIu32 "\n", N);
+	node* nodes;
+	csnip_mem_Alloc(2 * N, nodes, _);
+	struct nodetbl* T = nodetbl_make(NULL);
+	for (uint32_t i = 0; i < N; ++i) {
+		nodes[i] = mknode(i, i);
+		always_assert(nodetbl_link(T, NULL, &nodes[i]) == &nodes[i]);
+	}
+
+	/* Duplicates are not linked */
+	for (uint32_t i = 0; i < N; ++i) {
+		nodes[N + i] = mknode(i, 0);
+		always_assert(nodetbl_link(T, NULL, &nodes[N + i])
+			== &nodes[i]);
+	}
+	always_assert(nodetbl_size(T) == N);
+
+	/* Unlink even keys by key, odd ones by node */
+	for (uint32_t i = 0; i < N; ++i) {
+		if (i & 1) {
+			nodetbl_unlinknode(T, &nodes[i]);
+		} else {
+			always_assert(nodetbl_unlink(T, i) == &nodes[i]);
+			always_assert(nodetbl_unlink(T, i) == NULL);
+		}
+		always_assert(nodetbl_find(T, i) == NULL);
+	}
+	always_assert(nodetbl_size(T) == 0);
+	nodetbl_free(T);
+	csnip_mem_Free(nodes);
+	return 1;
+}
+
+/* Iterate, with and without a pending migration, removing nodes */
+static _Bool iter_test(uint32_t N)
+{
+	printf("Iteration: N = %" PRIu32 "\n", N);
+	struct nodetbl* T = nodetbl_make(NULL);
+	uint32_t k = 0;
+	for (int pass = 0; pass < 2; ++pass) {
+		/* Insert until a resize is in progress or not */
+		do {
+			nodetbl_insert(T, NULL, mknode(k, k));
+			++k;
+		} while (k < N || (T->old_nb != 0) != (pass == 0));
+
+		unsigned char* seen;
+		csnip_mem_Alloc0(k, seen, _);
+		size_t ctr = 0;
+		for (node* P = nodetbl_first(T); P; P = nodetbl_next(T, P)) {
+			always_assert(P->key < k && !seen[P->key]);
+			seen[P->key] = 1;
+			++ctr;
+		}
+		always_assert(ctr == nodetbl_size(T));
+		csnip_mem_Free(seen);
+
+		/* Remove the odd keys while iterating */
+		node* P = nodetbl_first(T);
+		while (P) {
+			node* Q = nodetbl_next(T, P);
+			if (P->key & 1)
+				nodetbl_remove(T, NULL, P->key);
+			P = Q;
+		}
+		for (uint32_t j = 0; j < k; ++j) {
+			always_assert((nodetbl_find(T, j) != NULL)
+				== ((j & 1) == 0));
+		}
+		for (uint32_t j = 1; j < k; j += 2)
+			nodetbl_insert(T, NULL, mknode(j, j));
+	}
+
+	/* reserve() completes the migration */
+	nodetbl_reserve(T, NULL, 4 * k);
+	always_assert(T->old_nb == 0 && nodetbl_capacity(T) >= 4 * k);
+	for (uint32_t j = 0; j < k; ++j)
+		always_assert(nodetbl_find(T, j)->val == j);
+	nodetbl_free(T);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(random_test(10, 20))
+	RUN_TEST(random_test(1000, 20))
+	RUN_TEST(random_test(50000, 4))
+	RUN_TEST(intrusive_test(10000))
+	RUN_TEST(iter_test(1000))
+
+	puts("-> tests passed.");
+	return 0;
+}
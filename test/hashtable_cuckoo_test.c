@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdint.h>
+
+#include <csnip/cext.h>
+#include <csnip/err.h>
+#include <csnip/lphash_cuckootable.h>
+#include <csnip/mem.h>
+
+/*  Test for the cuckoo hash table.
+ *
+ *  A random sequence of insertions and deletions is performed on the
+ *  table and on a reference bitmap, and the two are compared.  It is
+ *  checked that the table reaches a high load before growing, that
+ *  iteration and removal via the slot functions work, including the
+ *  stash, and that a hash function with too few values is detected.
+ *  The bucket layout is checked to keep buckets within cache lines.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+typedef struct {
+	uint32_t key;
+	uint32_t val;
+} u32map_entry;
+
+static uint32_t u32hash(uint32_t a)
+{
+	a ^= a >> 16;
+	a *= 0x7feb352dul;
+	a ^= a >> 15;
+	a *= 0x846ca68bul;
+	a ^= a >> 16;
+	return a;
+}
+
+CSNIP_LPHASH_CUCKOOTABLE_DEF_TYPE(u32map, u32map_entry)
+CSNIP_LPHASH_CUCKOOTABLE_DEF_FUNCS(csnip_cext_unused static,
+			u32map_,
+			uint32_t,
+			u32map_entry,
+			struct u32map,
+			k1, k2, e,
+			u32hash(k1),
+			k1 == k2,
+			e.key)
+
+/* Table with a hash function of only 4 values */
+CSNIP_LPHASH_CUCKOOTABLE_DEF_TYPE(weakmap, uint32_t)
+CSNIP_LPHASH_CUCKOOTABLE_DEF_FUNCS(csnip_cext_unused static,
+			weakmap_,
+			uint32_t,
+			uint32_t,
+			struct weakmap,
+			k1, k2, e,
+			u32hash(k1 & 3),
+			k1 == k2,
+			e)
+
+/* Table with entries of two cache lines per bucket */
+typedef struct {
+	uint64_t key;
+	uint64_t val;
+} u64map_entry;
+CSNIP_LPHASH_CUCKOOTABLE_DEF_TYPE(u64map, u64map_entry)
+
+static _Bool random_test(uint32_t range, int nrounds)
+{
+	printf("Random operations: key range = %" PRIu32 "\n", range);
+	unsigned char* present;
+	csnip_mem_Alloc0(range, present, _);
+	struct u32map* T = u32map_make(NULL);
+	size_t n = 0;
+	srand(range);
+	for (int round = 0; round < nrounds; ++round) {
+		for (uint32_t i = 0; i < range; ++i) {
+			const uint32_t k = (uint32_t)rand() % range;
+			const int op = rand() % 4;
+			u32map_entry E = { k, k * 3 }, O;
+			if (op == 0) {
+				_Bool r = u32map_remove(T, NULL, k);
+				always_assert(r == present[k]);
+				if (r) --n;
+				present[k] = 0;
+			} else if (op == 1) {
+				int r = u32map_insert_or_assign(T, NULL,
+					E, &O);
+				always_assert(r == !present[k]);
+				always_assert(r || O.key == k);
+				if (r) ++n;
+				present[k] = 1;
+			} else if (op == 2) {
+				u32map_entry* P = u32map_find_or_insert(T,
+					NULL, E);
+				always_assert(P && P->key == k);
+				if (!present[k]) ++n;
+				present[k] = 1;
+			} else {
+				int r = u32map_insert(T, NULL, E);
+				always_assert(r == !present[k]);
+				if (r) ++n;
+				present[k] = 1;
+			}
+		}
+		always_assert(u32map_size(T) == n);
+		for (uint32_t k = 0; k < range; ++k) {
+			u32map_entry* E = u32map_find(T, k);
+			always_assert((E != NULL) == present[k]);
+			always_assert(!E || E->val == 3 * k);
+		}
+	}
+	printf(" size = %zu, capacity = %zu, stash = %zu\n",
+		u32map_size(T), u32map_capacity(T), T->nstash);
+	u32map_free(T);
+	csnip_mem_Free(present);
+	return 1;
+}
+
+/* The load before growing is high */
+static _Bool load_test(uint32_t N)
+{
+	printf("Load test: N = %" PRIu32 "\n", N);
+	struct u32map* T = u32map_make(NULL);
+	double maxload = 0.0;
+	for (uint32_t k = 0; k < N; ++k) {
+		const size_t cap = u32map_capacity(T);
+		const double load = (double)u32map_size(T) / (double)cap;
+		u32map_insert(T, NULL, (u32map_entry){ k, k });
+		if (u32map_capacity(T) != cap && cap > 1000
+		  && load > maxload)
+			maxload = load;
+	}
+	printf(" maximum load before growing: %.3f\n", maxload);
+	always_assert(maxload > 0.85);
+	u32map_free(T);
+	return 1;
+}
+
+/* Slot functions */
+static _Bool slot_test(uint32_t N)
+{
+	printf("Slot functions: N = %" PRIu32 "\n", N);
+	struct u32map* T = u32map_make(NULL);
+	for (uint32_t k = 0; k < N; ++k)
+		u32map_insert(T, NULL, (u32map_entry){ k, k });
+
+	unsigned char* seen;
+	csnip_mem_Alloc0(N, seen, _);
+	size_t ctr = 0;
+	for (size_t s = u32map_firstoccupiedslot(T);
+		s < u32map_capacity(T);
+		s = u32map_nextoccupiedslot(T, s))
+	{
+		u32map_entry* E = u32map_getslotentryaddress(T, s);
+		always_assert(u32map_getslotfromentryaddress(T, E) == s);
+		always_assert(u32map_findslot(T, E->key) == s);
+		always_assert(E->key < N && !seen[E->key]);
+		seen[E->key] = 1;
+		++ctr;
+	}
+	always_assert(ctr == N);
+
+	ctr = 0;
+	for (size_t s = u32map_firstoccupiedslot(T);
+		s < u32map_capacity(T);
+		s = u32map_removeatslot(T, NULL, s))
+	{
+		++ctr;
+	}
+	always_assert(ctr == N);
+	always_assert(u32map_size(T) == 0);
+	u32map_free(T);
+	csnip_mem_Free(seen);
+	return 1;
+}
+
+/* Too many keys with the same hash */
+static _Bool weak_hash_test(void)
+{
+	puts("Weak hash function");
+	struct weakmap* T = weakmap_make(NULL);
+	int err = 0;
+	uint32_t k;
+	for (k = 0; k < 1000; ++k) {
+		weakmap_insert(T, &err, k);
+		if (err)
+			break;
+	}
+	printf(" %" PRIu32 " keys inserted, stash = %zu\n", k, T->nstash);
+	always_assert(err == csnip_err_RANGE);
+	always_assert(T->nstash == CSNIP_LPHASH_CUCKOOTABLE_STASH);
+	always_assert(weakmap_size(T) == k);
+
+	/* All the inserted keys are still there, some in the stash */
+	for (uint32_t j = 0; j < k; ++j)
+		always_assert(weakmap_find(T, j) != NULL);
+
+	/* Remove via the stash slots */
+	size_t ctr = 0;
+	for (size_t s = weakmap_firstoccupiedslot(T);
+		s < weakmap_capacity(T);
+		s = weakmap_removeatslot(T, NULL, s))
+	{
+		++ctr;
+	}
+	always_assert(ctr == k && T->nstash == 0);
+	weakmap_free(T);
+	return 1;
+}
+
+/* Bucket stride, and bucket placement within cache lines */
+#define BUCKET_SZ(tbltype)	sizeof(*((tbltype*)0)->bucket)
+
+static _Bool layout_test(void)
+{
+	puts("Bucket layout");
+	printf(" bucket sizes: %zu, %zu, %zu\n", BUCKET_SZ(struct u32map),
+		BUCKET_SZ(struct weakmap), BUCKET_SZ(struct u64map));
+	always_assert(BUCKET_SZ(struct u32map) == 64);
+	always_assert(BUCKET_SZ(struct weakmap) == 32);
+	always_assert(BUCKET_SZ(struct u64map) == 128);
+
+	struct u32map* T = u32map_make(NULL);
+	for (uint32_t k = 0; k < 1000; ++k)
+		u32map_insert(T, NULL, (u32map_entry){ k, k });
+	for (size_t b = 0; b < T->nbuckets; ++b) {
+		const uintptr_t first = (uintptr_t)&T->bucket[b];
+		const uintptr_t last = first + BUCKET_SZ(struct u32map) - 1;
+		always_assert(first / 64 == last / 64);
+	}
+	u32map_free(T);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(random_test(10, 20))
+	RUN_TEST(random_test(1000, 20))
+	RUN_TEST(random_test(50000, 4))
+	RUN_TEST(load_test(200000))
+	RUN_TEST(slot_test(10000))
+	RUN_TEST(weak_hash_test())
+	RUN_TEST(layout_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
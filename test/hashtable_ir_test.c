@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include <csnip/cext.h>
+#include <csnip/lphash_irtable.h>
+#include <csnip/mem.h>
+
+/*  Test for the incrementally rehashed hash table.
+ *
+ *  A random sequence of insertions and deletions is performed on the
+ *  table and on a reference bitmap, and the two are compared, also
+ *  while migrations are in progress.  Further, it is checked that
+ *  growing the table does not migrate all entries at once, and that
+ *  iteration over the slots sees the entries of both arrays.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+typedef struct {
+	uint32_t key;
+	uint32_t val;
+} u32map_entry;
+
+static uint32_t u32hash(uint32_t a)
+{
+	a ^= a >> 16;
+	a *= 0x7feb352dul;
+	a ^= a >> 15;
+	a *= 0x846ca68bul;
+	a ^= a >> 16;
+	return a;
+}
+
+CSNIP_LPHASH_IRTABLE_DEF_TYPE(u32map, u32map_entry)
+CSNIP_LPHASH_IRTABLE_DEF_FUNCS(csnip_cext_unused static,
+			u32map_,
+			uint32_t,
+			u32map_entry,
+			struct u32map,
+			k1, k2, e,
+			u32hash(k1),
+			k1 == k2,
+			e.key)
+
+static void check_counts(const struct u32map* T)
+{
+	size_t n = 0, on = 0;
+	for (size_t i = 0; i < T->cap; ++i)
+		n += T->occ[i];
+	for (size_t i = 0; i < T->ocap; ++i)
+		on += T->oocc[i];
+	always_assert(on == T->osize);
+	always_assert(n + on == T->size);
+}
+
+static _Bool random_test(uint32_t range, int nrounds)
+{
+	printf("Random operations: key range = %" PRIu32 "\n", range);
+	unsigned char* present;
+	csnip_mem_Alloc0(range, present, _);
+	struct u32map* T = u32map_make(NULL);
+	size_t n = 0;
+	int nmigrating = 0;
+	srand(range);
+	for (int round = 0; round < nrounds; ++round) {
+		for (uint32_t i = 0; i < range; ++i) {
+			const uint32_t k = (uint32_t)rand() % range;
+			const int op = rand() % 4;
+			if (op == 0) {
+				_Bool r = u32map_remove(T, NULL, k);
+				always_assert(r == present[k]);
+				if (r) --n;
+				present[k] = 0;
+			} else if (op == 1) {
+				u32map_entry E = { k, k * 3 }, O;
+				int r = u32map_insert_or_assign(T, NULL,
+					E, &O);
+				always_assert(r == !present[k]);
+				always_assert(r || O.key == k);
+				if (r) ++n;
+				present[k] = 1;
+			} else {
+				u32map_entry E = { k, k * 3 };
+				int r = u32map_insert(T, NULL, E);
+				always_assert(r == !present[k]);
+				if (r) ++n;
+				present[k] = 1;
+			}
+
+			/* Spot check in the middle of migrations */
+			if (T->osize > 0 && i % 64 == 0) {
+				++nmigrating;
+				check_counts(T);
+				always_assert(!!u32map_find(T, k)
+					== present[k]);
+			}
+		}
+		always_assert(u32map_size(T) == n);
+		check_counts(T);
+		for (uint32_t k = 0; k < range; ++k) {
+			u32map_entry* E = u32map_find(T, k);
+			always_assert((E != NULL) == present[k]);
+			always_assert(!E || E->val == 3 * k);
+		}
+	}
+	printf(" size = %zu, capacity = %zu, checks during migration: %d\n",
+		u32map_size(T), u32map_capacity(T), nmigrating);
+	u32map_free(T);
+	csnip_mem_Free(present);
+	return 1;
+}
+
+/* Growth is incremental, and the slot functions cover both arrays */
+static _Bool migration_test(uint32_t N)
+{
+	printf("Migration test: N = %" PRIu32 "\n", N);
+	struct u32map* T = u32map_make(NULL);
+	size_t maxold = 0, ngrow = 0;
+	for (uint32_t k = 0; k < N; ++k) {
+		const size_t cap = T->cap;
+		u32map_insert(T, NULL, (u32map_entry){ k, k });
+		if (T->cap != cap && cap >= 1024) {
+			/* Most entries must still be in the old array */
+			++ngrow;
+			always_assert(T->osize * 2 > T->size);
+		}
+		if (T->osize > maxold)
+			maxold = T->osize;
+	}
+	printf(" growths checked: %zu, max entries pending: %zu\n",
+		ngrow, maxold);
+	always_assert(ngrow > 0);
+
+	/* Find the table in the middle of a migration */
+	uint32_t k = N;
+	while (T->osize == 0 || T->osize * 2 < T->size) {
+		u32map_insert(T, NULL, (u32map_entry){ k, k });
+		++k;
+	}
+	const uint32_t nkeys = k;
+	check_counts(T);
+
+	/* Check that every key is seen exactly once by iteration */
+	unsigned char* seen;
+	csnip_mem_Alloc0(nkeys, seen, _);
+	size_t ctr = 0;
+	for (size_t s = u32map_firstoccupiedslot(T);
+		s < u32map_capacity(T);
+		s = u32map_nextoccupiedslot(T, s))
+	{
+		u32map_entry* E = u32map_getslotentryaddress(T, s);
+		always_assert(u32map_getslotfromentryaddress(T, E) == s);
+		always_assert(u32map_findslot(T, E->key) == s);
+		always_assert(E->key < nkeys && !seen[E->key]);
+		seen[E->key] = 1;
+		++ctr;
+	}
+	always_assert(ctr == nkeys);
+
+	/* Remove everything with removeatslot() */
+	ctr = 0;
+	for (size_t s = u32map_firstoccupiedslot(T);
+		s < u32map_capacity(T);
+		s = u32map_removeatslot(T, NULL, s))
+	{
+		++ctr;
+	}
+	printf(" removeatslot() iterations: %zu\n", ctr);
+	always_assert(ctr == nkeys);
+	always_assert(u32map_size(T) == 0);
+	check_counts(T);
+
+	u32map_free(T);
+	csnip_mem_Free(seen);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(random_test(10, 20))
+	RUN_TEST(random_test(1000, 20))
+	RUN_TEST(random_test(50000, 4))
+	RUN_TEST(migration_test(100000))
+
+	puts("-> tests passed.");
+	return 0;
+}
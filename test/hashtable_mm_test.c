@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <csnip/cext.h>
+#include <csnip/err.h>
+#include <csnip/hash.h>
+#include <csnip/lphash_mmtable.h>
+
+/*  Test for the memory mapped read-only hash table.
+ *
+ *  Tables with integer keys, and with string keys and values stored
+ *  in the data area, are built, saved, loaded again, and compared
+ *  with the inserted entries.  Further, loading files with the wrong
+ *  tag, built for another size_t width, truncated files and missing
+ *  files must fail.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+#define TBLFILE "hashtable_mm_test.tbl"
+
+static uint64_t u64hash(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+/* Integer keys and values */
+typedef struct {
+	uint64_t a;
+	uint32_t b;
+} u64val;
+
+CSNIP_LPHASH_MMTABLE_DEF_TYPE(u64bld, uint64_t, u64val)
+CSNIP_LPHASH_MMTABLE_DEF_FUNCS(csnip_cext_unused static, u64tbl_,
+	uint64_t, uint64_t, u64val, struct u64bld,
+	k1, k2, d, u64hash(k1), k1 == k2)
+
+/* String keys and values */
+typedef csnip_lphash_mmtable_ref strref;
+
+static _Bool str_match(const char* s, const char* d, strref r)
+{
+	return strlen(s) == r.len && memcmp(s, d + r.off, r.len) == 0;
+}
+
+CSNIP_LPHASH_MMTABLE_DEF_TYPE(strbld, strref, strref)
+CSNIP_LPHASH_MMTABLE_DEF_FUNCS(csnip_cext_unused static, strtbl_,
+	const char*, strref, strref, struct strbld,
+	k1, k2, d, csnip_hash_fnv64_s(k1, CSNIP_FNV64_INIT),
+	str_match(k1, d, k2))
+
+static _Bool int_test(uint64_t N)
+{
+	printf("Integer keys: N = %" PRIu64 "\n", N);
+	struct u64bld* B = u64tbl_builder_make(NULL);
+	for (uint64_t k = 0; k < N; ++k) {
+		const u64val v = { 3 * k, (uint32_t)k };
+		always_assert(u64tbl_builder_insert(B, NULL, k, k, v) == 1);
+	}
+	always_assert(u64tbl_builder_insert(B, NULL, 0,
+		0, (u64val){ 0, 0 }) == 0);
+	int err;
+	u64tbl_builder_save(B, &err, TBLFILE, 1);
+	always_assert(err == 0);
+	u64tbl_builder_free(B);
+
+	csnip_lphash_mmtable* T = u64tbl_open(TBLFILE, 1, &err);
+	always_assert(T != NULL && err == 0);
+	always_assert(u64tbl_size(T) == N);
+	printf(" size = %zu, capacity = %zu\n",
+		u64tbl_size(T), u64tbl_capacity(T));
+	for (uint64_t k = 0; k < 2 * N; ++k) {
+		const u64val* V = u64tbl_find(T, k);
+		always_assert((V != NULL) == (k < N));
+		always_assert(!V || (V->a == 3 * k && V->b == (uint32_t)k));
+	}
+
+	/* Iteration */
+	size_t ctr = 0;
+	for (size_t s = u64tbl_firstoccupiedslot(T);
+		s < u64tbl_capacity(T);
+		s = u64tbl_nextoccupiedslot(T, s))
+	{
+		const uint64_t k = *u64tbl_getslotkeyaddress(T, s);
+		always_assert(u64tbl_findslot(T, k) == s);
+		always_assert(u64tbl_getslotvalueaddress(T, s)->a == 3 * k);
+		++ctr;
+	}
+	always_assert(ctr == N);
+	csnip_lphash_mmtable_close(T);
+	return 1;
+}
+
+static _Bool string_test(int N)
+{
+	printf("String keys: N = %d\n", N);
+	struct strbld* B = strtbl_builder_make(NULL);
+	char key[32], val[32];
+	for (int i = 0; i < N; ++i) {
+		snprintf(key, sizeof(key), "key-%d", i);
+		snprintf(val, sizeof(val), "value-%d", i * 7);
+		strref rk = strtbl_builder_adddata(B, NULL, key, strlen(key));
+		strref rv = strtbl_builder_adddata(B, NULL, val, strlen(val));
+		always_assert(strtbl_builder_insert(B, NULL, key, rk, rv) == 1);
+	}
+	strtbl_builder_save(B, NULL, TBLFILE, 2);
+	strtbl_builder_free(B);
+
+	csnip_lphash_mmtable* T = strtbl_open(TBLFILE, 2, NULL);
+	always_assert(strtbl_size(T) == (size_t)N);
+	for (int i = 0; i < N; ++i) {
+		snprintf(key, sizeof(key), "key-%d", i);
+		snprintf(val, sizeof(val), "value-%d", i * 7);
+		const strref* V = strtbl_find(T, key);
+		always_assert(V != NULL && V->len == strlen(val));
+		const char* p = csnip_lphash_mmtable_data(T, *V);
+		always_assert(p && memcmp(p, val, V->len) == 0);
+	}
+	always_assert(strtbl_find(T, "key-x") == NULL);
+	csnip_lphash_mmtable_close(T);
+	return 1;
+}
+
+static _Bool error_test(void)
+{
+	puts("Error cases");
+	int err;
+
+	/* Empty table */
+	struct u64bld* B = u64tbl_builder_make(NULL);
+	u64tbl_builder_save(B, NULL, TBLFILE, 1);
+	u64tbl_builder_free(B);
+	csnip_lphash_mmtable* T = u64tbl_open(TBLFILE, 1, NULL);
+	always_assert(u64tbl_size(T) == 0 && u64tbl_find(T, 1) == NULL);
+	always_assert(u64tbl_firstoccupiedslot(T) == u64tbl_capacity(T));
+	csnip_lphash_mmtable_close(T);
+
+	/* Wrong tag or record types */
+	always_assert(u64tbl_open(TBLFILE, 2, &err) == NULL);
+	always_assert(err == csnip_err_FORMAT);
+	always_assert(strtbl_open(TBLFILE, 1, &err) == NULL);
+	always_assert(err == csnip_err_FORMAT);
+
+	/* Other hash width; the field follows the magic, version and
+	 * byte order */
+	FILE* fp = fopen(TBLFILE, "r+b");
+	const uint32_t hashsize = (sizeof(size_t) == 8 ? 4 : 8);
+	always_assert(fp && fseek(fp, 16, SEEK_SET) == 0);
+	always_assert(fwrite(&hashsize, sizeof(hashsize), 1, fp) == 1);
+	fclose(fp);
+	always_assert(u64tbl_open(TBLFILE, 1, &err) == NULL);
+	always_assert(err == csnip_err_FORMAT);
+
+	/* Truncated file */
+	fp = fopen(TBLFILE, "wb");
+	fputs("csnLPHT", fp);
+	fclose(fp);
+	always_assert(u64tbl_open(TBLFILE, 1, &err) == NULL);
+	always_assert(err == csnip_err_FORMAT);
+
+	/* Missing file */
+	remove(TBLFILE);
+	always_assert(u64tbl_open(TBLFILE, 1, &err) == NULL);
+	always_assert(err == csnip_err_ERRNO);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(int_test(100000))
+	RUN_TEST(string_test(10000))
+	RUN_TEST(error_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include <csnip/cext.h>
+#include <csnip/lphash_table.h>
+#include <csnip/lphash_rhtable.h>
+#include <csnip/lphash_swtable.h>
+#include <csnip/lphash_irtable.h>
+
+/*  Test for make_with_cap(), reserve() and shrink().
+ *
+ *  For each of the hash table implementations, check that a reserved
+ *  table does not grow while filling it up to the reserved size, and
+ *  that shrinking after removals reduces the capacity and keeps the
+ *  remaining entries.  For lphash_table, also check that a custom
+ *  maximum load factor is respected.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+static uint32_t u32hash(uint32_t a)
+{
+	a ^= a >> 16;
+	a *= 0x7feb352dul;
+	a ^= a >> 15;
+	a *= 0x846ca68bul;
+	a ^= a >> 16;
+	return a;
+}
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(lptbl, uint32_t)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(csnip_cext_unused static, lptbl_,
+	uint32_t, uint32_t, struct lptbl,
+	k1, k2, e, u32hash(k1), k1 == k2, e)
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(rhtbl, uint32_t)
+CSNIP_LPHASH_RHTABLE_DEF_FUNCS(csnip_cext_unused static, rhtbl_,
+	uint32_t, uint32_t, struct rhtbl,
+	k1, k2, e, u32hash(k1), k1 == k2, e)
+
+CSNIP_LPHASH_SWTABLE_DEF_TYPE(swtbl, uint32_t)
+CSNIP_LPHASH_SWTABLE_DEF_FUNCS(csnip_cext_unused static, swtbl_,
+	uint32_t, uint32_t, struct swtbl,
+	k1, k2, e, u32hash(k1), k1 == k2, e)
+
+CSNIP_LPHASH_IRTABLE_DEF_TYPE(irtbl, uint32_t)
+CSNIP_LPHASH_IRTABLE_DEF_FUNCS(csnip_cext_unused static, irtbl_,
+	uint32_t, uint32_t, struct irtbl,
+	k1, k2, e, u32hash(k1), k1 == k2, e)
+
+/* Linear probing with maximum load 1/2 */
+CSNIP_LPHASH_TABLE_DEF_TYPE(lphtbl, uint32_t)
+CSNIP_LPHASH_TABLE_DEF_FUNCS_WITH_LOAD(csnip_cext_unused static, lphtbl_,
+	uint32_t, uint32_t, struct lphtbl,
+	k1, k2, e, u32hash(k1), k1 == k2, e, 1, 2)
+
+#define DEF_TEST(name, prefix, tbltype) \
+	static _Bool name(const char* desc, uint32_t N) \
+	{ \
+		printf("%s: N = %" PRIu32 "\n", desc, N); \
+		int err; \
+		tbltype* T = prefix##make_with_cap(&err, N); \
+		always_assert(T != NULL && err == 0); \
+		const size_t cap0 = prefix##capacity(T); \
+		always_assert(cap0 > 0); \
+		\
+		/* Fill up without growing */ \
+		for (uint32_t k = 0; k < N; ++k) { \
+			always_assert(prefix##insert(T, NULL, k) == 1); \
+			always_assert(prefix##capacity(T) == cap0); \
+		} \
+		printf(" capacity %zu for %" PRIu32 " entries\n", cap0, N); \
+		\
+		/* reserve() does not shrink */ \
+		prefix##reserve(T, &err, 1); \
+		always_assert(err == 0 && prefix##capacity(T) == cap0); \
+		\
+		/* Remove most, and shrink */ \
+		for (uint32_t k = 0; k < N; ++k) { \
+			if ((k & 15) != 0) \
+				always_assert(prefix##remove(T, NULL, k)); \
+		} \
+		prefix##shrink(T, &err); \
+		always_assert(err == 0); \
+		printf(" capacity %zu after shrinking to %zu entries\n", \
+			prefix##capacity(T), prefix##size(T)); \
+		always_assert(prefix##capacity(T) * 4 < cap0); \
+		for (uint32_t k = 0; k < N; ++k) { \
+			always_assert((prefix##find(T, k) != NULL) \
+				== ((k & 15) == 0)); \
+		} \
+		\
+		/* Reserve again on a nonempty table;  with lphash_irtable, \
+		 * the capacity includes the old arrays until migrated. */ \
+		prefix##reserve(T, &err, 2 * (size_t)N); \
+		always_assert(err == 0); \
+		const size_t cap1 = prefix##capacity(T); \
+		for (uint32_t k = N; k < 2 * N; ++k) \
+			prefix##insert(T, NULL, k); \
+		always_assert(prefix##capacity(T) <= cap1); \
+		always_assert(prefix##size(T) == N + (N + 15) / 16); \
+		\
+		/* Shrinking an empty table releases the memory */ \
+		for (uint32_t k = 0; k < 2 * N; ++k) \
+			prefix##remove(T, NULL, k); \
+		prefix##shrink(T, NULL); \
+		always_assert(prefix##capacity(T) == 0); \
+		always_assert(prefix##insert(T, NULL, 42) == 1); \
+		always_assert(prefix##find(T, 42) != NULL); \
+		\
+		prefix##free(T); \
+		return 1; \
+	}
+
+DEF_TEST(lp_test, lptbl_, struct lptbl)
+DEF_TEST(rh_test, rhtbl_, struct rhtbl)
+DEF_TEST(sw_test, swtbl_, struct swtbl)
+DEF_TEST(ir_test, irtbl_, struct irtbl)
+DEF_TEST(lph_test, lphtbl_, struct lphtbl)
+
+/* The load of the half-load table never exceeds 1/2 */
+static _Bool load_test(void)
+{
+	puts("Maximum load 1/2");
+	struct lphtbl* T = lphtbl_make(NULL);
+	for (uint32_t k = 0; k < 10000; ++k) {
+		lphtbl_insert(T, NULL, k);
+		always_assert(lphtbl_size(T) * 2 <= lphtbl_capacity(T));
+	}
+	lphtbl_free(T);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(lp_test("lphash_table", 10000))
+	RUN_TEST(rh_test("lphash_rhtable", 10000))
+	RUN_TEST(sw_test("lphash_swtable", 10000))
+	RUN_TEST(ir_test("lphash_irtable", 10000))
+	RUN_TEST(lph_test("lphash_table, load 1/2", 10000))
+	RUN_TEST(load_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include <csnip/cext.h>
+#include <csnip/lphash_rhtable.h>
+#include <csnip/mem.h>
+
+/*  Test for the Robin Hood hash table.
+ *
+ *  A random sequence of insertions and deletions is performed on the
+ *  table and on a reference bitmap, and the two are compared.  After
+ *  each round, the Robin Hood invariants are checked:  The stored
+ *  probe distance matches the distance from the home slot, and probe
+ *  distances within a cluster increase by at most one per slot.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+typedef struct {
+	uint32_t key;
+	uint32_t val;
+} u32map_entry;
+
+static uint32_t u32hash(uint32_t a)
+{
+	a ^= a >> 16;
+	a *= 0x7feb352dul;
+	a ^= a >> 15;
+	a *= 0x846ca68bul;
+	a ^= a >> 16;
+	return a;
+}
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(u32map, u32map_entry)
+CSNIP_LPHASH_RHTABLE_DEF_FUNCS(csnip_cext_unused static,
+			u32map_,
+			uint32_t,
+			u32map_entry,
+			struct u32map,
+			k1, k2, e,
+			u32hash(k1),
+			k1 == k2,
+			e.key)
+
+/* Weak hash, only every 16th slot is a home slot */
+CSNIP_LPHASH_TABLE_DEF_TYPE(u32wmap, u32map_entry)
+CSNIP_LPHASH_RHTABLE_DEF_FUNCS(csnip_cext_unused static,
+			u32wmap_,
+			uint32_t,
+			u32map_entry,
+			struct u32wmap,
+			k1, k2, e,
+			k1 * 16,
+			k1 == k2,
+			e.key)
+
+#define DEF_CHECK_INVARIANTS(name, tbltype, hash) \
+	static void name(const tbltype* T) \
+	{ \
+		size_t n = 0; \
+		for (size_t i = 0; i < T->cap; ++i) { \
+			if (T->occ[i] == 0) \
+				continue; \
+			++n; \
+			const size_t home = (hash(T->entry[i].key)) \
+				& (T->cap - 1); \
+			always_assert(((home + T->occ[i] - 1) & (T->cap - 1)) \
+				== i); \
+			const size_t j = (i + 1) & (T->cap - 1); \
+			always_assert(T->occ[j] <= T->occ[i] + 1); \
+		} \
+		always_assert(n == T->size); \
+	}
+
+#define weak_hash(k)	((k) * 16)
+DEF_CHECK_INVARIANTS(check_invariants, struct u32map, u32hash)
+DEF_CHECK_INVARIANTS(check_winvariants, struct u32wmap, weak_hash)
+
+#define DEF_RANDOM_TEST(name, tbltype, prefix, checkfunc) \
+	static _Bool name(uint32_t range, int nrounds) \
+	{ \
+		printf("Random operations: key range = %" PRIu32 "\n", \
+			range); \
+		unsigned char* present; \
+		csnip_mem_Alloc0(range, present, _); \
+		tbltype* T = prefix##make(NULL); \
+		size_t n = 0; \
+		srand(range); \
+		for (int round = 0; round < nrounds; ++round) { \
+			for (uint32_t i = 0; i < range; ++i) { \
+				const uint32_t k = (uint32_t)rand() % range; \
+				if (rand() % 3 != 0) { \
+					/* insert */ \
+					u32map_entry E = { k, k * 3 }; \
+					int r = prefix##insert(T, NULL, E); \
+					always_assert(r == !present[k]); \
+					if (r) ++n; \
+					present[k] = 1; \
+				} else { \
+					_Bool r = prefix##remove(T, NULL, k); \
+					always_assert(r == present[k]); \
+					if (r) --n; \
+					present[k] = 0; \
+				} \
+			} \
+			always_assert(prefix##size(T) == n); \
+			checkfunc(T); \
+			for (uint32_t k = 0; k < range; ++k) { \
+				u32map_entry* E = prefix##find(T, k); \
+				always_assert((E != NULL) == present[k]); \
+				always_assert(!E || E->val == 3 * k); \
+			} \
+		} \
+		printf(" size = %zu, capacity = %zu\n", \
+			prefix##size(T), prefix##capacity(T)); \
+		\
+		/* Remove everything with removeatslot() */ \
+		size_t ctr = 0; \
+		for (size_t s = prefix##firstoccupiedslot(T); \
+			s < prefix##capacity(T); \
+			s = prefix##removeatslot(T, NULL, s)) \
+		{ \
+			++ctr; \
+		} \
+		printf(" removeatslot() iterations: %zu\n", ctr); \
+		always_assert(prefix##size(T) == 0); \
+		prefix##free(T); \
+		csnip_mem_Free(present); \
+		return 1; \
+	}
+
+DEF_RANDOM_TEST(random_test, struct u32map, u32map_, check_invariants)
+DEF_RANDOM_TEST(random_wtest, struct u32wmap, u32wmap_, check_winvariants)
+
+/* Check that the table fills up to high loads before growing */
+static _Bool load_test(void)
+{
+	puts("Load factor test");
+	struct u32map* T = u32map_make(NULL);
+	double max_load = 0;
+	for (uint32_t k = 0; k < 100000; ++k) {
+		const size_t cap = u32map_capacity(T);
+		const double load = u32map_size(T) / (double)cap;
+		u32map_insert(T, NULL, (u32map_entry){ k, k });
+		if (cap != u32map_capacity(T) && cap >= 1024) {
+			printf(" Grew from %zu at load %g\n", cap, load);
+			if (load > max_load)
+				max_load = load;
+		}
+	}
+	check_invariants(T);
+	u32map_free(T);
+	return max_load > 0.85;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(random_test(10, 20))
+	RUN_TEST(random_test(1000, 20))
+	RUN_TEST(random_test(50000, 4))
+	RUN_TEST(random_wtest(1000, 20))
+	RUN_TEST(random_wtest(10000, 4))
+	RUN_TEST(load_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <csnip/cext.h>
+#include <csnip/hash.h>
+#include <csnip/lphash_soatable.h>
+#include <csnip/mem.h>
+
+/*  Test for the split key/value hash table.
+ *
+ *  A random sequence of insertions and deletions with large values is
+ *  performed on the table and on a reference bitmap, and the two are
+ *  compared.  Further, iteration and removal via the slot functions
+ *  are checked, as well as a table with string keys.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+typedef struct {
+	uint64_t a[12];
+} bigval;
+
+static uint64_t u64hash(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+static bigval mkval(uint64_t k)
+{
+	bigval v;
+	for (int i = 0; i < 12; ++i)
+		v.a[i] = k * 12 + (uint64_t)i;
+	return v;
+}
+
+static _Bool isval(const bigval* v, uint64_t k)
+{
+	for (int i = 0; i < 12; ++i) {
+		if (v->a[i] != k * 12 + (uint64_t)i)
+			return 0;
+	}
+	return 1;
+}
+
+CSNIP_LPHASH_SOATABLE_DEF_TYPE(u64map, uint64_t, bigval)
+CSNIP_LPHASH_SOATABLE_DEF_FUNCS(csnip_cext_unused static,
+			u64map_,
+			uint64_t,
+			bigval,
+			struct u64map,
+			k1, k2,
+			u64hash(k1),
+			k1 == k2)
+
+CSNIP_LPHASH_SOATABLE_DEF_TYPE(strmap, const char*, int)
+CSNIP_LPHASH_SOATABLE_DEF_FUNCS(csnip_cext_unused static,
+			strmap_,
+			const char*,
+			int,
+			struct strmap,
+			k1, k2,
+			csnip_hash_fnv64_s(k1, CSNIP_FNV64_INIT),
+			strcmp(k1, k2) == 0)
+
+static _Bool random_test(uint64_t range, int nrounds)
+{
+	printf("Random operations: key range = %" PRIu64 "\n", range);
+	unsigned char* present;
+	csnip_mem_Alloc0(range, present, _);
+	struct u64map* T = u64map_make(NULL);
+	size_t n = 0;
+	srand((unsigned int)range);
+	for (int round = 0; round < nrounds; ++round) {
+		for (uint64_t i = 0; i < range; ++i) {
+			const uint64_t k = (uint64_t)rand() % range;
+			const int op = rand() % 4;
+			if (op == 0) {
+				_Bool r = u64map_remove(T, NULL, k);
+				always_assert(r == present[k]);
+				if (r) --n;
+				present[k] = 0;
+			} else if (op == 1) {
+				bigval O;
+				int r = u64map_insert_or_assign(T, NULL,
+					k, mkval(k), &O);
+				always_assert(r == !present[k]);
+				always_assert(r || isval(&O, k));
+				if (r) ++n;
+				present[k] = 1;
+			} else if (op == 2) {
+				bigval* V = u64map_find_or_insert(T, NULL,
+					k, mkval(k));
+				always_assert(V && isval(V, k));
+				if (!present[k]) ++n;
+				present[k] = 1;
+			} else {
+				int r = u64map_insert(T, NULL, k, mkval(k));
+				always_assert(r == !present[k]);
+				if (r) ++n;
+				present[k] = 1;
+			}
+		}
+		always_assert(u64map_size(T) == n);
+		for (uint64_t k = 0; k < range; ++k) {
+			bigval* V = u64map_find(T, k);
+			always_assert((V != NULL) == present[k]);
+			always_assert(!V || isval(V, k));
+		}
+	}
+	printf(" size = %zu, capacity = %zu\n",
+		u64map_size(T), u64map_capacity(T));
+	u64map_free(T);
+	csnip_mem_Free(present);
+	return 1;
+}
+
+static _Bool slot_test(uint64_t N)
+{
+	printf("Slot functions: N = %" PRIu64 "\n", N);
+	struct u64map* T = u64map_make_with_cap(NULL, N);
+	for (uint64_t k = 0; k < N; ++k)
+		always_assert(u64map_insert(T, NULL, k, mkval(k)) == 1);
+
+	/* Every key is seen exactly once by iteration */
+	unsigned char* seen;
+	csnip_mem_Alloc0(N, seen, _);
+	size_t ctr = 0;
+	for (size_t s = u64map_firstoccupiedslot(T);
+		s < u64map_capacity(T);
+		s = u64map_nextoccupiedslot(T, s))
+	{
+		always_assert(u64map_isslotoccupied(T, s));
+		const uint64_t k = *u64map_getslotkeyaddress(T, s);
+		bigval* V = u64map_getslotvalueaddress(T, s);
+		always_assert(k < N && !seen[k]);
+		always_assert(isval(V, k));
+		always_assert(u64map_getslotfromvalueaddress(T, V) == s);
+		always_assert(u64map_findslot(T, k) == s);
+		seen[k] = 1;
+		++ctr;
+	}
+	always_assert(ctr == N);
+	always_assert(u64map_findslot(T, N) == u64map_capacity(T));
+
+	/* Remove the odd keys with removeatslot() */
+	for (size_t s = u64map_firstoccupiedslot(T);
+		s < u64map_capacity(T); )
+	{
+		if (*u64map_getslotkeyaddress(T, s) & 1)
+			s = u64map_removeatslot(T, NULL, s);
+		else
+			s = u64map_nextoccupiedslot(T, s);
+	}
+	always_assert(u64map_size(T) == (N + 1) / 2);
+	for (uint64_t k = 0; k < N; ++k) {
+		bigval* V = u64map_find(T, k);
+		always_assert((V != NULL) == !(k & 1));
+		always_assert(!V || isval(V, k));
+	}
+
+	/* Shrink keeps the remaining entries */
+	const size_t cap0 = u64map_capacity(T);
+	u64map_shrink(T, NULL);
+	always_assert(u64map_capacity(T) < cap0);
+	for (uint64_t k = 0; k < N; k += 2)
+		always_assert(isval(u64map_find(T, k), k));
+
+	u64map_free(T);
+	csnip_mem_Free(seen);
+	return 1;
+}
+
+static _Bool string_test(int N)
+{
+	printf("String keys: N = %d\n", N);
+	char (*buf)[16];
+	csnip_mem_Alloc((size_t)N, buf, _);
+	struct strmap* T = strmap_make(NULL);
+	for (int i = 0; i < N; ++i) {
+		snprintf(buf[i], sizeof(buf[i]), "key-%d", i);
+		always_assert(strmap_insert(T, NULL, buf[i], i) == 1);
+	}
+	for (int i = 0; i < N; ++i) {
+		char key[16];
+		snprintf(key, sizeof(key), "key-%d", i);
+		int* V = strmap_find(T, key);
+		always_assert(V && *V == i);
+		always_assert(strcmp(*strmap_getslotkeyaddress(T,
+			strmap_findslot(T, key)), key) == 0);
+	}
+	always_assert(strmap_find(T, "nonexistent") == NULL);
+	strmap_free(T);
+	csnip_mem_Free(buf);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(random_test(10, 20))
+	RUN_TEST(random_test(1000, 20))
+	RUN_TEST(random_test(50000, 4))
+	RUN_TEST(slot_test(10000))
+	RUN_TEST(string_test(10000))
+
+	puts("-> tests passed.");
+	return 0;
+}
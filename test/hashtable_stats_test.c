@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#define CSNIP_LPHASH_TABLE_STATS
+#include <csnip/cext.h>
+#include <csnip/lphash_table.h>
+
+/*  Test for the hash table statistics.
+ *
+ *  Keys are inserted and looked up in tables with a good and a
+ *  constant hash function, and the search counts, probe length
+ *  histograms and rehash counts are checked.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+static uint64_t u64hash(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(u64tbl, uint64_t)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(csnip_cext_unused static, good_,
+	uint64_t, uint64_t, struct u64tbl,
+	k1, k2, e, u64hash(k1), k1 == k2, e)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(csnip_cext_unused static, bad_,
+	uint64_t, uint64_t, struct u64tbl,
+	k1, k2, e, 0 * k1, k1 == k2, e)
+
+static uint64_t hist_sum(const csnip_lphash_stats* S)
+{
+	uint64_t r = 0;
+	for (int i = 0; i < CSNIP_LPHASH_STATS_NHIST; ++i)
+		r += S->probehist[i];
+	return r;
+}
+
+static _Bool count_test(uint64_t N)
+{
+	printf("Counts: N = %" PRIu64 "\n", N);
+	struct u64tbl* T = good_make(NULL);
+	int nrehash = 0;
+	for (uint64_t k = 0; k < N; ++k) {
+		const size_t cap = good_capacity(T);
+		good_insert(T, NULL, k);
+		if (good_capacity(T) != cap)
+			++nrehash;
+	}
+	csnip_lphash_stats S = good_stats(T);
+	always_assert(S.size == N && S.cap == good_capacity(T));
+	always_assert(S.nhit == 0 && S.nmiss == N);
+	always_assert(S.nrehash == (uint64_t)nrehash);
+	always_assert(S.rehash_time >= 0.0);
+
+	good_resetstats(T);
+	for (uint64_t k = 0; k < 2 * N; ++k)
+		good_find(T, k);
+	S = good_stats(T);
+	always_assert(S.nhit == N && S.nmiss == N);
+	always_assert(hist_sum(&S) == 2 * N);
+	always_assert(S.nprobe_hit >= N && S.nprobe_miss >= N);
+	always_assert(S.maxprobe >= 1 && S.nrehash == 0);
+
+	/* With a good hash function, the probe lengths are short */
+	always_assert(S.nprobe_hit < 3 * N && S.nprobe_miss < 6 * N);
+	csnip_lphash_stats_dump(stdout, "good", &S);
+	good_free(T);
+	return 1;
+}
+
+static _Bool bad_hash_test(uint64_t N)
+{
+	printf("Constant hash: N = %" PRIu64 "\n", N);
+	struct u64tbl* T = bad_make(NULL);
+	for (uint64_t k = 0; k < N; ++k)
+		bad_insert(T, NULL, k);
+	bad_resetstats(T);
+	for (uint64_t k = 0; k < N; ++k)
+		always_assert(bad_find(T, k) != NULL);
+	csnip_lphash_stats S = bad_stats(T);
+	always_assert(S.nhit == N && S.nmiss == 0);
+
+	/* The i-th key is found after i + 1 probes */
+	always_assert(S.nprobe_hit == N * (N + 1) / 2);
+	always_assert(S.maxprobe == N);
+	csnip_lphash_stats_dump(stdout, "bad", &S);
+	bad_free(T);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(count_test(10000))
+	RUN_TEST(bad_hash_test(500))
+
+	puts("-> tests passed.");
+	return 0;
+}
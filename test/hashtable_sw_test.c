@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <csnip/cext.h>
+#include <csnip/hash.h>
+#include <csnip/lphash_swtable.h>
+#include <csnip/mem.h>
+
+/*  Test for the group probing hash table.
+ *
+ *  A random sequence of insertions and deletions is performed on the
+ *  table and on a reference bitmap, and the two are compared.  After
+ *  each round, the control bytes are checked for consistency with
+ *  the entries and the size and tombstone counts.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+typedef struct {
+	uint32_t key;
+	uint32_t val;
+} u32map_entry;
+
+static uint32_t u32hash(uint32_t a)
+{
+	a ^= a >> 16;
+	a *= 0x7feb352dul;
+	a ^= a >> 15;
+	a *= 0x846ca68bul;
+	a ^= a >> 16;
+	return a;
+}
+
+CSNIP_LPHASH_SWTABLE_DEF_TYPE(u32map, u32map_entry)
+CSNIP_LPHASH_SWTABLE_DEF_FUNCS(csnip_cext_unused static,
+			u32map_,
+			uint32_t,
+			u32map_entry,
+			struct u32map,
+			k1, k2, e,
+			u32hash(k1),
+			k1 == k2,
+			e.key)
+
+/* String keyed table */
+CSNIP_LPHASH_SWTABLE_DEF_TYPE(strmap, char*)
+CSNIP_LPHASH_SWTABLE_DEF_FUNCS(csnip_cext_unused static,
+			strmap_,
+			const char*,
+			char*,
+			struct strmap,
+			k1, k2, e,
+			csnip_hash_fnv64_s(k1, CSNIP_FNV64_INIT),
+			strcmp(k1, k2) == 0,
+			e)
+
+static void check_invariants(const struct u32map* T)
+{
+	size_t n = 0, ndel = 0;
+	for (size_t i = 0; i < T->cap; ++i) {
+		if (T->occ[i] == 1) {
+			++ndel;
+		} else if (T->occ[i] != 0) {
+			++n;
+			always_assert(T->occ[i]
+			  == (0x80 | (u32hash(T->entry[i].key) & 0x7f)));
+		}
+	}
+	always_assert(n == T->size);
+	always_assert(ndel == T->ndel);
+	always_assert((n + ndel) * 8 <= T->cap * 7);
+}
+
+static _Bool random_test(uint32_t range, int nrounds)
+{
+	printf("Random operations: key range = %" PRIu32 "\n", range);
+	unsigned char* present;
+	csnip_mem_Alloc0(range, present, _);
+	struct u32map* T = u32map_make(NULL);
+	size_t n = 0;
+	srand(range);
+	for (int round = 0; round < nrounds; ++round) {
+		for (uint32_t i = 0; i < range; ++i) {
+			const uint32_t k = (uint32_t)rand() % range;
+			if (rand() % 2 != 0) {
+				u32map_entry E = { k, k * 3 };
+				int r = u32map_insert(T, NULL, E);
+				always_assert(r == !present[k]);
+				if (r) ++n;
+				present[k] = 1;
+			} else {
+				_Bool r = u32map_remove(T, NULL, k);
+				always_assert(r == present[k]);
+				if (r) --n;
+				present[k] = 0;
+			}
+		}
+		always_assert(u32map_size(T) == n);
+		check_invariants(T);
+		for (uint32_t k = 0; k < range; ++k) {
+			u32map_entry* E = u32map_find(T, k);
+			always_assert((E != NULL) == present[k]);
+			always_assert(!E || E->val == 3 * k);
+		}
+	}
+	printf(" size = %zu, capacity = %zu, tombstones = %zu\n",
+		u32map_size(T), u32map_capacity(T), T->ndel);
+
+	/* Remove everything with removeatslot() */
+	size_t ctr = 0;
+	for (size_t s = u32map_firstoccupiedslot(T);
+		s < u32map_capacity(T);
+		s = u32map_removeatslot(T, NULL, s))
+	{
+		++ctr;
+	}
+	printf(" removeatslot() iterations: %zu\n", ctr);
+	always_assert(ctr == n);
+	always_assert(u32map_size(T) == 0);
+	u32map_free(T);
+	csnip_mem_Free(present);
+	return 1;
+}
+
+static _Bool string_test(int N)
+{
+	printf("String keys: N = %d\n", N);
+	struct strmap* T = strmap_make(NULL);
+	char buf[32];
+	for (int i = 0; i < N; ++i) {
+		snprintf(buf, sizeof(buf), "key-%d", i);
+		always_assert(strmap_insert(T, NULL, strdup(buf)) == 1);
+	}
+	always_assert(strmap_size(T) == (size_t)N);
+	for (int i = 0; i < 2 * N; ++i) {
+		snprintf(buf, sizeof(buf), "key-%d", i);
+		char** e = strmap_find(T, buf);
+		always_assert((e != NULL) == (i < N));
+		always_assert(!e || strcmp(*e, buf) == 0);
+	}
+
+	/* Free the strings */
+	for (size_t s = strmap_firstoccupiedslot(T);
+		s < strmap_capacity(T);
+		s = strmap_removeatslot(T, NULL, s))
+	{
+		free(*strmap_getslotentryaddress(T, s));
+	}
+	always_assert(strmap_size(T) == 0);
+	strmap_free(T);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(random_test(10, 20))
+	RUN_TEST(random_test(1000, 20))
+	RUN_TEST(random_test(50000, 4))
+	RUN_TEST(string_test(20000))
+
+	puts("-> tests passed.");
+	return 0;
+}
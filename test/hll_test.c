@@ -0,0 +1,186 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <csnip/err.h>
+#include <csnip/hll.h>
+
+/*  Test for the HyperLogLog sketch.
+ *
+ *  Checks the accuracy of the estimate for small and large sets, that
+ *  duplicates do not change the estimate, that sparse and dense modes
+ *  agree, that the sparse list is kept sorted and free of duplicates
+ *  when many keys repeat, that estimating leaves the sketch unchanged,
+ *  and that merging gives the sketch of the union.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+static double rel_err(double est, double n)
+{
+	return fabs(est - n) / n;
+}
+
+static _Bool accuracy_test(int p, size_t n, double tol)
+{
+	printf("Accuracy: p = %d, n = %zu\n", p, n);
+	csnip_hll* H = csnip_hll_make(p, NULL);
+	for (uint64_t i = 0; i < n; ++i)
+		csnip_hll_add(H, i, NULL);
+	const double est = csnip_hll_estimate(H);
+	printf(" estimate = %.1f, relative error = %.4f (%s)\n",
+		est, rel_err(est, (double)n),
+		csnip_hll_is_sparse(H) ? "sparse" : "dense");
+	always_assert(rel_err(est, (double)n) < tol);
+
+	/* Duplicates do not change the estimate */
+	for (uint64_t i = 0; i < n; i += 3)
+		csnip_hll_add(H, i, NULL);
+	always_assert(csnip_hll_estimate(H) == est);
+
+	csnip_hll_free(H);
+	return 1;
+}
+
+static _Bool sparse_dense_test(int p)
+{
+	printf("Sparse and dense modes: p = %d\n", p);
+
+	/* Z is an empty sketch in dense mode */
+	csnip_hll* Z = csnip_hll_make(p, NULL);
+	for (uint64_t i = 0; csnip_hll_is_sparse(Z); ++i)
+		csnip_hll_add(Z, i, NULL);
+	memset(Z->reg, 0, (size_t)1 << p);
+	always_assert(csnip_hll_estimate(Z) == 0.0);
+
+	csnip_hll* H = csnip_hll_make(p, NULL);
+	uint64_t n = 0;
+	while (csnip_hll_is_sparse(H)) {
+		csnip_hll_add(H, n * 7919, NULL);
+		++n;
+		if (n % 17 == 0) {
+			/* Dense copy gives the same estimate */
+			csnip_hll* D = csnip_hll_make(p, NULL);
+			csnip_hll_merge(D, Z, NULL);
+			csnip_hll_merge(D, H, NULL);
+			always_assert(!csnip_hll_is_sparse(D));
+			always_assert(csnip_hll_estimate(D)
+				== csnip_hll_estimate(H));
+			csnip_hll_free(D);
+		}
+	}
+	printf(" converted to dense after %llu keys\n",
+		(unsigned long long)n);
+	always_assert(rel_err(csnip_hll_estimate(H), (double)n) < 0.05);
+
+	csnip_hll_free(H);
+	csnip_hll_free(Z);
+	return 1;
+}
+
+static _Bool repeat_test(int p, uint64_t n, int nrep)
+{
+	printf("Repeated keys: p = %d, n = %llu, %d times\n", p,
+		(unsigned long long)n, nrep);
+	csnip_hll* H = csnip_hll_make(p, NULL);
+	csnip_hll* O = csnip_hll_make(p, NULL);
+	for (uint64_t i = 0; i < n * (uint64_t)nrep; ++i)
+		csnip_hll_add(H, (i * 7919) % n, NULL);
+	for (uint64_t i = 0; i < n; ++i)
+		csnip_hll_add(O, i, NULL);
+	always_assert(csnip_hll_is_sparse(H));
+
+	/* The sorted prefix has distinct indices */
+	always_assert(H->nsorted < H->nsparse);
+	for (size_t i = 1; i < H->nsorted; ++i)
+		always_assert((H->sparse[i - 1] >> 8) < (H->sparse[i] >> 8));
+
+	/* Estimates agree, and leave the sketch unchanged */
+	const size_t nsparse = H->nsparse, nsorted = H->nsorted;
+	uint32_t* copy = malloc(nsparse * sizeof(uint32_t));
+	always_assert(copy);
+	memcpy(copy, H->sparse, nsparse * sizeof(uint32_t));
+	always_assert(csnip_hll_estimate(H) == csnip_hll_estimate(O));
+	always_assert(H->nsparse == nsparse && H->nsorted == nsorted);
+	always_assert(memcmp(copy, H->sparse,
+			nsparse * sizeof(uint32_t)) == 0);
+	free(copy);
+
+	csnip_hll_free(H);
+	csnip_hll_free(O);
+	return 1;
+}
+
+static _Bool merge_test(int p, size_t n)
+{
+	printf("Merge: p = %d, n = %zu\n", p, n);
+	/* A has [0, 2n), B has [n, 3n) */
+	csnip_hll* A = csnip_hll_make(p, NULL);
+	csnip_hll* B = csnip_hll_make(p, NULL);
+	csnip_hll* U = csnip_hll_make(p, NULL);
+	for (uint64_t i = 0; i < 2 * n; ++i)
+		csnip_hll_add(A, i, NULL);
+	for (uint64_t i = n; i < 3 * n; ++i)
+		csnip_hll_add(B, i, NULL);
+	for (uint64_t i = 0; i < 3 * n; ++i)
+		csnip_hll_add(U, i, NULL);
+
+	csnip_hll_merge(A, B, NULL);
+	printf(" union estimate = %.1f, direct = %.1f\n",
+		csnip_hll_estimate(A), csnip_hll_estimate(U));
+	always_assert(csnip_hll_estimate(A) == csnip_hll_estimate(U));
+
+	/* Mismatched precision */
+	csnip_hll* X = csnip_hll_make(p + 1, NULL);
+	int err;
+	csnip_hll_merge(A, X, &err);
+	always_assert(err == csnip_err_INVAL);
+
+	csnip_hll_free(A);
+	csnip_hll_free(B);
+	csnip_hll_free(U);
+	csnip_hll_free(X);
+	return 1;
+}
+
+static _Bool param_test(void)
+{
+	printf("Parameter checks\n");
+	int err;
+	always_assert(csnip_hll_make(CSNIP_HLL_MIN_P - 1, &err) == NULL);
+	always_assert(err == csnip_err_INVAL);
+	always_assert(csnip_hll_make(CSNIP_HLL_MAX_P + 1, &err) == NULL);
+	always_assert(err == csnip_err_INVAL);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(accuracy_test(12, 10, 0.01))
+	RUN_TEST(accuracy_test(12, 500, 0.03))
+	RUN_TEST(accuracy_test(12, 20000, 0.05))
+	RUN_TEST(accuracy_test(12, 1000000, 0.05))
+	RUN_TEST(accuracy_test(16, 1000000, 0.02))
+	RUN_TEST(accuracy_test(4, 1000, 0.8))
+	RUN_TEST(sparse_dense_test(10))
+	RUN_TEST(sparse_dense_test(14))
+	RUN_TEST(repeat_test(18, 20000, 5))
+	RUN_TEST(merge_test(12, 100))
+	RUN_TEST(merge_test(12, 50000))
+	RUN_TEST(param_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <csnip/csnip_conf.h>
+#include <csnip/cext.h>
+#include <csnip/mem.h>
+
+/*  Test for the huge page backed allocations.
+ *
+ *  Allocates and resizes memory below and above the huge page size,
+ *  checking the alignment and that the contents are kept, and then
+ *  instantiates a dynamic array, a memory pool and a hash table with
+ *  huge page backed memory, selected through their allocation macros,
+ *  alongside a regular instance of each.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+/* Huge page backed arrays */
+#define CSNIP_ARR_ALLOC(nMember, ptr, err) \
+	csnip_mem_HugeAlloc(nMember, 0, ptr, err)
+#define CSNIP_ARR_REALLOC(nMember, ptr, err) \
+	csnip_mem_HugeRealloc(nMember, 0, ptr, err)
+#define CSNIP_ARR_FREE(ptr)	csnip_mem_HugeFree(ptr)
+#include <csnip/arr.h>
+CSNIP_ARR_DEF_FUNCS(csnip_cext_unused static, harr_, uint64_t,
+	args(uint64_t** a, size_t* n, size_t* cap), *a, *n, *cap, _)
+
+/* Memory pools, regular and huge page backed */
+#include <csnip/mempool.h>
+typedef struct {
+	uint64_t v[8];
+} item;
+CSNIP_MEMPOOL_DEF_TYPE(ipool_s, item)
+typedef struct ipool_s ipool;
+CSNIP_MEMPOOL_DEF_FUNCS(csnip_cext_unused static, ipool_, item, ipool)
+#undef CSNIP_MEMPOOL_SLAB_ALLOC
+#undef CSNIP_MEMPOOL_SLAB_FREE
+#define CSNIP_MEMPOOL_SLAB_ALLOC(nMember, ptr, err) \
+	csnip_mem_HugeAlloc(nMember, csnip_mem_HUGE_TLB, ptr, err)
+#define CSNIP_MEMPOOL_SLAB_FREE(ptr)	csnip_mem_HugeFree(ptr)
+CSNIP_MEMPOOL_DEF_FUNCS(csnip_cext_unused static, hpool_, item, ipool)
+
+/* Hash tables, regular and huge page backed */
+#include <csnip/lphash_table.h>
+CSNIP_LPHASH_TABLE_DEF_TYPE(u64tbl, uint64_t)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(csnip_cext_unused static, tbl_,
+	uint64_t, uint64_t, struct u64tbl,
+	k1, k2, e, (size_t)(k1 * 0x9e3779b97f4a7c15ull), k1 == k2, e)
+#undef CSNIP_LPHASH_TABLE_ALLOC
+#undef CSNIP_LPHASH_TABLE_FREE
+#define CSNIP_LPHASH_TABLE_ALLOC(nMember, ptr, err) \
+	csnip_mem_HugeAlloc(nMember, 0, ptr, err)
+#define CSNIP_LPHASH_TABLE_FREE(ptr)	csnip_mem_HugeFree(ptr)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(csnip_cext_unused static, htbl_,
+	uint64_t, uint64_t, struct u64tbl,
+	k1, k2, e, (size_t)(k1 * 0x9e3779b97f4a7c15ull), k1 == k2, e)
+
+static _Bool alloc_test(size_t n, int flags)
+{
+	printf("Alloc: %zu bytes, flags %d\n", n, flags);
+	int err = 0;
+	unsigned char* p;
+	csnip_mem_HugeAlloc(n, flags, p, err);
+	always_assert(err == 0 && p != NULL);
+	always_assert(((uintptr_t)p & 63) == 0);
+#ifdef CSNIP_CONF__HAVE_MMAP
+	/* Large allocations are mapped, aligned to the huge page size */
+	if (n >= CSNIP_MEM_HUGE_PAGE_SZ) {
+		always_assert(((uintptr_t)p & (CSNIP_MEM_HUGE_PAGE_SZ - 1))
+			== 64);
+	}
+#endif
+	for (size_t i = 0; i < n; ++i)
+		p[i] = (unsigned char)(i * 7);
+
+	/* Grow, keeping the contents */
+	csnip_mem_HugeRealloc(3 * n + 1000, flags, p, err);
+	always_assert(err == 0);
+	always_assert(((uintptr_t)p & 63) == 0);
+	for (size_t i = 0; i < n; ++i)
+		always_assert(p[i] == (unsigned char)(i * 7));
+	p[3 * n + 999] = 1;
+
+	csnip_mem_HugeFree(p);
+	always_assert(p == NULL);
+	csnip_mem_HugeFree(p);
+
+	/* Overflow */
+	uint64_t* q;
+	csnip_mem_HugeAlloc(SIZE_MAX / 4, 0, q, err);
+	always_assert(err != 0 && q == NULL);
+	return 1;
+}
+
+static _Bool arr_test(void)
+{
+	printf("Arrays\n");
+	uint64_t* a;
+	size_t n, cap;
+	harr_init(&a, &n, &cap, 0);
+	const size_t N = 1000000;
+	for (size_t i = 0; i < N; ++i)
+		harr_push(&a, &n, &cap, i);
+	always_assert(((uintptr_t)a & 63) == 0);
+	for (size_t i = 0; i < N; ++i)
+		always_assert(a[i] == i);
+	harr_deinit(&a, &n, &cap);
+	always_assert(a == NULL && n == 0);
+	return 1;
+}
+
+static _Bool pool_test(void)
+{
+	printf("Pools\n");
+	const size_t N = 100000;
+	ipool P = ipool_init_empty(), H = hpool_init_with_cap(N / 2, NULL);
+	item** p = malloc(N * sizeof(item*));
+	item** h = malloc(N * sizeof(item*));
+	always_assert(p && h);
+	for (size_t i = 0; i < N; ++i) {
+		p[i] = ipool_alloc_item(&P, NULL);
+		h[i] = hpool_alloc_item(&H, NULL);
+		p[i]->v[0] = h[i]->v[7] = i;
+	}
+	for (size_t i = 0; i < N; ++i)
+		always_assert(p[i]->v[0] == i && h[i]->v[7] == i);
+	for (size_t i = 0; i < N; ++i)
+		hpool_free_item(&H, h[i]);
+	const size_t cap = H.cap_items;
+	always_assert(hpool_trim(&H, NULL) == cap);
+	ipool_deinit(&P);
+	hpool_deinit(&H);
+	free(h);
+	free(p);
+	return 1;
+}
+
+static _Bool table_test(void)
+{
+	printf("Hash tables\n");
+	struct u64tbl* T = tbl_make(NULL);
+	struct u64tbl* H = htbl_make(NULL);
+	const uint64_t N = 200000;
+	for (uint64_t i = 0; i < N; ++i) {
+		always_assert(tbl_insert(T, NULL, 2 * i) == 1);
+		always_assert(htbl_insert(H, NULL, 2 * i) == 1);
+	}
+	for (uint64_t i = 0; i < 2 * N; ++i) {
+		const _Bool present = !(i & 1);
+		always_assert((tbl_find(T, i) != NULL) == present);
+		always_assert((htbl_find(H, i) != NULL) == present);
+	}
+	htbl_shrink(H, NULL);
+	always_assert(htbl_size(H) == N);
+	tbl_free(T);
+	htbl_free(H);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(alloc_test(1, 0))
+	RUN_TEST(alloc_test(1000, 0))
+	RUN_TEST(alloc_test(1000000, 0))
+	RUN_TEST(alloc_test(CSNIP_MEM_HUGE_PAGE_SZ, 0))
+	RUN_TEST(alloc_test(5 * CSNIP_MEM_HUGE_PAGE_SZ + 17, 0))
+	RUN_TEST(alloc_test(5 * CSNIP_MEM_HUGE_PAGE_SZ, csnip_mem_HUGE_TLB))
+	RUN_TEST(arr_test())
+	RUN_TEST(pool_test())
+	RUN_TEST(table_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
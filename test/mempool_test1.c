@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <csnip/cext.h>
+#include <csnip/mem.h>
+#include <csnip/mempool.h>
+
+/*  Test for the memory pool slab bookkeeping.
+ *
+ *  A burst of allocations is freed, and trim() must release all
+ *  slabs.  Then items are freed such that some slabs still hold live
+ *  items; trim() must release exactly the other slabs, the live items
+ *  must keep their contents, and the pool must remain usable.  Run
+ *  under a leak checker, this also checks that deinit() releases all
+ *  slabs.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+typedef struct {
+	uint64_t v;
+	uint64_t w;
+} My;
+
+CSNIP_MEMPOOL_DEF_TYPE(MyPool_s, My)
+typedef struct MyPool_s MyPool;
+
+CSNIP_MEMPOOL_DECL_FUNCS(csnip_cext_unused static,
+		MyPool_,
+		My,
+		MyPool)
+CSNIP_MEMPOOL_DEF_FUNCS(csnip_cext_unused static,
+		MyPool_,
+		My,
+		MyPool)
+
+/* Index of the slab containing e */
+static size_t slab_of(const MyPool* P, const My* e)
+{
+	for (size_t i = 0; i < P->n_slabs; ++i) {
+		if (e >= P->slabs[i] && e < P->slabs[i] + P->slab_sz[i])
+			return i;
+	}
+	always_assert(0);
+	return 0;
+}
+
+static _Bool burst_test(size_t N)
+{
+	printf("Burst: N = %zu\n", N);
+	MyPool P = MyPool_init_empty();
+	My** it;
+	csnip_mem_Alloc(N, it, _);
+	for (size_t i = 0; i < N; ++i) {
+		it[i] = MyPool_alloc_item(&P, NULL);
+		it[i]->v = i;
+	}
+	always_assert(P.n_items == N && P.cap_items >= N);
+	always_assert(P.n_slabs > 1);
+	size_t cap = 0;
+	for (size_t i = 0; i < P.n_slabs; ++i)
+		cap += P.slab_sz[i];
+	always_assert(cap == P.cap_items);
+
+	/* Nothing to release while every slab has live items */
+	always_assert(MyPool_trim(&P, NULL) == 0);
+	const size_t ncap = P.cap_items;
+	for (size_t i = 0; i < N; ++i)
+		MyPool_free_item(&P, it[i]);
+	always_assert(P.n_items == 0);
+	always_assert(MyPool_trim(&P, NULL) == ncap);
+	always_assert(P.n_slabs == 0 && P.cap_items == 0);
+	always_assert(P.first_free == NULL);
+
+	/* The pool is still usable */
+	for (size_t i = 0; i < N; ++i) {
+		it[i] = MyPool_alloc_item(&P, NULL);
+		it[i]->v = i;
+	}
+	for (size_t i = 0; i < N; ++i)
+		always_assert(it[i]->v == i);
+	always_assert(MyPool_trim(&P, NULL) == 0);
+
+	MyPool_deinit(&P);
+	csnip_mem_Free(it);
+	return 1;
+}
+
+static _Bool partial_test(size_t N)
+{
+	printf("Partial: N = %zu\n", N);
+	MyPool P = MyPool_init_with_cap(16, NULL);
+	My** it;
+	csnip_mem_Alloc(N, it, _);
+	for (size_t i = 0; i < N; ++i) {
+		it[i] = MyPool_alloc_item(&P, NULL);
+		it[i]->v = i;
+		it[i]->w = ~(uint64_t)i;
+	}
+
+	/* Keep one item in every other slab */
+	unsigned char* keep_slab;
+	csnip_mem_Alloc0(P.n_slabs, keep_slab, _);
+	unsigned char* keep;
+	csnip_mem_Alloc0(N, keep, _);
+	for (size_t i = 0; i < N; ++i) {
+		const size_t s = slab_of(&P, it[i]);
+		if ((s & 1) && !keep_slab[s]) {
+			keep_slab[s] = 1;
+			keep[i] = 1;
+		}
+	}
+	size_t expect = 0;
+	for (size_t s = 0; s < P.n_slabs; ++s) {
+		if (!keep_slab[s])
+			expect += P.slab_sz[s];
+	}
+	const size_t nslabs = P.n_slabs;
+	for (size_t i = 0; i < N; ++i) {
+		if (!keep[i])
+			MyPool_free_item(&P, it[i]);
+	}
+
+	always_assert(MyPool_trim(&P, NULL) == expect);
+	always_assert(P.n_slabs == nslabs / 2);
+	for (size_t i = 0; i < N; ++i) {
+		if (keep[i]) {
+			always_assert(it[i]->v == i && it[i]->w == ~(uint64_t)i);
+			slab_of(&P, it[i]);
+		}
+	}
+
+	/* The free list only holds items of the remaining slabs */
+	size_t nfree = 0;
+	for (My* e = P.first_free; e; e = *(My**)e) {
+		slab_of(&P, e);
+		++nfree;
+	}
+	always_assert(nfree == P.cap_items - P.n_items);
+
+	/* Reallocate */
+	for (size_t i = 0; i < N; ++i) {
+		if (!keep[i]) {
+			it[i] = MyPool_alloc_item(&P, NULL);
+			it[i]->v = i;
+			it[i]->w = ~(uint64_t)i;
+		}
+	}
+	for (size_t i = 0; i < N; ++i)
+		always_assert(it[i]->v == i && it[i]->w == ~(uint64_t)i);
+	always_assert(P.n_items == N);
+
+	MyPool_deinit(&P);
+	csnip_mem_Free(keep);
+	csnip_mem_Free(keep_slab);
+	csnip_mem_Free(it);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(burst_test(10))
+	RUN_TEST(burst_test(100000))
+	RUN_TEST(partial_test(1000))
+	RUN_TEST(partial_test(100000))
+
+	puts("-> tests passed.");
+	return 0;
+}
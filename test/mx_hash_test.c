@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/hash.h>
+#include <csnip/sort.h>
+#include <csnip/util.h>
+
+/*  Test for the mx64 hash.
+ *
+ *  Checks known answers, that the string, streaming, batched and buffer
+ *  variants agree, that every input bit affects every output bit with
+ *  probability close to 1/2, and that there are no collisions among
+ *  sets of similar keys.  The avalanche test starts at 2 byte keys:
+ *  for a single byte, there are only 128 input pairs per flipped bit,
+ *  too few to measure a bias.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+struct testvector {
+	const char* str;
+	uint64_t seed;
+	unsigned long long int h;
+};
+
+static const struct testvector tvs[] = {
+  { "", 0, 0x146a6b2ea9984c76ull },
+  { "a", 0, 0x128c54d5323074bbull },
+  { "abc", 0, 0x60a6c22d4cde567eull },
+  { "Hello\n", 0, 0x3abac33aafee23a3ull },
+  { "/etc/hosts", 0, 0xca57c2f987ffc149ull },
+  { "The quick brown fox", 0, 0x8499140b77b00c3bull },
+  { "0123456789abcdef0123456789abcdef", 0, 0x5a491b3bfe4cb691ull },
+  { "The quick brown fox jumps over the lazy dog", 0, 0x9b6addebaf3fa506ull },
+  { "The quick brown fox jumps over the lazy dog", 1, 0xf80fcc7b436bef21ull },
+
+  /* Sentinel */
+  { NULL }
+};
+
+static uint64_t rng_state = 0x12345678;
+
+static uint64_t rnd(void)
+{
+	uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+static _Bool vector_test(void)
+{
+	printf("Known answers\n");
+	for (int i = 0; tvs[i].str; ++i) {
+		const uint64_t h = hash_mx64_s(tvs[i].str, tvs[i].seed);
+		if (h != tvs[i].h) {
+			fprintf(stderr, "Vector %d: got %llx, expected %llx\n",
+				i, (unsigned long long)h, tvs[i].h);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static _Bool variants_test(void)
+{
+	printf("String, streaming and buffer variants\n");
+	char buf[301];
+	for (size_t len = 0; len <= 300; ++len) {
+		for (size_t i = 0; i < len; ++i)
+			buf[i] = (char)(1 + rnd() % 255);
+		buf[len] = '\0';
+		const uint64_t seed = rnd();
+		const uint64_t h = hash_mx64_b(buf, len, seed);
+		always_assert(hash_mx64_s(buf, seed) == h);
+
+		/* Random split into pieces */
+		for (int rep = 0; rep < 10; ++rep) {
+			hash_mx64_state S;
+			hash_mx64_init(&S, seed);
+			size_t pos = 0;
+			while (pos < len) {
+				size_t n = rnd() % (rep < 5 ? 8 : 80);
+				if (n > len - pos)
+					n = len - pos;
+				hash_mx64_update(&S, buf + pos, n);
+				pos += n;
+			}
+			always_assert(hash_mx64_final(&S) == h);
+		}
+
+		/* The seed matters */
+		always_assert(hash_mx64_b(buf, len, seed + 1) != h);
+	}
+	return 1;
+}
+
+static _Bool batch_test(void)
+{
+	printf("Batched variants\n");
+	enum { N = 1000 };
+	static unsigned char buf[N * 64];
+	static const void* keys[N];
+	static size_t lens[N];
+	static uint64_t out[N];
+	static uint64_t k64[N];
+	static uint32_t k32[N];
+	for (size_t i = 0; i < sizeof(buf); ++i)
+		buf[i] = (unsigned char)rnd();
+	for (size_t i = 0; i < N; ++i) {
+		keys[i] = buf + rnd() % (sizeof(buf) - 100);
+		lens[i] = rnd() % 100;
+		k64[i] = rnd();
+		k32[i] = (uint32_t)rnd();
+	}
+
+	for (int rep = 0; rep < 3; ++rep) {
+		const uint64_t seed = (rep == 0 ? 0 : rnd());
+		hash_mx64_many(keys, lens, N, seed, out);
+		for (size_t i = 0; i < N; ++i)
+			always_assert(out[i] == hash_mx64_b(keys[i], lens[i], seed));
+
+		/* Fixed width keys, hashed as little endian bytes */
+		unsigned char le[8];
+		hash_mx64_u64_many(k64, N, seed, out);
+		for (size_t i = 0; i < N; ++i) {
+			for (int j = 0; j < 8; ++j)
+				le[j] = (unsigned char)(k64[i] >> (8 * j));
+			always_assert(out[i] == hash_mx64_b(le, 8, seed));
+		}
+		hash_mx64_u32_many(k32, N, seed, out);
+		for (size_t i = 0; i < N; ++i) {
+			for (int j = 0; j < 4; ++j)
+				le[j] = (unsigned char)(k32[i] >> (8 * j));
+			always_assert(out[i] == hash_mx64_b(le, 4, seed));
+		}
+	}
+	return 1;
+}
+
+static _Bool avalanche_test(size_t len)
+{
+	printf("Avalanche: %zu bytes\n", len);
+	const int nsample = 2000;
+	unsigned char buf[128];
+	double worst = 0.0;
+	double sum = 0.0;
+	for (size_t ib = 0; ib < 8 * len; ++ib) {
+		int flips[64] = { 0 };
+		for (int s = 0; s < nsample; ++s) {
+			for (size_t i = 0; i < len; ++i)
+				buf[i] = (unsigned char)rnd();
+			const uint64_t h0 = hash_mx64_b(buf, len, 0);
+			buf[ib / 8] ^= (unsigned char)(1u << (ib % 8));
+			const uint64_t d = h0 ^ hash_mx64_b(buf, len, 0);
+			for (int ob = 0; ob < 64; ++ob)
+				flips[ob] += (int)((d >> ob) & 1);
+		}
+		for (int ob = 0; ob < 64; ++ob) {
+			const double p = (double)flips[ob] / nsample;
+			sum += p;
+			const double dev = (p > 0.5 ? p - 0.5 : 0.5 - p);
+			if (dev > worst)
+				worst = dev;
+		}
+	}
+	const double mean = sum / (64.0 * 8.0 * (double)len);
+	printf(" mean flip probability %.4f, worst bias %.4f\n", mean, worst);
+	always_assert(mean > 0.49 && mean < 0.51);
+	always_assert(worst < 0.07);
+	return 1;
+}
+
+static _Bool collision_test(void)
+{
+	printf("Collisions\n");
+	const size_t N = 200000;
+	uint64_t* h = malloc(2 * N * sizeof(uint64_t));
+	always_assert(h);
+
+	/* Consecutive integers, and short decimal strings */
+	char s[32];
+	for (size_t i = 0; i < N; ++i) {
+		const uint64_t k = i;
+		h[i] = hash_mx64_b(&k, sizeof(k), 0);
+		snprintf(s, sizeof(s), "key%zu", i);
+		h[N + i] = hash_mx64_s(s, 0);
+	}
+	csnip_Qsort(u, v, h[u] < h[v], csnip_Tswap(uint64_t, h[u], h[v]),
+		2 * N);
+	for (size_t i = 1; i < 2 * N; ++i)
+		always_assert(h[i - 1] != h[i]);
+	free(h);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(vector_test())
+	RUN_TEST(variants_test())
+	RUN_TEST(batch_test())
+	RUN_TEST(avalanche_test(2))
+	RUN_TEST(avalanche_test(3))
+	RUN_TEST(avalanche_test(8))
+	RUN_TEST(avalanche_test(17))
+	RUN_TEST(avalanche_test(33))
+	RUN_TEST(avalanche_test(100))
+	RUN_TEST(collision_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
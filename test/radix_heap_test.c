@@ -0,0 +1,206 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Count the bucket reallocations */
+static long nrealloc = 0;
+#define CSNIP_ARR_REALLOC(nMember, ptr, err) \
+	do { \
+		++nrealloc; \
+		csnip_mem_Realloc(nMember, ptr, err); \
+	} while (0)
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/cext.h>
+#include <csnip/err.h>
+#include <csnip/mem.h>
+#include <csnip/radix_heap.h>
+#include <csnip/util.h>
+
+/* Radix heaps with 32 and 64 bit keys, payload is the insertion
+ * index.
+ */
+CSNIP_RADIXHEAP_DEF_TYPE(rh32_s, uint32_t, int)
+typedef struct rh32_s rh32;
+CSNIP_RADIXHEAP_DEF_FUNCS(cext_unused static, rh32_, uint32_t, int, rh32)
+
+CSNIP_RADIXHEAP_DEF_TYPE(rh64_s, uint64_t, int)
+typedef struct rh64_s rh64;
+CSNIP_RADIXHEAP_DEF_FUNCS(cext_unused static, rh64_, uint64_t, int, rh64)
+
+static uint64_t simple_rng(uint64_t* pseed)
+{
+	*pseed = *pseed * 6364136223846793005ull + 1442695040888963407ull;
+	return *pseed >> 11;
+}
+
+/* Test:
+ * 1. Random monotone push/pop sequence, checked against a brute force
+ *    reference that scans for the minimum.
+ */
+#define DEF_RANDOM_TEST(name, htype, hprefix, ktype) \
+	static bool name(int n, uint64_t range, uint64_t seed) \
+	{ \
+		printf("Test 1 (" #ktype "). n = %d, range = %llu\n", \
+			n, (unsigned long long)range); \
+		bool success = false; \
+		ktype* ref; \
+		int* refval; \
+		mem_Alloc(n, ref, _); \
+		mem_Alloc(n, refval, _); \
+		int nref = 0; \
+		ktype last = 0; \
+		\
+		htype H; \
+		hprefix##init(&H); \
+		for (int i = 0; i < n; ++i) { \
+			/* Push a new entry */ \
+			const ktype k = (ktype)(last + \
+				simple_rng(&seed) % range); \
+			hprefix##push(&H, NULL, k, i); \
+			ref[nref] = k; \
+			refval[nref] = i; \
+			++nref; \
+			\
+			/* Pop a random number of entries */ \
+			int npop = (int)(simple_rng(&seed) % 3); \
+			if (i == n - 1) \
+				npop = nref; \
+			for (int j = 0; j < npop && nref > 0; ++j) { \
+				int m = 0; \
+				for (int l = 1; l < nref; ++l) { \
+					if (ref[l] < ref[m]) \
+						m = l; \
+				} \
+				int v; \
+				const ktype got = hprefix##pop(&H, NULL, &v); \
+				if (got != ref[m]) { \
+					printf("-> popped key %llu, " \
+					  "expected %llu FAILED\n", \
+					  (unsigned long long)got, \
+					  (unsigned long long)ref[m]); \
+					goto done; \
+				} \
+				/* Find the payload in the reference */ \
+				int l; \
+				for (l = 0; l < nref; ++l) { \
+					if (refval[l] == v) \
+						break; \
+				} \
+				if (l == nref || ref[l] != got) { \
+					printf("-> payload mismatch FAILED\n"); \
+					goto done; \
+				} \
+				ref[l] = ref[nref - 1]; \
+				refval[l] = refval[nref - 1]; \
+				--nref; \
+				last = got; \
+			} \
+			if (hprefix##size(&H) != (size_t)nref) { \
+				printf("-> size mismatch FAILED\n"); \
+				goto done; \
+			} \
+		} \
+		success = true; \
+	done: \
+		hprefix##deinit(&H); \
+		mem_Free(ref); \
+		mem_Free(refval); \
+		return success; \
+	}
+
+DEF_RANDOM_TEST(check_random32, rh32, rh32_, uint32_t)
+DEF_RANDOM_TEST(check_random64, rh64, rh64_, uint64_t)
+
+/* Test:
+ * 2. Error conditions: popping from an empty heap, and pushing a key
+ *    smaller than the last extracted one.
+ */
+static bool check_errors(void)
+{
+	puts("Test 2 (error conditions).");
+	bool success = false;
+	rh32 H;
+	rh32_init(&H);
+
+	int err = 0;
+	rh32_pop(&H, &err, NULL);
+	if (err != err_UNDERFLOW) {
+		puts("-> pop from empty heap did not underflow FAILED");
+		goto done;
+	}
+
+	rh32_push(&H, &err, 10, 0);
+	rh32_push(&H, &err, 20, 1);
+	if (err != 0 || rh32_top(&H, &err, NULL) != 10
+	  || rh32_pop(&H, &err, NULL) != 10)
+	{
+		puts("-> unexpected top/pop FAILED");
+		goto done;
+	}
+	rh32_push(&H, &err, 5, 2);
+	if (err != err_RANGE) {
+		puts("-> non-monotone push was accepted FAILED");
+		goto done;
+	}
+	if (rh32_size(&H) != 1) {
+		puts("-> size changed by a failed push FAILED");
+		goto done;
+	}
+	success = true;
+done:
+	rh32_deinit(&H);
+	return success;
+}
+
+/* Test:
+ * 3. Bucket capacities are kept in steady state:  repeated rounds of
+ *    pushes and pops do not reallocate once the buckets have grown.
+ */
+static bool check_steady_state(void)
+{
+	puts("Test 3 (steady state reallocations).");
+	rh64 H;
+	rh64_init(&H);
+	uint64_t seed = 7, base = 0;
+	long warm = 0;
+	for (int round = 0; round < 2000; ++round) {
+		if (round == 100)
+			warm = nrealloc;
+		for (int i = 0; i < 100; ++i)
+			rh64_push(&H, NULL, base + simple_rng(&seed) % 1000, i);
+		for (int i = 0; i < 100; ++i)
+			base = rh64_pop(&H, NULL, NULL);
+	}
+	rh64_deinit(&H);
+	printf("  reallocations after warm-up: %ld\n", nrealloc - warm);
+	if (nrealloc - warm > 100) {
+		puts("-> buckets were reallocated in steady state FAILED");
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	const int ns[] = { 1, 2, 17, 1000, 50000 };
+	const uint64_t ranges[] = { 1, 2, 100, 1u << 20, 1ull << 40 };
+	uint64_t seed = 1;
+	for (int ni = 0; ni < Static_len(ns); ++ni) {
+		for (int ri = 0; ri < Static_len(ranges); ++ri) {
+			const uint64_t r = ranges[ri];
+			if (!check_random64(ns[ni], r, seed++)
+			  || (r <= 100
+			    && !check_random32(ns[ni], r, seed++)))
+			{
+				fprintf(stderr, "==> FAILURE\n");
+				return 1;
+			}
+		}
+	}
+	if (!check_errors() || !check_steady_state()) {
+		fprintf(stderr, "==> FAILURE\n");
+		return 1;
+	}
+	return 0;
+}
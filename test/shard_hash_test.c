@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define CSNIP_SHORT_NAMES
+#include <csnip/hash.h>
+
+/*  Test for the consistent hashing functions.
+ *
+ *  For jump consistent hashing and rendezvous hashing, checks that
+ *  keys are spread evenly, respectively proportionally to the
+ *  weights, over the shards, that adding a shard only moves the
+ *  expected fraction of keys, all of them to the new shard, and that
+ *  removing a shard only moves the keys of that shard.  The batch
+ *  functions must agree with the single key ones.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+#define NKEYS	200000
+
+static uint64_t keys[NKEYS];
+
+static void make_keys(void)
+{
+	for (size_t i = 0; i < NKEYS; ++i)
+		keys[i] = hash_splitmix64(i);
+}
+
+/* Check that cnt[i] / NKEYS is within a relative tolerance of p[i] */
+static void check_spread(const size_t* cnt, const double* p, size_t n)
+{
+	for (size_t i = 0; i < n; ++i) {
+		const double e = p[i] * NKEYS;
+		always_assert(cnt[i] > 0.9 * e && cnt[i] < 1.1 * e);
+	}
+}
+
+static _Bool jump_test(uint32_t n)
+{
+	printf("Jump: %u shards\n", n);
+	static uint32_t a[NKEYS], b[NKEYS], c[NKEYS];
+	hash_jump_many(keys, NKEYS, n, a);
+	hash_jump_many(keys, NKEYS, n + 1, b);
+
+	size_t cnt[64] = { 0 };
+	double p[64];
+	size_t moved = 0;
+	for (size_t i = 0; i < NKEYS; ++i) {
+		always_assert(a[i] == hash_jump(keys[i], n));
+		always_assert(b[i] == hash_jump(keys[i], n + 1));
+		always_assert(a[i] < n && b[i] <= n);
+		++cnt[a[i]];
+		if (a[i] != b[i]) {
+			/* Keys only move to the new shard */
+			always_assert(b[i] == n);
+			++moved;
+		}
+	}
+	for (uint32_t i = 0; i < n; ++i)
+		p[i] = 1.0 / n;
+	check_spread(cnt, p, n);
+
+	const double f = (double)moved / NKEYS;
+	printf(" moved %.4f of the keys, expected %.4f\n", f, 1.0 / (n + 1));
+	always_assert(f > 0.9 / (n + 1) && f < 1.1 / (n + 1));
+
+	/* Batch with a length not divisible by the group size */
+	hash_jump_many(keys, 13, n, c);
+	for (size_t i = 0; i < 13; ++i)
+		always_assert(c[i] == a[i]);
+	return 1;
+}
+
+static _Bool jump_edge_test(void)
+{
+	printf("Jump: edge cases\n");
+	for (size_t i = 0; i < 1000; ++i) {
+		always_assert(hash_jump(keys[i], 0) == 0);
+		always_assert(hash_jump(keys[i], 1) == 0);
+		always_assert(hash_jump(keys[i], 0xffffffffu) < 0xffffffffu);
+	}
+	return 1;
+}
+
+static _Bool hrw_test(const double* weight)
+{
+	printf("Rendezvous: %s\n", weight ? "weighted" : "unweighted");
+	enum { N = 6 };
+	uint64_t ids[N + 1];
+	for (int i = 0; i <= N; ++i)
+		ids[i] = 1000 + 17 * (uint64_t)i;
+
+	static size_t a[NKEYS], b[NKEYS], c[NKEYS];
+	hash_hrw_many(keys, NKEYS, ids, weight, N, a);
+	hash_hrw_many(keys, NKEYS, ids, weight, N + 1, b);
+
+	/* Expected shares */
+	double wsum = 0.0, p[N + 1];
+	for (int i = 0; i <= N; ++i)
+		wsum += (weight ? weight[i] : 1.0);
+	size_t cnt[N + 1] = { 0 };
+	size_t moved = 0;
+	for (size_t i = 0; i < NKEYS; ++i) {
+		always_assert(a[i] == hash_hrw(keys[i], ids, weight, N));
+		always_assert(a[i] < N && b[i] <= N);
+		++cnt[b[i]];
+		if (a[i] != b[i]) {
+			always_assert(b[i] == N);
+			++moved;
+		}
+	}
+	for (int i = 0; i <= N; ++i)
+		p[i] = (weight ? weight[i] : 1.0) / wsum;
+	check_spread(cnt, p, N + 1);
+	const double f = (double)moved / NKEYS;
+	printf(" adding: moved %.4f of the keys, expected %.4f\n", f, p[N]);
+	always_assert(f > 0.9 * p[N] && f < 1.1 * p[N]);
+
+	/* Removing shard 2, by moving the last one into its place:  only
+	 * the keys of shard 2 move */
+	uint64_t ids2[N + 1];
+	double w2[N + 1];
+	for (int i = 0; i <= N; ++i) {
+		ids2[i] = ids[i];
+		w2[i] = (weight ? weight[i] : 1.0);
+	}
+	ids2[2] = ids[N];
+	w2[2] = w2[N];
+	hash_hrw_many(keys, NKEYS, ids2, weight ? w2 : NULL, N, c);
+	for (size_t i = 0; i < NKEYS; ++i) {
+		const uint64_t before = ids[b[i]];
+		const uint64_t after = ids2[c[i]];
+		if (before != ids[2])
+			always_assert(after == before);
+		else
+			always_assert(after != ids[2]);
+	}
+	return 1;
+}
+
+static _Bool hrw_edge_test(void)
+{
+	printf("Rendezvous: edge cases\n");
+	const uint64_t ids[3] = { 1, 2, 3 };
+	const uint64_t ids_rev[3] = { 3, 2, 1 };
+	const double w0[3] = { 0.0, 0.0, 0.0 };
+	const double w1[3] = { 0.0, 1.0, -1.0 };
+	for (size_t i = 0; i < 1000; ++i) {
+		always_assert(hash_hrw(keys[i], ids, NULL, 0) == 0);
+		always_assert(hash_hrw(keys[i], ids, w0, 3) == 3);
+		always_assert(hash_hrw(keys[i], ids, w1, 3) == 1);
+
+		/* Independent of the order of the ids */
+		const size_t s = hash_hrw(keys[i], ids, NULL, 3);
+		always_assert(ids_rev[hash_hrw(keys[i], ids_rev, NULL, 3)]
+			== ids[s]);
+	}
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	static const double weight[] = { 1.0, 2.0, 3.0, 1.5, 0.5, 4.0, 2.0 };
+	make_keys();
+	RUN_TEST(jump_test(1))
+	RUN_TEST(jump_test(10))
+	RUN_TEST(jump_test(37))
+	RUN_TEST(jump_edge_test())
+	RUN_TEST(hrw_test(NULL))
+	RUN_TEST(hrw_test(weight))
+	RUN_TEST(hrw_edge_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
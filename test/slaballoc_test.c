@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <csnip/slaballoc.h>
+
+/*  Test for the size class slab allocator.
+ *
+ *  Checks that the size classes cover all sizes with steps of at most
+ *  12.5%, and then allocates and frees objects of random sizes,
+ *  small and large, in random order, checking their alignment, that
+ *  live objects don't overlap (by filling each with a pattern that is
+ *  checked before it is freed), and that freed memory is reused.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+static uint64_t rng_state = 88172645463325252ull;
+
+static uint64_t rnd(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static _Bool class_test(void)
+{
+	printf("Size classes\n");
+	size_t prev = 0;
+	int nclass = 0;
+	for (size_t sz = 0; sz <= CSNIP_SLABALLOC_MAX_SMALL; ++sz) {
+		const size_t g = csnip_slaballoc_good_size(sz);
+		always_assert(g >= sz && g >= 16);
+		always_assert((g & 15) == 0);
+		always_assert(g >= prev);
+		if (g != prev) {
+			++nclass;
+			if (prev >= 128)
+				always_assert(8 * g <= 9 * prev);
+			prev = g;
+		}
+	}
+	always_assert(prev == CSNIP_SLABALLOC_MAX_SMALL);
+	always_assert(nclass == CSNIP_SLABALLOC_NCLASS);
+	always_assert(csnip_slaballoc_good_size(100000) == 100000);
+	return 1;
+}
+
+/* Draw a size, mostly small, sometimes large */
+static size_t rnd_size(void)
+{
+	const uint64_t r = rnd();
+	if ((r & 255) == 0)
+		return CSNIP_SLABALLOC_MAX_SMALL + (size_t)(r >> 40) % 100000;
+	return (size_t)((r >> 8) & ((1u << ((r >> 20) % 14)) - 1)) + 1;
+}
+
+static void fill(unsigned char* p, size_t sz, size_t tag)
+{
+	for (size_t i = 0; i < sz; ++i)
+		p[i] = (unsigned char)(tag + i);
+}
+
+static void check(const unsigned char* p, size_t sz, size_t tag)
+{
+	for (size_t i = 0; i < sz; ++i)
+		always_assert(p[i] == (unsigned char)(tag + i));
+}
+
+static _Bool random_test(size_t nlive, size_t nops)
+{
+	printf("Random: %zu live objects, %zu operations\n", nlive, nops);
+	csnip_slaballoc* S = csnip_slaballoc_make(NULL);
+	unsigned char** p = calloc(nlive, sizeof(*p));
+	size_t* sz = calloc(nlive, sizeof(*sz));
+	always_assert(p && sz);
+
+	for (size_t op = 0; op < nops; ++op) {
+		const size_t j = (size_t)(rnd() >> 11) % nlive;
+		if (p[j]) {
+			check(p[j], sz[j], j);
+			csnip_slaballoc_free_item(S, p[j]);
+			p[j] = NULL;
+			continue;
+		}
+		sz[j] = rnd_size();
+		p[j] = csnip_slaballoc_alloc_item(S, sz[j], NULL);
+		always_assert(((uintptr_t)p[j] & 15) == 0);
+		always_assert(csnip_slaballoc_usable_size(p[j])
+			== csnip_slaballoc_good_size(sz[j]));
+		fill(p[j], sz[j], j);
+	}
+
+	/* Free half of the objects, and the allocator with the rest */
+	for (size_t j = 0; j < nlive; j += 2) {
+		if (p[j]) {
+			check(p[j], sz[j], j);
+			csnip_slaballoc_free_item(S, p[j]);
+		}
+	}
+	for (size_t j = 1; j < nlive; j += 2) {
+		if (p[j])
+			check(p[j], sz[j], j);
+	}
+	csnip_slaballoc_free(S);
+	free(sz);
+	free(p);
+	return 1;
+}
+
+static _Bool reuse_test(void)
+{
+	printf("Reuse\n");
+	csnip_slaballoc* S = csnip_slaballoc_make(NULL);
+	enum { N = 10000 };
+	static void* p[N];
+
+	/* Freed objects are reused, most recently freed first */
+	for (int i = 0; i < N; ++i)
+		p[i] = csnip_slaballoc_alloc_item(S, 100, NULL);
+	void* q = p[N / 2];
+	csnip_slaballoc_free_item(S, q);
+	always_assert(csnip_slaballoc_alloc_item(S, 97, NULL) == q);
+
+	/* Slabs emptied completely are reused for other sizes */
+	for (int i = 0; i < N; ++i)
+		csnip_slaballoc_free_item(S, p[i]);
+	void* r = csnip_slaballoc_alloc_item(S, 3000, NULL);
+	_Bool found = 0;
+	for (int i = 0; i < N && !found; ++i) {
+		const uintptr_t d = (uintptr_t)r ^ (uintptr_t)p[i];
+		found = (d < CSNIP_SLABALLOC_SLAB_SZ);
+	}
+	always_assert(found);
+	csnip_slaballoc_free_item(S, r);
+	csnip_slaballoc_free_item(S, NULL);
+	csnip_slaballoc_free(S);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(class_test())
+	RUN_TEST(random_test(100, 10000))
+	RUN_TEST(random_test(10000, 500000))
+	RUN_TEST(reuse_test())
+
+	puts("-> tests passed.");
+	return 0;
+}
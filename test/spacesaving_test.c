@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <csnip/cext.h>
+#include <csnip/err.h>
+#include <csnip/lphash_table.h>
+#include <csnip/mem.h>
+#include <csnip/spacesaving.h>
+
+/*  Test for the Space-Saving heavy hitters summary.
+ *
+ *  Zipf-like streams, unit and weighted, are fed into summaries, and
+ *  the counters are checked against the exact counts:  each count
+ *  must bound the true count from above, and count - err from below;
+ *  all keys more frequent than total / k must be monitored; and topk
+ *  must return the counters in descending order.  The same checks are
+ *  done for the merge of the summaries of two halves of a stream.
+ */
+
+#define always_assert(expr)  do { \
+	if (!(expr)) { \
+		fprintf(stderr, "Check failed: \"" #expr "\". Abort.\n"); \
+		exit(1); \
+	} \
+	} while (0)
+
+static size_t u64hash(uint64_t x)
+{
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdull;
+	x ^= x >> 33;
+	return (size_t)x;
+}
+
+CSNIP_LPHASH_TABLE_DEF_TYPE(topk_index, struct topk_counter*)
+CSNIP_SPACESAVING_DEF_TYPE(topk, uint64_t, struct topk_index)
+CSNIP_LPHASH_TABLE_DECL_FUNCS(csnip_cext_unused static,
+			topk_index_,
+			uint64_t,
+			struct topk_counter*,
+			struct topk_index)
+CSNIP_LPHASH_TABLE_DEF_FUNCS(static,
+			topk_index_,
+			uint64_t,
+			struct topk_counter*,
+			struct topk_index,
+			k1, k2, e,
+			u64hash(k1),
+			k1 == k2,
+			e->key)
+
+CSNIP_SPACESAVING_DECL_FUNCS(csnip_cext_unused static,
+			topk_,
+			uint64_t,
+			struct topk,
+			struct topk_counter)
+CSNIP_SPACESAVING_DEF_FUNCS(static,
+			topk_,
+			uint64_t,
+			struct topk,
+			struct topk_counter,
+			struct topk_bucket,
+			topk_index_)
+
+#define NKEYS		20000
+
+/* Stream of n keys, where key i has probability proportional to
+ * 1 / (i + 1).  Returns the keys; their counts are added to cnt. */
+static uint64_t* make_stream(size_t n, unsigned seed, uint64_t* cnt)
+{
+	static double cdf[NKEYS];
+	double s = 0.0;
+	for (size_t i = 0; i < NKEYS; ++i) {
+		s += 1.0 / (double)(i + 1);
+		cdf[i] = s;
+	}
+
+	uint64_t* keys;
+	csnip_mem_Alloc(n, keys, _);
+	srand(seed);
+	for (size_t j = 0; j < n; ++j) {
+		const double u = s * ((double)rand() / ((double)RAND_MAX + 1.0));
+		size_t lo = 0, hi = NKEYS - 1;
+		while (lo < hi) {
+			const size_t mid = (lo + hi) / 2;
+			if (cdf[mid] <= u)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		keys[j] = lo;
+		++cnt[lo];
+	}
+	return keys;
+}
+
+/* Check the guarantees of summary S against the exact counts */
+static void check_summary(const struct topk* S, const uint64_t* cnt)
+{
+	uint64_t total = 0;
+	for (size_t i = 0; i < NKEYS; ++i)
+		total += cnt[i];
+	always_assert(topk_total(S) == total);
+	const uint64_t min = topk_min_count(S);
+	always_assert(min <= total / topk_capacity(S));
+
+	for (uint64_t i = 0; i < NKEYS; ++i) {
+		const struct topk_counter* c = topk_find(S, i);
+		if (c == NULL) {
+			always_assert(cnt[i] <= min);
+			always_assert(cnt[i] <= total / topk_capacity(S));
+		} else {
+			always_assert(c->key == i);
+			always_assert(c->count >= cnt[i]);
+			always_assert(c->count - c->err <= cnt[i]);
+			always_assert(c->err <= min);
+		}
+	}
+
+	/* topk returns all counters in descending order */
+	struct topk_counter* out;
+	csnip_mem_Alloc(topk_capacity(S), out, _);
+	const size_t n = topk_topk(S, out, topk_capacity(S));
+	always_assert(n == topk_size(S));
+	for (size_t i = 0; i < n; ++i) {
+		always_assert(i == 0 || out[i - 1].count >= out[i].count);
+		always_assert(topk_find(S, out[i].key)->count == out[i].count);
+	}
+	if (n == topk_capacity(S))
+		always_assert(out[n - 1].count == min);
+	csnip_mem_Free(out);
+}
+
+static _Bool exact_test(void)
+{
+	printf("Exact counts with few keys\n");
+	struct topk* S = topk_make(100, NULL);
+	for (uint64_t i = 0; i < 100; ++i) {
+		for (uint64_t j = 0; j <= i; ++j)
+			topk_offer(S, NULL, i, 1);
+	}
+	always_assert(topk_size(S) == 100 && topk_min_count(S) == 1);
+	for (uint64_t i = 0; i < 100; ++i) {
+		const struct topk_counter* c = topk_find(S, i);
+		always_assert(c != NULL && c->count == i + 1 && c->err == 0);
+	}
+
+	struct topk_counter out[5];
+	always_assert(topk_topk(S, out, 5) == 5);
+	for (int i = 0; i < 5; ++i)
+		always_assert(out[i].key == 99 - (uint64_t)i);
+
+	topk_clear(S);
+	always_assert(topk_size(S) == 0 && topk_total(S) == 0);
+	always_assert(topk_find(S, 50) == NULL);
+	topk_free(S);
+	return 1;
+}
+
+static _Bool stream_test(size_t k, size_t n, uint64_t maxw)
+{
+	printf("Stream: k = %zu, n = %zu, weights up to %llu\n",
+		k, n, (unsigned long long)maxw);
+	uint64_t* cnt;
+	csnip_mem_Alloc0(NKEYS, cnt, _);
+	uint64_t* keys = make_stream(n, 1, cnt);
+
+	struct topk* S = topk_make(k, NULL);
+	for (size_t j = 0; j < n; ++j) {
+		const uint64_t w = 1 + (uint64_t)j % maxw;
+		cnt[keys[j]] += w - 1;
+		const struct topk_counter* c = topk_offer(S, NULL, keys[j], w);
+		always_assert(c->key == keys[j]);
+	}
+	check_summary(S, cnt);
+
+	/* The most frequent keys are found */
+	struct topk_counter out[10];
+	topk_topk(S, out, 10);
+	for (int i = 0; i < 10; ++i)
+		always_assert(out[i].key == (uint64_t)i);
+	printf(" min_count = %llu, total / k = %llu\n",
+		(unsigned long long)topk_min_count(S),
+		(unsigned long long)(topk_total(S) / k));
+
+	topk_free(S);
+	csnip_mem_Free(keys);
+	csnip_mem_Free(cnt);
+	return 1;
+}
+
+static _Bool merge_test(size_t k, size_t n)
+{
+	printf("Merge: k = %zu, n = %zu\n", k, n);
+	uint64_t* cnt;
+	csnip_mem_Alloc0(NKEYS, cnt, _);
+	uint64_t* keys1 = make_stream(n, 2, cnt);
+	uint64_t* keys2 = make_stream(n, 3, cnt);
+
+	struct topk* A = topk_make(k, NULL);
+	struct topk* B = topk_make(k, NULL);
+	for (size_t j = 0; j < n; ++j) {
+		topk_offer(A, NULL, keys1[j], 1);
+		topk_offer(B, NULL, keys2[j], 1);
+	}
+	topk_merge(A, NULL, B);
+	always_assert(topk_size(A) == k);
+	check_summary(A, cnt);
+
+	struct topk_counter out[10];
+	topk_topk(A, out, 10);
+	for (int i = 0; i < 10; ++i)
+		always_assert(out[i].key == (uint64_t)i);
+
+	/* Merging into an empty summary gives the same counters */
+	struct topk* E = topk_make(k, NULL);
+	topk_merge(E, NULL, A);
+	for (size_t i = 0; i < k; ++i) {
+		const struct topk_counter* c = topk_find(E, A->counter[i].key);
+		always_assert(c && c->count == A->counter[i].count
+			&& c->err == A->counter[i].err);
+	}
+
+	topk_free(A);
+	topk_free(B);
+	topk_free(E);
+	csnip_mem_Free(keys1);
+	csnip_mem_Free(keys2);
+	csnip_mem_Free(cnt);
+	return 1;
+}
+
+static _Bool param_test(void)
+{
+	printf("Parameter checks\n");
+	int err;
+	always_assert(topk_make(0, &err) == NULL);
+	always_assert(err == csnip_err_INVAL);
+	return 1;
+}
+
+int main()
+{
+#define RUN_TEST(expr) \
+	if (!(expr)) { \
+		printf("-> " #expr " failed.\n"); \
+		return 1; \
+	}
+
+	RUN_TEST(exact_test())
+	RUN_TEST(stream_test(100, 200000, 1))
+	RUN_TEST(stream_test(1000, 500000, 1))
+	RUN_TEST(stream_test(200, 200000, 7))
+	RUN_TEST(merge_test(100, 100000))
+	RUN_TEST(merge_test(500, 100000))
+	RUN_TEST(param_test())
+
+	puts("-> tests passed.");
+	return 0;
+}